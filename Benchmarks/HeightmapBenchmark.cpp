@@ -0,0 +1,2346 @@
+//CPU benchmarks for the platform independent mesh code in DirectX3DRenderer.
+//does not need d3d, so it also builds on linux, see CMakeLists.txt. returns 1 when a check of a report fails
+#include "ChunkedLod.h"
+#include "DepthFilter.h"
+#include "DepthImage.h"
+#include "FixedTimestep.h"
+#include "FramePacer.h"
+#include "FrustumCulling.h"
+#include "GeometryPool.h"
+#include "HeightmapMeshBuilder.h"
+#include "HeightmapMeshKernels.h"
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "NetpbmImage.h"
+#include "ParallelFor.h"
+#include "ProgressiveMesh.h"
+#include "RawDepthFile.h"
+#include "RedrawTracker.h"
+#include "RtinMeshBuilder.h"
+#include "SequencePipeline.h"
+#include "ShaderCache.h"
+#include "VertexCache.h"
+#include "VertexIdGrid.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+constexpr uint32_t benchmarkWidth = 1600;
+constexpr uint32_t benchmarkHeight = 1024;
+
+static std::vector<uint8_t> MakeDepthMap(uint32_t width, uint32_t height)
+{
+	std::mt19937 random(42);
+	std::vector<uint8_t> depth(static_cast<size_t>(width) * height);
+	for (uint8_t& sample : depth)
+		sample = static_cast<uint8_t>(random() % 256);
+	return depth;
+}
+
+//smooth hills on a flat floor, closer to a real depth map than noise, which no simplification can reduce.
+//scale stretches the hills, so maps of different sizes show the same landscape at different resolutions
+static std::vector<uint8_t> MakeTerrainMap(uint32_t width, uint32_t height, double scale = 1.0)
+{
+	std::vector<uint8_t> depth(static_cast<size_t>(width) * height);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			double hx = x / scale;
+			double hy = y / scale;
+			double hills = 120.0 + 70.0 * std::sin(hx / 90.0) * std::cos(hy / 70.0) + 25.0 * std::sin(hx / 23.0 + hy / 41.0);
+			depth[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>(std::clamp(hills, 100.0, 255.0));
+		}
+	}
+	return depth;
+}
+
+static int failedChecks = 0;
+
+//text of a check in a report line. a failed check is counted and makes main return 1, so a regression fails the run
+static const char* Check(bool passed, const char* passedText, const char* failedText)
+{
+	if (!passed)
+		++failedChecks;
+	return passed ? passedText : failedText;
+}
+
+template <typename TFunction>
+static double BestSeconds(int iterations, TFunction&& fn)
+{
+	double best = 1e30;
+	for (int i = 0; i < iterations; ++i)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		fn();
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (elapsed.count() < best)
+			best = elapsed.count();
+	}
+	return best;
+}
+
+static bool SameMesh(const HeightmapMesh& a, const HeightmapMesh& b)
+{
+	return a.vertices.size() == b.vertices.size()
+		&& a.indices == b.indices
+		&& std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(HeightmapVertex)) == 0;
+}
+
+static void BenchmarkKernels(const std::vector<uint8_t>& depth)
+{
+	std::printf("== row kernels, %ux%u, single thread\n", benchmarkWidth, benchmarkHeight);
+
+	HeightmapMesh reference;
+	HeightmapMeshBuilder(HeightmapOrientation::HeightAlongY, 1, SimdLevel::Scalar).Build(depth.data(), benchmarkWidth, benchmarkHeight, reference);
+
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+	for (SimdLevel level : levels)
+	{
+		const HeightmapKernels<uint8_t>& kernels = GetHeightmapKernels<uint8_t>(level);
+		if (kernels.level != level)
+		{
+			std::printf("%-8s not supported\n", SimdLevelName(level));
+			continue;
+		}
+
+		std::vector<HeightmapVertex> vertices(HeightmapMeshBuilder::VertexCount(benchmarkWidth, benchmarkHeight));
+		std::vector<uint32_t> indices(HeightmapMeshBuilder::IndexCount(benchmarkWidth, benchmarkHeight));
+
+		double vertexSeconds = BestSeconds(10, [&]()
+		{
+			for (uint32_t y = 0; y < benchmarkHeight; ++y)
+				kernels.writeVertexRow(depth.data() + y * benchmarkWidth, benchmarkWidth, benchmarkHeight, y,
+					0, benchmarkWidth, reference.maxDepth, HeightmapOrientation::HeightAlongY, vertices.data() + y * benchmarkWidth);
+		});
+		double indexSeconds = BestSeconds(10, [&]()
+		{
+			for (uint32_t y = 0; y + 1 < benchmarkHeight; ++y)
+				kernels.writeIndexRow(benchmarkWidth, y, indices.data() + static_cast<size_t>(y) * (benchmarkWidth - 1) * 6);
+		});
+
+		HeightmapMesh mesh;
+		HeightmapMeshBuilder(HeightmapOrientation::HeightAlongY, 1, level).Build(depth.data(), benchmarkWidth, benchmarkHeight, mesh);
+
+		std::printf("%-8s %8.1f Mvertices/s %8.1f Mindices/s  bit-exact: %s\n",
+			SimdLevelName(level),
+			vertices.size() / vertexSeconds / 1e6,
+			indices.size() / indexSeconds / 1e6,
+			Check(SameMesh(mesh, reference), "yes", "NO"));
+	}
+}
+
+static void BenchmarkBuilder(const std::vector<uint8_t>& depth)
+{
+	std::printf("== full build, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	HeightmapMesh mesh;
+	for (unsigned int threads : { 1u, 0u })
+	{
+		HeightmapMeshBuilder builder(HeightmapOrientation::HeightAlongY, threads);
+		double seconds = BestSeconds(10, [&]() { builder.Build(depth.data(), benchmarkWidth, benchmarkHeight, mesh); });
+		std::printf("%-8s threads=%-3s %8.2f ms %8.1f Mvertices/s\n",
+			SimdLevelName(builder.GetSimdLevel()), threads == 0 ? "all" : "1",
+			seconds * 1e3, mesh.vertices.size() / seconds / 1e6);
+	}
+}
+
+static void ReportRowBandPool()
+{
+	std::printf("== row band pool\n");
+
+	//a band that throws, on a worker and on the calling thread, reaches the caller after the other bands are done,
+	//and the pool keeps working afterwards
+	RowBandPool pool(4);
+	std::vector<uint8_t> done(64, 0);
+	int caught = 0;
+	for (unsigned int throwing : { 0u, pool.ThreadCount() - 1 })
+	{
+		std::fill(done.begin(), done.end(), 0);
+		try
+		{
+			ParallelForRowBands(pool, 64, [&](unsigned int band, uint32_t rowBegin, uint32_t rowEnd)
+			{
+				if (band == throwing)
+					throw std::runtime_error("band failed");
+				std::fill(done.begin() + rowBegin, done.begin() + rowEnd, 1);
+			});
+		}
+		catch (const std::runtime_error&)
+		{
+			++caught;
+		}
+	}
+	uint32_t rowsPerBand = 64 / pool.ThreadCount();
+	bool othersRan = std::count(done.begin(), done.end(), 1) == static_cast<std::ptrdiff_t>(64 - rowsPerBand);
+	std::fill(done.begin(), done.end(), 0);
+	ParallelForRowBands(pool, 64, [&](unsigned int, uint32_t rowBegin, uint32_t rowEnd) { std::fill(done.begin() + rowBegin, done.begin() + rowEnd, 1); });
+	bool reusable = std::count(done.begin(), done.end(), 1) == 64;
+	std::printf("%u threads: %s of 2 exceptions reach the caller (%s, %s)\n", pool.ThreadCount(), Check(caught == 2, "both", "NOT ALL"),
+		Check(othersRan, "the other bands finish", "OTHER BANDS LOST"), Check(reusable, "pool reusable", "POOL BROKEN"));
+
+	//cost of one call that does no work: waking the waiting workers against starting and joining a thread per band
+	const int calls = 2000;
+	double pooled = BestSeconds(5, [&]()
+	{
+		for (int call = 0; call < calls; ++call)
+			ParallelForRowBands(pool, 64, [](unsigned int, uint32_t, uint32_t) {});
+	});
+	double spawned = BestSeconds(5, [&]()
+	{
+		for (int call = 0; call < calls; ++call)
+		{
+			std::vector<std::thread> workers;
+			for (unsigned int band = 1; band < pool.ThreadCount(); ++band)
+				workers.emplace_back([]() {});
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+	});
+	std::printf("empty call over %u bands: pool %.2f us, thread per band %.2f us\n", pool.ThreadCount(),
+		pooled / calls * 1e6, spawned / calls * 1e6);
+}
+
+//index and vertex memory of the tiled mesh and its shared 16-bit index table against the single 32-bit mesh,
+//for the sizes in data/
+static void ReportTiling()
+{
+	std::printf("== tiled mesh with shared 16-bit index table, %u quads per tile (compile time table: %s)\n",
+		defaultHeightmapTileQuads, GridIndexTableCache::HasPrecomputedTile(defaultHeightmapTileQuads) ? "yes" : "no");
+
+	const uint32_t sizes[][2] = { { 275, 183 }, { 1600, 1024 } };
+	HeightmapMeshBuilder builder;
+	TiledHeightmapMesh mesh;
+	for (const uint32_t* size : sizes)
+	{
+		std::vector<uint8_t> depth = MakeDepthMap(size[0], size[1]);
+		TiledMeshOptions options;
+		options.topology = GridTopology::TriangleList;
+		builder.BuildTiled(depth.data(), size[0], size[1], options, mesh);
+
+		double singleIndexBytes = 4.0 * HeightmapMeshBuilder::IndexCount(size[0], size[1]);
+		double singleVertexBytes = static_cast<double>(sizeof(HeightmapVertex)) * HeightmapMeshBuilder::VertexCount(size[0], size[1]);
+		double tiledIndexBytes = 2.0 * mesh.indexTable->indices.size();
+		double tiledVertexBytes = static_cast<double>(sizeof(HeightmapVertex)) * mesh.vertices.size();
+
+		std::printf("%4ux%-4u %3zu tiles  indices %8.1f KB -> %8.1f KB (-%.1f%%)  vertices %8.1f KB -> %8.1f KB (+%.1f%%)\n",
+			size[0], size[1], mesh.tiles.size(),
+			singleIndexBytes / 1024, tiledIndexBytes / 1024, 100.0 * (1.0 - tiledIndexBytes / singleIndexBytes),
+			singleVertexBytes / 1024, tiledVertexBytes / 1024, 100.0 * (tiledVertexBytes / singleVertexBytes - 1.0));
+	}
+}
+
+//indices the gpu reads per frame and the size of the shared index table, triangle list against strips
+static void ReportTopology()
+{
+	std::printf("== list vs strip topology, %u quads per tile\n", defaultHeightmapTileQuads);
+
+	const uint32_t sizes[][2] = { { 275, 183 }, { 1600, 1024 } };
+	const GridTopology topologies[] = { GridTopology::TriangleList, GridTopology::TriangleStrip };
+	HeightmapMeshBuilder builder;
+	TiledHeightmapMesh mesh;
+	for (const uint32_t* size : sizes)
+	{
+		std::vector<uint8_t> depth = MakeDepthMap(size[0], size[1]);
+		size_t listDrawn = 0;
+		for (GridTopology topology : topologies)
+		{
+			TiledMeshOptions options;
+			options.topology = topology;
+			builder.BuildTiled(depth.data(), size[0], size[1], options, mesh);
+
+			size_t drawn = 0;
+			for (const HeightmapTile& tile : mesh.tiles)
+				drawn += tile.indexCount;
+			if (topology == GridTopology::TriangleList)
+				listDrawn = drawn;
+
+			std::printf("%4ux%-4u %-6s %9zu indices per frame (%5.2f per cell, %3.0f%% of list)  table %7.1f KB\n",
+				size[0], size[1], topology == GridTopology::TriangleList ? "list" : "strip",
+				drawn, static_cast<double>(drawn) / (static_cast<double>(size[0] - 1) * (size[1] - 1)),
+				100.0 * drawn / listDrawn, 2.0 * mesh.indexTable->indices.size() / 1024);
+		}
+	}
+}
+
+//vertex buffer size and build time of the compact format, and the largest difference between the decoded
+//compact vertices and the full ones
+static void ReportVertexFormat(std::vector<uint8_t> depth)
+{
+	std::printf("== full vs compact vertices, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	//a max depth of 255 makes every height an exact multiple of the unorm16 step, 200 does not
+	for (uint8_t& sample : depth)
+		sample = static_cast<uint8_t>(sample % 201);
+
+	HeightmapMeshBuilder builder;
+	TiledHeightmapMesh full;
+	TiledHeightmapMesh compact;
+	TiledMeshOptions options;
+	options.normalFormat = HeightmapNormalFormat::None;
+
+	options.vertexFormat = HeightmapVertexFormat::Full;
+	double fullSeconds = BestSeconds(10, [&] { builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, full); });
+	options.vertexFormat = HeightmapVertexFormat::Compact;
+	double compactSeconds = BestSeconds(10, [&] { builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, compact); });
+
+	float maxPositionError = 0.0f;
+	float maxUvError = 0.0f;
+	for (size_t i = 0; i < compact.compactVertices.size(); ++i)
+	{
+		HeightmapVertex decoded = DecodeCompactVertex(compact.compactVertices[i], benchmarkWidth, benchmarkHeight, HeightmapOrientation::HeightAlongY);
+		for (int c = 0; c < 3; ++c)
+			maxPositionError = std::max(maxPositionError, std::fabs(decoded.position[c] - full.vertices[i].position[c]));
+		for (int c = 0; c < 2; ++c)
+			maxUvError = std::max(maxUvError, std::fabs(decoded.texCoord[c] - full.vertices[i].texCoord[c]));
+	}
+
+	for (const TiledHeightmapMesh* mesh : { &full, &compact })
+	{
+		std::printf("%-8s %2zu bytes per vertex  %8.1f KB  %7.3f ms\n",
+			mesh == &full ? "full" : "compact", mesh->VertexStride(), mesh->VertexBytes() / 1024.0,
+			(mesh == &full ? fullSeconds : compactSeconds) * 1e3);
+	}
+	std::printf("round trip: max position error %.3g (unorm16 step %.3g), max uv error %.3g\n",
+		maxPositionError, 1.0 / 65535, maxUvError);
+}
+
+//angle in degrees between the normal of the tiled mesh and the one of the positions around the same sample. atan2 of
+//the cross and the dot product, acos loses everything below about 0.03 degrees to float normals of length 1 +- 1e-7
+static double NormalAngle(const float normal[3], const float reference[3])
+{
+	double cross[3] = { static_cast<double>(normal[1]) * reference[2] - static_cast<double>(normal[2]) * reference[1],
+		static_cast<double>(normal[2]) * reference[0] - static_cast<double>(normal[0]) * reference[2],
+		static_cast<double>(normal[0]) * reference[1] - static_cast<double>(normal[1]) * reference[0] };
+	double dot = static_cast<double>(normal[0]) * reference[0] + static_cast<double>(normal[1]) * reference[1]
+		+ static_cast<double>(normal[2]) * reference[2];
+	return std::atan2(std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot) * 57.29578;
+}
+
+//normals of the tiled build: every kernel set must write the same bits as the scalar one in both orientations, the
+//normals must match the cross product of the position differences, and the cost of the normal stream in build time
+//and memory for both vertex formats
+static void ReportNormals(const std::vector<uint8_t>& noise)
+{
+	std::printf("== vertex normals, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+	TiledHeightmapMesh reference[2][2];
+	TiledHeightmapMesh mesh;
+	for (SimdLevel level : levels)
+	{
+		if (GetHeightmapKernels<uint8_t>(level).level != level)
+			continue;
+
+		bool same = true;
+		for (int orientation = 0; orientation < 2; ++orientation)
+		{
+			HeightmapMeshBuilder builder(static_cast<HeightmapOrientation>(orientation), 1, level);
+			for (int format = 0; format < 2; ++format)
+			{
+				TiledMeshOptions options;
+				options.tileQuads = 61;	//odd tile edges start rows on every column alignment
+				options.normalFormat = format == 0 ? HeightmapNormalFormat::Float : HeightmapNormalFormat::Octahedral;
+				TiledHeightmapMesh& built = level == SimdLevel::Scalar ? reference[orientation][format] : mesh;
+				builder.BuildTiled(noise.data(), benchmarkWidth, benchmarkHeight, options, built);
+				same &= built.NormalBytes() == reference[orientation][format].NormalBytes()
+					&& std::memcmp(built.NormalData(), reference[orientation][format].NormalData(), built.NormalBytes()) == 0;
+			}
+		}
+		std::printf("%-8s normals bit-exact: %s\n", SimdLevelName(level), Check(same, "yes", "NO"));
+	}
+
+	std::vector<uint8_t> depth = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	HeightmapMeshBuilder builder;
+	HeightmapMesh flat;
+	builder.Build(depth.data(), benchmarkWidth, benchmarkHeight, flat);
+	TiledMeshOptions options;
+	options.normalFormat = HeightmapNormalFormat::Float;
+	TiledHeightmapMesh floatMesh;
+	builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, floatMesh);
+	options.normalFormat = HeightmapNormalFormat::Octahedral;
+	TiledHeightmapMesh octahedralMesh;
+	builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, octahedralMesh);
+
+	double maxFloatAngle = 0.0;
+	double maxOctahedralAngle = 0.0;
+	for (const HeightmapTile& tile : floatMesh.tiles)
+	{
+		for (uint32_t ly = 0; ly <= tile.quadsY; ++ly)
+		{
+			for (uint32_t lx = 0; lx <= tile.quadsX; ++lx)
+			{
+				uint32_t x = tile.x + lx;
+				uint32_t y = tile.y + ly;
+				auto position = [&](uint32_t px, uint32_t py) { return flat.vertices[static_cast<size_t>(py) * benchmarkWidth + px].position; };
+				const float* left = position(x > 0 ? x - 1 : x, y);
+				const float* right = position(x + 1 < benchmarkWidth ? x + 1 : x, y);
+				const float* up = position(x, y > 0 ? y - 1 : y);
+				const float* down = position(x, y + 1 < benchmarkHeight ? y + 1 : y);
+
+				//x tangent cross the tangent towards the previous row points up in a right handed frame
+				float alongX[3] = { right[0] - left[0], right[1] - left[1], right[2] - left[2] };
+				float alongRow[3] = { up[0] - down[0], up[1] - down[1], up[2] - down[2] };
+				float expected[3] = { alongRow[1] * alongX[2] - alongRow[2] * alongX[1], alongRow[2] * alongX[0] - alongRow[0] * alongX[2],
+					alongRow[0] * alongX[1] - alongRow[1] * alongX[0] };
+				float length = std::sqrt(expected[0] * expected[0] + expected[1] * expected[1] + expected[2] * expected[2]);
+				for (float& component : expected)
+					component /= length;
+
+				size_t vertex = tile.baseVertex + static_cast<size_t>(ly) * (tile.quadsX + 1) + lx;
+				float decoded[3];
+				DecodeOctahedralNormal(octahedralMesh.octahedralNormals[vertex], HeightmapOrientation::HeightAlongY, decoded);
+				maxFloatAngle = std::max(maxFloatAngle, NormalAngle(floatMesh.normals[vertex].normal, expected));
+				maxOctahedralAngle = std::max(maxOctahedralAngle, NormalAngle(decoded, expected));
+			}
+		}
+	}
+	std::printf("largest angle to the position differences: float %.4f deg, octahedral %.4f deg\n", maxFloatAngle, maxOctahedralAngle);
+
+	const std::pair<HeightmapVertexFormat, HeightmapNormalFormat> formats[] = {
+		{ HeightmapVertexFormat::Full, HeightmapNormalFormat::None }, { HeightmapVertexFormat::Full, HeightmapNormalFormat::Float },
+		{ HeightmapVertexFormat::Full, HeightmapNormalFormat::Octahedral }, { HeightmapVertexFormat::Compact, HeightmapNormalFormat::None },
+		{ HeightmapVertexFormat::Compact, HeightmapNormalFormat::Octahedral } };
+	const char* normalNames[] = { "none", "float", "octahedral" };
+	for (const auto& format : formats)
+	{
+		options.vertexFormat = format.first;
+		options.normalFormat = format.second;
+		double seconds = BestSeconds(10, [&] { builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, mesh); });
+		std::printf("%-8s normals %-10s %2zu bytes per vertex  %8.1f KB  %7.3f ms\n",
+			format.first == HeightmapVertexFormat::Full ? "full" : "compact", normalNames[static_cast<int>(format.second)],
+			mesh.VertexStride() + mesh.NormalStride(), (mesh.VertexBytes() + mesh.NormalBytes()) / 1024.0, seconds * 1e3);
+	}
+}
+
+//UpdateTiled after a run of edits must leave the mesh exactly as BuildTiled of the edited map, every vertex that
+//differs from before the edit must be inside the reported ranges, and a small edit must cost far less than a rebuild
+static void ReportDirtyUpdate()
+{
+	std::printf("== dirty region update, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	//one sample above the rest, so the edits can both raise and remove the max
+	std::vector<uint8_t> initial = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	for (uint8_t& sample : initial)
+		sample = std::min<uint8_t>(sample, 240);
+	initial[static_cast<size_t>(700) * benchmarkWidth + 900] = 250;
+
+	struct Edit
+	{
+		const char* name;
+		DepthRect rect;
+		uint8_t value;	//0 writes noise
+	};
+	const Edit edits[] = {
+		{ "interior", { 300, 200, 40, 30 }, 0 },
+		{ "tile corner", { 120, 120, 5, 5 }, 0 },
+		{ "first sample", { 0, 0, 1, 1 }, 0 },
+		{ "past the corner", { benchmarkWidth - 10, benchmarkHeight - 20, 40, 40 }, 0 },
+		{ "last column", { benchmarkWidth - 1, 300, 1, 200 }, 0 },
+		{ "raise max", { 800, 500, 1, 1 }, 255 },
+		{ "remove max", { 800, 500, 1, 1 }, 100 },
+		{ "remove old max", { 900, 700, 1, 1 }, 100 },
+	};
+
+	const std::pair<HeightmapVertexFormat, HeightmapNormalFormat> formats[] = {
+		{ HeightmapVertexFormat::Full, HeightmapNormalFormat::Float }, { HeightmapVertexFormat::Compact, HeightmapNormalFormat::Octahedral },
+		{ HeightmapVertexFormat::Full, HeightmapNormalFormat::None } };
+	for (const auto& format : formats)
+	{
+		TiledMeshOptions options;
+		options.tileQuads = 61;	//tile edges off the power of two columns
+		options.vertexFormat = format.first;
+		options.normalFormat = format.second;
+		HeightmapOrientation orientation = format.first == HeightmapVertexFormat::Full ? HeightmapOrientation::HeightAlongY : HeightmapOrientation::HeightAlongZ;
+		HeightmapMeshBuilder builder(orientation);
+
+		std::vector<uint8_t> depth = initial;
+		TiledHeightmapMesh mesh;
+		TiledHeightmapMesh reference;
+		TiledMeshUpdate update;
+		builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, mesh);
+
+		std::mt19937 random(7);
+		for (const Edit& edit : edits)
+		{
+			for (uint32_t y = edit.rect.y; y < std::min(edit.rect.y + edit.rect.height, benchmarkHeight); ++y)
+				for (uint32_t x = edit.rect.x; x < std::min(edit.rect.x + edit.rect.width, benchmarkWidth); ++x)
+					depth[static_cast<size_t>(y) * benchmarkWidth + x] = edit.value != 0 ? edit.value : static_cast<uint8_t>(100 + random() % 100);
+
+			std::vector<uint8_t> vertexBefore(static_cast<const uint8_t*>(mesh.VertexData()), static_cast<const uint8_t*>(mesh.VertexData()) + mesh.VertexBytes());
+			std::vector<uint8_t> normalBefore(static_cast<const uint8_t*>(mesh.NormalData()), static_cast<const uint8_t*>(mesh.NormalData()) + mesh.NormalBytes());
+			builder.UpdateTiled(depth.data(), edit.rect, mesh, update);
+			builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, reference);
+
+			bool same = mesh.maxDepth == reference.maxDepth && mesh.VertexBytes() == reference.VertexBytes()
+				&& std::memcmp(mesh.VertexData(), reference.VertexData(), mesh.VertexBytes()) == 0
+				&& std::memcmp(mesh.NormalData(), reference.NormalData(), mesh.NormalBytes()) == 0;
+			for (size_t t = 0; t < mesh.tiles.size(); ++t)
+			{
+				same &= std::memcmp(mesh.tiles[t].boundsMin, reference.tiles[t].boundsMin, sizeof(float) * 3) == 0
+					&& std::memcmp(mesh.tiles[t].boundsMax, reference.tiles[t].boundsMax, sizeof(float) * 3) == 0;
+			}
+
+			//every vertex with a changed position or normal must be uploaded
+			std::vector<bool> uploaded(mesh.VertexCount(), false);
+			size_t uploadedCount = 0;
+			for (const VertexRange& range : update.vertexRanges)
+			{
+				std::fill(uploaded.begin() + range.firstVertex, uploaded.begin() + range.firstVertex + range.vertexCount, true);
+				uploadedCount += range.vertexCount;
+			}
+			size_t changedCount = 0;
+			bool covered = true;
+			for (size_t v = 0; v < mesh.VertexCount(); ++v)
+			{
+				const uint8_t* vertexAfter = static_cast<const uint8_t*>(mesh.VertexData()) + v * mesh.VertexStride();
+				const uint8_t* normalAfter = static_cast<const uint8_t*>(mesh.NormalData()) + v * mesh.NormalStride();
+				bool changed = std::memcmp(vertexAfter, vertexBefore.data() + v * mesh.VertexStride(), mesh.VertexStride()) != 0
+					|| (mesh.NormalStride() > 0 && std::memcmp(normalAfter, normalBefore.data() + v * mesh.NormalStride(), mesh.NormalStride()) != 0);
+				changedCount += changed ? 1 : 0;
+				covered &= !changed || uploaded[v];
+			}
+
+			std::printf("%-8s normals %-10s %-15s %2zu tiles %2zu ranges %8zu uploaded %8zu changed  %s, %s\n",
+				format.first == HeightmapVertexFormat::Full ? "full" : "compact", format.second == HeightmapNormalFormat::None ? "none" :
+				format.second == HeightmapNormalFormat::Float ? "float" : "octahedral", edit.name, update.tiles.size(),
+				update.vertexRanges.size(), uploadedCount, changedCount, Check(same, "matches rebuild", "MISMATCH"),
+				Check(covered, "changes uploaded", "CHANGE NOT UPLOADED"));
+		}
+	}
+
+	//a 64 x 64 brush stroke against rebuilding everything, rewriting the same values keeps the max depth
+	TiledMeshOptions options;
+	HeightmapMeshBuilder builder;
+	std::vector<uint8_t> depth = initial;
+	TiledHeightmapMesh mesh;
+	TiledMeshUpdate update;
+	builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, mesh);
+	DepthRect stroke{ 500, 400, 64, 64 };
+	double updateSeconds = BestSeconds(50, [&] { builder.UpdateTiled(depth.data(), stroke, mesh, update); });
+	double rebuildSeconds = BestSeconds(10, [&] { builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, mesh); });
+	size_t uploadedCount = 0;
+	for (const VertexRange& range : update.vertexRanges)
+		uploadedCount += range.vertexCount;
+	std::printf("64x64 edit: update %.3f ms, %zu KB uploaded; rebuild %.3f ms, %zu KB uploaded\n", updateSeconds * 1e3,
+		uploadedCount * (mesh.VertexStride() + mesh.NormalStride()) / 1024, rebuildSeconds * 1e3, (mesh.VertexBytes() + mesh.NormalBytes()) / 1024);
+}
+
+static void ReportDepthDecode()
+{
+	std::printf("== depth decode, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	struct Layout
+	{
+		const char* name;
+		PixelLayout layout;
+		uint32_t red;	//byte of the red channel
+	};
+	const Layout layouts[] = { { "gray", PixelLayout::Gray8, 0 }, { "rgb", PixelLayout::Rgb8, 0 }, { "bgr", PixelLayout::Bgr8, 2 },
+		{ "rgba", PixelLayout::Rgba8, 0 }, { "bgra", PixelLayout::Bgra8, 2 } };
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+
+	//every level against a plain loop, on rows padded past the last pixel and widths around the vector sizes
+	std::mt19937 random(11);
+	for (const Layout& layout : layouts)
+	{
+		uint32_t bytes = PixelLayoutBytes(layout.layout);
+		bool same = true;
+		for (uint32_t width : { 1u, 15u, 17u, 18u, 31u, 33u, 1601u })
+		{
+			constexpr uint32_t height = 3;
+			size_t rowPitch = static_cast<size_t>(width) * bytes + 7;
+			std::vector<uint8_t> pixels(rowPitch * height);
+			for (uint8_t& byte : pixels)
+				byte = static_cast<uint8_t>(random());
+			std::vector<uint8_t> expected(static_cast<size_t>(width) * height);
+			for (uint32_t y = 0; y < height; ++y)
+				for (uint32_t x = 0; x < width; ++x)
+					expected[static_cast<size_t>(y) * width + x] = pixels[y * rowPitch + x * bytes + layout.red];
+
+			for (SimdLevel level : levels)
+			{
+				std::vector<uint8_t> samples(expected.size());
+				ExtractDepthChannel(pixels.data(), rowPitch, width, height, layout.layout, samples.data(), level);
+				same &= samples == expected;
+			}
+		}
+		std::printf("%-5s every level %s\n", layout.name, Check(same, "matches the red channel", "MISMATCH"));
+	}
+
+	//netpbm files through ReadNetpbmDepth
+	std::vector<uint8_t> terrain = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "heightmap_decode";
+	std::filesystem::create_directories(directory);
+	NetpbmImage gray;
+	gray.width = benchmarkWidth;
+	gray.height = benchmarkHeight;
+	gray.channels = 1;
+	gray.pixels = terrain;
+	NetpbmImage color = gray;
+	color.channels = 3;
+	color.pixels.resize(terrain.size() * 3);
+	for (size_t i = 0; i < terrain.size(); ++i)
+	{
+		color.pixels[i * 3] = terrain[i];
+		color.pixels[i * 3 + 1] = static_cast<uint8_t>(i);
+		color.pixels[i * 3 + 2] = static_cast<uint8_t>(i >> 8);
+	}
+	std::string grayPath = (directory / "depth.pgm").string();
+	std::string colorPath = (directory / "depth.ppm").string();
+	WriteNetpbm(grayPath, gray);
+	WriteNetpbm(colorPath, color);
+	DepthImage image;
+	ReadNetpbmDepth(grayPath, image);
+	bool grayRead = image.width == benchmarkWidth && image.height == benchmarkHeight && image.samples == terrain;
+	double grayReadSeconds = BestSeconds(5, [&] { ReadNetpbmDepth(grayPath, image); });
+	ReadNetpbmDepth(colorPath, image);
+	bool colorRead = image.width == benchmarkWidth && image.height == benchmarkHeight && image.samples == terrain;
+	double colorReadSeconds = BestSeconds(5, [&] { ReadNetpbmDepth(colorPath, image); });
+	std::filesystem::remove_all(directory);
+	std::printf("pgm read %s, %.2f ms; ppm read %s, %.2f ms\n", Check(grayRead, "matches", "MISMATCH"), grayReadSeconds * 1e3,
+		Check(colorRead, "matches", "MISMATCH"), colorReadSeconds * 1e3);
+
+	//extraction alone per level, and the memory of an rgba texture against the r8 one
+	std::printf("%-5s %10s %10s %10s %10s\n", "ms", "scalar", "sse2", "avx2", "avx512");
+	for (const Layout& layout : layouts)
+	{
+		uint32_t bytes = PixelLayoutBytes(layout.layout);
+		if (bytes == 1)
+			continue;
+		std::vector<uint8_t> pixels(terrain.size() * bytes, 0);
+		std::vector<uint8_t> samples(terrain.size());
+		std::printf("%-5s", layout.name);
+		for (SimdLevel level : levels)
+		{
+			double seconds = BestSeconds(10, [&] { ExtractDepthChannel(pixels.data(), static_cast<size_t>(benchmarkWidth) * bytes,
+				benchmarkWidth, benchmarkHeight, layout.layout, samples.data(), level); });
+			std::printf(" %10.3f", seconds * 1e3);
+		}
+		std::printf("\n");
+	}
+	std::printf("texture: rgba %zu KB, r8 %zu KB\n", terrain.size() * 4 / 1024, terrain.size() / 1024);
+}
+
+static void ReportDepthFilter()
+{
+	std::printf("== depth pre-filter, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	const DepthFilterKind kinds[] = { DepthFilterKind::Median3, DepthFilterKind::Median5, DepthFilterKind::Bilateral3, DepthFilterKind::Bilateral5 };
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+
+	//every level against scalar, on sizes narrower than a vector and with columns left over after the last one
+	std::vector<uint8_t> noise = MakeDepthMap(benchmarkWidth, benchmarkHeight);
+	const std::pair<uint32_t, uint32_t> sizes[] = { { 1, 1 }, { 2, 7 }, { 5, 3 }, { 31, 9 }, { 37, 19 }, { 70, 11 }, { 1601, 29 } };
+	for (DepthFilterKind kind : kinds)
+	{
+		bool same = true;
+		for (SimdLevel level : levels)
+		{
+			DepthFilter scalar(1, SimdLevel::Scalar);
+			DepthFilter filter(1, level);
+			for (const auto& size : sizes)
+			{
+				DepthFilterOptions options;
+				options.kind = kind;
+				std::vector<uint8_t> expected, actual;
+				scalar.Apply(noise.data(), size.first, size.second, options, expected);
+				filter.Apply(noise.data(), size.first, size.second, options, actual);
+				same &= expected == actual;
+			}
+		}
+		std::printf("%-10s every level %s\n", DepthFilterName(kind), Check(same, "matches scalar", "MISMATCH"));
+	}
+
+	//impulse noise on the terrain: the share of samples more than 4 away from the clean map before and after
+	std::vector<uint8_t> clean = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	std::vector<uint8_t> speckled = clean;
+	std::mt19937 random(3);
+	for (uint8_t& sample : speckled)
+		if (random() % 50 == 0)
+			sample = random() % 2 == 0 ? 0 : 255;
+	auto wrongShare = [&](const std::vector<uint8_t>& depth)
+	{
+		size_t wrong = 0;
+		for (size_t i = 0; i < depth.size(); ++i)
+			wrong += std::abs(depth[i] - clean[i]) > 4 ? 1 : 0;
+		return 100.0 * wrong / depth.size();
+	};
+	std::printf("speckled: %.2f%% samples off\n", wrongShare(speckled));
+	for (DepthFilterKind kind : kinds)
+	{
+		DepthFilterOptions options;
+		options.kind = kind;
+		std::vector<uint8_t> filtered;
+		DepthFilter().Apply(speckled.data(), benchmarkWidth, benchmarkHeight, options, filtered);
+		bool median = kind == DepthFilterKind::Median3 || kind == DepthFilterKind::Median5;
+		double share = wrongShare(filtered);
+		std::printf("%-10s %.2f%% samples off%s\n", DepthFilterName(kind), share, !median ? "" : Check(share < 0.1, ", speckles removed", ", SPECKLES NOT REMOVED"));
+	}
+
+	//time per kind and level on one thread, the best level on every thread, and how many cores the fastest level
+	//needs to stay within the budget of a sequence frame
+	const double budgetMilliseconds = 4.0;
+	std::printf("%-10s %10s %10s %10s %10s %12s %14s\n", "ms", "scalar", "sse2", "avx2", "avx512", "all threads", "cores for 4 ms");
+	for (DepthFilterKind kind : kinds)
+	{
+		DepthFilterOptions options;
+		options.kind = kind;
+		std::vector<uint8_t> filtered;
+		std::printf("%-10s", DepthFilterName(kind));
+		double bestMilliseconds = 1e30;
+		for (SimdLevel level : levels)
+		{
+			DepthFilter filter(1, level);
+			double seconds = BestSeconds(3, [&] { filter.Apply(clean.data(), benchmarkWidth, benchmarkHeight, options, filtered); });
+			bestMilliseconds = std::min(bestMilliseconds, seconds * 1e3);
+			std::printf(" %10.2f", seconds * 1e3);
+		}
+		DepthFilter filter;
+		double seconds = BestSeconds(3, [&] { filter.Apply(clean.data(), benchmarkWidth, benchmarkHeight, options, filtered); });
+		std::printf(" %12.2f %14.0f\n", seconds * 1e3, std::ceil(bestMilliseconds / budgetMilliseconds));
+	}
+}
+
+static bool SameTiledMesh(const TiledHeightmapMesh& a, const TiledHeightmapMesh& b)
+{
+	bool same = a.maxDepth == b.maxDepth && a.VertexBytes() == b.VertexBytes() && a.NormalBytes() == b.NormalBytes()
+		&& std::memcmp(a.VertexData(), b.VertexData(), a.VertexBytes()) == 0 && std::memcmp(a.NormalData(), b.NormalData(), a.NormalBytes()) == 0
+		&& a.tiles.size() == b.tiles.size();
+	for (size_t t = 0; same && t < a.tiles.size(); ++t)
+	{
+		same = std::memcmp(a.tiles[t].boundsMin, b.tiles[t].boundsMin, sizeof(float) * 3) == 0
+			&& std::memcmp(a.tiles[t].boundsMax, b.tiles[t].boundsMax, sizeof(float) * 3) == 0;
+	}
+	return same;
+}
+
+//16-bit and float maps: meshed without conversion they must give the 8-bit mesh when they hold the same values,
+//every level must match scalar on values an 8-bit map cannot hold, and the raw format must mesh in place
+static void ReportWideDepth()
+{
+	std::printf("== 16-bit and float depth, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	std::vector<uint8_t> terrain = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	std::vector<uint16_t> terrain16(terrain.begin(), terrain.end());
+	std::vector<float> terrain32(terrain.begin(), terrain.end());
+
+	//millimeters over the whole 16-bit range, and floats with fractions
+	std::mt19937 random(5);
+	std::vector<uint16_t> millimeters(terrain.size());
+	std::vector<float> meters(terrain.size());
+	for (size_t i = 0; i < terrain.size(); ++i)
+	{
+		millimeters[i] = static_cast<uint16_t>(terrain[i] * 257 - random() % 200);
+		meters[i] = terrain[i] / 64.0f + static_cast<float>(random() % 1000) / 997.0f;
+	}
+
+	const std::pair<HeightmapVertexFormat, HeightmapNormalFormat> formats[] = {
+		{ HeightmapVertexFormat::Full, HeightmapNormalFormat::Float }, { HeightmapVertexFormat::Compact, HeightmapNormalFormat::Octahedral } };
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+	for (const auto& format : formats)
+	{
+		TiledMeshOptions options;
+		options.tileQuads = 61;
+		options.vertexFormat = format.first;
+		options.normalFormat = format.second;
+		const char* name = format.first == HeightmapVertexFormat::Full ? "full, float normals" : "compact, octahedral normals";
+
+		TiledHeightmapMesh reference;
+		TiledHeightmapMesh mesh;
+		HeightmapMeshBuilder builder;
+		builder.BuildTiled(terrain.data(), benchmarkWidth, benchmarkHeight, options, reference);
+		builder.BuildTiled(terrain16.data(), benchmarkWidth, benchmarkHeight, options, mesh);
+		bool same16 = SameTiledMesh(mesh, reference);
+		builder.BuildTiled(terrain32.data(), benchmarkWidth, benchmarkHeight, options, mesh);
+		bool same32 = SameTiledMesh(mesh, reference);
+		std::printf("%-28s 8-bit values as u16 %s, as f32 %s\n", name, Check(same16, "match", "MISMATCH"), Check(same32, "match", "MISMATCH"));
+
+		TiledHeightmapMesh scalar16;
+		TiledHeightmapMesh scalar32;
+		HeightmapMeshBuilder(HeightmapOrientation::HeightAlongY, 1, SimdLevel::Scalar).BuildTiled(millimeters.data(), benchmarkWidth, benchmarkHeight, options, scalar16);
+		HeightmapMeshBuilder(HeightmapOrientation::HeightAlongY, 1, SimdLevel::Scalar).BuildTiled(meters.data(), benchmarkWidth, benchmarkHeight, options, scalar32);
+		bool levels16 = true;
+		bool levels32 = true;
+		for (SimdLevel level : levels)
+		{
+			HeightmapMeshBuilder levelBuilder(HeightmapOrientation::HeightAlongY, 0, level);
+			if (levelBuilder.GetSimdLevel() != level)
+				continue;
+			levelBuilder.BuildTiled(millimeters.data(), benchmarkWidth, benchmarkHeight, options, mesh);
+			levels16 &= SameTiledMesh(mesh, scalar16);
+			levelBuilder.BuildTiled(meters.data(), benchmarkWidth, benchmarkHeight, options, mesh);
+			levels32 &= SameTiledMesh(mesh, scalar32);
+		}
+		std::printf("%-28s every level matches scalar: millimeters %s, fractional meters %s\n", name, Check(levels16, "yes", "NO"),
+			Check(levels32, "yes", "NO"));
+	}
+
+	//the flat mesh of Build too
+	HeightmapMesh flat;
+	HeightmapMesh flat16;
+	HeightmapMeshBuilder builder;
+	builder.Build(terrain.data(), benchmarkWidth, benchmarkHeight, flat);
+	builder.Build(terrain16.data(), benchmarkWidth, benchmarkHeight, flat16);
+	bool sameFlat = SameMesh(flat, flat16) && flat.maxDepth == flat16.maxDepth;
+	builder.Build(terrain32.data(), benchmarkWidth, benchmarkHeight, flat16);
+	sameFlat &= SameMesh(flat, flat16) && flat.maxDepth == flat16.maxDepth;
+	std::printf("flat mesh from u16 and f32 %s\n", Check(sameFlat, "matches", "MISMATCH"));
+
+	//raw files are mapped, the samples are meshed where they lie in the mapping
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "heightmap_wide";
+	std::filesystem::create_directories(directory);
+	std::string path16 = (directory / "depth16.rawdepth").string();
+	std::string path32 = (directory / "depth32.rawdepth").string();
+	WriteRawDepth(path16, DepthSamples{ benchmarkWidth, benchmarkHeight, DepthSampleType::UInt16, millimeters.data() });
+	WriteRawDepth(path32, DepthSamples{ benchmarkWidth, benchmarkHeight, DepthSampleType::Float32, meters.data() });
+
+	TiledMeshOptions options;
+	TiledHeightmapMesh fromMemory;
+	TiledHeightmapMesh fromFile;
+	bool rawSame = true;
+	for (const std::string& path : { path16, path32 })
+	{
+		RawDepthFile file(path);
+		DepthSamples samples = file.Samples();
+		bool wide16 = samples.type == DepthSampleType::UInt16;
+		const void* memory = wide16 ? static_cast<const void*>(millimeters.data()) : static_cast<const void*>(meters.data());
+		rawSame &= samples.width == benchmarkWidth && samples.height == benchmarkHeight
+			&& samples.type == (path == path16 ? DepthSampleType::UInt16 : DepthSampleType::Float32)
+			&& std::memcmp(samples.data, memory, terrain.size() * DepthSampleBytes(samples.type)) == 0;
+		VisitDepthSamples(samples, [&](const auto* typed) { builder.BuildTiled(typed, benchmarkWidth, benchmarkHeight, options, fromFile); });
+		if (wide16)
+			builder.BuildTiled(millimeters.data(), benchmarkWidth, benchmarkHeight, options, fromMemory);
+		else
+			builder.BuildTiled(meters.data(), benchmarkWidth, benchmarkHeight, options, fromMemory);
+		rawSame &= SameTiledMesh(fromFile, fromMemory);
+	}
+
+	//a truncated file must be refused instead of read past the mapping
+	std::filesystem::resize_file(path16, rawDepthHeaderBytes + terrain.size() * 2 - 1);
+	bool truncatedRefused = false;
+	try
+	{
+		RawDepthFile file(path16);
+	}
+	catch (const std::runtime_error&)
+	{
+		truncatedRefused = true;
+	}
+	std::printf("raw u16 and f32 %s, truncated file %s\n", Check(rawSame, "map and mesh like the samples in memory", "MISMATCH"),
+		Check(truncatedRefused, "refused", "NOT REFUSED"));
+
+	//16-bit pgm, big endian in the file
+	NetpbmImage pgm;
+	pgm.width = benchmarkWidth;
+	pgm.height = benchmarkHeight;
+	pgm.channels = 1;
+	pgm.maxValue = 65535;
+	pgm.pixels.resize(terrain.size() * 2);
+	std::memcpy(pgm.pixels.data(), millimeters.data(), pgm.pixels.size());
+	std::string pgmPath = (directory / "depth16.pgm").string();
+	WriteNetpbm(pgmPath, pgm);
+	DepthImage image;
+	ReadNetpbmDepth(pgmPath, image);
+	bool pgmSame = image.sampleType == DepthSampleType::UInt16 && image.width == benchmarkWidth && image.height == benchmarkHeight
+		&& std::memcmp(image.samples.data(), millimeters.data(), image.samples.size()) == 0 && image.samples.size() == pgm.pixels.size();
+	bool sequenceRefused = false;
+	try
+	{
+		NetpbmImage sequenceFrame;
+		ReadNetpbm(pgmPath, sequenceFrame);
+	}
+	catch (const std::runtime_error&)
+	{
+		sequenceRefused = true;
+	}
+	std::printf("16-bit pgm %s, 8-bit readers %s it\n", Check(pgmSame, "round trips", "MISMATCH"), Check(sequenceRefused, "refuse", "DO NOT REFUSE"));
+
+	//8-bit copy for the modes that read bytes
+	std::vector<uint8_t> quantized;
+	QuantizeDepthSamples(DepthSamples{ benchmarkWidth, benchmarkHeight, DepthSampleType::UInt16, terrain16.data() }, quantized);
+	uint8_t quantizedMax = *std::max_element(quantized.begin(), quantized.end());
+	std::printf("8-bit copy of a u16 map: max %u\n", quantizedMax);
+
+	//cost of the sample type, and of getting the samples: mapping against reading the 16-bit pgm
+	TiledHeightmapMesh mesh;
+	double seconds8 = BestSeconds(5, [&] { builder.BuildTiled(terrain.data(), benchmarkWidth, benchmarkHeight, options, mesh); });
+	double seconds16 = BestSeconds(5, [&] { builder.BuildTiled(millimeters.data(), benchmarkWidth, benchmarkHeight, options, mesh); });
+	double seconds32 = BestSeconds(5, [&] { builder.BuildTiled(meters.data(), benchmarkWidth, benchmarkHeight, options, mesh); });
+	WriteRawDepth(path16, DepthSamples{ benchmarkWidth, benchmarkHeight, DepthSampleType::UInt16, millimeters.data() });
+	double mapSeconds = BestSeconds(5, [&]
+	{
+		RawDepthFile file(path16);
+		VisitDepthSamples(file.Samples(), [&](const auto* typed) { builder.BuildTiled(typed, benchmarkWidth, benchmarkHeight, options, mesh); });
+	});
+	double pgmSeconds = BestSeconds(5, [&]
+	{
+		ReadNetpbmDepth(pgmPath, image);
+		VisitDepthSamples(image.Samples(), [&](const auto* typed) { builder.BuildTiled(typed, benchmarkWidth, benchmarkHeight, options, mesh); });
+	});
+	std::filesystem::remove_all(directory);
+	std::printf("tiled build: u8 %.2f ms, u16 %.2f ms, f32 %.2f ms; map + build %.2f ms, pgm read + build %.2f ms\n",
+		seconds8 * 1e3, seconds16 * 1e3, seconds32 * 1e3, mapSeconds * 1e3, pgmSeconds * 1e3);
+}
+
+//checks the cpu emulation of MainVertexId against the flat mesh: vertex i of the non-indexed draw must be
+//mesh.vertices[mesh.indices[i]], and compares the cpu work and gpu memory of both modes
+static void ReportVertexId(std::vector<uint8_t> depth)
+{
+	std::printf("== vertex buffer free mode (SV_VertexID + depth texture), %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	//the shader rescales unorm8 instead of dividing by the max depth, a max below 255 shows the rounding difference
+	for (uint8_t& sample : depth)
+		sample = static_cast<uint8_t>(sample % 201);
+
+	HeightmapMeshBuilder builder;
+	HeightmapMesh mesh;
+	builder.Build(depth.data(), benchmarkWidth, benchmarkHeight, mesh);
+
+	uint32_t vertexCount = GridVertexIdCount(benchmarkWidth, benchmarkHeight);
+	float depthScale = VertexIdDepthScale(static_cast<uint8_t>(mesh.maxDepth));
+	size_t gridMismatches = 0;
+	float maxDepthError = 0.0f;
+	for (uint32_t id = 0; id < vertexCount; ++id)
+	{
+		HeightmapVertex emulated = EmulateVertexIdVertex(id, depth.data(), benchmarkWidth, benchmarkHeight, depthScale, HeightmapOrientation::HeightAlongY);
+		const HeightmapVertex& built = mesh.vertices[mesh.indices[id]];
+		if (emulated.position[0] != built.position[0] || emulated.position[2] != built.position[2]
+			|| std::memcmp(emulated.texCoord, built.texCoord, sizeof(built.texCoord)) != 0)
+			++gridMismatches;
+		maxDepthError = std::max(maxDepthError, std::fabs(emulated.position[1] - built.position[1]));
+	}
+
+	TiledHeightmapMesh tiled;
+	TiledMeshOptions options;
+	double buildSeconds = BestSeconds(10, [&] { builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, tiled); });
+	double reduceSeconds = BestSeconds(10, [&] { builder.ReduceMaxDepth(depth.data(), benchmarkWidth, benchmarkHeight); });
+
+	std::printf("%u vertex shader invocations per frame (the tiled mesh stores %zu vertices), grid/uv mismatches %zu, max depth error %.3g (%s)\n",
+		vertexCount, tiled.VertexCount(), gridMismatches, maxDepthError, Check(gridMismatches == 0 && maxDepthError < 1e-5f, "ok", "MISMATCH"));
+	std::printf("cpu %7.3f ms -> %7.3f ms (max depth only), vertex + index buffers %8.1f KB -> 0 KB\n",
+		buildSeconds * 1e3, reduceSeconds * 1e3, (tiled.VertexBytes() + 2.0 * tiled.indexTable->indices.size()) / 1024);
+}
+
+//triangle count and build time of the adaptive mesh against the error threshold, plus a coverage check:
+//the triangles must add up to exactly the area of the map, any hole or overlap would change the sum
+static void ReportRtin()
+{
+	std::printf("== rtin adaptive mesh, %ux%u terrain, uniform grid %zu triangles\n", benchmarkWidth, benchmarkHeight,
+		HeightmapMeshBuilder::IndexCount(benchmarkWidth, benchmarkHeight) / 3);
+
+	std::vector<uint8_t> depth = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	RtinErrorPyramid pyramid;
+	//4 threads also on machines with fewer cores, where it shows what waking the pool for the coarse levels would cost
+	for (unsigned int threads : { 1u, 4u, 0u })
+	{
+		RtinMeshBuilder builder(HeightmapOrientation::HeightAlongY, threads);
+		double seconds = BestSeconds(5, [&] { builder.BuildErrors(depth.data(), benchmarkWidth, benchmarkHeight, pyramid); });
+		std::printf("error pyramid (%u grid) %-9s %7.2f ms\n", pyramid.gridSize, threads == 1 ? "1 thread" : threads == 4 ? "4 threads" : "parallel",
+			seconds * 1e3);
+	}
+
+	RtinMeshBuilder builder;
+	HeightmapMesh mesh;
+	size_t uniformTriangles = HeightmapMeshBuilder::IndexCount(benchmarkWidth, benchmarkHeight) / 3;
+	for (float maxError : { 0.0f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f })
+	{
+		double seconds = BestSeconds(5, [&] { builder.Extract(depth.data(), pyramid, maxError, mesh); });
+
+		double area = 0.0;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			const float* a = mesh.vertices[mesh.indices[i]].position;
+			const float* b = mesh.vertices[mesh.indices[i + 1]].position;
+			const float* c = mesh.vertices[mesh.indices[i + 2]].position;
+			area += std::fabs((b[0] - a[0]) * (c[2] - a[2]) - (c[0] - a[0]) * (b[2] - a[2])) * 0.5 * benchmarkWidth * benchmarkHeight;
+		}
+
+		std::printf("max error %5.1f  %8zu triangles (%5.2f%%)  %8zu vertices  extract %7.2f ms  area %s\n",
+			maxError, mesh.indices.size() / 3, 100.0 * mesh.indices.size() / 3 / uniformTriangles, mesh.vertices.size(), seconds * 1e3,
+			Check(std::fabs(area - (benchmarkWidth - 1.0) * (benchmarkHeight - 1.0)) < 1.0, "ok", "MISMATCH"));
+	}
+}
+
+//camera of the lod reports, eye in the local space of the mesh
+static LodView MakeLodView(float eyeX, float eyeY, float eyeZ)
+{
+	//1080 pixels high with the 90 degree field of view of the application
+	return LodView{ { eyeX, eyeY, eyeZ }, 1080.0f / 2.0f, 2.0f };
+}
+
+//checks one selection: every drawn node is either full resolution or within the pixel error, neighbours differ by
+//at most one level, the triangles add up to the area of the map and no vertex lies inside another triangle's edge
+static bool CheckLodSelection(const LodTerrain& terrain, const LodSelector& selector, const std::vector<LodDraw>& draws, const LodView& view)
+{
+	bool ok = true;
+	for (const LodDraw& draw : draws)
+	{
+		const LodNode& node = terrain.nodes[draw.node];
+		ok = ok && (node.level == 0 || LodScreenError(node, view) <= view.maxPixelError);
+	}
+
+	for (uint32_t y = 0; y < terrain.levelNodesY[0]; ++y)
+	{
+		for (uint32_t x = 0; x < terrain.levelNodesX[0]; ++x)
+		{
+			int32_t level = static_cast<int32_t>(selector.LevelAt(x, y));
+			if (x + 1 < terrain.levelNodesX[0])
+				ok = ok && std::abs(static_cast<int32_t>(selector.LevelAt(x + 1, y)) - level) <= 1;
+			if (y + 1 < terrain.levelNodesY[0])
+				ok = ok && std::abs(static_cast<int32_t>(selector.LevelAt(x, y + 1)) - level) <= 1;
+		}
+	}
+
+	//back to grid coordinates, z runs from the last row to the first
+	auto gridPoint = [&](const HeightmapVertex& vertex)
+	{
+		int64_t x = std::lround(vertex.position[0] * terrain.width);
+		int64_t y = std::lround((1.0f - vertex.position[2]) * terrain.height);
+		return std::make_pair(x, y);
+	};
+
+	std::vector<std::pair<int64_t, int64_t>> corners;
+	std::unordered_set<int64_t> used;
+	for (const LodDraw& draw : draws)
+	{
+		const TileIndexRange& range = terrain.stitchRanges[draw.stitchMask];
+		for (uint32_t i = 0; i < range.indexCount; ++i)
+		{
+			corners.push_back(gridPoint(terrain.vertices[terrain.nodes[draw.node].baseVertex + terrain.indices[range.startIndex + i]]));
+			used.insert(corners.back().second * terrain.width + corners.back().first);
+		}
+	}
+
+	double area = 0.0;
+	for (size_t i = 0; i < corners.size(); i += 3)
+	{
+		auto a = corners[i];
+		auto b = corners[i + 1];
+		auto c = corners[i + 2];
+		area += std::abs(static_cast<double>((b.first - a.first) * (c.second - a.second) - (c.first - a.first) * (b.second - a.second))) * 0.5;
+
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			auto from = corners[i + edge];
+			auto to = corners[i + (edge + 1) % 3];
+			int64_t steps = std::gcd(std::abs(to.first - from.first), std::abs(to.second - from.second));
+			for (int64_t k = 1; k < steps; ++k)
+			{
+				int64_t x = from.first + (to.first - from.first) / steps * k;
+				int64_t y = from.second + (to.second - from.second) / steps * k;
+				ok = ok && used.count(y * terrain.width + x) == 0;
+			}
+		}
+	}
+	return ok && std::fabs(area - (terrain.width - 1.0) * (terrain.height - 1.0)) < 0.5;
+}
+
+//drawn triangles of the chunked lod against the map size for one camera: with the landscape fixed and only the
+//resolution growing, the selection should stay close to constant while the uniform grid grows with the samples
+static void ReportLod()
+{
+	std::printf("== chunked lod, %u quads per chunk, 1080p at 90 degrees, %.0f pixel error\n", defaultLodChunkQuads,
+		MakeLodView(0, 0, 0).maxPixelError);
+
+	{
+		std::vector<uint8_t> depth = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+		ChunkedLodBuilder builder;
+		LodTerrain terrain;
+		double seconds = BestSeconds(3, [&] { builder.Build(depth.data(), benchmarkWidth, benchmarkHeight, defaultLodChunkQuads, terrain); });
+
+		LodSelector selector;
+		int failed = 0;
+		const LodView views[] = { MakeLodView(1.5f, 1.5f, -0.5f), MakeLodView(0.5f, 0.6f, 1.3f), MakeLodView(0.2f, 0.3f, 0.8f), MakeLodView(0.5f, 0.05f, 0.5f) };
+		for (const LodView& view : views)
+			failed += CheckLodSelection(terrain, selector, selector.Select(terrain, view), view) ? 0 : 1;
+
+		std::printf("%ux%u: %u levels, %zu nodes, %zu vertices (%.2fx the map), build %7.2f ms, %zu of %zu views %s\n",
+			benchmarkWidth, benchmarkHeight, terrain.LevelCount(), terrain.nodes.size(), terrain.vertices.size(),
+			static_cast<double>(terrain.vertices.size()) / (static_cast<double>(benchmarkWidth) * benchmarkHeight), seconds * 1e3,
+			std::size(views) - failed, std::size(views), Check(failed == 0, "crack free and within the error", "FAILED"));
+	}
+
+	//the default camera of the application, (1, 1, -1) in world space
+	const LodView view = MakeLodView(1.5f, 1.5f, -0.5f);
+	for (uint32_t scale : { 1u, 2u, 4u, 8u })
+	{
+		uint32_t width = benchmarkWidth / 2 * scale;
+		uint32_t height = benchmarkHeight / 2 * scale;
+		std::vector<uint8_t> depth = MakeTerrainMap(width, height, scale / 2.0);
+
+		//the selection only needs the hierarchy, the vertices of the largest maps would not fit comfortably
+		ChunkedLodBuilder builder;
+		LodTerrain terrain;
+		double buildSeconds = BestSeconds(1, [&] { builder.BuildHierarchy(depth.data(), width, height, defaultLodChunkQuads, terrain); });
+
+		LodSelector selector;
+		const std::vector<LodDraw>* draws = nullptr;
+		double selectSeconds = BestSeconds(20, [&] { draws = &selector.Select(terrain, view); });
+
+		size_t triangles = 0;
+		for (const LodDraw& draw : *draws)
+			triangles += terrain.stitchRanges[draw.stitchMask].indexCount / 3;
+
+		std::printf("%5ux%-5u uniform %9zu triangles, lod %5zu chunks %8zu triangles (%6.2f%%), hierarchy %8.2f ms, select %6.3f ms\n",
+			width, height, HeightmapMeshBuilder::IndexCount(width, height) / 3, draws->size(), triangles,
+			100.0 * triangles / (HeightmapMeshBuilder::IndexCount(width, height) / 3), buildSeconds * 1e3, selectSeconds * 1e3);
+	}
+}
+
+//row vector matrices with the conventions of XMMatrixLookAtRH and XMMatrixPerspectiveFovRH, which need windows
+struct Matrix4
+{
+	float m[4][4];
+};
+
+static Matrix4 Multiply(const Matrix4& a, const Matrix4& b)
+{
+	Matrix4 result{};
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			for (int k = 0; k < 4; ++k)
+				result.m[i][j] += a.m[i][k] * b.m[k][j];
+	return result;
+}
+
+static Matrix4 LookAtRH(const float eye[3], const float target[3])
+{
+	auto normalize = [](float v[3])
+	{
+		float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		for (int i = 0; i < 3; ++i)
+			v[i] /= length;
+	};
+
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	float z[3] = { eye[0] - target[0], eye[1] - target[1], eye[2] - target[2] };
+	normalize(z);
+	float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+	normalize(x);
+	float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	Matrix4 view{};
+	for (int i = 0; i < 3; ++i)
+	{
+		view.m[i][0] = x[i];
+		view.m[i][1] = y[i];
+		view.m[i][2] = z[i];
+	}
+	view.m[3][0] = -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]);
+	view.m[3][1] = -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]);
+	view.m[3][2] = -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]);
+	view.m[3][3] = 1.0f;
+	return view;
+}
+
+static Matrix4 PerspectiveFovRH(float fovY, float aspect, float nearZ, float farZ)
+{
+	float h = 1.0f / std::tan(fovY * 0.5f);
+	float range = farZ / (nearZ - farZ);
+
+	Matrix4 projection{};
+	projection.m[0][0] = h / aspect;
+	projection.m[1][1] = h;
+	projection.m[2][2] = range;
+	projection.m[2][3] = -1.0f;
+	projection.m[3][2] = range * nearZ;
+	return projection;
+}
+
+//the camera of Application::Update, eye looking at the origin, with the model matrix of UpdateModelBuffer
+static Frustum MakeApplicationFrustum(const float eye[3])
+{
+	const float origin[3] = { 0.0f, 0.0f, 0.0f };
+	Matrix4 model{};
+	for (int i = 0; i < 4; ++i)
+		model.m[i][i] = 1.0f;
+	model.m[3][0] = model.m[3][1] = model.m[3][2] = -0.5f;
+
+	Matrix4 viewProjection = Multiply(LookAtRH(eye, origin), PerspectiveFovRH(90.0f * 0.0174533f, 16.0f / 9.0f, 0.1f, 100.0f));
+	return ExtractFrustum(Multiply(model, viewProjection).m);
+}
+
+//batched culling of 100k random boxes per kernel against the reference that tests all eight corners of every box,
+//then the tiles of the benchmark map that survive as the camera zooms in on the model
+static void ReportFrustumCulling()
+{
+	constexpr size_t boxCount = 100000;
+	std::printf("== frustum culling, %zu boxes\n", boxCount);
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+	std::uniform_real_distribution<float> extent(0.0f, 0.1f);
+	BoundingBoxes boxes;
+	for (size_t i = 0; i < boxCount; ++i)
+	{
+		float boundsMin[3] = { position(random), position(random), position(random) };
+		float boundsMax[3] = { boundsMin[0] + extent(random), boundsMin[1] + extent(random), boundsMin[2] + extent(random) };
+		boxes.Add(boundsMin, boundsMax);
+	}
+
+	const float eye[3] = { 1.0f, 1.0f, -1.0f };
+	Frustum frustum = MakeApplicationFrustum(eye);
+
+	//outside when all eight corners are behind one plane
+	std::vector<uint32_t> reference;
+	for (size_t box = 0; box < boxCount; ++box)
+	{
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p)
+		{
+			const float* plane = frustum.planes[p];
+			outside = true;
+			for (int corner = 0; corner < 8 && outside; ++corner)
+			{
+				float x = corner & 1 ? boxes.maxX[box] : boxes.minX[box];
+				float y = corner & 2 ? boxes.maxY[box] : boxes.minY[box];
+				float z = corner & 4 ? boxes.maxZ[box] : boxes.minZ[box];
+				outside = plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f;
+			}
+		}
+		if (!outside)
+			reference.push_back(static_cast<uint32_t>(box));
+	}
+
+	std::vector<uint32_t> visible(boxCount);
+	double scalarSeconds = 0.0;
+	for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 })
+	{
+		const FrustumCullKernels& kernels = GetFrustumCullKernels(level);
+		if (kernels.level != level)
+			continue;
+
+		uint32_t visibleCount = 0;
+		double seconds = BestSeconds(20, [&] { visibleCount = kernels.cullBoxes(frustum, boxes, visible.data()); });
+		if (level == SimdLevel::Scalar)
+			scalarSeconds = seconds;
+
+		bool same = visibleCount == reference.size() && std::equal(reference.begin(), reference.end(), visible.begin());
+		std::printf("%-8s %7.3f ms  %5.2f ns/box  %6u visible  %5.2fx  %s\n", SimdLevelName(level), seconds * 1e3,
+			seconds * 1e9 / boxCount, visibleCount, scalarSeconds / seconds, Check(same, "matches corner test", "MISMATCH"));
+	}
+
+	HeightmapMeshBuilder builder;
+	TiledHeightmapMesh mesh;
+	std::vector<uint8_t> depth = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, TiledMeshOptions{}, mesh);
+
+	BoundingBoxes tileBounds;
+	for (const HeightmapTile& tile : mesh.tiles)
+		tileBounds.Add(tile.boundsMin, tile.boundsMax);
+
+	const FrustumCullKernels& kernels = GetFrustumCullKernels(SimdLevel::AVX512);
+	std::vector<uint32_t> visibleTiles(mesh.tiles.size());
+	for (float zoom : { 0.0f, 0.8f, 1.2f, 1.5f })
+	{
+		//ZoomView moves the eye along the view direction, which runs from (1, 1, -1) to the origin
+		float scale = 1.0f - zoom / std::sqrt(3.0f);
+		const float zoomedEye[3] = { eye[0] * scale, eye[1] * scale, eye[2] * scale };
+		uint32_t visibleCount = kernels.cullBoxes(MakeApplicationFrustum(zoomedEye), tileBounds, visibleTiles.data());
+
+		size_t triangles = 0;
+		for (uint32_t i = 0; i < visibleCount; ++i)
+			triangles += mesh.tiles[visibleTiles[i]].quadsX * mesh.tiles[visibleTiles[i]].quadsY * 2;
+		std::printf("zoom %.1f: %3u of %zu tiles drawn, %8zu of %zu triangles\n", zoom, visibleCount, mesh.tiles.size(),
+			triangles, HeightmapMeshBuilder::IndexCount(benchmarkWidth, benchmarkHeight) / 3);
+	}
+}
+
+//the triangles of a list as sorted, rotation independent keys, to check that a reordering kept all of them
+static std::vector<std::array<uint32_t, 3>> CanonicalTriangles(const HeightmapMesh& mesh)
+{
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		std::array<uint32_t, 3> triangle{};
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			//by position, vertex numbers change with the fetch reordering
+			const HeightmapVertex& vertex = mesh.vertices[mesh.indices[i + corner]];
+			triangle[corner] = static_cast<uint32_t>(std::lround(vertex.position[0] * mesh.width)) * 0x10000u
+				+ static_cast<uint32_t>(std::lround((1.0f - vertex.position[2]) * mesh.height));
+		}
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+static void PrintCacheStats(const char* name, const VertexCacheStats& small, const VertexCacheStats& large)
+{
+	std::printf("%-28s acmr %5.3f / %5.3f  atvr %5.3f / %5.3f  overfetch %5.2f\n", name, small.acmr, large.acmr, small.atvr,
+		large.atvr, small.overfetch);
+}
+
+//adds up the simulation of every tile draw, the cache does not carry over from one draw to the next
+static void AddCacheStats(VertexCacheStats& total, const VertexCacheStats& tile)
+{
+	total.triangles += tile.triangles;
+	total.transformedVertices += tile.transformedVertices;
+	total.uniqueVertices += tile.uniqueVertices;
+	total.acmr = static_cast<double>(total.transformedVertices) / total.triangles;
+	total.atvr = static_cast<double>(total.transformedVertices) / total.uniqueVertices;
+	total.overfetch += tile.overfetch * tile.uniqueVertices;
+}
+
+//simulated post-transform cache of every index order the renderer can draw, for a 16 and a 32 entry fifo:
+//the original single row major mesh, the three tile topologies and the rtin mesh before and after reordering
+static void ReportVertexCache()
+{
+	std::printf("== post-transform cache, %ux%u, fifo 16 / 32 entries\n", benchmarkWidth, benchmarkHeight);
+
+	std::vector<uint8_t> depth = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	HeightmapMeshBuilder builder;
+	HeightmapMesh single;
+	builder.Build(depth.data(), benchmarkWidth, benchmarkHeight, single);
+	PrintCacheStats("single mesh, row major",
+		SimulateVertexCache(single.indices.data(), single.indices.size(), sizeof(HeightmapVertex), 16),
+		SimulateVertexCache(single.indices.data(), single.indices.size(), sizeof(HeightmapVertex), 32));
+
+	const std::pair<GridTopology, const char*> topologies[] = { { GridTopology::TriangleList, "tiles, list" },
+		{ GridTopology::TriangleStrip, "tiles, strip" }, { GridTopology::TriangleListBands, "tiles, banded list" } };
+	TiledHeightmapMesh mesh;
+	for (const auto& topology : topologies)
+	{
+		TiledMeshOptions options;
+		options.topology = topology.first;
+		builder.BuildTiled(depth.data(), benchmarkWidth, benchmarkHeight, options, mesh);
+
+		VertexCacheStats total[2];
+		for (const HeightmapTile& tile : mesh.tiles)
+		{
+			const uint16_t* indices = mesh.indexTable->indices.data() + tile.startIndex;
+			AddCacheStats(total[0], SimulateVertexCache(indices, tile.indexCount, topology.first, mesh.VertexStride(), 16));
+			AddCacheStats(total[1], SimulateVertexCache(indices, tile.indexCount, topology.first, mesh.VertexStride(), 32));
+		}
+		total[0].overfetch /= total[0].uniqueVertices;
+		PrintCacheStats(topology.second, total[0], total[1]);
+	}
+
+	RtinMeshBuilder rtinBuilder;
+	HeightmapMesh adaptive;
+	rtinBuilder.Build(depth.data(), benchmarkWidth, benchmarkHeight, 1.0f, adaptive);
+	std::vector<std::array<uint32_t, 3>> extracted = CanonicalTriangles(adaptive);
+	PrintCacheStats("rtin (max error 1), as built",
+		SimulateVertexCache(adaptive.indices.data(), adaptive.indices.size(), sizeof(HeightmapVertex), 16),
+		SimulateVertexCache(adaptive.indices.data(), adaptive.indices.size(), sizeof(HeightmapVertex), 32));
+
+	HeightmapMesh optimized = adaptive;
+	double cacheSeconds = BestSeconds(3, [&]
+	{
+		optimized.indices = adaptive.indices;
+		OptimizeVertexCache(optimized.indices.data(), optimized.indices.size(), optimized.vertices.size());
+	});
+	PrintCacheStats("rtin, vertex cache order",
+		SimulateVertexCache(optimized.indices.data(), optimized.indices.size(), sizeof(HeightmapVertex), 16),
+		SimulateVertexCache(optimized.indices.data(), optimized.indices.size(), sizeof(HeightmapVertex), 32));
+
+	double fetchSeconds = BestSeconds(1, [&] { OptimizeVertexFetch(optimized.indices, optimized.vertices); });
+	PrintCacheStats("rtin, and vertex fetch order",
+		SimulateVertexCache(optimized.indices.data(), optimized.indices.size(), sizeof(HeightmapVertex), 16),
+		SimulateVertexCache(optimized.indices.data(), optimized.indices.size(), sizeof(HeightmapVertex), 32));
+
+	std::printf("reordering %zu triangles: cache %.2f ms, fetch %.2f ms, triangles %s\n", adaptive.indices.size() / 3,
+		cacheSeconds * 1e3, fetchSeconds * 1e3, Check(CanonicalTriangles(optimized) == extracted, "unchanged", "CHANGED"));
+}
+
+//true when the triangle faces away from eye, with the normal turned to growing height like the meshlet cones
+static bool TriangleBackfacing(const HeightmapMesh& mesh, const uint32_t* corners, const float eye[3])
+{
+	const float* a = mesh.vertices[corners[0]].position;
+	const float* b = mesh.vertices[corners[1]].position;
+	const float* c = mesh.vertices[corners[2]].position;
+	float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+	float sign = normal[1] < 0.0f ? -1.0f : 1.0f;
+	return sign * (normal[0] * (a[0] - eye[0]) + normal[1] * (a[1] - eye[1]) + normal[2] * (a[2] - eye[2])) >= 0.0f;
+}
+
+//meshlets of the benchmark map: the triangles must be those of the uniform mesh, the culler must match the eight
+//corner test followed by the cone test, and every triangle of a cone culled meshlet must really face away. then the
+//rejection rates and draw counts for the default camera, zoomed in, grazing over the terrain and from below
+static void ReportMeshlets()
+{
+	std::printf("== meshlets, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	std::vector<uint8_t> depth = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	HeightmapMeshBuilder builder;
+	HeightmapMesh mesh;
+	builder.Build(depth.data(), benchmarkWidth, benchmarkHeight, mesh);
+
+	MeshletBuilder meshletBuilder;
+	MeshletMesh meshlets;
+	double buildSeconds = BestSeconds(5, [&] { meshletBuilder.Build(mesh, meshlets); });
+
+	bool withinLimits = true;
+	for (const Meshlet& meshlet : meshlets.meshlets)
+		withinLimits &= meshlet.vertexCount <= maxMeshletVertices && meshlet.triangleCount <= maxMeshletTriangles;
+
+	HeightmapMesh clustered;
+	clustered.width = mesh.width;
+	clustered.height = mesh.height;
+	clustered.vertices = mesh.vertices;
+	clustered.indices = meshlets.indices;
+	bool sameTriangles = CanonicalTriangles(clustered) == CanonicalTriangles(mesh);
+
+	//the local triangles must give the same indices as the flat list
+	bool sameLocal = true;
+	for (const Meshlet& meshlet : meshlets.meshlets)
+	{
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
+		{
+			uint32_t local = meshlets.meshletTriangles[meshlet.triangleOffset * 3 + i];
+			sameLocal &= meshlets.meshletVertices[meshlet.vertexOffset + local] == meshlets.indices[meshlet.triangleOffset * 3 + i];
+		}
+	}
+
+	std::printf("%zu meshlets, built in %.2f ms, %s, triangles %s, local indices %s\n", meshlets.meshlets.size(), buildSeconds * 1e3,
+		Check(withinLimits, "within 64 / 124", "OVER LIMITS"), Check(sameTriangles, "unchanged", "CHANGED"), Check(sameLocal, "match", "MISMATCH"));
+
+	MeshletCuller culler;
+	culler.SetMeshlets(meshlets);
+	const std::pair<const char*, std::array<float, 3>> cameras[] = { { "default", { 1.0f, 1.0f, -1.0f } },
+		{ "zoom 1.2", { 0.307f, 0.307f, -0.307f } }, { "grazing", { 0.9f, 0.08f, -0.9f } }, { "below", { 0.3f, -1.0f, -0.3f } } };
+	for (const auto& camera : cameras)
+	{
+		Frustum frustum = MakeApplicationFrustum(camera.second.data());
+		//world = local - 0.5, as in MakeApplicationFrustum
+		const float eye[3] = { camera.second[0] + 0.5f, camera.second[1] + 0.5f, camera.second[2] + 0.5f };
+		const std::vector<MeshletDraw>& draws = culler.Cull(meshlets, frustum, eye);
+		MeshletCullStats stats = culler.Stats();
+
+		std::vector<bool> drawn(meshlets.meshlets.size(), false);
+		size_t drawnTriangles = 0;
+		for (const MeshletDraw& draw : draws)
+		{
+			drawnTriangles += draw.indexCount / 3;
+			for (size_t m = 0; m < meshlets.meshlets.size(); ++m)
+			{
+				uint32_t start = meshlets.meshlets[m].triangleOffset * 3;
+				drawn[m] = drawn[m] || (start >= draw.startIndex && start < draw.startIndex + draw.indexCount);
+			}
+		}
+
+		bool matches = drawnTriangles == stats.triangles;
+		bool conservative = true;
+		for (size_t m = 0; m < meshlets.meshlets.size(); ++m)
+		{
+			const Meshlet& meshlet = meshlets.meshlets[m];
+			bool outside = false;
+			for (int p = 0; p < 6 && !outside; ++p)
+			{
+				const float* plane = frustum.planes[p];
+				outside = true;
+				for (int corner = 0; corner < 8 && outside; ++corner)
+				{
+					float x = corner & 1 ? meshlet.boundsMax[0] : meshlet.boundsMin[0];
+					float y = corner & 2 ? meshlet.boundsMax[1] : meshlet.boundsMin[1];
+					float z = corner & 4 ? meshlet.boundsMax[2] : meshlet.boundsMin[2];
+					outside = plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f;
+				}
+			}
+			bool coneCulled = !outside && MeshletConeCulled(meshlet, eye);
+			matches &= drawn[m] == (!outside && !coneCulled);
+
+			for (uint32_t t = 0; coneCulled && t < meshlet.triangleCount; ++t)
+				conservative &= TriangleBackfacing(mesh, meshlets.indices.data() + (meshlet.triangleOffset + t) * 3, eye);
+		}
+
+		double cullSeconds = BestSeconds(50, [&] { culler.Cull(meshlets, frustum, eye); });
+		std::printf("%-8s %5.1f%% frustum, %5.1f%% cone, %5u of %u drawn in %4u draws, %8zu triangles, cull %.3f ms, %s, %s\n",
+			camera.first, 100.0 * stats.frustumCulled / stats.meshlets, 100.0 * stats.coneCulled / stats.meshlets, stats.visible,
+			stats.meshlets, stats.draws, stats.triangles, cullSeconds * 1e3, Check(matches, "matches reference", "MISMATCH"),
+			Check(conservative, "cones conservative", "CONE CULLED A FRONT FACE"));
+	}
+}
+
+//the rings and the triple buffer under two threads, then a generated sequence through the whole pipeline: every
+//frame must be uploaded once, every frame the display takes must hold the mesh BuildTiled makes of its file, and
+//what the display skipped must be counted as dropped
+static void ReportSequencePipeline()
+{
+	std::printf("== rgb-d sequence pipeline\n");
+
+	constexpr uint32_t itemCount = 1000000;
+	SpscRing<uint32_t> ring(64);
+	bool ordered = true;
+	std::thread consumer([&]
+	{
+		uint32_t expected = 0;
+		uint32_t item = 0;
+		while (expected < itemCount)
+		{
+			if (ring.TryPop(item))
+				ordered &= item == expected++;
+			else
+				std::this_thread::yield();
+		}
+	});
+	auto ringStart = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < itemCount;)
+	{
+		if (ring.TryPush(i))
+			++i;
+		else
+			std::this_thread::yield();
+	}
+	consumer.join();
+	std::chrono::duration<double> ringSeconds = std::chrono::high_resolution_clock::now() - ringStart;
+	std::printf("spsc ring: %u items in order: %s, %.1f Mitems/s\n", itemCount, Check(ordered, "yes", "NO"), itemCount / ringSeconds.count() / 1e6);
+
+	//the writer stamps its slot, the reader must only ever see newer stamps
+	TripleBufferSlots slots;
+	std::atomic<uint32_t> stamps[3] = {};
+	std::atomic<bool> writing{ true };
+	uint32_t published = 0;
+	uint32_t replaced = 0;
+	std::thread writer([&]
+	{
+		for (uint32_t stamp = 1; stamp <= itemCount / 10; ++stamp)
+		{
+			stamps[slots.BackSlot()].store(stamp, std::memory_order_relaxed);
+			replaced += slots.Publish() ? 1 : 0;
+			++published;
+			std::this_thread::yield();
+		}
+		writing = false;
+	});
+	uint32_t taken = 0;
+	uint32_t lastStamp = 0;
+	bool newer = true;
+	while (true)
+	{
+		bool written = !writing;
+		if (!slots.Acquire())
+		{
+			if (written)
+				break;
+			std::this_thread::yield();
+			continue;
+		}
+		uint32_t stamp = stamps[slots.FrontSlot()].load(std::memory_order_relaxed);
+		newer &= stamp > lastStamp;
+		lastStamp = stamp;
+		++taken;
+	}
+	writer.join();
+	std::printf("triple buffer: %u published, %u taken, %u dropped, newest taken: %s, accounted: %s\n", published, taken, replaced,
+		Check(newer && lastStamp == published, "yes", "NO"), Check(taken + replaced == published, "yes", "NO"));
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "heightmap_sequence";
+	std::filesystem::create_directories(directory);
+	constexpr uint32_t frameCount = 24;
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		//hills of another size in every frame
+		NetpbmImage depth;
+		depth.width = 320;
+		depth.height = 240;
+		depth.channels = 1;
+		depth.pixels = MakeTerrainMap(depth.width, depth.height, 0.3 + frame * 0.05);
+		NetpbmImage color = depth;
+		color.channels = 3;
+		color.pixels.assign(depth.pixels.size() * 3, static_cast<uint8_t>(frame));
+		WriteNetpbm(SequenceFramePath(directory.string(), "depth", frame), depth);
+		WriteNetpbm(SequenceFramePath(directory.string(), "rgb", frame), color);
+	}
+
+	for (float framesPerSecond : { 0.0f, 120.0f })
+	{
+		SequencePipelineOptions options;
+		options.framesPerSecond = framesPerSecond;
+		MemorySequenceUploader uploader;
+		SequencePipeline pipeline(options, uploader);
+		pipeline.Start(directory.string());
+
+		HeightmapMeshBuilder builder;
+		TiledHeightmapMesh expected;
+		NetpbmImage depth;
+		bool matches = true;
+		bool increasing = true;
+		int64_t lastFrame = -1;
+		uint32_t slot = 0;
+		while (true)
+		{
+			bool finished = pipeline.Finished();
+			if (pipeline.AcquireLatest(slot))
+			{
+				const MemorySequenceUploader::Slot& shown = uploader.GetSlot(slot);
+				ReadNetpbm(SequenceFramePath(directory.string(), "depth", shown.frameIndex), depth);
+				builder.BuildTiled(depth.pixels.data(), depth.width, depth.height, options.mesh, expected);
+				matches &= shown.vertices.size() == expected.VertexBytes()
+					&& std::memcmp(shown.vertices.data(), expected.VertexData(), expected.VertexBytes()) == 0
+					&& shown.normals.size() == expected.NormalBytes()
+					&& std::memcmp(shown.normals.data(), expected.NormalData(), expected.NormalBytes()) == 0
+					&& shown.color.size() == static_cast<size_t>(depth.width) * depth.height * 4 && shown.color[0] == shown.frameIndex;
+				increasing &= static_cast<int64_t>(shown.frameIndex) > lastFrame;
+				lastFrame = shown.frameIndex;
+			}
+			if (finished)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(16));
+		}
+
+		SequenceStats stats = pipeline.Stats();
+		std::printf("fps %-4s %u frames uploaded: %s, shown frames match BuildTiled: %s, in order: %s, last shown: %s, %llu shown + %llu dropped\n",
+			framesPerSecond == 0.0f ? "max" : "120", frameCount, Check(stats.upload.frames == frameCount, "yes", "NO"), Check(matches, "yes", "NO"),
+			Check(increasing, "yes", "NO"), Check(lastFrame == frameCount - 1, "yes", "NO"), static_cast<unsigned long long>(stats.presented),
+			static_cast<unsigned long long>(stats.dropped));
+		std::printf("%s", FormatSequenceStats(stats).c_str());
+	}
+
+	//a missing file stops the decoder with a message, the frames before it still come through
+	std::filesystem::remove(SequenceFramePath(directory.string(), "rgb", 5));
+	MemorySequenceUploader uploader;
+	SequencePipeline pipeline(SequencePipelineOptions{}, uploader);
+	pipeline.Start(directory.string());
+	while (!pipeline.Finished())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::printf("missing frame: %llu frames uploaded, error reported: %s\n", static_cast<unsigned long long>(pipeline.Stats().upload.frames),
+		Check(!pipeline.Error().empty(), "yes", "NO"));
+	std::filesystem::remove_all(directory);
+}
+
+//startup of mesh and rtin mode with the mesh cache against decoding and building, the upload is stood in for by copying
+//the buffers once, which also faults in the pages of a mapped entry
+static void ReportMeshCache()
+{
+	std::printf("== mesh cache, %ux%u pgm\n", benchmarkWidth, benchmarkHeight);
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "heightmap_mesh_cache";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	std::string depthPath = (directory / "depth.pgm").string();
+	NetpbmImage pgm;
+	pgm.width = benchmarkWidth;
+	pgm.height = benchmarkHeight;
+	pgm.channels = 1;
+	pgm.pixels = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	WriteNetpbm(depthPath, pgm);
+
+	MeshCache cache((directory / "entries").string());
+	TiledMeshOptions options;
+	options.normalFormat = HeightmapNormalFormat::Octahedral;
+	const uint64_t tiledSettings = HashBytes("tiled", 5);
+	const uint64_t rtinSettings = HashBytes("rtin", 4);
+	auto fileKey = [&](uint64_t settings)
+	{
+		MappedFile file(depthPath);
+		return HashBytes(file.Data(), file.Size(), settings);
+	};
+
+	std::vector<uint8_t> uploaded;
+	auto upload = [&](const void* data, size_t bytes)
+	{
+		uploaded.resize(bytes);
+		std::memcpy(uploaded.data(), data, bytes);
+	};
+
+	//what LoadAndPrepareRenderResource does without the cache
+	HeightmapMeshBuilder builder;
+	RtinMeshBuilder rtinBuilder;
+	DepthImage image;
+	TiledHeightmapMesh built;
+	HeightmapMesh adaptive;
+	auto buildTiled = [&]
+	{
+		ReadNetpbmDepth(depthPath, image);
+		builder.BuildTiled(image.samples.data(), image.width, image.height, options, built);
+		upload(built.VertexData(), built.VertexBytes());
+		upload(built.NormalData(), built.NormalBytes());
+	};
+	auto buildAdaptive = [&]
+	{
+		ReadNetpbmDepth(depthPath, image);
+		rtinBuilder.Build(image.samples.data(), image.width, image.height, 1.0f, adaptive);
+		OptimizeVertexCache(adaptive.indices.data(), adaptive.indices.size(), adaptive.vertices.size());
+		OptimizeVertexFetch(adaptive.indices, adaptive.vertices);
+		upload(adaptive.vertices.data(), adaptive.vertices.size() * sizeof(HeightmapVertex));
+		upload(adaptive.indices.data(), adaptive.indices.size() * sizeof(uint32_t));
+	};
+
+	//the first run misses and stores, the second one maps
+	MeshCacheEntry entry;
+	bool missed = !cache.Load(fileKey(tiledSettings), entry) && !cache.Load(fileKey(rtinSettings), entry);
+	buildTiled();
+	MeshCacheWriter tiledWriter;
+	AddTiledMesh(built, tiledWriter);
+	cache.Store(fileKey(tiledSettings), tiledWriter);
+	buildAdaptive();
+	MeshCacheWriter rtinWriter;
+	AddAdaptiveMesh(adaptive, rtinWriter);
+	cache.Store(fileKey(rtinSettings), rtinWriter);
+
+	TiledHeightmapMesh cached;
+	const MeshBlock* vertices = nullptr;
+	const MeshBlock* normals = nullptr;
+	bool tiledSame = cache.Load(fileKey(tiledSettings), entry) && ReadTiledMesh(entry, cached, vertices, normals)
+		&& cached.width == built.width && cached.height == built.height && cached.maxDepth == built.maxDepth
+		&& cached.vertexFormat == built.vertexFormat && cached.normalFormat == built.normalFormat && cached.indexTable == built.indexTable
+		&& cached.tiles.size() == built.tiles.size()
+		&& std::memcmp(cached.tiles.data(), built.tiles.data(), built.tiles.size() * sizeof(HeightmapTile)) == 0
+		&& vertices->bytes == built.VertexBytes() && std::memcmp(vertices->data, built.VertexData(), vertices->bytes) == 0
+		&& normals != nullptr && normals->bytes == built.NormalBytes() && std::memcmp(normals->data, built.NormalData(), normals->bytes) == 0
+		&& reinterpret_cast<uintptr_t>(vertices->data) % meshCachePageBytes == 0;
+	size_t tiledEntryBytes = entry.Bytes();
+
+	HeightmapMesh cachedAdaptive;
+	const MeshBlock* indices = nullptr;
+	bool adaptiveSame = cache.Load(fileKey(rtinSettings), entry) && ReadAdaptiveMesh(entry, cachedAdaptive, vertices, indices)
+		&& indices->encoding == MeshBlockEncoding::Index16 && indices->bytes == adaptive.indices.size() * sizeof(uint16_t)
+		&& vertices->bytes == adaptive.vertices.size() * sizeof(HeightmapVertex)
+		&& std::memcmp(vertices->data, adaptive.vertices.data(), vertices->bytes) == 0;
+	for (size_t i = 0; adaptiveSame && i < adaptive.indices.size(); ++i)
+		adaptiveSame = static_cast<const uint16_t*>(indices->data)[i] == adaptive.indices[i];
+	std::printf("first run %s; tiled entry %s, %zu KB; rtin entry %s, indices %zu KB instead of %zu KB\n", Check(missed, "misses", "DID NOT MISS"),
+		Check(tiledSame, "matches the built mesh", "MISMATCH"), tiledEntryBytes / 1024, Check(adaptiveSame, "matches the built mesh", "MISMATCH"),
+		adaptive.indices.size() * sizeof(uint16_t) / 1024, adaptive.indices.size() * sizeof(uint32_t) / 1024);
+
+	//a single changed sample or other settings must miss, a damaged entry must be refused
+	uint64_t tiledKey = fileKey(tiledSettings);
+	pgm.pixels[pgm.pixels.size() / 2] ^= 1;
+	WriteNetpbm(depthPath, pgm);
+	bool editMisses = !cache.Load(fileKey(tiledSettings), entry);
+	pgm.pixels[pgm.pixels.size() / 2] ^= 1;
+	WriteNetpbm(depthPath, pgm);
+	bool settingsMiss = !cache.Load(fileKey(HashBytes("tiled", 5, 1)), entry);
+	std::filesystem::resize_file(cache.EntryPath(tiledKey), std::filesystem::file_size(cache.EntryPath(tiledKey)) - 1);
+	bool damagedRefused = !cache.Load(tiledKey, entry);
+	std::printf("edited map %s, other settings %s, truncated entry %s\n", Check(editMisses, "misses", "DOES NOT MISS"),
+		Check(settingsMiss, "miss", "DO NOT MISS"), Check(damagedRefused, "refused", "NOT REFUSED"));
+	cache.Store(tiledKey, tiledWriter);
+
+	//startup without and with the cache, the pgm read stands in for the jpeg decode, which costs more
+	double tiledBuildSeconds = BestSeconds(5, buildTiled);
+	double tiledCachedSeconds = BestSeconds(5, [&]
+	{
+		MeshCacheEntry hit;
+		if (cache.Load(fileKey(tiledSettings), hit) && ReadTiledMesh(hit, cached, vertices, normals))
+		{
+			upload(vertices->data, vertices->bytes);
+			upload(normals->data, normals->bytes);
+		}
+	});
+	double adaptiveBuildSeconds = BestSeconds(3, buildAdaptive);
+	double adaptiveCachedSeconds = BestSeconds(5, [&]
+	{
+		MeshCacheEntry hit;
+		if (cache.Load(fileKey(rtinSettings), hit) && ReadAdaptiveMesh(hit, cachedAdaptive, vertices, indices))
+		{
+			upload(vertices->data, vertices->bytes);
+			upload(indices->data, indices->bytes);
+		}
+	});
+	MappedFile depthFile(depthPath);
+	double hashSeconds = BestSeconds(10, [&] { tiledKey = HashBytes(depthFile.Data(), depthFile.Size()); });
+	std::printf("tiled: decode + build %.2f ms, cached %.2f ms (%.1fx); rtin: decode + build %.2f ms, cached %.2f ms (%.1fx); hash %.1f GB/s\n",
+		tiledBuildSeconds * 1e3, tiledCachedSeconds * 1e3, tiledBuildSeconds / tiledCachedSeconds, adaptiveBuildSeconds * 1e3,
+		adaptiveCachedSeconds * 1e3, adaptiveBuildSeconds / adaptiveCachedSeconds, depthFile.Size() / hashSeconds * 1e-9);
+	std::filesystem::remove_all(directory);
+}
+
+//time to the preview against the full build of mesh mode, and how often a render thread that polls the worker gets
+//to run while the full mesh is built
+static void ReportProgressiveLoad()
+{
+	std::printf("== progressive load, %ux%u\n", benchmarkWidth, benchmarkHeight);
+
+	//odd sizes, so the last preview row and column come from a partial step
+	const uint32_t oddWidth = benchmarkWidth + 3;
+	const uint32_t oddHeight = benchmarkHeight - 5;
+	std::vector<uint8_t> odd = MakeTerrainMap(oddWidth, oddHeight);
+	std::vector<uint16_t> odd16(odd.begin(), odd.end());
+	std::vector<float> odd32(odd.begin(), odd.end());
+	bool decimated = true;
+	for (const DepthSamples& samples : { DepthSamples{ oddWidth, oddHeight, DepthSampleType::UInt8, odd.data() },
+		DepthSamples{ oddWidth, oddHeight, DepthSampleType::UInt16, odd16.data() }, DepthSamples{ oddWidth, oddHeight, DepthSampleType::Float32, odd32.data() } })
+	{
+		DepthImage preview;
+		DecimateDepthSamples(samples, defaultPreviewStep, preview);
+		decimated &= preview.width == (oddWidth + 7) / 8 && preview.height == (oddHeight + 7) / 8 && preview.sampleType == samples.type;
+		VisitDepthSamples(preview.Samples(), [&](const auto* data)
+		{
+			for (uint32_t y = 0; decimated && y < preview.height; ++y)
+				for (uint32_t x = 0; x < preview.width; ++x)
+					decimated &= data[static_cast<size_t>(y) * preview.width + x] == odd[static_cast<size_t>(y) * 8 * oddWidth + x * 8];
+		});
+	}
+	std::printf("every 8th sample of every 8th row of a %ux%u map in u8, u16 and f32: %s\n", oddWidth, oddHeight, Check(decimated, "match", "MISMATCH"));
+
+	std::vector<uint8_t> terrain = MakeTerrainMap(benchmarkWidth, benchmarkHeight);
+	DepthSamples samples{ benchmarkWidth, benchmarkHeight, DepthSampleType::UInt8, terrain.data() };
+	TiledMeshOptions options;
+	HeightmapMeshBuilder builder;
+	TiledHeightmapMesh reference;
+	builder.BuildTiled(terrain.data(), benchmarkWidth, benchmarkHeight, options, reference);
+
+	//the upload is stood in for by a copy of the buffers
+	std::vector<uint8_t> uploaded;
+	auto upload = [&](const TiledHeightmapMesh& mesh)
+	{
+		uploaded.assign(static_cast<const uint8_t*>(mesh.VertexData()), static_cast<const uint8_t*>(mesh.VertexData()) + mesh.VertexBytes());
+		uploaded.insert(uploaded.end(), static_cast<const uint8_t*>(mesh.NormalData()), static_cast<const uint8_t*>(mesh.NormalData()) + mesh.NormalBytes());
+	};
+	DepthImage preview;
+	TiledHeightmapMesh previewMesh;
+	for (uint32_t step : { 4u, 8u, 16u })
+	{
+		double previewSeconds = BestSeconds(10, [&]
+		{
+			DecimateDepthSamples(samples, step, preview);
+			builder.BuildTiled(preview.samples.data(), preview.width, preview.height, options, previewMesh);
+			upload(previewMesh);
+		});
+		std::printf("preview of every %2uth sample: %ux%u, %6.2f ms to build and upload, %zu KB\n", step, preview.width, preview.height,
+			previewSeconds * 1e3, (previewMesh.VertexBytes() + previewMesh.NormalBytes()) / 1024);
+	}
+	TiledHeightmapMesh full;
+	double fullSeconds = BestSeconds(5, [&]
+	{
+		builder.BuildTiled(terrain.data(), benchmarkWidth, benchmarkHeight, options, full);
+		upload(full);
+	});
+	std::printf("full mesh: %6.2f ms to build and upload, %zu KB\n", fullSeconds * 1e3, (full.VertexBytes() + full.NormalBytes()) / 1024);
+
+	//a render thread polling at 1 ms keeps running while the worker builds, and gets the same mesh a direct build makes
+	BackgroundMeshBuild background;
+	TiledHeightmapMesh taken;
+	std::string error;
+	bool idle = !background.TryTake(taken, error);
+	background.Start([&](TiledHeightmapMesh& mesh)
+	{
+		builder.BuildTiled(terrain.data(), benchmarkWidth, benchmarkHeight, options, mesh);
+		upload(mesh);
+	});
+	auto start = std::chrono::steady_clock::now();
+	uint32_t polls = 0;
+	while (!background.TryTake(taken, error))
+	{
+		++polls;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	double takenSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	bool same = error.empty() && SameTiledMesh(taken, reference) && !background.Running();
+
+	//a job that throws hands out its error and leaves the mesh alone
+	background.Start([](TiledHeightmapMesh&) { throw std::runtime_error("out of memory"); });
+	background.Wait();
+	bool failed = background.TryTake(taken, error) && error == "out of memory" && SameTiledMesh(taken, reference);
+	std::printf("worker: %s before start, full mesh after %.2f ms with %u polls of the render thread, %s; failing job %s\n",
+		Check(idle, "nothing", "SOMETHING"), takenSeconds * 1e3, polls, Check(same, "matches a direct build", "MISMATCH"),
+		Check(failed, "reports its error", "DOES NOT REPORT"));
+}
+
+//stands in for d3dcompiler: the bytecode is the request and the source text, and a source containing "error" fails
+class FakeShaderCompiler : public ShaderCompiler
+{
+public:
+	uint64_t version = 1;
+	uint32_t compiles = 0;
+
+	uint64_t Version() const override
+	{
+		return version;
+	}
+
+	bool Compile(const ShaderCompileRequest& request, ShaderBytecode& bytecode, std::string& error) override
+	{
+		++compiles;
+		std::ifstream file(request.path, std::ios::binary);
+		std::string text = request.entryPoint + "|" + request.profile + "|" + std::to_string(request.flags) + "|"
+			+ std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		if (text.find("error") != std::string::npos)
+		{
+			error = request.path + "(1,1): error X3000: syntax error";
+			return false;
+		}
+		bytecode.assign(text.begin(), text.end());
+		return true;
+	}
+};
+
+//hits, misses and invalidation of the shader cache with a fake compiler, and the cost of a hit on the real shaders
+static void ReportShaderCache()
+{
+	std::printf("== shader cache\n");
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "heightmap_shader_cache";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory / "include");
+	auto writeText = [](const std::filesystem::path& path, const std::string& text) { std::ofstream(path, std::ios::binary) << text; };
+	writeText(directory / "Main.vs.hlsl", "#include \"include/Common.hlsli\"\nfloat4 Main() : SV_Position { return Offset(); }\n");
+	writeText(directory / "include" / "Common.hlsli", "#pragma once\n  #  include \"Constants.hlsli\"\nfloat4 Offset() { return scale; }\n");
+	writeText(directory / "include" / "Constants.hlsli", "static const float4 scale = 1;\n");
+	std::string entries = (directory / "entries").string();
+
+	FakeShaderCompiler compiler;
+	ShaderCompileRequest request{ (directory / "Main.vs.hlsl").string(), "Main", "vs_5_0", 2048 };
+	ShaderBytecode compiled;
+	ShaderBytecode bytecode;
+	std::string error;
+
+	//a miss compiles and stores, a new cache of the same directory reads the entry back
+	bool missed = ShaderCache(compiler, entries).Load(request, compiled, error) && compiler.compiles == 1;
+	ShaderCache cache(compiler, entries);
+	bool hit = cache.Load(request, bytecode, error) && bytecode == compiled && compiler.compiles == 1 && cache.Stats().disk == 1;
+
+	//everything in the key has to miss once
+	uint64_t key = 0;
+	cache.Key(request, key);
+	auto misses = [&](const ShaderCompileRequest& changed)
+	{
+		uint32_t compiles = compiler.compiles;
+		ShaderBytecode changedBytecode;
+		return ShaderCache(compiler, entries).Load(changed, changedBytecode, error) && compiler.compiles == compiles + 1;
+	};
+	ShaderCompileRequest otherEntry = request;
+	otherEntry.entryPoint = "MainLit";
+	ShaderCompileRequest otherProfile = request;
+	otherProfile.profile = "vs_5_1";
+	ShaderCompileRequest otherFlags = request;
+	otherFlags.flags = 0;
+	bool keysMiss = misses(otherEntry) && misses(otherProfile) && misses(otherFlags);
+	compiler.version = 2;
+	keysMiss &= misses(request);
+	compiler.version = 1;
+	writeText(directory / "include" / "Constants.hlsli", "static const float4 scale = 2;\n");
+	bool includeMisses = misses(request);
+	writeText(directory / "include" / "Constants.hlsli", "static const float4 scale = 1;\n");
+	std::printf("miss %s, entry %s, other entry point, profile, flags or compiler %s, edited nested include %s\n",
+		Check(missed, "compiles", "DOES NOT COMPILE"), Check(hit, "read back without compiling", "NOT READ BACK"),
+		Check(keysMiss, "miss", "DO NOT MISS"), Check(includeMisses, "misses", "DOES NOT MISS"));
+
+	//a damaged entry is compiled again and replaced, a failing compile reports the compiler's message
+	std::filesystem::resize_file(cache.EntryPath(key), std::filesystem::file_size(cache.EntryPath(key)) - 1);
+	uint32_t compiles = compiler.compiles;
+	bool repaired = ShaderCache(compiler, entries).Load(request, bytecode, error) && bytecode == compiled && compiler.compiles == compiles + 1
+		&& ShaderCache(compiler, entries).Load(request, bytecode, error) && compiler.compiles == compiles + 1;
+	writeText(directory / "Broken.hlsl", "float4 Main() { error }\n");
+	ShaderCompileRequest broken{ (directory / "Broken.hlsl").string(), "Main", "ps_5_0", 0 };
+	ShaderCache failing(compiler, entries);
+	error.clear();
+	bool reported = !failing.Load(broken, bytecode, error) && error.find("X3000") != std::string::npos && failing.Stats().failed == 1;
+	ShaderCompileRequest missing{ (directory / "Missing.hlsl").string(), "Main", "ps_5_0", 0 };
+	bool missingReported = !failing.Load(missing, bytecode, error) && failing.Stats().failed == 2;
+	std::printf("truncated entry %s, compile error %s, missing source %s\n", Check(repaired, "compiled again and replaced", "NOT REPLACED"),
+		Check(reported, "reported", "NOT REPORTED"), Check(missingReported, "reported", "NOT REPORTED"));
+
+	//includes the key cannot follow, a system header and a file that only a disabled branch or a comment names, leave
+	//the key unknown. the source is compiled on every load and no entry is written
+	writeText(directory / "Unresolved.hlsl", "#include <d3d_system.hlsli>\n#if 0\n#include \"Removed.hlsli\"\n#endif\n"
+		"//#include \"Commented.hlsli\"\nfloat4 Main() : SV_Position { return 0; }\n");
+	ShaderCompileRequest unresolved{ (directory / "Unresolved.hlsl").string(), "Main", "vs_5_0", 0 };
+	size_t entryCount = std::distance(std::filesystem::directory_iterator(entries), std::filesystem::directory_iterator());
+	compiles = compiler.compiles;
+	ShaderCache uncachedCache(compiler, entries);
+	bool uncachedCompiled = uncachedCache.Load(unresolved, bytecode, error) && uncachedCache.Load(unresolved, bytecode, error)
+		&& compiler.compiles == compiles + 2 && uncachedCache.Stats().uncached == 2 && uncachedCache.Stats().failed == 0
+		&& std::distance(std::filesystem::directory_iterator(entries), std::filesystem::directory_iterator()) == static_cast<ptrdiff_t>(entryCount);
+	std::printf("unresolvable includes %s\n", Check(uncachedCompiled, "compiled without an entry", "FAIL THE LOAD"));
+
+	//embedded bytecode of the same source needs neither the compiler nor the directory, stale bytecode is passed over,
+	//and without a source file the request alone picks it
+	std::string path = request.path;
+	EmbeddedShader embedded[] = { { path.c_str(), "Main", "vs_5_0", 2048, key, compiled.data(), compiled.size() } };
+	compiles = compiler.compiles;
+	ShaderCache embeddedCache(compiler, std::string(), embedded, 1);
+	bool fromTable = embeddedCache.Load(request, bytecode, error) && bytecode == compiled && embeddedCache.Stats().embedded == 1;
+	embedded[0].key = key ^ 1;
+	bool stalePassed = embeddedCache.Load(request, bytecode, error) && embeddedCache.Stats().compiled == 1;
+	std::filesystem::rename(request.path, request.path + ".moved");
+	bool withoutSource = embeddedCache.Load(request, bytecode, error) && bytecode == compiled && embeddedCache.Stats().embedded == 2;
+	std::filesystem::rename(request.path + ".moved", request.path);
+	std::string headerPath = (directory / "EmbeddedShaders.h").string();
+	embeddedCache.WriteEmbeddedHeader(headerPath);
+	std::ifstream header(headerPath);
+	std::string headerText((std::istreambuf_iterator<char>(header)), std::istreambuf_iterator<char>());
+	char keyText[32];
+	std::snprintf(keyText, sizeof(keyText), "0x%016llxull", static_cast<unsigned long long>(key));
+	bool headerWritten = headerText.find("embeddedShaders[]") != std::string::npos && headerText.find(keyText) != std::string::npos
+		&& headerText.find("0x4d, 0x61, 0x69, 0x6e,") != std::string::npos;
+	std::printf("embedded bytecode %s, stale bytecode %s, without the source %s, header %s; %u compiles in all\n",
+		Check(fromTable, "used", "NOT USED"), Check(stalePassed, "compiled over", "USED"), Check(withoutSource, "used", "NOT USED"),
+		Check(headerWritten, "written", "NOT WRITTEN"), compiler.compiles - compiles);
+
+	//what a warm start costs for the six shaders Application loads: hashing the sources and reading the entries
+	//the shaders of the repository, when run from Benchmarks like the build line
+	std::filesystem::path shaders = std::filesystem::path("..") / "DirectX3DRenderer";
+	const ShaderCompileRequest real[] = {
+		{ (shaders / "GenerateVerticesIndicies.hlsl").string(), "Main", "cs_5_0", 2048 },
+		{ (shaders / "Main.vs.hlsl").string(), "Main", "vs_5_0", 2048 },
+		{ (shaders / "Main.ps.hlsl").string(), "Main", "ps_5_0", 2048 },
+		{ (shaders / "Main.vs.hlsl").string(), "MainCompact", "vs_5_0", 2048 },
+		{ (shaders / "Main.vs.hlsl").string(), "MainVertexId", "vs_5_0", 2048 },
+		{ (shaders / "Main.vs.hlsl").string(), "MainLit", "vs_5_0", 2048 } };
+	if (std::filesystem::exists(real[0].path))
+	{
+		for (const ShaderCompileRequest& shader : real)
+			ShaderCache(compiler, entries).Load(shader, bytecode, error);
+		double warmSeconds = BestSeconds(20, [&]
+		{
+			ShaderCache warm(compiler, entries);
+			for (const ShaderCompileRequest& shader : real)
+				warm.Load(shader, bytecode, error);
+		});
+		std::printf("warm start of the 6 shaders of Application: %.3f ms for the keys and the entries\n", warmSeconds * 1e3);
+	}
+	std::filesystem::remove_all(directory);
+}
+
+//a clock driven by hand: a sleep returns up to one scheduler tick late, a round of spinning takes a microsecond
+class ManualFrameClock : public FrameClock
+{
+public:
+	Duration now{ 0 };
+	Duration tick{ 0 };	//the coarsest oversleep, a sleep of d returns after d rounded up to the next tick
+	uint32_t sleeps = 0;
+	uint32_t spins = 0;
+
+	Duration Now() override
+	{
+		return now;
+	}
+
+	void Sleep(Duration duration) override
+	{
+		++sleeps;
+		Duration end = now + duration;
+		if (tick.count() > 0)
+			end = (end + tick - Duration(1)) / tick * tick;
+		now = end;
+	}
+
+	void Spin() override
+	{
+		++spins;
+		now += std::chrono::microseconds(1);
+	}
+};
+
+static void ReportFramePacer()
+{
+	std::printf("== frame pacing\n");
+	using namespace std::chrono;
+
+	//a target rate of 60 with frames that take 3 to 9 ms of work, and a scheduler that wakes up on 1 ms ticks
+	auto run = [](FramePacing pacing, nanoseconds spinTime, ManualFrameClock& clock, std::vector<double>& frameMilliseconds)
+	{
+		FramePacerOptions options;
+		options.pacing = pacing;
+		options.targetFramesPerSecond = 60.0;
+		options.spinTime = spinTime;
+		FramePacer pacer(clock, options);
+		clock.tick = milliseconds(1);
+		clock.now = microseconds(123);
+		std::mt19937 random(7);
+		pacer.EndFrame();
+		for (int frame = 0; frame < 600; ++frame)
+		{
+			clock.now += microseconds(3000 + random() % 6000);
+			frameMilliseconds.push_back(pacer.EndFrame() * 1e3);
+		}
+		return pacer.Stats();
+	};
+	const double period = 1e3 / 60.0;
+	ManualFrameClock spun;
+	std::vector<double> spunFrames;
+	FramePacerStats spunStats = run(FramePacing::TargetRate, milliseconds(2), spun, spunFrames);
+	bool exact = std::all_of(spunFrames.begin(), spunFrames.end(), [&](double ms) { return std::abs(ms - period) < 0.002; });
+	ManualFrameClock slept;
+	std::vector<double> sleptFrames;
+	FramePacerStats sleptStats = run(FramePacing::TargetRate, nanoseconds(0), slept, sleptFrames);
+	ManualFrameClock uncapped;
+	std::vector<double> uncappedFrames;
+	FramePacerStats uncappedStats = run(FramePacing::Uncapped, milliseconds(2), uncapped, uncappedFrames);
+	std::printf("target 60 fps, 1 ms scheduler ticks: sleep and spin %.3f ms mean, %.4f ms jitter, %u sleeps %u spins (%s); "
+		"sleep only %.3f ms mean, %.4f ms jitter; uncapped %.3f ms mean, %s\n",
+		spunStats.meanMilliseconds, spunStats.jitterMilliseconds, spun.sleeps, spun.spins, Check(exact, "every frame on the period", "OFF THE PERIOD"),
+		sleptStats.meanMilliseconds, sleptStats.jitterMilliseconds, uncappedStats.meanMilliseconds,
+		Check(uncapped.sleeps == 0 && uncapped.spins == 0, "never waits", "WAITS"));
+
+	//a hitch of 50 ms is one late frame, the frames after it are a period apart again instead of catching up
+	ManualFrameClock clock;
+	FramePacerOptions options;
+	options.pacing = FramePacing::TargetRate;
+	FramePacer pacer(clock, options);
+	pacer.EndFrame();
+	std::vector<double> frames;
+	for (int frame = 0; frame < 10; ++frame)
+	{
+		clock.now += milliseconds(frame == 4 ? 50 : 5);
+		frames.push_back(pacer.EndFrame() * 1e3);
+	}
+	bool rescheduled = pacer.Stats().late == 1 && std::abs(frames[4] - 50.0) < 0.002
+		&& std::all_of(frames.begin() + 5, frames.end(), [&](double ms) { return std::abs(ms - period) < 0.002; });
+	FramePacerOptions vsync;
+	FramePacerOptions half;
+	half.pacing = FramePacing::VSyncHalf;
+	FramePacerOptions target = options;
+	FramePacerOptions none;
+	none.pacing = FramePacing::Uncapped;
+	bool intervals = FramePacer(clock, vsync).SyncInterval() == 1 && FramePacer(clock, half).SyncInterval() == 2
+		&& FramePacer(clock, target).SyncInterval() == 0 && FramePacer(clock, none).SyncInterval() == 0;
+	std::printf("late frame %s, sync intervals %s\n", Check(rescheduled, "moves the schedule without hurrying the next ones", "MAKES THE NEXT ONES HURRY"),
+		Check(intervals, "1, 2, 0, 0", "WRONG"));
+
+	//the idle render loop polls once a frame of each mode, on a 144 Hz display with a target of 60
+	auto pollMilliseconds = [&](FramePacerOptions modeOptions)
+	{
+		modeOptions.refreshRate = 144.0;
+		return duration<double, std::milli>(FramePacer(clock, modeOptions).PollPeriod()).count();
+	};
+	double polls[4] = { pollMilliseconds(vsync), pollMilliseconds(half), pollMilliseconds(target), pollMilliseconds(none) };
+	bool pollPeriods = std::abs(polls[0] - 1e3 / 144.0) < 1e-3 && std::abs(polls[1] - 2e3 / 144.0) < 1e-3
+		&& std::abs(polls[2] - period) < 1e-3 && std::abs(polls[3] - 1e3 / 144.0) < 1e-3;
+	std::printf("poll periods at 144 Hz: %.2f, %.2f, %.2f, %.2f ms (%s)\n", polls[0], polls[1], polls[2], polls[3],
+		Check(pollPeriods, "a frame of each mode", "WRONG"));
+
+	//the real clock of this machine at 120 fps
+	SystemFrameClock system;
+	options.targetFramesPerSecond = 120.0;
+	FramePacer real(system, options);
+	real.EndFrame();
+	for (int frame = 0; frame < 60; ++frame)
+		real.EndFrame();
+	std::printf("system clock at 120 fps: %s", FormatFramePacerStats(real.Stats()).c_str());
+}
+
+static void ReportFixedTimestep()
+{
+	std::printf("== fixed timestep\n");
+
+	//a held key moves the camera at 1 unit per second, the camera code of Application: a step saves the offset and adds
+	//the velocity, a frame draws between the offsets before and after the last step
+	struct Camera
+	{
+		float previous = 0.0f;
+		float current = 0.0f;
+	};
+	//the camera after its 252nd step, 2.1 s of 120 Hz steps, and every rendered position on the way
+	auto play = [](double framesPerSecond, double seconds, std::vector<float>* rendered, float& atStep)
+	{
+		FixedTimestep timestep(120.0);
+		Camera camera;
+		uint32_t first = timestep.Advance(0.0);
+		int frames = static_cast<int>(std::llround(seconds * framesPerSecond));
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			uint32_t steps = timestep.Advance(1.0 / framesPerSecond);
+			for (uint32_t step = 0; step < steps; ++step)
+			{
+				camera.previous = camera.current;
+				camera.current += 1.0f * timestep.StepSeconds();
+				if (timestep.Steps() - steps + step + 1 == 252)
+					atStep = camera.current;
+			}
+			if (rendered != nullptr)
+				rendered->push_back(InterpolateStep(camera.previous, camera.current, timestep.Alpha()));
+		}
+		return first == 0 ? timestep.Steps() : 0;
+	};
+	//the 252nd step ends on the same bits at 30, 144 and 300 fps, moving by the frame time ends elsewhere at every rate
+	float at30 = 0.0f;
+	float at144 = 0.0f;
+	float at300 = 0.0f;
+	uint64_t steps30 = play(30.0, 2.2, nullptr, at30);
+	uint64_t steps144 = play(144.0, 2.2, nullptr, at144);
+	uint64_t steps300 = play(300.0, 2.2, nullptr, at300);
+	float variable30 = 0.0f;
+	float variable300 = 0.0f;
+	for (int frame = 0; frame < 63; ++frame)
+		variable30 += 1.0f * static_cast<float>(1.0 / 30.0);
+	for (int frame = 0; frame < 630; ++frame)
+		variable300 += 1.0f * static_cast<float>(1.0 / 300.0);
+	bool same = at30 == at144 && at30 == at300 && at30 != 0.0f;
+	std::printf("2.2 s at 30, 144 and 300 fps: %llu, %llu and %llu steps, camera after 2.1 s of steps %.9f, %.9f and %.9f (%s); "
+		"moved by the frame time %.9f and %.9f\n", static_cast<unsigned long long>(steps30), static_cast<unsigned long long>(steps144),
+		static_cast<unsigned long long>(steps300), at30, at144, at300, Check(same, "identical", "DIFFERENT"), variable30, variable300);
+
+	//at 144 fps a 120 Hz step lands on 5 of every 6 frames: without interpolation the camera stops every sixth frame,
+	//with it every frame moves by the same amount
+	std::vector<float> rendered;
+	float unused = 0.0f;
+	play(144.0, 2.0, &rendered, unused);
+	double smoothest = 1e9;
+	double roughest = 0.0;
+	//from the third frame, the camera stands still until its first step and is drawn a step behind from then on
+	for (size_t frame = 2; frame < rendered.size(); ++frame)
+	{
+		double moved = rendered[frame] - rendered[frame - 1];
+		smoothest = (std::min)(smoothest, moved);
+		roughest = (std::max)(roughest, moved);
+	}
+	FixedTimestep snapping(120.0);
+	uint32_t stalls = 0;
+	for (int frame = 0; frame < 288; ++frame)
+		stalls += snapping.Advance(1.0 / 144.0) == 0 ? 1 : 0;
+	std::printf("144 fps: interpolated frames move %.5f to %.5f (frame time %.5f), snapped to the steps %u of 288 frames stand still\n",
+		smoothest, roughest, 1.0 / 144.0, stalls);
+
+	//a 2 s hitch is cut to 0.25 s, time that is not a number or runs backwards is no time
+	FixedTimestep hitch(120.0);
+	uint32_t hitchSteps = hitch.Advance(2.0);
+	bool clamped = hitchSteps == 30 && std::abs(hitch.DroppedSeconds() - 1.75) < 1e-9;
+	bool ignored = hitch.Advance(-1.0) == 0 && hitch.Advance(std::nan("")) == 0 && hitch.Steps() == 30;
+	std::printf("2 s hitch %s, negative and nan frame times %s\n", Check(clamped, "runs 30 steps and drops 1.75 s", "NOT CLAMPED"),
+		Check(ignored, "ignored", "NOT IGNORED"));
+}
+
+static void ReportRedraw()
+{
+	std::printf("== on demand redraw\n");
+
+	//ten seconds of a viewer polled at 60 Hz: the first frame, a key held for 2 s, half a second of the mouse moving
+	//over the window without a button, a resize and one mesh swapped in. Application blocks instead of polling, the
+	//passes are only there to count what a continuous loop draws in the same time
+	auto session = [](RedrawMode mode)
+	{
+		RedrawTracker redraw(mode);
+		for (int pass = 0; pass < 600; ++pass)
+		{
+			bool keyHeld = pass >= 60 && pass < 180;
+			if (pass == 60)
+				redraw.Invalidate(RedrawReason::Camera);	//MoveCamera
+			if (pass == 180)
+				redraw.Invalidate(RedrawReason::Camera);	//StopCamera
+			if (pass == 300)
+				redraw.Invalidate(RedrawReason::Window);
+			if (pass == 400)
+				redraw.Invalidate(RedrawReason::Scene);
+			//passes 200 to 229 are mouse moves that change nothing
+
+			if (!redraw.BeginFrame())
+			{
+				redraw.RecordWait(1.0 / 60.0);
+				continue;
+			}
+			//UpdateCameraPosition asks for the next frame while the key is held
+			if (keyHeld)
+				redraw.Invalidate(RedrawReason::Camera);
+		}
+		return redraw.Stats();
+	};
+	RedrawStats onDemand = session(RedrawMode::OnDemand);
+	RedrawStats continuous = session(RedrawMode::Continuous);
+	const RedrawStats& stats = onDemand;
+	bool counted = stats.rendered == 124 && stats.skipped == 476 && stats.byReason[static_cast<size_t>(RedrawReason::Camera)] == 121
+		&& stats.byReason[static_cast<size_t>(RedrawReason::Window)] == 1 && stats.byReason[static_cast<size_t>(RedrawReason::Scene)] == 2;
+	bool always = continuous.rendered == 600 && continuous.skipped == 0 && continuous.waits == 0;
+	std::printf("on demand: %s", FormatRedrawStats(onDemand).c_str());
+	std::printf("continuous: %s", FormatRedrawStats(continuous).c_str());
+	std::printf("on demand counts %s, continuous %s, %.0f%% of the frames drawn\n", Check(counted, "as expected", "WRONG"),
+		Check(always, "draws every pass", "SKIPS"), 100.0 * static_cast<double>(onDemand.rendered) / static_cast<double>(continuous.rendered));
+}
+
+static void ReportGeometryPool()
+{
+	std::printf("== static geometry\n");
+
+	//the base quad of Application, VertexPositionUv has the layout of HeightmapVertex
+	const HeightmapVertex baseVertices[] = { { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f, 1.0f },
+		{ 1.0f, 0.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f, 1.0f } };
+	const uint32_t baseIndices[] = { 0, 1, 2, 2, 3, 0 };
+	const size_t quadBytes = sizeof(baseVertices) + sizeof(baseIndices);
+	const int frames = 600;
+
+	//ten seconds at 60 fps of creating the quad in every frame and never releasing it, the way Render did
+	MemoryBufferDevice perFrame;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		perFrame.CreateBuffer(BufferBinding::Vertex, baseVertices, sizeof(baseVertices));
+		perFrame.CreateBuffer(BufferBinding::Index, baseIndices, sizeof(baseIndices));
+	}
+
+	//the same ten seconds with the quad registered once and looked up by the frames
+	MemoryBufferDevice device;
+	bool same = true;
+	bool accounted = false;
+	bool contents = false;
+	GeometryPoolStats afterClear;
+	{
+		GeometryPool pool(device);
+		const StaticGeometry* quad = pool.Register("base", baseVertices, sizeof(HeightmapVertex), 4, baseIndices, 6);
+		for (int frame = 0; frame < frames; ++frame)
+			same &= pool.Register("base", baseVertices, sizeof(HeightmapVertex), 4, baseIndices, 6) == quad && pool.Find("base") == quad;
+		GeometryPoolStats stats = pool.Stats();
+		accounted = quad != nullptr && stats.liveBuffers == 2 && stats.liveBuffers == device.LiveBuffers()
+			&& stats.liveBytes == quadBytes && stats.liveBytes == device.LiveBytes() && stats.created == 2;
+		contents = quad != nullptr && device.Contents(quad->indexBuffer) != nullptr
+			&& std::memcmp(device.Contents(quad->indexBuffer)->data(), baseIndices, sizeof(baseIndices)) == 0;
+		pool.Clear();
+		afterClear = pool.Stats();
+	}
+	std::printf("%d frames: creating the quad every frame leaves %u buffers of %zu bytes alive; registered once %u buffers of %zu bytes "
+		"(%s, %s, %s)\n", frames, perFrame.LiveBuffers(), perFrame.LiveBytes(), static_cast<uint32_t>(afterClear.created), afterClear.peakBytes,
+		Check(same, "every frame gets the same buffers", "FRAMES CREATE BUFFERS"), Check(accounted, "counted like the device", "MISCOUNTED"),
+		Check(contents, "contents copied", "CONTENTS WRONG"));
+	bool cleared = afterClear.liveBuffers == 0 && afterClear.liveBytes == 0 && afterClear.released == 2 && device.LiveBuffers() == 0
+		&& device.UnknownReleases() == 0;
+
+	//a failing index buffer gives back the vertex buffer it already has, and the destructor releases what is left
+	MemoryBufferDevice failing;
+	bool unwound = false;
+	{
+		GeometryPool pool(failing);
+		pool.Register("base", baseVertices, sizeof(HeightmapVertex), 4, baseIndices, 6);
+		failing.failingCreate = 4;	//the index buffer of the second mesh
+		bool refused = pool.Register("grid", baseVertices, sizeof(HeightmapVertex), 4, baseIndices, 6) == nullptr;
+		unwound = refused && pool.Find("grid") == nullptr && pool.Stats().failed == 1 && pool.Stats().liveBuffers == 2
+			&& failing.LiveBuffers() == 2;
+		pool.Release("missing");
+	}
+	bool destroyed = failing.LiveBuffers() == 0 && failing.UnknownReleases() == 0;
+	std::printf("clear %s, failed register %s, destructor %s\n", Check(cleared, "releases everything", "LEAKS"),
+		Check(unwound, "keeps nothing", "LEAKS"), Check(destroyed, "releases the rest", "LEAKS"));
+	std::printf("%s", FormatGeometryPoolStats(afterClear).c_str());
+}
+
+int main()
+{
+	std::vector<uint8_t> depth = MakeDepthMap(benchmarkWidth, benchmarkHeight);
+	std::printf("detected: %s\n", SimdLevelName(DetectSimdLevel()));
+
+	BenchmarkKernels(depth);
+	BenchmarkBuilder(depth);
+	ReportRowBandPool();
+	ReportTiling();
+	ReportTopology();
+	ReportVertexFormat(depth);
+	ReportNormals(depth);
+	ReportDirtyUpdate();
+	ReportDepthDecode();
+	ReportDepthFilter();
+	ReportWideDepth();
+	ReportVertexId(depth);
+	ReportRtin();
+	ReportLod();
+	ReportFrustumCulling();
+	ReportVertexCache();
+	ReportMeshlets();
+	ReportSequencePipeline();
+	ReportMeshCache();
+	ReportProgressiveLoad();
+	ReportShaderCache();
+	ReportFramePacer();
+	ReportFixedTimestep();
+	ReportRedraw();
+	ReportGeometryPool();
+
+	if (failedChecks > 0)
+		std::printf("%d checks FAILED\n", failedChecks);
+	return failedChecks > 0 ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+//plays an rgb-d sequence through SequencePipeline without a window or a gpu, the uploads go to system memory and a
+//display loop takes the newest frame at a fixed refresh rate the way Render does. builds on linux, see CMakeLists.txt
+//usage:
+//	SequencePlayer <directory> [--fps=<frames per second>] [--display-hz=<refreshes per second>] [--generate=<frames>]
+//--generate first writes that many synthetic 640x480 frames into the directory, for a run without captured data
+#include "NetpbmImage.h"
+#include "SequencePipeline.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+//rolling hills that move a little every frame, with a matching color gradient
+static void GenerateSequence(const std::string& directory, uint32_t frameCount)
+{
+	constexpr uint32_t width = 640;
+	constexpr uint32_t height = 480;
+	NetpbmImage depth;
+	depth.width = width;
+	depth.height = height;
+	depth.channels = 1;
+	depth.pixels.resize(static_cast<size_t>(width) * height);
+	NetpbmImage color = depth;
+	color.channels = 3;
+	color.pixels.resize(depth.pixels.size() * 3);
+
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				double phase = frame * 0.1;
+				double hills = 128.0 + 60.0 * std::sin(x / 40.0 + phase) * std::cos(y / 30.0 - phase);
+				uint8_t sample = static_cast<uint8_t>(hills);
+				size_t i = static_cast<size_t>(y) * width + x;
+				depth.pixels[i] = sample;
+				color.pixels[i * 3] = sample;
+				color.pixels[i * 3 + 1] = static_cast<uint8_t>(x * 255 / width);
+				color.pixels[i * 3 + 2] = static_cast<uint8_t>(y * 255 / height);
+			}
+		}
+		WriteNetpbm(SequenceFramePath(directory, "depth", frame), depth);
+		WriteNetpbm(SequenceFramePath(directory, "rgb", frame), color);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <directory> [--fps=<n>] [--display-hz=<n>] [--generate=<frames>]\n", argv[0]);
+		return 1;
+	}
+
+	std::string directory = argv[1];
+	SequencePipelineOptions options;
+	double displayHz = 60.0;
+	uint32_t generate = 0;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (std::strncmp(argv[i], "--fps=", 6) == 0)
+			options.framesPerSecond = std::stof(argv[i] + 6);
+		else if (std::strncmp(argv[i], "--display-hz=", 13) == 0)
+			displayHz = std::stod(argv[i] + 13);
+		else if (std::strncmp(argv[i], "--generate=", 11) == 0)
+			generate = static_cast<uint32_t>(std::stoul(argv[i] + 11));
+		else
+			std::fprintf(stderr, "Ignoring unknown option %s\n", argv[i]);
+	}
+
+	try
+	{
+		if (generate > 0)
+			GenerateSequence(directory, generate);
+
+		MemorySequenceUploader uploader;
+		SequencePipeline pipeline(options, uploader);
+		pipeline.Start(directory);
+		const SequenceInfo& info = pipeline.Info();
+		std::printf("%s: %u frames, depth %ux%u, color %ux%u\n", directory.c_str(), info.frameCount, info.width, info.height,
+			info.colorWidth, info.colorHeight);
+
+		//the display loop only ever takes what is ready, like Render
+		auto refresh = std::chrono::duration_cast<SequenceClock::duration>(std::chrono::duration<double>(1.0 / displayHz));
+		SequenceClock::time_point next = SequenceClock::now();
+		uint32_t slot = 0;
+		while (true)
+		{
+			bool finished = pipeline.Finished();
+			pipeline.AcquireLatest(slot);
+			if (finished)
+				break;
+			next += refresh;
+			std::this_thread::sleep_until(next);
+		}
+
+		if (!pipeline.Error().empty())
+			std::fprintf(stderr, "%s\n", pipeline.Error().c_str());
+		std::printf("%s", FormatSequenceStats(pipeline.Stats()).c_str());
+		std::printf("last frame shown: %u\n", uploader.GetSlot(slot).frameIndex);
+		return pipeline.Error().empty() ? 0 : 1;
+	}
+	catch (const std::exception& exception)
+	{
+		std::fprintf(stderr, "%s\n", exception.what());
+		return 1;
+	}
+}
@@ -2,8 +2,16 @@
 #include <wincodec.h>
 #include <DirectXColors.h>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
 #include <d3dcompiler.h>
 #include "WICTextureLoader.h"
+#include "MeshCache.h"
+#include "RawDepthFile.h"
+#include "VertexCache.h"
+#include "VertexIdGrid.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -11,6 +19,16 @@
 #pragma comment(lib, "winmm.lib")
 #pragma comment(lib, "dxguid.lib")
 
+//a build defining HEIGHTMAP_EMBEDDED_SHADERS includes the header written by --embed-shaders=EmbeddedShaders.h and
+//starts without compiling
+#if defined(HEIGHTMAP_EMBEDDED_SHADERS)
+#include "EmbeddedShaders.h"
+constexpr size_t embeddedShaderCount = sizeof(embeddedShaders) / sizeof(embeddedShaders[0]);
+#else
+static const EmbeddedShader* const embeddedShaders = nullptr;
+constexpr size_t embeddedShaderCount = 0;
+#endif
+
 POINT lastMousePos;
 bool leftMouseClicked = false;
 bool rightMouseClicked = false;
@@ -24,6 +42,11 @@ LRESULT CALLBACK Application::WndProc(HWND hWnd, UINT message, WPARAM wParam, LP
 		PAINTSTRUCT ps;
 		HDC hdc = BeginPaint(hWnd, &ps);
 		EndPaint(hWnd, &ps);
+
+		//uncovered or restored, draw it again
+		Application* application = reinterpret_cast<Application*>(GetWindowLongPtrW(hWnd, GWLP_USERDATA));
+		if (application != nullptr)
+			application->_redraw.Invalidate(RedrawReason::Window);
 	}
 	break;
 	case WM_DESTROY:
@@ -183,15 +206,83 @@ inline void SetDebugName(_In_ ID3D11DeviceChild* deviceResource, _In_z_ const ch
 	deviceResource->SetPrivateData(WKPDID_D3DDebugObjectName, TDebugNameLength - 1, debugName);
 }
 
-Application::Application(HINSTANCE hinst, int _nCmdShow)
+//the c runtime and std::string based readers take paths in the ansi code page
+static std::string ToAnsiPath(const std::wstring& path)
+{
+	int length = WideCharToMultiByte(CP_ACP, 0, path.c_str(), -1, nullptr, 0, nullptr, nullptr);
+	std::string ansiPath(length > 0 ? length - 1 : 0, '\0');
+	WideCharToMultiByte(CP_ACP, 0, path.c_str(), -1, &ansiPath[0], length, nullptr, nullptr);
+	return ansiPath;
+}
+
+static size_t BufferBytes(const Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer)
+{
+	D3D11_BUFFER_DESC desc = {};
+	if (buffer != nullptr)
+		buffer->GetDesc(&desc);
+	return desc.ByteWidth;
+}
+
+static uint32_t FloatBits(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+//everything besides the depth file that changes the mesh of the cached modes, settings a mode ignores are left out so
+//they do not split its entries
+static uint64_t MeshSettingsHash(const RenderSettings& settings)
+{
+	bool tiled = settings.renderMode == HeightmapRenderMode::Mesh;
+	uint32_t parameters[] = {
+		static_cast<uint32_t>(settings.renderMode),
+		tiled ? settings.mesh.tileQuads : 0,
+		tiled ? static_cast<uint32_t>(settings.mesh.topology) : 0,
+		tiled ? static_cast<uint32_t>(settings.mesh.vertexFormat) : 0,
+		tiled ? static_cast<uint32_t>(settings.mesh.normalFormat) : 0,
+		tiled ? 0 : FloatBits(settings.maxError),
+		static_cast<uint32_t>(settings.depthFilter.kind),
+		settings.depthFilter.kind != DepthFilterKind::None ? FloatBits(settings.depthFilter.rangeCutoff) : 0,
+		settings.depthFilter.kind != DepthFilterKind::None ? FloatBits(settings.depthFilter.spatialSigma) : 0
+	};
+	return HashBytes(parameters, sizeof(parameters));
+}
+
+Application::Application(HINSTANCE hinst, int _nCmdShow, const RenderSettings& settings)
+	: _framePacer(_frameClock, settings.pacing),
+	_timestep(settings.updatesPerSecond),
+	_redraw(settings.redraw),
+	_meshCache(ToAnsiPath(settings.meshCacheDirectory)),
+	_shaderCache(_shaderCompiler, ToAnsiPath(settings.shaderCacheDirectory), embeddedShaders, embeddedShaderCount)
 {
 	_hinst = hinst;
+	_settings = settings;
 	initialize(_nCmdShow);
 }
 
 Application::~Application()
 {
+	//a full mesh still being built holds the device and _depthData
+	_fullMeshBuild.Wait();
+	if (_sequence != nullptr)
+	{
+		_sequence->Stop();
+		std::cout << FormatSequenceStats(_sequence->Stats());
+		_sequence.reset();
+		_sequenceUploader.reset();
+	}
+	_deviceContext->ClearState();
 	_deviceContext->Flush();
+	std::cout << FormatFramePacerStats(_framePacer.Stats());
+	std::cout << FormatRedrawStats(_redraw.Stats());
+
+	//everything the pool created is released here, a live buffer after Clear is a leak
+	_baseQuad = nullptr;
+	_staticGeometry->Clear();
+	std::cout << FormatGeometryPoolStats(_staticGeometry->Stats());
+	_staticGeometry.reset();
+	_bufferDevice.reset();
 
 	_samplerState.Reset();
 	_rasterState.Reset();
@@ -201,6 +292,14 @@ Application::~Application()
 	_vertexShader.Reset();
 	_pixelShader.Reset();
 	_inputLayout.Reset();
+	_compactVertexShader.Reset();
+	_compactInputLayout.Reset();
+	_vertexIdShader.Reset();
+	_litVertexShader.Reset();
+	_litInputLayout.Reset();
+	_compactLitVertexShader.Reset();
+	_compactLitInputLayout.Reset();
+	_normalBuffer.Reset();
 	DestroySwapchainResources();
 	_swapChain.Reset();
 	_dxgiFactory.Reset();
@@ -310,6 +409,15 @@ void Application::initialize_directX()
 		&_swapChain)))
 		throw std::exception("Failed to create swap chain");
 
+	//the vsync modes wait for the refresh of the monitor the window is on, 0 and 1 stand for the default of the hardware
+	MONITORINFOEXW monitor = {};
+	monitor.cbSize = sizeof(monitor);
+	DEVMODEW displayMode = {};
+	displayMode.dmSize = sizeof(displayMode);
+	if (GetMonitorInfoW(MonitorFromWindow(_window, MONITOR_DEFAULTTONEAREST), &monitor)
+		&& EnumDisplaySettingsW(monitor.szDevice, ENUM_CURRENT_SETTINGS, &displayMode) && displayMode.dmDisplayFrequency > 1)
+		_framePacer.SetRefreshRate(displayMode.dmDisplayFrequency);
+
 	if (!CreateSwapchainResources())
 		throw std::exception("Failed to create swap chain resources");
 
@@ -318,6 +426,7 @@ void Application::initialize_directX()
 	CreateDepthStencilView();
 	CreateDepthState();
 	CreateConstantBuffer();
+	CreateStaticGeometry();
 
 	InitializeCamera();
 }
@@ -332,27 +441,47 @@ void Application::InitializeCamera()
 	modelScale = 1.0f;
 	viewOffsetX = 0.0f;
 	viewOffsetY = 0.0f;
+	previousViewOffsetX = 0.0f;
+	previousViewOffsetY = 0.0f;
 	cameraOffsetZ = 0.0f;
+	_redraw.Invalidate(RedrawReason::Camera);
 }
  
 void Application::UpdateCameraPosition()
 {
-	float velocity = cameraSpeed * _deltaTime;
+	//the keys move the camera in fixed steps whatever the frame rate, UpdateViewMatrix draws between the last two
+	uint32_t steps = _timestep.Advance(_deltaTime);
+	for (uint32_t step = 0; step < steps; ++step)
+	{
+		previousViewOffsetX = viewOffsetX;
+		previousViewOffsetY = viewOffsetY;
+		StepCamera(_timestep.StepSeconds());
+	}
+
+	//a held key keeps drawing, and so does a released one until the view settles on its last step
+	if (isMovingFront || isMovingBack || isMovingLeft || isMovingRight
+		|| previousViewOffsetX != viewOffsetX || previousViewOffsetY != viewOffsetY)
+		_redraw.Invalidate(RedrawReason::Camera);
+}
+
+void Application::StepCamera(float seconds)
+{
+	float velocity = cameraSpeed * seconds;
 	if (isMovingFront)
 	{
-		PanModel(0, velocity);
+		viewOffsetY += velocity;
 	}
 	if (isMovingBack)
 	{
-		PanModel(0, -velocity);
+		viewOffsetY -= velocity;
 	}
 	if (isMovingLeft)
 	{
-		PanModel(velocity, 0);
+		viewOffsetX += velocity;
 	}
 	if (isMovingRight)
 	{
-		PanModel(-velocity, 0);
+		viewOffsetX -= velocity;
 	}
 }
 
@@ -367,8 +496,9 @@ void Application::UpdateViewMatrix()
 	XMVECTOR viewDirection = XMVector3Normalize(XMVectorSubtract(camTarget, camPos));
 	XMVECTOR rightVector = XMVector3Normalize(XMVector3Cross(camUp, viewDirection));
 
-	XMVECTOR translationX = XMVectorScale(rightVector, viewOffsetX);
-	XMVECTOR translationY = XMVectorScale(camUp, viewOffsetY);
+	float alpha = _timestep.Alpha();
+	XMVECTOR translationX = XMVectorScale(rightVector, InterpolateStep(previousViewOffsetX, viewOffsetX, alpha));
+	XMVECTOR translationY = XMVectorScale(camUp, InterpolateStep(previousViewOffsetY, viewOffsetY, alpha));
 	XMVECTOR translationZ = XMVectorScale(viewDirection, cameraOffsetZ);
 	XMVECTOR translation = XMVectorAdd(XMVectorAdd(translationX, translationY), translationZ);
 
@@ -376,6 +506,25 @@ void Application::UpdateViewMatrix()
 	camTarget = XMVectorAdd(camTarget, translation);
 
 	viewMatrix = XMMatrixLookAtRH(camPos, camTarget, camUp);
+	XMStoreFloat3(&eyePosition, camPos);
+}
+
+void Application::LocalEyePosition(float eye[3]) const
+{
+	//undo the model matrix of UpdateModelBuffer, lod nodes and meshlets are in the local space of the mesh
+	eye[0] = eyePosition.x / modelScale + 0.5f;
+	eye[1] = eyePosition.y / modelScale + 0.5f;
+	eye[2] = eyePosition.z / modelScale + 0.5f;
+}
+
+LodView Application::CurrentLodView() const
+{
+	LodView view{};
+	LocalEyePosition(view.eye);
+	//same 90 degree vertical field of view as the projection in Update
+	view.errorScale = static_cast<float>(window_height) / (2.0f * std::tan(0.5f * 90.0f * 0.0174533f));
+	view.maxPixelError = _settings.maxPixelError;
+	return view;
 }
 
 void Application::UpdateModelBuffer()
@@ -399,8 +548,12 @@ void Application::PanModel(float dx, float dy)
 {
 	using namespace DirectX;
 	
+	//mouse drags move the camera right away, both ends of the step move so the interpolation keeps the drag
 	viewOffsetX += dx;
 	viewOffsetY += dy;
+	previousViewOffsetX += dx;
+	previousViewOffsetY += dy;
+	_redraw.Invalidate(RedrawReason::Camera);
 
 	UpdateViewMatrix();
 }
@@ -418,12 +571,14 @@ void Application::ZoomView(float dz)
 		cameraOffsetZ = minZ;
 	else if (cameraOffsetZ > maxZ)
 		cameraOffsetZ = maxZ;
+	_redraw.Invalidate(RedrawReason::Camera);
 
 	UpdateViewMatrix();
 }
 
 void Application::MoveCamera(Direction d)
 {
+	_redraw.Invalidate(RedrawReason::Camera);
 	switch (d)
 	{
 	case Direction::FRONT:
@@ -443,6 +598,7 @@ void Application::MoveCamera(Direction d)
 
 void Application::StopCamera(Direction d)
 {
+	_redraw.Invalidate(RedrawReason::Camera);
 	switch (d)
 	{
 	case Direction::FRONT:
@@ -471,6 +627,7 @@ void Application::RotateModel(float dx, float dy)
 	position = XMVector3TransformNormal(position, rY);
 	position = XMVector3TransformNormal(position, rX);
 	XMStoreFloat3(&cameraPosition, position);
+	_redraw.Invalidate(RedrawReason::Camera);
 
 	UpdateViewMatrix();
 }
@@ -516,6 +673,28 @@ void Application::CreateConstantBuffer()
 	_device->CreateBuffer(&desc, nullptr, &_perObjectConstantBuffer);
 }
 
+void Application::CreateStaticGeometry()
+{
+	_bufferDevice = std::make_unique<D3D11BufferDevice>(_device.Get());
+	_staticGeometry = std::make_unique<GeometryPool>(*_bufferDevice);
+
+	const VertexPositionUv baseVertices[] = {
+		{{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},  // Bottom-left corner (red)
+		{{1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},  // Bottom-right corner (red)
+		{{1.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},  // Top-right corner (red)
+		{{0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}}   // Top-left corner (red)
+	};
+
+	const uint32_t baseIndices[] = {
+		0, 1, 2,  // First triangle
+		2, 3, 0   // Second triangle
+	};
+
+	_baseQuad = _staticGeometry->Register("base", baseVertices, sizeof(VertexPositionUv), _countof(baseVertices), baseIndices, _countof(baseIndices));
+	if (_baseQuad == nullptr)
+		throw std::exception("Failed to create the base geometry");
+}
+
 void Application::CreateSamplerState()
 {
 	// Define the sampler description
@@ -622,6 +801,7 @@ void Application::OnWindowResized()
 	CreateSwapchainResources();
 
 	CreateDepthStencilView();
+	_redraw.Invalidate(RedrawReason::Window);
 }
 
 void Application::Run()
@@ -630,22 +810,14 @@ void Application::Run()
 		return;
 
 	//pool event, and update UI
-	bool bGotMsg;
 	MSG  msg = { 0 };
 
 	while (true)
 	{
-		_oldTime = _currentTime;
-		_currentTime = std::chrono::high_resolution_clock::now();
-
-		std::chrono::duration<double, std::milli> timeSpan = (_currentTime - _oldTime);
-		_deltaTime = static_cast<float>(timeSpan.count() / 1000.0);
-
 		// Process window events.
 		// Use PeekMessage() so we can use idle time to render the scene. 
-		bGotMsg = PeekMessageW(&msg, NULL, 0U, 0U, PM_REMOVE);
-
-		if (bGotMsg)
+		// Every pending message is handled before the frame, so input does not queue up behind the frame rate.
+		while (PeekMessageW(&msg, NULL, 0U, 0U, PM_REMOVE))
 		{
 			if (msg.message == WM_QUIT)
 				break;
@@ -654,13 +826,48 @@ void Application::Run()
 			TranslateMessage(&msg);
 			DispatchMessageW(&msg);
 		}
-		
+		if (msg.message == WM_QUIT)
+			break;
+
+		PollScene();
+		if (!_redraw.BeginFrame())
+		{
+			WaitForChange();
+			continue;
+		}
+
 		Update();
 		Render();
-		Sleep(50);
+		//waits for the next frame of the target rate, the vsync modes already waited in Present
+		_deltaTime = static_cast<float>(_framePacer.EndFrame());
 	}
 }
 
+void Application::PollScene()
+{
+	//not short circuited, both are polled every pass
+	if (ShowLatestSequenceFrame() | ShowFullMesh())
+		_redraw.Invalidate(RedrawReason::Scene);
+}
+
+void Application::WaitForChange()
+{
+	//a playing sequence or a full mesh still being built is polled once a frame of the active pacing, anything else comes
+	//as a message
+	bool polling = _sequence != nullptr || _fullMeshBuild.Running();
+	double pollMilliseconds = std::chrono::duration<double, std::milli>(_framePacer.PollPeriod()).count();
+	DWORD timeout = polling ? static_cast<DWORD>((std::max)(1.0, pollMilliseconds)) : INFINITE;
+
+	auto waitStart = std::chrono::high_resolution_clock::now();
+	MsgWaitForMultipleObjectsEx(0, nullptr, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+	std::chrono::duration<double> waited = std::chrono::high_resolution_clock::now() - waitStart;
+	_redraw.RecordWait(waited.count());
+
+	//the next frame is timed from its own start, the idle time would otherwise move the camera in one jump
+	_framePacer.Restart();
+	_deltaTime = 0.0f;
+}
+
 void Application::LoadAndPrepareRenderResource()
 {
 	//load and process height map
@@ -672,132 +879,302 @@ void Application::LoadAndPrepareRenderResource()
 		return;
 	}
 
-	//load depth map
-	ComPtr<ID3D11Resource> resource;
-	if (FAILED(DirectX::CreateWICTextureFromFile(_device.Get(), L"C:\\Users\\Payhemfoh\\source\\repos\\DirectX3DRenderer\\data\\depth.jpg", &resource, &_depthResource)))
+	//mesh and rtin modes look the map up in the mesh cache first, a hit skips decoding and building and uploads
+	//straight from the mapped entry
+	const std::wstring& depthPath = _settings.depthPath;
+	uint64_t meshCacheKey = 0;
+	bool cacheMesh = _meshCache.Enabled()
+		&& (_settings.renderMode == HeightmapRenderMode::Mesh || _settings.renderMode == HeightmapRenderMode::Rtin);
+	if (cacheMesh)
+	{
+		auto lookupStart = std::chrono::high_resolution_clock::now();
+		MeshCacheEntry entry;
+		try
+		{
+			MappedFile depthFile(depthPath);
+			meshCacheKey = HashBytes(depthFile.Data(), depthFile.Size(), MeshSettingsHash(_settings));
+		}
+		catch (const std::exception&)
+		{
+			//the load below reports the missing file
+			cacheMesh = false;
+		}
+
+		if (cacheMesh && _meshCache.Load(meshCacheKey, entry) && LoadCachedMesh(entry))
+		{
+			std::chrono::duration<double, std::milli> lookupTime = std::chrono::high_resolution_clock::now() - lookupStart;
+			std::cout << "Heightmap " << modelWidth << "x" << modelHeight << ": " << entry.Bytes() / 1024
+				<< " KB mesh cache entry " << _meshCache.EntryPath(meshCacheKey) << " hashed, mapped and uploaded in "
+				<< lookupTime.count() << " ms" << std::endl;
+			return;
+		}
+	}
+
+	//raw maps are mapped and read in place, images are decoded on the cpu into one sample per pixel.
+	//the texture is only made for vertexid below
+	DepthImage depthImage;
+	RawDepthFile rawDepth;
+	DepthSamples depthSamples;
+	if (depthPath.size() > 9 && _wcsicmp(depthPath.c_str() + depthPath.size() - 9, L".rawdepth") == 0)
+	{
+		try
+		{
+			rawDepth = RawDepthFile(depthPath);
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << exception.what() << std::endl;
+			return;
+		}
+		depthSamples = rawDepth.Samples();
+	}
+	else if (DecodeDepthImage(depthPath, depthImage))
+		depthSamples = depthImage.Samples();
+	else
 	{
 		std::cerr << "Error loading texture" << std::endl;
 		return;
 	}
 
-	//copy depth map into 2d array
-	ComPtr<ID3D11Texture2D> depthTexture2D;
-	resource.As(&depthTexture2D);
+	modelWidth = depthSamples.width;
+	modelHeight = depthSamples.height;
+
+	//the tiled mesh and the vertexid texture take 16-bit and float samples as they are, everything else reads bytes:
+	//a decoded 8-bit image is taken over, other maps are scaled into an 8-bit copy
+	bool wideSamples = depthSamples.type != DepthSampleType::UInt8 && (_settings.renderMode == HeightmapRenderMode::VertexId
+		|| (_settings.renderMode == HeightmapRenderMode::Mesh && _settings.depthFilter.kind == DepthFilterKind::None));
+	if (wideSamples)
+		_depthData.clear();
+	else if (depthSamples.data == depthImage.samples.data() && depthImage.sampleType == DepthSampleType::UInt8)
+		_depthData.swap(depthImage.samples);
+	else
+		QuantizeDepthSamples(depthSamples, _depthData);
+	std::vector<uint8_t>& depthData = _depthData;
 
-	// Get the description of the original depth texture
-	D3D11_TEXTURE2D_DESC desc;
-	depthTexture2D->GetDesc(&desc);
-	
-	// Modify the description for a staging texture
-	D3D11_TEXTURE2D_DESC stagingDesc = desc;
-	stagingDesc.Usage = D3D11_USAGE_STAGING;
-	stagingDesc.BindFlags = 0;
-	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-	stagingDesc.MiscFlags = 0;
-
-	// Create the staging texture
-	ComPtr<ID3D11Texture2D> stagingTexture;
-	HRESULT hr = _device->CreateTexture2D(&stagingDesc, nullptr, stagingTexture.GetAddressOf());
-	if (FAILED(hr)) {
-		// Handle error
+	//convert depth map into mesh
+
+	#pragma region CPU Code
+	if (_settings.renderMode == HeightmapRenderMode::VertexId)
+	{
+		//no mesh at all, MainVertexId samples an r8, r16 or r32 float texture of the map and needs the max depth to normalize it
+		const void* textureSamples = wideSamples ? depthSamples.data : depthData.data();
+		DXGI_FORMAT textureFormat = DXGI_FORMAT_R8_UNORM;
+		float textureRange = 255.0f;
+		if (wideSamples && depthSamples.type == DepthSampleType::UInt16)
+		{
+			textureFormat = DXGI_FORMAT_R16_UNORM;
+			textureRange = 65535.0f;
+		}
+		else if (wideSamples)
+		{
+			textureFormat = DXGI_FORMAT_R32_FLOAT;
+			textureRange = 1.0f;
+		}
+
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = modelWidth;
+		textureDesc.Height = modelHeight;
+		textureDesc.MipLevels = 1;
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = textureFormat;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		D3D11_SUBRESOURCE_DATA textureData = {};
+		textureData.pSysMem = textureSamples;
+		textureData.SysMemPitch = modelWidth * (wideSamples ? DepthSampleBytes(depthSamples.type) : 1);
+
+		ComPtr<ID3D11Texture2D> depthTexture;
+		_depthResource.Reset();
+		if (FAILED(_device->CreateTexture2D(&textureDesc, &textureData, &depthTexture))
+			|| FAILED(_device->CreateShaderResourceView(depthTexture.Get(), nullptr, &_depthResource)))
+		{
+			std::cerr << "Error creating depth texture" << std::endl;
+			return;
+		}
+
+		float maxDepth = 0.0f;
+		DepthSamples textureMap{ modelWidth, modelHeight, wideSamples ? depthSamples.type : DepthSampleType::UInt8, textureSamples };
+		VisitDepthSamples(textureMap, [&](const auto* samples) { maxDepth = static_cast<float>(_meshBuilder.ReduceMaxDepth(samples, modelWidth, modelHeight)); });
+		_perObjectConstantBufferData.gridSize = DirectX::XMFLOAT4(static_cast<float>(modelWidth), static_cast<float>(modelHeight),
+			VertexIdDepthScale(maxDepth, textureRange), 0.0f);
+
+		std::cout << "Heightmap " << modelWidth << "x" << modelHeight << ": no vertex or index buffer, "
+			<< GridVertexIdCount(modelWidth, modelHeight) << " vertices per frame from SV_VertexID" << std::endl;
 		return;
 	}
 
-	_deviceContext->CopyResource(stagingTexture.Get(), depthTexture2D.Get());
+	//mesh mode draws a preview of the map right away and builds the full mesh on a worker thread, the filter included
+	uint32_t previewStep = _settings.previewStep;
+	bool progressive = _settings.renderMode == HeightmapRenderMode::Mesh && previewStep > 1
+		&& static_cast<uint32_t>(modelWidth) >= 2 * previewStep && static_cast<uint32_t>(modelHeight) >= 2 * previewStep;
 
-	// Map the staging texture
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	hr = _deviceContext->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mappedResource);
-	if (FAILED(hr)) {
-		// Handle error
+	//vertexid samples the texture, every other mode meshes the filtered map, edits from UpdateDepthRegion go in unfiltered
+	if (_settings.depthFilter.kind != DepthFilterKind::None && !progressive)
+	{
+		std::vector<uint8_t> filtered;
+		_depthFilter.Apply(depthData.data(), modelWidth, modelHeight, _settings.depthFilter, filtered);
+		depthData.swap(filtered);
+	}
+
+	if (_settings.renderMode == HeightmapRenderMode::Lod)
+	{
+		auto buildStart = std::chrono::high_resolution_clock::now();
+		_lodBuilder.Build(depthData.data(), modelWidth, modelHeight, defaultLodChunkQuads, _lodTerrain);
+		std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - buildStart;
+
+		std::cout << "Heightmap " << modelWidth << "x" << modelHeight << ": " << _lodTerrain.LevelCount() << " lod levels, "
+			<< _lodTerrain.nodes.size() << " chunks, vertex buffer " << sizeof(VertexPositionUv) * _lodTerrain.vertices.size() / 1024
+			<< " KB, built in " << buildTime.count() << " ms" << std::endl;
+
+		D3D11_BUFFER_DESC lodVertexBufferDesc = {};
+		lodVertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		lodVertexBufferDesc.ByteWidth = static_cast<UINT>(sizeof(VertexPositionUv) * _lodTerrain.vertices.size());
+		lodVertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA lodVertexData = {};
+		lodVertexData.pSysMem = _lodTerrain.vertices.data();
+		_device->CreateBuffer(&lodVertexBufferDesc, &lodVertexData, &_vertexBuffer);
+
+		//the 16 stitch variants of a chunk, shared by every node
+		D3D11_BUFFER_DESC lodIndexBufferDesc = {};
+		lodIndexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		lodIndexBufferDesc.ByteWidth = static_cast<UINT>(sizeof(uint16_t) * _lodTerrain.indices.size());
+		lodIndexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA lodIndexData = {};
+		lodIndexData.pSysMem = _lodTerrain.indices.data();
+
+		_indicesBuffer.Reset();
+		_device->CreateBuffer(&lodIndexBufferDesc, &lodIndexData, &_indicesBuffer);
+		_uploadedIndexTable.reset();
 		return;
 	}
 
-	// Copy depth data to a 2D array
-	std::vector<unsigned char> depthData(desc.Width * desc.Height);
-	if (mappedResource.pData) {
-		BYTE* src = reinterpret_cast<BYTE*>(mappedResource.pData);
-		for (int y = 0; y < desc.Height; ++y)
+	if (_settings.renderMode == HeightmapRenderMode::Meshlets)
+	{
+		auto buildStart = std::chrono::high_resolution_clock::now();
+		HeightmapMesh gridMesh;
+		_meshBuilder.Build(depthData.data(), modelWidth, modelHeight, gridMesh);
+		_meshletBuilder.Build(gridMesh, _meshlets);
+		_meshletCuller.SetMeshlets(_meshlets);
+		std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - buildStart;
+
+		std::cout << "Heightmap " << modelWidth << "x" << modelHeight << ": " << _meshlets.meshlets.size() << " meshlets of up to "
+			<< (meshletBlockQuads + 1) * (meshletBlockQuads + 1) << " vertices and " << meshletBlockQuads * meshletBlockQuads * 2
+			<< " triangles, built in " << buildTime.count() << " ms" << std::endl;
+
+		D3D11_BUFFER_DESC meshletVertexBufferDesc = {};
+		meshletVertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		meshletVertexBufferDesc.ByteWidth = static_cast<UINT>(sizeof(VertexPositionUv) * gridMesh.vertices.size());
+		meshletVertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA meshletVertexData = {};
+		meshletVertexData.pSysMem = gridMesh.vertices.data();
+		_device->CreateBuffer(&meshletVertexBufferDesc, &meshletVertexData, &_vertexBuffer);
+
+		//32-bit indices in meshlet order, so the visible meshlets are ranges of one buffer
+		D3D11_BUFFER_DESC meshletIndexBufferDesc = {};
+		meshletIndexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		meshletIndexBufferDesc.ByteWidth = static_cast<UINT>(sizeof(UINT) * _meshlets.indices.size());
+		meshletIndexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA meshletIndexData = {};
+		meshletIndexData.pSysMem = _meshlets.indices.data();
+
+		_indicesBuffer.Reset();
+		_device->CreateBuffer(&meshletIndexBufferDesc, &meshletIndexData, &_indicesBuffer);
+		_uploadedIndexTable.reset();
+		return;
+	}
+
+	if (_settings.renderMode == HeightmapRenderMode::Rtin)
+	{
+		auto buildStart = std::chrono::high_resolution_clock::now();
+		_rtinBuilder.Build(depthData.data(), modelWidth, modelHeight, _settings.maxError, _adaptiveMesh);
+		//the extraction emits triangles depth first through the rtin tree, reorder them for the vertex cache
+		OptimizeVertexCache(_adaptiveMesh.indices.data(), _adaptiveMesh.indices.size(), _adaptiveMesh.vertices.size());
+		OptimizeVertexFetch(_adaptiveMesh.indices, _adaptiveMesh.vertices);
+		std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - buildStart;
+
+		std::cout << "Heightmap " << modelWidth << "x" << modelHeight << ": rtin with max error " << _settings.maxError << ", "
+			<< _adaptiveMesh.indices.size() / 3 << " triangles instead of " << HeightmapMeshBuilder::IndexCount(modelWidth, modelHeight) / 3
+			<< ", " << _adaptiveMesh.vertices.size() << " vertices, built in " << buildTime.count() << " ms" << std::endl;
+
+		UploadAdaptiveMesh(_adaptiveMesh.vertices.data(), _adaptiveMesh.vertices.size(), _adaptiveMesh.indices.data(),
+			_adaptiveMesh.indices.size(), DXGI_FORMAT_R32_UINT);
+		if (cacheMesh)
 		{
-			for (int x = 0; x < desc.Width; ++x)
-			{
-				//only get r channel from rgba image
-				depthData[y * desc.Width + x] = src[(y * mappedResource.RowPitch) + x];
-			}
+			MeshCacheWriter writer;
+			AddAdaptiveMesh(_adaptiveMesh, writer);
+			_meshCache.Store(meshCacheKey, writer);
 		}
-		_deviceContext->Unmap(stagingTexture.Get(), 0);
-	}
-	else {
-		// Handle error
 		return;
 	}
 
-	modelWidth = desc.Width;
-	modelHeight = desc.Height;
-	//convert depth map into mesh
-
-	auto max = std::max_element(depthData.begin(), depthData.end());
+	//the preview is made of the unfiltered map, before the samples move into the job below
+	DepthImage preview;
+	if (progressive)
+	{
+		DepthSamples unfiltered = wideSamples ? depthSamples
+			: DepthSamples{ static_cast<uint32_t>(modelWidth), static_cast<uint32_t>(modelHeight), DepthSampleType::UInt8, depthData.data() };
+		DecimateDepthSamples(unfiltered, previewStep, preview);
+	}
 
-	#pragma region CPU Code
-	_vertices.clear();
-	_indices.clear();
-
-	for (UINT y = 0; y < modelHeight; ++y) {
-		for (UINT x = 0; x < modelWidth; ++x) {
-			// Calculate depth value along the y-axis
-			float depthValue = static_cast<float>(depthData[y * modelWidth + x]) / *max;
-
-			// Calculate x and z positions
-			float posX = static_cast<float>(x) / modelWidth;
-			float posZ = static_cast<float>(y) / modelHeight;
-			float invertedPosZ = 1.0 - posZ;
-			// Use depthValue as the y-coordinate
-			float posY = depthValue;
-
-			// Calculate UV coordinates
-			float uvX = posX;
-			float uvY = invertedPosZ;
-
-			_vertices.push_back(VertexPositionUv{
-				{ posX, posY, invertedPosZ },   // Position
-				{ uvX, uvY }            // UV coordinates
-				});
-
-			if (x < modelWidth - 1 && y < modelHeight - 1) {
-				_indices.push_back(y * modelWidth + x);
-				_indices.push_back(y * modelWidth + x + 1);
-				_indices.push_back((y + 1) * modelWidth + x);
-
-				_indices.push_back((y + 1) * modelWidth + x);
-				_indices.push_back(y * modelWidth + x + 1);
-				_indices.push_back((y + 1) * modelWidth + x + 1);
+	//builds the full mesh and creates its buffers, here or on the worker of _fullMeshBuild. the job owns the decoded or
+	//mapped samples until it is done, the 8-bit ones are _depthData, which nothing else touches until the job is taken
+	auto buildFull = [this, wideSamples, progressive, cacheMesh, meshCacheKey, image = std::move(depthImage),
+		mapped = std::make_shared<RawDepthFile>(std::move(rawDepth))](TiledHeightmapMesh& mesh,
+		ComPtr<ID3D11Buffer>& vertexBuffer, ComPtr<ID3D11Buffer>& normalBuffer)
+	{
+		if (wideSamples)
+		{
+			DepthSamples samples = mapped->Samples().data != nullptr ? mapped->Samples() : image.Samples();
+			VisitDepthSamples(samples, [&](const auto* data) { _meshBuilder.BuildTiled(data, modelWidth, modelHeight, _settings.mesh, mesh); });
+		}
+		else
+		{
+			if (progressive && _settings.depthFilter.kind != DepthFilterKind::None)
+			{
+				std::vector<uint8_t> filtered;
+				_depthFilter.Apply(_depthData.data(), modelWidth, modelHeight, _settings.depthFilter, filtered);
+				_depthData.swap(filtered);
 			}
+			_meshBuilder.BuildTiled(_depthData.data(), modelWidth, modelHeight, _settings.mesh, mesh);
 		}
-	}
-
-	// Create vertex buffer
-	D3D11_BUFFER_DESC vertexBufferDesc = {};
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexPositionUv) * _vertices.size();
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA vertexData = {};
-	vertexData.pSysMem = _vertices.data();
 
-	_device->CreateBuffer(&vertexBufferDesc, &vertexData, &_vertexBuffer);
+		if (cacheMesh)
+		{
+			MeshCacheWriter writer;
+			AddTiledMesh(mesh, writer);
+			_meshCache.Store(meshCacheKey, writer);
+		}
+		return CreateTiledMeshBuffers(mesh.VertexData(), mesh.VertexBytes(), mesh.NormalData(), mesh.NormalBytes(), vertexBuffer, normalBuffer);
+	};
 
-	// Create index buffer
-	D3D11_BUFFER_DESC indexBufferDesc = {};
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(UINT) * _indices.size();
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
+	if (!progressive)
+	{
+		ComPtr<ID3D11Buffer> vertexBuffer;
+		ComPtr<ID3D11Buffer> normalBuffer;
+		if (!buildFull(_mesh, vertexBuffer, normalBuffer))
+			std::cerr << "Error creating the heightmap buffers" << std::endl;
+		ShowTiledMesh(vertexBuffer, normalBuffer);
+		return;
+	}
 
-	D3D11_SUBRESOURCE_DATA indexData = {};
-	indexData.pSysMem = _indices.data();
+	auto previewStart = std::chrono::high_resolution_clock::now();
+	VisitDepthSamples(preview.Samples(), [&](const auto* samples) { _meshBuilder.BuildTiled(samples, preview.width, preview.height, _settings.mesh, _mesh); });
+	UploadTiledMesh(_mesh.VertexData(), _mesh.VertexBytes(), _mesh.NormalData(), _mesh.NormalBytes());
+	std::chrono::duration<double, std::milli> previewTime = std::chrono::high_resolution_clock::now() - previewStart;
+	std::cout << "Heightmap " << modelWidth << "x" << modelHeight << ": preview of " << preview.width << "x" << preview.height << " samples built and uploaded in "
+		<< previewTime.count() << " ms, building the full mesh in the background" << std::endl;
 
-	_device->CreateBuffer(&indexBufferDesc, &indexData, &_indicesBuffer);
+	_fullMeshBuild.Start([this, buildFull = std::move(buildFull)](TiledHeightmapMesh& mesh)
+	{
+		if (!buildFull(mesh, _fullVertexBuffer, _fullNormalBuffer))
+			throw std::runtime_error("cannot create the heightmap buffers");
+	});
 
 	#pragma endregion
 
@@ -807,7 +1184,7 @@ void Application::LoadAndPrepareRenderResource()
 		unsigned int modelWidth;
 		unsigned int modelHeight;
 		float maxDepth;
-	} buffer = {modelWidth, modelHeight, *max};
+	} buffer = {modelWidth, modelHeight, static_cast<float>(_mesh.maxDepth)};
 
 	// Create constant buffer
 	D3D11_BUFFER_DESC constantBufferDesc = {};
@@ -841,25 +1218,7 @@ void Application::LoadAndPrepareRenderResource()
 	_device->CreateUnorderedAccessView(_vertexBuffer.Get(), &uavDesc, &vertexDataUAV);
 
 
-	// Create the structured buffer for index data
-	D3D11_BUFFER_DESC indexBufferDesc = {};
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(UINT) * modelWidth * modelHeight * 6; // Assuming 6 indices per quad
-	indexBufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.StructureByteStride = sizeof(UINT);
-	indexBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-	_device->CreateBuffer(&indexBufferDesc, nullptr, _indicesBuffer.GetAddressOf());
-
-	// Create the UAV for the index buffer
-	D3D11_UNORDERED_ACCESS_VIEW_DESC indexUavDesc = {};
-	indexUavDesc.Format = DXGI_FORMAT_UNKNOWN;
-	indexUavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
-	indexUavDesc.Buffer.FirstElement = 0;
-	indexUavDesc.Buffer.NumElements = modelWidth * modelHeight * 6; // Assuming 6 indices per quad
-
-	ID3D11UnorderedAccessView* indexDataUAV;
-	_device->CreateUnorderedAccessView(_indicesBuffer.Get(), &indexUavDesc, &indexDataUAV);
+	// Indices are not generated here, the shared GridIndexTable buffer is reused for every reload
 
 	// Set compute shader
 	_deviceContext->CSSetShader(_computeShader.Get(), nullptr, 0);
@@ -870,21 +1229,290 @@ void Application::LoadAndPrepareRenderResource()
 	// Bind the input and output structured buffers
 	_deviceContext->CSSetShaderResources(0, 1, &_depthResource);
 	_deviceContext->CSSetUnorderedAccessViews(0, 1, &vertexDataUAV, nullptr);
-	_deviceContext->CSSetUnorderedAccessViews(1, 1, &indexDataUAV, nullptr);
 
 	// Dispatch the compute shader
 	_deviceContext->Dispatch((modelWidth + 15) / 16, (modelHeight + 15) / 16, 1);
 
 	// Unbind the buffers
-	ID3D11UnorderedAccessView* nullUAVs[2] = { nullptr, nullptr };
-	_deviceContext->CSSetUnorderedAccessViews(0, 2, nullUAVs, nullptr);
+	ID3D11UnorderedAccessView* nullUAVs[1] = { nullptr };
+	_deviceContext->CSSetUnorderedAccessViews(0, 1, nullUAVs, nullptr);
 	_deviceContext->CSSetShader(nullptr, nullptr, 0);
 	#pragma endregion*/
 }
 
+// Create index buffer, a reload of the same size keeps the one already on the gpu
+void Application::UploadIndexTable(const std::shared_ptr<const GridIndexTable>& indexTable)
+{
+	if (indexTable == nullptr || indexTable == _uploadedIndexTable)
+		return;
+
+	D3D11_BUFFER_DESC indexBufferDesc = {};
+	indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexBufferDesc.ByteWidth = static_cast<UINT>(sizeof(uint16_t) * indexTable->indices.size());
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA indexData = {};
+	indexData.pSysMem = indexTable->indices.data();
+
+	_indicesBuffer.Reset();
+	_device->CreateBuffer(&indexBufferDesc, &indexData, &_indicesBuffer);
+	_uploadedIndexTable = indexTable;
+}
+
+void Application::UploadTiledMesh(const void* vertices, size_t vertexBytes, const void* normals, size_t normalBytes)
+{
+	ComPtr<ID3D11Buffer> vertexBuffer;
+	ComPtr<ID3D11Buffer> normalBuffer;
+	if (!CreateTiledMeshBuffers(vertices, vertexBytes, normals, normalBytes, vertexBuffer, normalBuffer))
+		std::cerr << "Error creating the heightmap buffers" << std::endl;
+	ShowTiledMesh(vertexBuffer, normalBuffer);
+}
+
+bool Application::CreateTiledMeshBuffers(const void* vertices, size_t vertexBytes, const void* normals, size_t normalBytes,
+	ComPtr<ID3D11Buffer>& vertexBuffer, ComPtr<ID3D11Buffer>& normalBuffer) const
+{
+	// Create vertex buffer
+	D3D11_BUFFER_DESC vertexBufferDesc = {};
+	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	vertexBufferDesc.ByteWidth = static_cast<UINT>(vertexBytes);
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA vertexData = {};
+	vertexData.pSysMem = vertices;
+
+	vertexBuffer.Reset();
+	if (FAILED(_device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer)))
+		return false;
+
+	normalBuffer.Reset();
+	if (normalBytes > 0)
+	{
+		D3D11_BUFFER_DESC normalBufferDesc = {};
+		normalBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		normalBufferDesc.ByteWidth = static_cast<UINT>(normalBytes);
+		normalBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA normalData = {};
+		normalData.pSysMem = normals;
+		if (FAILED(_device->CreateBuffer(&normalBufferDesc, &normalData, &normalBuffer)))
+			return false;
+	}
+	return true;
+}
+
+void Application::ShowTiledMesh(const ComPtr<ID3D11Buffer>& vertexBuffer, const ComPtr<ID3D11Buffer>& normalBuffer)
+{
+	//the size of _mesh, which is smaller than the map while the preview is drawn
+	_perObjectConstantBufferData.gridSize = DirectX::XMFLOAT4(static_cast<float>(_mesh.width), static_cast<float>(_mesh.height), 0.0f,
+		_mesh.normalFormat == HeightmapNormalFormat::Octahedral ? 1.0f : 0.0f);
+
+	_tileBounds.Clear();
+	for (const HeightmapTile& tile : _mesh.tiles)
+		_tileBounds.Add(tile.boundsMin, tile.boundsMax);
+	_visibleTiles.resize(_mesh.tiles.size());
+
+	size_t singleMeshIndexBytes = sizeof(UINT) * HeightmapMeshBuilder::IndexCount(_mesh.width, _mesh.height);
+	size_t tiledIndexBytes = _mesh.indexTable != nullptr ? sizeof(uint16_t) * _mesh.indexTable->indices.size() : 0;
+	std::cout << "Heightmap " << _mesh.width << "x" << _mesh.height << ": " << _mesh.tiles.size()
+		<< (_settings.mesh.topology == GridTopology::TriangleStrip ? " strip" : _settings.mesh.topology == GridTopology::TriangleListBands ? " banded list" : " list")
+		<< " tiles, index buffer "
+		<< tiledIndexBytes / 1024 << " KB instead of " << singleMeshIndexBytes / 1024 << " KB, "
+		<< (_mesh.vertexFormat == HeightmapVertexFormat::Compact ? "compact" : "full") << " vertex buffer "
+		<< BufferBytes(vertexBuffer) / 1024 << " KB instead of "
+		<< sizeof(VertexPositionUv) * HeightmapMeshBuilder::VertexCount(_mesh.width, _mesh.height) / 1024 << " KB, "
+		<< (_mesh.normalFormat == HeightmapNormalFormat::None ? "no" : _mesh.normalFormat == HeightmapNormalFormat::Octahedral ? "octahedral" : "float")
+		<< " normals " << BufferBytes(normalBuffer) / 1024 << " KB" << std::endl;
+
+	_vertexBuffer = vertexBuffer;
+	_normalBuffer = normalBuffer;
+	UploadIndexTable(_mesh.indexTable);
+}
+
+bool Application::ShowFullMesh()
+{
+	std::string error;
+	if (!_fullMeshBuild.TryTake(_mesh, error))
+		return false;
+
+	if (!error.empty())
+	{
+		std::cerr << "Error building the full mesh, keeping the preview: " << error << std::endl;
+		return false;
+	}
+	ShowTiledMesh(_fullVertexBuffer, _fullNormalBuffer);
+	_fullVertexBuffer.Reset();
+	_fullNormalBuffer.Reset();
+
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - _loadStart;
+	std::cout << "Full detail after " << loadTime.count() << " ms, built and uploaded in " << _fullMeshBuild.Seconds() * 1000.0
+		<< " ms on a worker thread" << std::endl;
+	return true;
+}
+
+void Application::UploadAdaptiveMesh(const void* vertices, size_t vertexCount, const void* indices, size_t indexCount, DXGI_FORMAT indexFormat)
+{
+	D3D11_BUFFER_DESC adaptiveVertexBufferDesc = {};
+	adaptiveVertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	adaptiveVertexBufferDesc.ByteWidth = static_cast<UINT>(sizeof(VertexPositionUv) * vertexCount);
+	adaptiveVertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA adaptiveVertexData = {};
+	adaptiveVertexData.pSysMem = vertices;
+	_device->CreateBuffer(&adaptiveVertexBufferDesc, &adaptiveVertexData, &_vertexBuffer);
+
+	//one buffer of 32-bit indices, or 16-bit ones from the mesh cache, the adaptive mesh is not tiled
+	D3D11_BUFFER_DESC adaptiveIndexBufferDesc = {};
+	adaptiveIndexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	adaptiveIndexBufferDesc.ByteWidth = static_cast<UINT>((indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(UINT)) * indexCount);
+	adaptiveIndexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA adaptiveIndexData = {};
+	adaptiveIndexData.pSysMem = indices;
+
+	_indicesBuffer.Reset();
+	_device->CreateBuffer(&adaptiveIndexBufferDesc, &adaptiveIndexData, &_indicesBuffer);
+	_uploadedIndexTable.reset();
+	_adaptiveIndexCount = static_cast<UINT>(indexCount);
+	_adaptiveIndexFormat = indexFormat;
+}
+
+bool Application::LoadCachedMesh(const MeshCacheEntry& entry)
+{
+	if (_settings.renderMode == HeightmapRenderMode::Rtin)
+	{
+		const MeshBlock* vertices = nullptr;
+		const MeshBlock* indices = nullptr;
+		if (!ReadAdaptiveMesh(entry, _adaptiveMesh, vertices, indices))
+			return false;
+
+		modelWidth = static_cast<int>(_adaptiveMesh.width);
+		modelHeight = static_cast<int>(_adaptiveMesh.height);
+		bool narrow = indices->encoding == MeshBlockEncoding::Index16;
+		UploadAdaptiveMesh(vertices->data, vertices->bytes / sizeof(HeightmapVertex), indices->data,
+			indices->bytes / (narrow ? sizeof(uint16_t) : sizeof(uint32_t)), narrow ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT);
+		return true;
+	}
+
+	const MeshBlock* vertices = nullptr;
+	const MeshBlock* normals = nullptr;
+	if (!ReadTiledMesh(entry, _mesh, vertices, normals))
+		return false;
+
+	//the map itself was never decoded, so there is nothing for UpdateDepthRegion to edit
+	_depthData.clear();
+	modelWidth = static_cast<int>(_mesh.width);
+	modelHeight = static_cast<int>(_mesh.height);
+	UploadTiledMesh(vertices->data, vertices->bytes, normals != nullptr ? normals->data : nullptr, normals != nullptr ? normals->bytes : 0);
+	return true;
+}
+
+bool Application::StartSequence()
+{
+	//the pipeline reads the files with the c runtime
+	std::string directory = ToAnsiPath(_settings.sequenceDirectory);
+
+	SequencePipelineOptions options;
+	options.mesh = _settings.mesh;
+	options.framesPerSecond = _settings.sequenceFramesPerSecond;
+	options.filter = _settings.depthFilter;
+	options.loop = true;
+	try
+	{
+		_sequenceUploader = std::make_unique<D3D11SequenceUploader>(_device.Get());
+		_sequence = std::make_unique<SequencePipeline>(options, *_sequenceUploader);
+		_sequence->Start(directory);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << "Error starting the sequence: " << exception.what() << std::endl;
+		_sequence.reset();
+		_sequenceUploader.reset();
+		return false;
+	}
+
+	const SequenceInfo& info = _sequence->Info();
+	modelWidth = static_cast<int>(info.width);
+	modelHeight = static_cast<int>(info.height);
+	_mesh.width = info.width;
+	_mesh.height = info.height;
+	_mesh.vertexFormat = _settings.mesh.vertexFormat;
+	_mesh.normalFormat = _settings.mesh.normalFormat;
+	_perObjectConstantBufferData.gridSize = DirectX::XMFLOAT4(static_cast<float>(info.width), static_cast<float>(info.height), 0.0f,
+		_mesh.normalFormat == HeightmapNormalFormat::Octahedral ? 1.0f : 0.0f);
+
+	std::cout << "Sequence " << directory << ": " << info.frameCount << " frames, depth " << info.width << "x"
+		<< info.height << ", color " << info.colorWidth << "x" << info.colorHeight << std::endl;
+	return true;
+}
+
+//takes the newest frame the pipeline uploaded, if there is one Render has not drawn yet. never waits for the pipeline
+bool Application::ShowLatestSequenceFrame()
+{
+	uint32_t slot = 0;
+	if (_sequence == nullptr || !_sequence->AcquireLatest(slot))
+		return false;
+
+	const D3D11SequenceUploader::Slot& frame = _sequenceUploader->Present(slot, _deviceContext.Get());
+	_vertexBuffer = frame.vertexBuffer;
+	_normalBuffer = frame.normalBuffer;
+	_skinResource = frame.colorView;
+	_mesh.tiles = frame.tiles;
+	_mesh.indexTable = frame.indexTable;
+	_tileBounds = frame.tileBounds;
+	_visibleTiles.resize(frame.tiles.size());
+	UploadIndexTable(frame.indexTable);
+	return true;
+}
+
+bool Application::UpdateDepthRegion(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* samples, size_t rowPitch)
+{
+	//a mesh of 16-bit or float samples has no 8-bit copy to edit, a preview has no map of its size
+	if (_settings.renderMode != HeightmapRenderMode::Mesh || _sequence != nullptr || _mesh.tiles.empty() || _depthData.empty()
+		|| _fullMeshBuild.Running())
+		return false;
+	if (x >= _mesh.width || y >= _mesh.height)
+		return true;
+
+	//parenthesized, windows.h defines min as a macro
+	uint32_t copyWidth = (std::min)(width, _mesh.width - x);
+	uint32_t copyHeight = (std::min)(height, _mesh.height - y);
+	for (uint32_t row = 0; row < copyHeight; ++row)
+		std::copy(samples + row * rowPitch, samples + row * rowPitch + copyWidth, _depthData.data() + static_cast<size_t>(y + row) * _mesh.width + x);
+
+	_meshBuilder.UpdateTiled(_depthData.data(), DepthRect{ x, y, copyWidth, copyHeight }, _mesh, _meshUpdate);
+
+	//boxed updates of the default usage buffers, one per rewritten range and stream
+	size_t vertexStride = _mesh.VertexStride();
+	size_t normalStride = _mesh.NormalStride();
+	for (const VertexRange& range : _meshUpdate.vertexRanges)
+	{
+		uint32_t rangeEnd = range.firstVertex + range.vertexCount;
+		D3D11_BOX vertexBox = { static_cast<UINT>(range.firstVertex * vertexStride), 0, 0, static_cast<UINT>(rangeEnd * vertexStride), 1, 1 };
+		_deviceContext->UpdateSubresource(_vertexBuffer.Get(), 0, &vertexBox,
+			static_cast<const uint8_t*>(_mesh.VertexData()) + range.firstVertex * vertexStride, 0, 0);
+
+		if (_normalBuffer != nullptr)
+		{
+			D3D11_BOX normalBox = { static_cast<UINT>(range.firstVertex * normalStride), 0, 0, static_cast<UINT>(rangeEnd * normalStride), 1, 1 };
+			_deviceContext->UpdateSubresource(_normalBuffer.Get(), 0, &normalBox,
+				static_cast<const uint8_t*>(_mesh.NormalData()) + range.firstVertex * normalStride, 0, 0);
+		}
+	}
+
+	for (uint32_t t : _meshUpdate.tiles)
+		_tileBounds.Set(t, _mesh.tiles[t].boundsMin, _mesh.tiles[t].boundsMax);
+	_redraw.Invalidate(RedrawReason::Scene);
+	return true;
+}
+
 bool Application::Load()
 {
+	_loadStart = std::chrono::high_resolution_clock::now();
 	CreateShaderResources();
+	if (!_settings.sequenceDirectory.empty() && _settings.renderMode == HeightmapRenderMode::Mesh)
+		return StartSequence();
 	LoadAndPrepareRenderResource();
 
 	return true;
@@ -912,6 +1540,10 @@ void Application::Update()
 	XMStoreFloat4x4(&_perFrameConstantBufferData.viewProjectionMatrix, viewProjection);
 
 	UpdateModelBuffer();
+
+	XMFLOAT4X4 cullMatrix;
+	XMStoreFloat4x4(&cullMatrix, XMMatrixMultiply(XMLoadFloat4x4(&_perObjectConstantBufferData.modelMatrix), viewProjection));
+	_frustum = ExtractFrustum(cullMatrix.m);
 	UpdateConstantBuffer();
 }
 
@@ -932,20 +1564,89 @@ void Application::CreateShaderResources()
 	std::wstring VertexShaderFilePath = L"Main.vs.hlsl";
 	std::wstring PixelShaderFilePath = L"Main.ps.hlsl";
 	std::wstring ComputeShaderFilePath = L"GenerateVerticesIndicies.hlsl";
+	auto loadStart = std::chrono::high_resolution_clock::now();
+
+	ShaderBytecode vertexShaderBlob;
 
-	ComPtr<ID3DBlob> vertexShaderBlob;
-	
 	_computeShader = CreateComputeShader(_device.Get(), ComputeShaderFilePath);
-	_vertexShader = CreateVertexShader(_device.Get(), VertexShaderFilePath, vertexShaderBlob);
+	_vertexShader = CreateVertexShader(_device.Get(), VertexShaderFilePath, "Main", vertexShaderBlob);
 	_pixelShader = CreatePixelShader(_device.Get(),PixelShaderFilePath);
 
 	if (FAILED(_device->CreateInputLayout(
 		vertexInputLayoutInfo,
 		_countof(vertexInputLayoutInfo),
-		vertexShaderBlob->GetBufferPointer(),
-		vertexShaderBlob->GetBufferSize(),
+		vertexShaderBlob.data(),
+		vertexShaderBlob.size(),
 		&_inputLayout)))
 		throw std::exception("D3D11: Failed to create the input layout");
+
+	ShaderBytecode compactVertexShaderBlob;
+	_compactVertexShader = CreateVertexShader(_device.Get(), VertexShaderFilePath, "MainCompact", compactVertexShaderBlob);
+
+	if (FAILED(_device->CreateInputLayout(
+		compactVertexInputLayoutInfo,
+		_countof(compactVertexInputLayoutInfo),
+		compactVertexShaderBlob.data(),
+		compactVertexShaderBlob.size(),
+		&_compactInputLayout)))
+		throw std::exception("D3D11: Failed to create the compact input layout");
+
+	ShaderBytecode vertexIdShaderBlob;
+	_vertexIdShader = CreateVertexShader(_device.Get(), VertexShaderFilePath, "MainVertexId", vertexIdShaderBlob);
+
+	if (_settings.renderMode == HeightmapRenderMode::Mesh && _settings.mesh.normalFormat != HeightmapNormalFormat::None)
+		CreateLitShaderResources(VertexShaderFilePath);
+
+	const ShaderCacheStats& stats = _shaderCache.Stats();
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - loadStart;
+	std::cout << "Shaders loaded in " << loadTime.count() << " ms: " << stats.embedded << " embedded, " << stats.disk << " from the cache, "
+		<< stats.compiled << " compiled (" << stats.uncached << " not cacheable), " << stats.failed << " failed" << std::endl;
+
+	if (!_settings.embedShadersPath.empty())
+	{
+		try
+		{
+			_shaderCache.WriteEmbeddedHeader(ToAnsiPath(_settings.embedShadersPath));
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << exception.what() << std::endl;
+		}
+	}
+}
+
+void Application::CreateLitShaderResources(const std::wstring& VertexShaderFilePath)
+{
+
+	//the normal stream is the last element of both lit layouts
+	const D3D11_INPUT_ELEMENT_DESC& normalElement = _settings.mesh.normalFormat == HeightmapNormalFormat::Octahedral
+		? octahedralNormalInputElement : floatNormalInputElement;
+	std::vector<D3D11_INPUT_ELEMENT_DESC> litLayout(std::begin(vertexInputLayoutInfo), std::end(vertexInputLayoutInfo));
+	litLayout.push_back(normalElement);
+	std::vector<D3D11_INPUT_ELEMENT_DESC> compactLitLayout(std::begin(compactVertexInputLayoutInfo), std::end(compactVertexInputLayoutInfo));
+	compactLitLayout.push_back(normalElement);
+
+	ShaderBytecode litVertexShaderBlob;
+	_litVertexShader = CreateVertexShader(_device.Get(), VertexShaderFilePath, "MainLit", litVertexShaderBlob);
+
+	if (FAILED(_device->CreateInputLayout(
+		litLayout.data(),
+		static_cast<UINT>(litLayout.size()),
+		litVertexShaderBlob.data(),
+		litVertexShaderBlob.size(),
+		&_litInputLayout)))
+		throw std::exception("D3D11: Failed to create the lit input layout");
+
+	ShaderBytecode compactLitVertexShaderBlob;
+	_compactLitVertexShader = CreateVertexShader(_device.Get(), VertexShaderFilePath, "MainCompactLit", compactLitVertexShaderBlob);
+
+	if (FAILED(_device->CreateInputLayout(
+		compactLitLayout.data(),
+		static_cast<UINT>(compactLitLayout.size()),
+		compactLitVertexShaderBlob.data(),
+		compactLitVertexShaderBlob.size(),
+		&_compactLitInputLayout)))
+		throw std::exception("D3D11: Failed to create the compact lit input layout");
 }
 
 void Application::CreateDepthStencilView()
@@ -983,7 +1684,7 @@ Application::ComPtr<ID3D11ComputeShader> Application::CreateComputeShader(
 	const std::wstring& filePath
 )
 {
-	ComPtr<ID3DBlob> computeShaderBlob = nullptr;
+	ShaderBytecode computeShaderBlob;
 
 	if (!CompileShader(filePath, "Main", "cs_5_0", computeShaderBlob))
 	{
@@ -992,8 +1693,8 @@ Application::ComPtr<ID3D11ComputeShader> Application::CreateComputeShader(
 
 	Application::ComPtr<ID3D11ComputeShader> computeShader;
 	if (FAILED(device->CreateComputeShader(
-		computeShaderBlob->GetBufferPointer(),
-		computeShaderBlob->GetBufferSize(),
+		computeShaderBlob.data(),
+		computeShaderBlob.size(),
 		nullptr,
 		&computeShader)))
 	{
@@ -1007,17 +1708,18 @@ Application::ComPtr<ID3D11ComputeShader> Application::CreateComputeShader(
 Application::ComPtr<ID3D11VertexShader> Application::CreateVertexShader(
 	ID3D11Device* device,
 	const std::wstring& filePath,
-	Application::ComPtr<ID3DBlob>& vertexShaderBlob)
+	const std::string& entryPoint,
+	ShaderBytecode& vertexShaderBlob)
 {
-	if (!CompileShader(filePath, "Main", "vs_5_0", vertexShaderBlob))
+	if (!CompileShader(filePath, entryPoint, "vs_5_0", vertexShaderBlob))
 	{
 		return nullptr;
 	}
 
 	Application::ComPtr<ID3D11VertexShader> vertexShader;
 	if (FAILED(device->CreateVertexShader(
-		vertexShaderBlob->GetBufferPointer(),
-		vertexShaderBlob->GetBufferSize(),
+		vertexShaderBlob.data(),
+		vertexShaderBlob.size(),
 		nullptr,
 		&vertexShader)))
 	{
@@ -1032,7 +1734,7 @@ Application::ComPtr<ID3D11PixelShader> Application::CreatePixelShader(
 	ID3D11Device* device,
 	const std::wstring& filePath)
 {
-	ComPtr<ID3DBlob> pixelShaderBlob = nullptr;
+	ShaderBytecode pixelShaderBlob;
 	if (!CompileShader(filePath, "Main", "ps_5_0", pixelShaderBlob))
 	{
 		return nullptr;
@@ -1040,8 +1742,8 @@ Application::ComPtr<ID3D11PixelShader> Application::CreatePixelShader(
 
 	ComPtr<ID3D11PixelShader> pixelShader;
 	if (FAILED(device->CreatePixelShader(
-		pixelShaderBlob->GetBufferPointer(),
-		pixelShaderBlob->GetBufferSize(),
+		pixelShaderBlob.data(),
+		pixelShaderBlob.size(),
 		nullptr,
 		&pixelShader)))
 	{
@@ -1056,33 +1758,20 @@ bool Application::CompileShader(
 	const std::wstring& filePath,
 	const std::string& entryPoint,
 	const std::string& profile,
-	ComPtr<ID3DBlob>& shaderBlob)
+	ShaderBytecode& shaderBytecode)
 {
 	constexpr uint32_t compileFlags = D3DCOMPILE_ENABLE_STRICTNESS;
 
-	ComPtr<ID3DBlob> tempShaderBlob = nullptr;
-	ComPtr<ID3DBlob> errorBlob = nullptr;
-	if (FAILED(D3DCompileFromFile(
-		filePath.data(),
-		nullptr,
-		D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		entryPoint.data(),
-		profile.data(),
-		compileFlags,
-		0,
-		&tempShaderBlob,
-		&errorBlob)))
+	//compiles only when neither the embedded table nor the cache directory has bytecode of this exact source
+	ShaderCompileRequest request{ ToAnsiPath(filePath), entryPoint, profile, compileFlags };
+	std::string error;
+	if (!_shaderCache.Load(request, shaderBytecode, error))
 	{
 		std::cerr << "D3D11: Failed to read shader from file\n";
-		if (errorBlob != nullptr)
-		{
-			MessageBoxA(NULL, (std::string("D3D11: With message: ") + static_cast<const char*>(errorBlob->GetBufferPointer())).c_str(), "ERROR", MB_OK);
-		}
-
+		MessageBoxA(NULL, (std::string("D3D11: With message: ") + error).c_str(), "ERROR", MB_OK);
 		return false;
 	}
 
-	shaderBlob = tempShaderBlob;
 	return true;
 }
 
@@ -1114,24 +1803,62 @@ void Application::SetShaderResources()
 {
 	constexpr UINT vertexOffset = 0;
 
-	_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY::D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	UINT stride = static_cast<UINT>(sizeof(VertexPositionUv));
-	
-	_deviceContext->IASetVertexBuffers(
-		0,
-		1,
-		_vertexBuffer.GetAddressOf(),
-		&stride,
-		&vertexOffset);
-
-	_deviceContext->IASetIndexBuffer(
-		_indicesBuffer.Get(),
-		DXGI_FORMAT::DXGI_FORMAT_R32_UINT,
-		0);
+	if (_settings.renderMode == HeightmapRenderMode::VertexId)
+	{
+		//nothing to fetch, every vertex comes from SV_VertexID and the depth texture
+		ID3D11Buffer* noVertexBuffer = nullptr;
+		UINT noStride = 0;
+		_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY::D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		_deviceContext->IASetVertexBuffers(0, 1, &noVertexBuffer, &noStride, &vertexOffset);
+		_deviceContext->IASetInputLayout(nullptr);
+		_deviceContext->VSSetShader(_vertexIdShader.Get(), nullptr, 0);
+		_deviceContext->VSSetShaderResources(0, 1, _depthResource.GetAddressOf());
+	}
+	else
+	{
+		//strips restart at every 0xFFFF index, which the table puts between rows of cells
+		bool tiled = _settings.renderMode == HeightmapRenderMode::Mesh;
+		_deviceContext->IASetPrimitiveTopology(tiled && _mesh.indexTable != nullptr && _mesh.indexTable->topology == GridTopology::TriangleStrip
+			? D3D11_PRIMITIVE_TOPOLOGY::D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP
+			: D3D11_PRIMITIVE_TOPOLOGY::D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		//the meshlets are 32-bit triangle lists of full vertices, the adaptive mesh too unless it came narrowed from the mesh cache,
+		//the lod chunks 16-bit lists of full vertices
+		DXGI_FORMAT indexFormat = DXGI_FORMAT::DXGI_FORMAT_R16_UINT;
+		if (_settings.renderMode == HeightmapRenderMode::Rtin)
+			indexFormat = _adaptiveIndexFormat;
+		else if (_settings.renderMode == HeightmapRenderMode::Meshlets)
+			indexFormat = DXGI_FORMAT::DXGI_FORMAT_R32_UINT;
+		bool compact = tiled && _mesh.vertexFormat == HeightmapVertexFormat::Compact;
+		bool lit = tiled && _normalBuffer != nullptr;
+		UINT strides[2] = { static_cast<UINT>(tiled ? _mesh.VertexStride() : sizeof(VertexPositionUv)), static_cast<UINT>(_mesh.NormalStride()) };
+		UINT offsets[2] = { vertexOffset, vertexOffset };
+		ID3D11Buffer* vertexBuffers[2] = { _vertexBuffer.Get(), _normalBuffer.Get() };
+
+		_deviceContext->IASetVertexBuffers(
+			0,
+			lit ? 2 : 1,
+			vertexBuffers,
+			strides,
+			offsets);
+
+		_deviceContext->IASetIndexBuffer(
+			_indicesBuffer.Get(),
+			indexFormat,
+			0);
+
+		if (lit)
+		{
+			_deviceContext->IASetInputLayout(compact ? _compactLitInputLayout.Get() : _litInputLayout.Get());
+			_deviceContext->VSSetShader(compact ? _compactLitVertexShader.Get() : _litVertexShader.Get(), nullptr, 0);
+		}
+		else
+		{
+			_deviceContext->IASetInputLayout(compact ? _compactInputLayout.Get() : _inputLayout.Get());
+			_deviceContext->VSSetShader(compact ? _compactVertexShader.Get() : _vertexShader.Get(), nullptr, 0);
+		}
+	}
 
-	_deviceContext->IASetInputLayout(_inputLayout.Get());
-	_deviceContext->VSSetShader(_vertexShader.Get(), nullptr, 0);
 	_deviceContext->PSSetShader(_pixelShader.Get(), nullptr, 0);
 
 	_deviceContext->PSSetSamplers(0, 1, _samplerState.GetAddressOf());
@@ -1162,58 +1889,68 @@ void Application::Render()
 	_deviceContext->RSSetState(_rasterState.Get());
 	SetConstantBuffer();
 
-	_deviceContext->DrawIndexed(_indices.size(), 0, 0);
-
-	//draw base
-	std::vector<VertexPositionUv> baseVertices = {
-		{{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},  // Bottom-left corner (red)
-		{{1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},  // Bottom-right corner (red)
-		{{1.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},  // Top-right corner (red)
-		{{0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}}   // Top-left corner (red)
-	};
-
-	std::vector<UINT> baseIndices = {
-		0, 1, 2,  // First triangle
-		2, 3, 0   // Second triangle
-	};
-
-	// Create vertex buffer for base
-	D3D11_BUFFER_DESC baseVertexBufferDesc = {};
-	baseVertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	baseVertexBufferDesc.ByteWidth = sizeof(VertexPositionUv) * baseVertices.size();
-	baseVertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	baseVertexBufferDesc.CPUAccessFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA baseVertexData = {};
-	baseVertexData.pSysMem = baseVertices.data();
-
-	ID3D11Buffer* baseVertexBuffer;
-	_device->CreateBuffer(&baseVertexBufferDesc, &baseVertexData, &baseVertexBuffer);
-
-	// Create index buffer for base
-	D3D11_BUFFER_DESC baseIndexBufferDesc = {};
-	baseIndexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	baseIndexBufferDesc.ByteWidth = sizeof(UINT) * baseIndices.size();
-	baseIndexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	baseIndexBufferDesc.CPUAccessFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA baseIndexData = {};
-	baseIndexData.pSysMem = baseIndices.data();
+	if (_settings.renderMode == HeightmapRenderMode::VertexId)
+	{
+		_deviceContext->Draw(GridVertexIdCount(modelWidth, modelHeight), 0);
+	}
+	else if (_settings.renderMode == HeightmapRenderMode::Rtin)
+	{
+		_deviceContext->DrawIndexed(_adaptiveIndexCount, 0, 0);
+	}
+	else if (_settings.renderMode == HeightmapRenderMode::Lod)
+	{
+		//nodes picked for the current camera, each drawn with the stitch variant matching its coarser neighbours
+		for (const LodDraw& draw : _lodSelector.Select(_lodTerrain, CurrentLodView()))
+		{
+			const TileIndexRange& range = _lodTerrain.stitchRanges[draw.stitchMask];
+			_deviceContext->DrawIndexed(range.indexCount, range.startIndex, static_cast<INT>(_lodTerrain.nodes[draw.node].baseVertex));
+		}
+	}
+	else if (_settings.renderMode == HeightmapRenderMode::Meshlets)
+	{
+		//runs of neighbouring meshlets that survive the frustum and cone tests, one draw each
+		float eye[3];
+		LocalEyePosition(eye);
+		for (const MeshletDraw& draw : _meshletCuller.Cull(_meshlets, _frustum, eye))
+			_deviceContext->DrawIndexed(draw.indexCount, draw.startIndex, 0);
+	}
+	else
+	{
+		//one draw per tile that reaches into the view, the tile indices are relative to its own vertex block
+		uint32_t visibleCount = _cullKernels.cullBoxes(_frustum, _tileBounds, _visibleTiles.data());
+		for (uint32_t i = 0; i < visibleCount; ++i)
+		{
+			const HeightmapTile& tile = _mesh.tiles[_visibleTiles[i]];
+			_deviceContext->DrawIndexed(tile.indexCount, tile.startIndex, static_cast<INT>(tile.baseVertex));
+		}
+	}
 
-	ID3D11Buffer* baseIndexBuffer;
-	_device->CreateBuffer(&baseIndexBufferDesc, &baseIndexData, &baseIndexBuffer);
+	//draw base, its buffers were created once by CreateStaticGeometry
+	ID3D11Buffer* baseVertexBuffer = D3D11BufferDevice::Buffer(_baseQuad->vertexBuffer);
 
 	// Set the vertex buffer for the base
-	UINT stride = sizeof(VertexPositionUv);
+	UINT stride = _baseQuad->vertexStride;
 	UINT offset = 0;
 	_deviceContext->IASetVertexBuffers(0, 1, &baseVertexBuffer, &stride, &offset);
 
 	// Set the index buffer for the base
-	_deviceContext->IASetIndexBuffer(baseIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	_deviceContext->IASetIndexBuffer(D3D11BufferDevice::Buffer(_baseQuad->indexBuffer), DXGI_FORMAT_R32_UINT, 0);
+	_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY::D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	//the base is always full VertexPositionUv, whatever format the heightmap uses
+	_deviceContext->IASetInputLayout(_inputLayout.Get());
+	_deviceContext->VSSetShader(_vertexShader.Get(), nullptr, 0);
 
 	// Draw the base
-	_deviceContext->DrawIndexed(baseIndices.size(), 0, 0);
+	_deviceContext->DrawIndexed(_baseQuad->indexCount, 0, 0);
+
 
+	_swapChain->Present(_framePacer.SyncInterval(), 0);
 
-	_swapChain->Present(1, 0);
+	if (!_firstFramePresented)
+	{
+		_firstFramePresented = true;
+		std::chrono::duration<double, std::milli> firstFrameTime = std::chrono::high_resolution_clock::now() - _loadStart;
+		std::cout << "First frame after " << firstFrameTime.count() << " ms" << (_fullMeshBuild.Running() ? ", showing the preview" : "") << std::endl;
+	}
 }
\ No newline at end of file
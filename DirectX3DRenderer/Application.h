@@ -9,6 +9,22 @@
 #include <DirectXMath.h>
 #include <map>
 #include <chrono>
+#include "HeightmapMeshBuilder.h"
+#include "ChunkedLod.h"
+#include "MeshCache.h"
+#include "DepthImage.h"
+#include "FrustumCulling.h"
+#include "MeshletBuilder.h"
+#include "ProgressiveMesh.h"
+#include "RenderSettings.h"
+#include "RtinMeshBuilder.h"
+#include "D3D11BufferDevice.h"
+#include "D3D11SequenceUploader.h"
+#include "D3DShaderCompiler.h"
+#include "FramePacer.h"
+#include "FixedTimestep.h"
+#include "RedrawTracker.h"
+#include "SequencePipeline.h"
 
 using Position = DirectX::XMFLOAT3;
 using Uv = DirectX::XMFLOAT2;
@@ -18,6 +34,10 @@ struct VertexPositionUv {
 	Uv texCoord;
 };
 
+//the mesh builder writes HeightmapVertex, which is uploaded as VertexPositionUv without conversion
+static_assert(sizeof(HeightmapVertex) == sizeof(VertexPositionUv), "HeightmapVertex must match VertexPositionUv");
+static_assert(offsetof(HeightmapVertex, texCoord) == offsetof(VertexPositionUv, texCoord), "HeightmapVertex must match VertexPositionUv");
+
 struct PerFrameConstantBuffer
 {
 	DirectX::XMFLOAT4X4 viewProjectionMatrix;
@@ -26,8 +46,11 @@ struct PerFrameConstantBuffer
 struct PerObjectConstantBuffer
 {
 	DirectX::XMFLOAT4X4 modelMatrix;
+	DirectX::XMFLOAT4 gridSize;	//heightmap width and height in samples, used by MainCompact to dequantize
 };
 
+static_assert(sizeof(PerObjectConstantBuffer) == 80, "PerObjectConstantBuffer must match cbuffer PerObject in Main.vs.hlsl");
+
 constexpr D3D11_INPUT_ELEMENT_DESC vertexInputLayoutInfo[] ={
 	{
 		"POSITION",
@@ -49,6 +72,52 @@ constexpr D3D11_INPUT_ELEMENT_DESC vertexInputLayoutInfo[] ={
 	}
 };
 
+//CompactHeightmapVertex, read by the MainCompact entry point of Main.vs.hlsl
+constexpr D3D11_INPUT_ELEMENT_DESC compactVertexInputLayoutInfo[] ={
+	{
+		"GRID",
+		0,
+		DXGI_FORMAT::DXGI_FORMAT_R16G16_UINT,
+		0,
+		offsetof(CompactHeightmapVertex, gridX),
+		D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA,
+		0
+	},
+	{
+		"HEIGHT",
+		0,
+		DXGI_FORMAT::DXGI_FORMAT_R16G16_UNORM,
+		0,
+		offsetof(CompactHeightmapVertex, height),
+		D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA,
+		0
+	}
+};
+
+//normal stream of the lit entry points MainLit and MainCompactLit, appended to either layout above
+constexpr D3D11_INPUT_ELEMENT_DESC floatNormalInputElement =
+{
+	"NORMAL",
+	0,
+	DXGI_FORMAT::DXGI_FORMAT_R32G32B32_FLOAT,
+	1,
+	0,
+	D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA,
+	0
+};
+
+//OctahedralNormal, decoded by DecodeNormal in Main.vs.hlsl
+constexpr D3D11_INPUT_ELEMENT_DESC octahedralNormalInputElement =
+{
+	"NORMAL",
+	0,
+	DXGI_FORMAT::DXGI_FORMAT_R16G16_SNORM,
+	1,
+	0,
+	D3D11_INPUT_CLASSIFICATION::D3D11_INPUT_PER_VERTEX_DATA,
+	0
+};
+
 enum Direction {
 	FRONT,
 	BACK,
@@ -63,14 +132,19 @@ class Application
 
 private:
 	#pragma region Windows Properties
+	RenderSettings _settings;
 	HWND _window;
 	HINSTANCE _hinst;
 	int window_width;
 	int window_height;
 
-	float _deltaTime = 0.016f;
-	std::chrono::high_resolution_clock::time_point _oldTime;
-	std::chrono::high_resolution_clock::time_point _currentTime;
+	float _deltaTime = 0.0f;	//seconds of the previous frame, 0 before the first one
+	std::chrono::high_resolution_clock::time_point _loadStart;
+	SystemFrameClock _frameClock;
+	FramePacer _framePacer;	//of _frameClock, declared after it
+	FixedTimestep _timestep;	//steps of the camera motion
+	RedrawTracker _redraw;
+	bool _firstFramePresented = false;
 	#pragma endregion
 
 	#pragma region Camera Control
@@ -78,11 +152,14 @@ private:
 	DirectX::XMFLOAT3 cameraTarget;
 	DirectX::XMFLOAT3 cameraUp;
 	DirectX::XMMATRIX viewMatrix;
+	DirectX::XMFLOAT3 eyePosition;	//camera position after the pan and zoom offsets of UpdateViewMatrix
 	float cameraSpeed;
 	float cameraOffsetZ;
 	float modelScale;
 	float viewOffsetX;
 	float viewOffsetY;
+	float previousViewOffsetX;	//before the last step of _timestep, the view is drawn in between
+	float previousViewOffsetY;
 
 	bool isMovingLeft;
 	bool isMovingRight;
@@ -114,16 +191,53 @@ private:
 	ComPtr<ID3D11VertexShader> _vertexShader = nullptr;
 	ComPtr<ID3D11PixelShader> _pixelShader = nullptr;
 	ComPtr<ID3D11InputLayout> _inputLayout = nullptr;
+	ComPtr<ID3D11VertexShader> _compactVertexShader = nullptr;
+	ComPtr<ID3D11InputLayout> _compactInputLayout = nullptr;
+	ComPtr<ID3D11VertexShader> _vertexIdShader = nullptr;
+	ComPtr<ID3D11VertexShader> _litVertexShader = nullptr;
+	ComPtr<ID3D11InputLayout> _litInputLayout = nullptr;
+	ComPtr<ID3D11VertexShader> _compactLitVertexShader = nullptr;
+	ComPtr<ID3D11InputLayout> _compactLitInputLayout = nullptr;
 	//ComPtr<ID3D11Buffer> _cubeVertices = nullptr;
 	//ComPtr<ID3D11Buffer> _cubeIndices = nullptr;
 	ComPtr<ID3D11Buffer> _vertexBuffer = nullptr;
 	ComPtr<ID3D11Buffer> _indicesBuffer = nullptr;
+	ComPtr<ID3D11Buffer> _normalBuffer = nullptr;	//second stream of the tiled mesh, empty without normals
 	ComPtr<ID3D11Buffer> _constantBuffer = nullptr;
 	ComPtr<ID3D11ShaderResourceView> _depthResource = nullptr;
 	ComPtr<ID3D11ShaderResourceView> _skinResource = nullptr;
 
-	std::vector<VertexPositionUv> _vertices;
-	std::vector<UINT> _indices;
+	HeightmapMeshBuilder _meshBuilder{ HeightmapOrientation::HeightAlongY };
+	std::vector<uint8_t> _depthData;	//the loaded map after the depth filter, kept for UpdateDepthRegion. empty when the mesh was built from wider samples
+	DepthFilter _depthFilter;
+	TiledHeightmapMesh _mesh;	//the preview while _fullMeshBuild runs
+	TiledMeshUpdate _meshUpdate;
+	BackgroundMeshBuild _fullMeshBuild;	//builds the full mesh of a map whose preview is drawn meanwhile
+	ComPtr<ID3D11Buffer> _fullVertexBuffer = nullptr;	//created by the worker of _fullMeshBuild
+	ComPtr<ID3D11Buffer> _fullNormalBuffer = nullptr;
+	std::shared_ptr<const GridIndexTable> _uploadedIndexTable;
+	RtinMeshBuilder _rtinBuilder{ HeightmapOrientation::HeightAlongY };
+	HeightmapMesh _adaptiveMesh;	//empty when the buffers were uploaded from the mesh cache
+	UINT _adaptiveIndexCount = 0;
+	DXGI_FORMAT _adaptiveIndexFormat = DXGI_FORMAT_R32_UINT;
+	MeshCache _meshCache;
+	D3DShaderCompiler _shaderCompiler;
+	ShaderCache _shaderCache;	//of _shaderCompiler, declared after it
+	ChunkedLodBuilder _lodBuilder{ HeightmapOrientation::HeightAlongY };
+	LodTerrain _lodTerrain;
+	LodSelector _lodSelector;
+	BoundingBoxes _tileBounds;		//one box per tile of _mesh
+	std::vector<uint32_t> _visibleTiles;
+	Frustum _frustum{};				//of model * view * projection, the tile boxes are in the local space of the mesh
+	const FrustumCullKernels& _cullKernels = GetFrustumCullKernels(SimdLevel::AVX512);
+	MeshletBuilder _meshletBuilder{ HeightmapOrientation::HeightAlongY };
+	MeshletMesh _meshlets;
+	MeshletCuller _meshletCuller;
+	std::unique_ptr<D3D11SequenceUploader> _sequenceUploader;
+	std::unique_ptr<SequencePipeline> _sequence;	//set while --sequence plays, draws through _mesh like a single map
+	std::unique_ptr<D3D11BufferDevice> _bufferDevice;
+	std::unique_ptr<GeometryPool> _staticGeometry;	//of _bufferDevice, declared after it
+	const StaticGeometry* _baseQuad = nullptr;	//in _staticGeometry
 	#pragma region
 
 	#pragma region Window Management
@@ -137,6 +251,10 @@ private:
 	bool Load();
 	void Update();
 	void Render();
+	//swaps in a sequence frame or the full mesh when one is ready, they do not arrive through messages
+	void PollScene();
+	//blocks until a message arrives, or until the next PollScene is due while the scene can still change
+	void WaitForChange();
 	void initialize(int _nCmdShow);
 	void initialize_directX();
 	void OnWindowResized();
@@ -145,8 +263,11 @@ private:
 	#pragma region Camera Control
 	void InitializeCamera();
 	void UpdateCameraPosition();
+	void StepCamera(float seconds);
 	void UpdateViewMatrix();
 	void UpdateModelBuffer();
+	void LocalEyePosition(float eye[3]) const;
+	LodView CurrentLodView() const;
 	void PanModel(float dx, float dy);
 	void RotateModel(float dx, float dy);
 	void ZoomView(float dz);
@@ -159,12 +280,30 @@ private:
 	void DestroySwapchainResources();
 	void CreateDepthState();
 	void CreateConstantBuffer();
+	//the buffers that live as long as the device, the base quad
+	void CreateStaticGeometry();
 	void CreateRasterState();
 	void CreateSamplerState();
 	void CreateShaderResources();
+	//the vertex shaders and layouts of the normal stream, mesh mode only
+	void CreateLitShaderResources(const std::wstring& VertexShaderFilePath);
 	void CreateDepthStencilView();
 	void UpdateConstantBuffer();
 	void LoadAndPrepareRenderResource();
+	void UploadIndexTable(const std::shared_ptr<const GridIndexTable>& indexTable);
+	//create the buffers of _mesh and _adaptiveMesh from data that was just built or sits in a mapped mesh cache entry
+	void UploadTiledMesh(const void* vertices, size_t vertexBytes, const void* normals, size_t normalBytes);
+	//only touches the device, which is free threaded, so the worker of _fullMeshBuild calls it too
+	bool CreateTiledMeshBuffers(const void* vertices, size_t vertexBytes, const void* normals, size_t normalBytes,
+		ComPtr<ID3D11Buffer>& vertexBuffer, ComPtr<ID3D11Buffer>& normalBuffer) const;
+	//draws _mesh from the buffers from now on
+	void ShowTiledMesh(const ComPtr<ID3D11Buffer>& vertexBuffer, const ComPtr<ID3D11Buffer>& normalBuffer);
+	//swaps the preview for the full mesh once _fullMeshBuild has it, never waits. returns whether it did
+	bool ShowFullMesh();
+	void UploadAdaptiveMesh(const void* vertices, size_t vertexCount, const void* indices, size_t indexCount, DXGI_FORMAT indexFormat);
+	bool LoadCachedMesh(const MeshCacheEntry& entry);
+	bool StartSequence();
+	bool ShowLatestSequenceFrame();
 
 	void SetRenderTarget();
 	void SetShaderResources();
@@ -178,7 +317,8 @@ private:
 	ComPtr<ID3D11VertexShader> CreateVertexShader(
 		ID3D11Device* device,
 		const std::wstring& filePath,
-		ComPtr<ID3DBlob>& vertexShaderBlob);
+		const std::string& entryPoint,
+		ShaderBytecode& vertexShaderBytecode);
 	ComPtr<ID3D11PixelShader>CreatePixelShader(
 		ID3D11Device* device,
 		const std::wstring& filePath);
@@ -186,12 +326,17 @@ private:
 		const std::wstring& filePath,
 		const std::string& entryPoint,
 		const std::string& profile,
-		ComPtr<ID3DBlob>& shaderBlob);
+		ShaderBytecode& shaderBytecode);
 	#pragma endregion
 public:
-	Application(HINSTANCE hinst, int _nCmdShow);
+	Application(HINSTANCE hinst, int _nCmdShow, const RenderSettings& settings = {});
 	~Application();
 	void Run();
+
+	//writes width x height samples, rowPitch bytes apart, into the loaded map at (x, y) and uploads only the vertices,
+	//normals and tile boxes that depend on them. false when the render mode does not draw the tiled mesh of a single 8-bit map,
+	//when that mesh was loaded from the mesh cache, or while only its preview is drawn
+	bool UpdateDepthRegion(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* samples, size_t rowPitch);
 	static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 };
 
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <d3dcompiler.h>
 #include "WICTextureLoader.h"
+#include "DepthImage.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -663,7 +664,6 @@ void Application2::Run()
 void Application2::LoadAndPrepareRenderResource()
 {
 	//load and process height map
-	vertices.clear();
 
 	//load rgb skin
 	if (FAILED(DirectX::CreateWICTextureFromFile(_device.Get(), L"C:\\Users\\Payhemfoh\\source\\repos\\DirectX3DRenderer\\data\\rgb.jpg", nullptr, &_skinResource)))
@@ -672,118 +672,38 @@ void Application2::LoadAndPrepareRenderResource()
 		return;
 	}
 
-	//load depth map
-	ComPtr<ID3D11Resource> resource;
-	if (FAILED(DirectX::CreateWICTextureFromFile(_device.Get(), L"C:\\Users\\Payhemfoh\\source\\repos\\DirectX3DRenderer\\data\\depth.jpg", &resource, &_depthResource)))
+	//decode the depth map on the cpu into one sample per pixel, nothing here samples it as a texture
+	DepthImage depthImage;
+	if (!DecodeDepthImage(L"C:\\Users\\Payhemfoh\\source\\repos\\DirectX3DRenderer\\data\\depth.jpg", depthImage))
 	{
 		std::cerr << "Error loading texture" << std::endl;
 		return;
 	}
 
-	//copy depth map into 2d array
-	ComPtr<ID3D11Texture2D> depthTexture2D;
-	resource.As(&depthTexture2D);
-
-	// Get the description of the original depth texture
-	D3D11_TEXTURE2D_DESC desc;
-	depthTexture2D->GetDesc(&desc);
-
-	// Modify the description for a staging texture
-	D3D11_TEXTURE2D_DESC stagingDesc = desc;
-	stagingDesc.Usage = D3D11_USAGE_STAGING;
-	stagingDesc.BindFlags = 0;
-	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-	stagingDesc.MiscFlags = 0;
-
-	// Create the staging texture
-	ComPtr<ID3D11Texture2D> stagingTexture;
-	HRESULT hr = _device->CreateTexture2D(&stagingDesc, nullptr, stagingTexture.GetAddressOf());
-	if (FAILED(hr)) {
-		// Handle error
-		return;
-	}
-
-	_deviceContext->CopyResource(stagingTexture.Get(), depthTexture2D.Get());
-
-	// Map the staging texture
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	hr = _deviceContext->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mappedResource);
-	if (FAILED(hr)) {
-		// Handle error
-		return;
-	}
-
-	// Copy depth data to a 2D array
-	std::vector<unsigned char> depthData(desc.Width * desc.Height);
-	if (mappedResource.pData) {
-		BYTE* src = reinterpret_cast<BYTE*>(mappedResource.pData);
-		for (int y = 0; y < desc.Height; ++y)
-		{
-			for (int x = 0; x < desc.Width; ++x)
-			{
-				//only get r channel from rgba image
-				depthData[y * desc.Width + x] = src[(y * mappedResource.RowPitch) + x];
-			}
-		}
-		_deviceContext->Unmap(stagingTexture.Get(), 0);
-	}
-	else {
-		// Handle error
-		return;
-	}
-
-	modelWidth = desc.Width;
-	modelHeight = desc.Height;
-	//convert depth map into mesh
-	vertices.clear();
-	indices.clear();
-
-	auto max = std::max_element(depthData.begin(), depthData.end());
-
-	for (UINT y = 0; y < modelHeight; ++y) {
-		for (UINT x = 0; x < modelWidth; ++x) {
-			float depthValue = ((float)depthData[y * modelWidth + x]) / *max;
-			float posX = static_cast<float>(x) / modelWidth;
-			float posY = static_cast<float>(y) / modelHeight;
-
-			float invertedPosY = 1.0f - posY;
-
-			vertices.push_back(VertexPositionUv{
-				{ posX, invertedPosY, depthValue },
-				{ posX, invertedPosY }
-				});
-
-			if (x < modelWidth - 1 && y < modelHeight - 1) {
-				indices.push_back(y * modelWidth + x);
-				indices.push_back(y * modelWidth + x + 1);
-				indices.push_back((y + 1) * modelWidth + x);
-
-				indices.push_back((y + 1) * modelWidth + x);
-				indices.push_back(y * modelWidth + x + 1);
-				indices.push_back((y + 1) * modelWidth + x + 1);
-			}
-		}
-	}
+	modelWidth = depthImage.width;
+	modelHeight = depthImage.height;
+	//convert depth map into mesh, 16-bit and float maps without an 8-bit copy
+	VisitDepthSamples(depthImage.Samples(), [&](const auto* samples) { meshBuilder.Build(samples, modelWidth, modelHeight, mesh); });
 
 	// Create vertex buffer
 	D3D11_BUFFER_DESC vertexBufferDesc = {};
 	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = static_cast<UINT>(vertices.size() * sizeof(VertexPositionUv));
+	vertexBufferDesc.ByteWidth = static_cast<UINT>(mesh.vertices.size() * sizeof(VertexPositionUv));
 	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
 	D3D11_SUBRESOURCE_DATA vertexData = {};
-	vertexData.pSysMem = vertices.data();
+	vertexData.pSysMem = mesh.vertices.data();
 
 	_device->CreateBuffer(&vertexBufferDesc, &vertexData, _vertexBuffer.GetAddressOf());
 
 	// Create index buffer
 	D3D11_BUFFER_DESC indexBufferDesc = {};
 	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = static_cast<UINT>(indices.size() * sizeof(UINT));
+	indexBufferDesc.ByteWidth = static_cast<UINT>(mesh.indices.size() * sizeof(UINT));
 	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 
 	D3D11_SUBRESOURCE_DATA indexData = {};
-	indexData.pSysMem = indices.data();
+	indexData.pSysMem = mesh.indices.data();
 
 	_device->CreateBuffer(&indexBufferDesc, &indexData, _indicesBuffer.GetAddressOf());
 }
@@ -1040,6 +960,6 @@ void Application2::Render()
 	SetConstantBuffer();
 	//_deviceContext->Draw(vertices.size(), 0);
 
-	_deviceContext->DrawIndexed(static_cast<UINT>(indices.size()), 0, 0);
+	_deviceContext->DrawIndexed(static_cast<UINT>(mesh.indices.size()), 0, 0);
 	_swapChain->Present(1, 0);
 }
\ No newline at end of file
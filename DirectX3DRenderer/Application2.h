@@ -9,6 +9,7 @@
 #include <DirectXMath.h>
 #include <map>
 #include <chrono>
+#include "HeightmapMeshBuilder.h"
 
 using Position = DirectX::XMFLOAT3;
 using Uv = DirectX::XMFLOAT2;
@@ -18,6 +19,10 @@ struct VertexPositionUv {
 	Uv texCoord;
 };
 
+//the mesh builder writes HeightmapVertex, which is uploaded as VertexPositionUv without conversion
+static_assert(sizeof(HeightmapVertex) == sizeof(VertexPositionUv), "HeightmapVertex must match VertexPositionUv");
+static_assert(offsetof(HeightmapVertex, texCoord) == offsetof(VertexPositionUv, texCoord), "HeightmapVertex must match VertexPositionUv");
+
 struct PerFrameConstantBuffer
 {
 	DirectX::XMFLOAT4X4 viewProjectionMatrix;
@@ -26,8 +31,11 @@ struct PerFrameConstantBuffer
 struct PerObjectConstantBuffer
 {
 	DirectX::XMFLOAT4X4 modelMatrix;
+	DirectX::XMFLOAT4 gridSize;	//not read by the Main entry point, but part of the PerObject cbuffer of Main.vs.hlsl
 };
 
+static_assert(sizeof(PerObjectConstantBuffer) == 80, "PerObjectConstantBuffer must match cbuffer PerObject in Main.vs.hlsl");
+
 constexpr D3D11_INPUT_ELEMENT_DESC vertexInputLayoutInfo[] ={
 	{
 		"POSITION",
@@ -120,8 +128,8 @@ private:
 	ComPtr<ID3D11ShaderResourceView> _depthResource = nullptr;
 	ComPtr<ID3D11ShaderResourceView> _skinResource = nullptr;
 
-	std::vector<VertexPositionUv> vertices;
-	std::vector<uint32_t> indices;
+	HeightmapMeshBuilder meshBuilder{ HeightmapOrientation::HeightAlongZ };
+	HeightmapMesh mesh;
 	#pragma region
 
 	#pragma region Window Management
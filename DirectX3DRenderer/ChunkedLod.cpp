@@ -0,0 +1,375 @@
+#include "ChunkedLod.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+//grid coordinate of the i-th vertex of a node, vertices past the edge of the map collapse onto it
+static uint32_t NodeSample(uint32_t origin, uint32_t i, uint32_t level, uint32_t limit)
+{
+	return std::min(origin + (i << level), limit - 1);
+}
+
+//local index of vertex (i, j) of a chunk, folded onto its even neighbour along the stitched edges
+static uint16_t StitchedVertex(uint32_t i, uint32_t j, uint32_t chunkQuads, uint32_t stitchMask)
+{
+	if (i % 2 == 1 && ((j == 0 && (stitchMask & LodStitchTop)) || (j == chunkQuads && (stitchMask & LodStitchBottom))))
+		--i;
+	if (j % 2 == 1 && ((i == 0 && (stitchMask & LodStitchLeft)) || (i == chunkQuads && (stitchMask & LodStitchRight))))
+		--j;
+	return static_cast<uint16_t>(j * (chunkQuads + 1) + i);
+}
+
+//same cell split as WriteTileIndices, the triangles that folding made degenerate are dropped
+static void WriteStitchedChunkIndices(uint32_t chunkQuads, uint32_t stitchMask, std::vector<uint16_t>& out)
+{
+	for (uint32_t j = 0; j < chunkQuads; ++j)
+	{
+		for (uint32_t i = 0; i < chunkQuads; ++i)
+		{
+			uint16_t topLeft = StitchedVertex(i, j, chunkQuads, stitchMask);
+			uint16_t topRight = StitchedVertex(i + 1, j, chunkQuads, stitchMask);
+			uint16_t bottomLeft = StitchedVertex(i, j + 1, chunkQuads, stitchMask);
+			uint16_t bottomRight = StitchedVertex(i + 1, j + 1, chunkQuads, stitchMask);
+
+			//with both the right and the bottom edge folded, the usual diagonal of the bottom right cell would run
+			//through its top left vertex, the other diagonal closes the corner
+			bool foldedCorner = i + 1 == chunkQuads && j + 1 == chunkQuads
+				&& (stitchMask & LodStitchRight) && (stitchMask & LodStitchBottom);
+			if (foldedCorner)
+			{
+				out.insert(out.end(), { topLeft, topRight, bottomRight });
+				out.insert(out.end(), { topLeft, bottomRight, bottomLeft });
+				continue;
+			}
+
+			if (topLeft != topRight && topLeft != bottomLeft && topRight != bottomLeft)
+				out.insert(out.end(), { topLeft, topRight, bottomLeft });
+			if (bottomLeft != topRight && topRight != bottomRight && bottomLeft != bottomRight)
+				out.insert(out.end(), { bottomLeft, topRight, bottomRight });
+		}
+	}
+}
+
+//largest difference, in depth units, between the samples below a node and the triangles the node draws
+static float NodeDeviation(const uint8_t* depthData, uint32_t width, uint32_t height, const LodNode& node, uint32_t chunkQuads)
+{
+	auto depth = [&](uint32_t x, uint32_t y) { return static_cast<float>(depthData[static_cast<size_t>(y) * width + x]); };
+
+	uint32_t xEnd = NodeSample(node.x, chunkQuads, node.level, width);
+	uint32_t yEnd = NodeSample(node.y, chunkQuads, node.level, height);
+	float deviation = 0.0f;
+	for (uint32_t y = node.y; y <= yEnd; ++y)
+	{
+		uint32_t j = std::min((y - node.y) >> node.level, chunkQuads - 1);
+		uint32_t y0 = NodeSample(node.y, j, node.level, height);
+		uint32_t y1 = NodeSample(node.y, j + 1, node.level, height);
+		float fy = y1 > y0 ? static_cast<float>(y - y0) / static_cast<float>(y1 - y0) : 0.0f;
+
+		for (uint32_t x = node.x; x <= xEnd; ++x)
+		{
+			uint32_t i = std::min((x - node.x) >> node.level, chunkQuads - 1);
+			uint32_t x0 = NodeSample(node.x, i, node.level, width);
+			uint32_t x1 = NodeSample(node.x, i + 1, node.level, width);
+			float fx = x1 > x0 ? static_cast<float>(x - x0) / static_cast<float>(x1 - x0) : 0.0f;
+
+			//the cell is split along its top right to bottom left diagonal
+			float interpolated = fx + fy <= 1.0f
+				? depth(x0, y0) + fx * (depth(x1, y0) - depth(x0, y0)) + fy * (depth(x0, y1) - depth(x0, y0))
+				: depth(x1, y1) + (1.0f - fx) * (depth(x0, y1) - depth(x1, y1)) + (1.0f - fy) * (depth(x1, y0) - depth(x1, y1));
+			deviation = std::max(deviation, std::fabs(interpolated - depth(x, y)));
+		}
+	}
+	return deviation;
+}
+
+uint32_t LodTerrain::LevelCount() const
+{
+	return static_cast<uint32_t>(levelNodesX.size());
+}
+
+uint32_t LodTerrain::NodeIndex(uint32_t level, uint32_t nodeX, uint32_t nodeY) const
+{
+	return levelFirstNode[level] + nodeY * levelNodesX[level] + nodeX;
+}
+
+float LodScreenError(const LodNode& node, const LodView& view)
+{
+	float distanceSquared = 0.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float outside = std::max({ node.boundsMin[axis] - view.eye[axis], 0.0f, view.eye[axis] - node.boundsMax[axis] });
+		distanceSquared += outside * outside;
+	}
+
+	//inside the box counts as infinitely close
+	float distance = std::max(std::sqrt(distanceSquared), 1e-6f);
+	return node.geometricError * view.errorScale / distance;
+}
+
+ChunkedLodBuilder::ChunkedLodBuilder(HeightmapOrientation orientation, unsigned int threadCount)
+	: _orientation(orientation),
+	_pool(threadCount)
+{
+}
+
+void ChunkedLodBuilder::BuildHierarchy(const uint8_t* depthData, uint32_t width, uint32_t height, uint32_t chunkQuads,
+	LodTerrain& terrain) const
+{
+	if (chunkQuads == 0 || chunkQuads % 2 == 1 || chunkQuads > maxHeightmapTileQuads)
+		throw std::invalid_argument("ChunkedLodBuilder: chunk size must be even and between 2 and maxHeightmapTileQuads");
+
+	terrain.width = width;
+	terrain.height = height;
+	terrain.chunkQuads = chunkQuads;
+	terrain.maxDepth = 0;
+	terrain.levelNodesX.clear();
+	terrain.levelNodesY.clear();
+	terrain.levelFirstNode.clear();
+	terrain.nodes.clear();
+	terrain.vertices.clear();
+	terrain.indices.clear();
+
+	for (uint32_t mask = 0; mask < lodStitchVariantCount; ++mask)
+	{
+		TileIndexRange& range = terrain.stitchRanges[mask];
+		range.quadsX = chunkQuads;
+		range.quadsY = chunkQuads;
+		range.startIndex = static_cast<uint32_t>(terrain.indices.size());
+		WriteStitchedChunkIndices(chunkQuads, mask, terrain.indices);
+		range.indexCount = static_cast<uint32_t>(terrain.indices.size()) - range.startIndex;
+	}
+
+	if (width < 2 || height < 2)
+		return;
+
+	terrain.maxDepth = *std::max_element(depthData, depthData + static_cast<size_t>(width) * height);
+	const float depthDivisor = terrain.maxDepth > 0 ? static_cast<float>(terrain.maxDepth) : 1.0f;
+
+	//levels up to the first one that covers the whole map with a single node
+	uint32_t nodeCount = 0;
+	for (uint32_t level = 0;; ++level)
+	{
+		uint64_t span = static_cast<uint64_t>(chunkQuads) << level;
+		uint32_t nodesX = static_cast<uint32_t>((width - 1 + span - 1) / span);
+		uint32_t nodesY = static_cast<uint32_t>((height - 1 + span - 1) / span);
+		terrain.levelNodesX.push_back(nodesX);
+		terrain.levelNodesY.push_back(nodesY);
+		terrain.levelFirstNode.push_back(nodeCount);
+		nodeCount += nodesX * nodesY;
+		if (nodesX == 1 && nodesY == 1)
+			break;
+	}
+	terrain.nodes.resize(nodeCount);
+
+	int depthSlot = _orientation == HeightmapOrientation::HeightAlongY ? 1 : 2;
+	int rowSlot = 3 - depthSlot;
+	uint32_t vertexBlock = (chunkQuads + 1) * (chunkQuads + 1);
+
+	//finest level first, every coarser node takes the bounds and the error of its children into account
+	for (uint32_t level = 0; level < terrain.LevelCount(); ++level)
+	{
+		uint32_t nodesX = terrain.levelNodesX[level];
+		ParallelForRowBands(_pool, terrain.levelNodesY[level], [&](unsigned int, uint32_t rowBegin, uint32_t rowEnd)
+		{
+			for (uint32_t nodeY = rowBegin; nodeY < rowEnd; ++nodeY)
+			{
+				for (uint32_t nodeX = 0; nodeX < nodesX; ++nodeX)
+				{
+					uint32_t index = terrain.NodeIndex(level, nodeX, nodeY);
+					LodNode& node = terrain.nodes[index];
+					node.level = level;
+					node.x = nodeX * (chunkQuads << level);
+					node.y = nodeY * (chunkQuads << level);
+					node.baseVertex = index * vertexBlock;
+
+					uint32_t xEnd = NodeSample(node.x, chunkQuads, level, width);
+					uint32_t yEnd = NodeSample(node.y, chunkQuads, level, height);
+					uint8_t minSample = 255;
+					uint8_t maxSample = 0;
+					if (level == 0)
+					{
+						for (uint32_t y = node.y; y <= yEnd; ++y)
+						{
+							auto row = std::minmax_element(depthData + static_cast<size_t>(y) * width + node.x, depthData + static_cast<size_t>(y) * width + xEnd + 1);
+							minSample = std::min(minSample, *row.first);
+							maxSample = std::max(maxSample, *row.second);
+						}
+						node.geometricError = 0.0f;
+					}
+					else
+					{
+						float childError = 0.0f;
+						float minHeight = 1.0f;
+						float maxHeight = 0.0f;
+						for (uint32_t child = 0; child < 4; ++child)
+						{
+							uint32_t childX = nodeX * 2 + child % 2;
+							uint32_t childY = nodeY * 2 + child / 2;
+							if (childX >= terrain.levelNodesX[level - 1] || childY >= terrain.levelNodesY[level - 1])
+								continue;
+
+							const LodNode& childNode = terrain.nodes[terrain.NodeIndex(level - 1, childX, childY)];
+							childError = std::max(childError, childNode.geometricError);
+							minHeight = std::min(minHeight, childNode.boundsMin[depthSlot]);
+							maxHeight = std::max(maxHeight, childNode.boundsMax[depthSlot]);
+						}
+						minSample = static_cast<uint8_t>(std::lround(minHeight * depthDivisor));
+						maxSample = static_cast<uint8_t>(std::lround(maxHeight * depthDivisor));
+						node.geometricError = std::max(childError, NodeDeviation(depthData, width, height, node, chunkQuads) / depthDivisor);
+					}
+
+					node.boundsMin[0] = static_cast<float>(node.x) / static_cast<float>(width);
+					node.boundsMax[0] = static_cast<float>(xEnd) / static_cast<float>(width);
+					node.boundsMin[rowSlot] = 1.0f - static_cast<float>(yEnd) / static_cast<float>(height);
+					node.boundsMax[rowSlot] = 1.0f - static_cast<float>(node.y) / static_cast<float>(height);
+					node.boundsMin[depthSlot] = static_cast<float>(minSample) / depthDivisor;
+					node.boundsMax[depthSlot] = static_cast<float>(maxSample) / depthDivisor;
+				}
+			}
+		});
+	}
+}
+
+void ChunkedLodBuilder::BuildVertices(const uint8_t* depthData, LodTerrain& terrain) const
+{
+	uint32_t stride = terrain.chunkQuads + 1;
+	terrain.vertices.resize(terrain.nodes.size() * stride * stride);
+
+	const float depthDivisor = terrain.maxDepth > 0 ? static_cast<float>(terrain.maxDepth) : 1.0f;
+	ParallelForRowBands(_pool, static_cast<uint32_t>(terrain.nodes.size()), [&](unsigned int, uint32_t nodeBegin, uint32_t nodeEnd)
+	{
+		for (uint32_t n = nodeBegin; n < nodeEnd; ++n)
+		{
+			const LodNode& node = terrain.nodes[n];
+			HeightmapVertex* out = terrain.vertices.data() + node.baseVertex;
+			for (uint32_t j = 0; j < stride; ++j)
+			{
+				uint32_t y = NodeSample(node.y, j, node.level, terrain.height);
+				for (uint32_t i = 0; i < stride; ++i)
+				{
+					uint32_t x = NodeSample(node.x, i, node.level, terrain.width);
+					float depthValue = static_cast<float>(depthData[static_cast<size_t>(y) * terrain.width + x]) / depthDivisor;
+					*out++ = MakeHeightmapVertex(x, y, terrain.width, terrain.height, depthValue, _orientation);
+				}
+			}
+		}
+	});
+}
+
+void ChunkedLodBuilder::Build(const uint8_t* depthData, uint32_t width, uint32_t height, uint32_t chunkQuads, LodTerrain& terrain) const
+{
+	BuildHierarchy(depthData, width, height, chunkQuads, terrain);
+	BuildVertices(depthData, terrain);
+}
+
+void LodSelector::Assign(uint32_t level, uint32_t nodeX, uint32_t nodeY)
+{
+	uint32_t xEnd = std::min((nodeX + 1) << level, _nodesX);
+	uint32_t yEnd = std::min((nodeY + 1) << level, _nodesY);
+	if ((nodeX << level) >= xEnd)
+		return;
+
+	for (uint32_t y = nodeY << level; y < yEnd; ++y)
+		std::fill(_levels.begin() + y * _nodesX + (nodeX << level), _levels.begin() + y * _nodesX + xEnd, static_cast<uint8_t>(level));
+}
+
+void LodSelector::Refine(const LodTerrain& terrain, const LodView& view, uint32_t level, uint32_t nodeX, uint32_t nodeY)
+{
+	const LodNode& node = terrain.nodes[terrain.NodeIndex(level, nodeX, nodeY)];
+	if (level == 0 || LodScreenError(node, view) <= view.maxPixelError)
+	{
+		Assign(level, nodeX, nodeY);
+		return;
+	}
+
+	for (uint32_t child = 0; child < 4; ++child)
+	{
+		uint32_t childX = nodeX * 2 + child % 2;
+		uint32_t childY = nodeY * 2 + child / 2;
+		if (childX < terrain.levelNodesX[level - 1] && childY < terrain.levelNodesY[level - 1])
+			Refine(terrain, view, level - 1, childX, childY);
+	}
+}
+
+//splits every node that is more than one level coarser than a neighbour, returns false once nothing changed.
+//splitting only ever lowers levels, so the loop ends, and the children of a node that met the error bound meet it too.
+bool LodSelector::Balance()
+{
+	bool changed = false;
+	for (uint32_t y = 0; y < _nodesY; ++y)
+	{
+		for (uint32_t x = 0; x < _nodesX; ++x)
+		{
+			uint32_t level = _levels[y * _nodesX + x];
+			const int32_t offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+			for (const int32_t* offset : offsets)
+			{
+				int32_t neighbourX = static_cast<int32_t>(x) + offset[0];
+				int32_t neighbourY = static_cast<int32_t>(y) + offset[1];
+				if (neighbourX < 0 || neighbourY < 0 || neighbourX >= static_cast<int32_t>(_nodesX) || neighbourY >= static_cast<int32_t>(_nodesY))
+					continue;
+
+				uint32_t neighbourLevel = _levels[neighbourY * _nodesX + neighbourX];
+				if (neighbourLevel <= level + 1)
+					continue;
+
+				uint32_t parentX = static_cast<uint32_t>(neighbourX) >> neighbourLevel;
+				uint32_t parentY = static_cast<uint32_t>(neighbourY) >> neighbourLevel;
+				for (uint32_t child = 0; child < 4; ++child)
+					Assign(neighbourLevel - 1, parentX * 2 + child % 2, parentY * 2 + child / 2);
+				changed = true;
+			}
+		}
+	}
+	return changed;
+}
+
+const std::vector<LodDraw>& LodSelector::Select(const LodTerrain& terrain, const LodView& view)
+{
+	_draws.clear();
+	if (terrain.nodes.empty())
+	{
+		_nodesX = 0;
+		_nodesY = 0;
+		_levels.clear();
+		return _draws;
+	}
+
+	_nodesX = terrain.levelNodesX[0];
+	_nodesY = terrain.levelNodesY[0];
+	_levels.assign(static_cast<size_t>(_nodesX) * _nodesY, 0);
+
+	Refine(terrain, view, terrain.LevelCount() - 1, 0, 0);
+	while (Balance())
+	{
+	}
+
+	//one draw per selected node, found at its top left level 0 node
+	for (uint32_t y = 0; y < _nodesY; ++y)
+	{
+		for (uint32_t x = 0; x < _nodesX; ++x)
+		{
+			uint32_t level = _levels[y * _nodesX + x];
+			uint32_t size = 1u << level;
+			if (x % size != 0 || y % size != 0)
+				continue;
+
+			LodDraw draw{ terrain.NodeIndex(level, x >> level, y >> level), 0 };
+			if (x > 0 && LevelAt(x - 1, y) > level)
+				draw.stitchMask |= LodStitchLeft;
+			if (y > 0 && LevelAt(x, y - 1) > level)
+				draw.stitchMask |= LodStitchTop;
+			if (x + size < _nodesX && LevelAt(x + size, y) > level)
+				draw.stitchMask |= LodStitchRight;
+			if (y + size < _nodesY && LevelAt(x, y + size) > level)
+				draw.stitchMask |= LodStitchBottom;
+			_draws.push_back(draw);
+		}
+	}
+	return _draws;
+}
+
+uint32_t LodSelector::LevelAt(uint32_t nodeX, uint32_t nodeY) const
+{
+	return _levels[static_cast<size_t>(nodeY) * _nodesX + nodeX];
+}
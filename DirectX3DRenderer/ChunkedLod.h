@@ -0,0 +1,111 @@
+#pragma once
+#include "HeightmapMeshBuilder.h"
+#include "ParallelFor.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+//view dependent level of detail (geomipmapping on a chunk quadtree).
+//a node of level L covers chunkQuads << L cells and is drawn as a chunkQuads x chunkQuads grid taking every
+//2^L-th sample, so every level halves the resolution and every node costs the same number of triangles.
+//the selection keeps neighbouring nodes within one level of each other, and the edges of a node that border
+//a coarser node fold their odd vertices onto the even ones, which leaves no cracks and no t-junctions.
+
+constexpr uint32_t defaultLodChunkQuads = 32;
+
+//edges of a node that border a node one level coarser
+enum LodStitchEdge : uint32_t
+{
+	LodStitchLeft = 1,
+	LodStitchTop = 2,
+	LodStitchRight = 4,
+	LodStitchBottom = 8
+};
+
+constexpr uint32_t lodStitchVariantCount = 16;
+
+struct LodNode
+{
+	uint32_t level;
+	uint32_t x;				//first grid column covered by the node
+	uint32_t y;				//first grid row covered by the node
+	uint32_t baseVertex;	//BaseVertexLocation of the draw, the node owns (chunkQuads + 1)^2 vertices from here
+	float geometricError;	//largest normalized height error against the full resolution, never below its children's
+	float boundsMin[3];		//box in the local space of the mesh, the same space as the vertices
+	float boundsMax[3];
+};
+
+struct LodTerrain
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t chunkQuads = 0;
+	uint8_t maxDepth = 0;
+	std::vector<uint32_t> levelNodesX;		//nodes per row of every level, level 0 is the full resolution
+	std::vector<uint32_t> levelNodesY;
+	std::vector<uint32_t> levelFirstNode;	//index of the first node of every level inside nodes
+	std::vector<LodNode> nodes;
+	std::vector<HeightmapVertex> vertices;	//empty until ChunkedLodBuilder::BuildVertices
+	std::vector<uint16_t> indices;			//one triangle list per stitch mask, shared by every node
+	std::array<TileIndexRange, lodStitchVariantCount> stitchRanges{};
+
+	uint32_t LevelCount() const;
+	uint32_t NodeIndex(uint32_t level, uint32_t nodeX, uint32_t nodeY) const;
+};
+
+//camera for the selection, in the local space of the mesh
+struct LodView
+{
+	float eye[3];
+	float errorScale;		//viewport height / (2 tan(fovY / 2)), turns error / distance into pixels
+	float maxPixelError;	//nodes are refined until their projected error is at most this many pixels
+};
+
+struct LodDraw
+{
+	uint32_t node;
+	uint32_t stitchMask;	//LodStitchEdge bits, selects terrain.stitchRanges
+};
+
+//projected error of a node in pixels
+float LodScreenError(const LodNode& node, const LodView& view);
+
+class ChunkedLodBuilder
+{
+private:
+	HeightmapOrientation _orientation;
+	mutable RowBandPool _pool;
+
+public:
+	//threadCount of 0 uses every hardware thread
+	explicit ChunkedLodBuilder(HeightmapOrientation orientation = HeightmapOrientation::HeightAlongY, unsigned int threadCount = 0);
+
+	//nodes, bounds, errors and the stitch indices, everything the selection needs.
+	//throws std::invalid_argument when chunkQuads is odd, 0 or larger than maxHeightmapTileQuads
+	void BuildHierarchy(const uint8_t* depthData, uint32_t width, uint32_t height, uint32_t chunkQuads, LodTerrain& terrain) const;
+
+	//the vertex blocks of every node of every level, about 1.4 times the samples (4/3 for the levels, plus the shared chunk edges)
+	void BuildVertices(const uint8_t* depthData, LodTerrain& terrain) const;
+
+	void Build(const uint8_t* depthData, uint32_t width, uint32_t height, uint32_t chunkQuads, LodTerrain& terrain) const;
+};
+
+//picks the nodes to draw for one frame. keeps its buffers between frames so selecting does not allocate
+class LodSelector
+{
+private:
+	std::vector<uint8_t> _levels;	//selected level of every level 0 node
+	std::vector<LodDraw> _draws;
+	uint32_t _nodesX = 0;
+	uint32_t _nodesY = 0;
+
+	void Refine(const LodTerrain& terrain, const LodView& view, uint32_t level, uint32_t nodeX, uint32_t nodeY);
+	void Assign(uint32_t level, uint32_t nodeX, uint32_t nodeY);
+	bool Balance();
+
+public:
+	const std::vector<LodDraw>& Select(const LodTerrain& terrain, const LodView& view);
+
+	//level drawn over level 0 node (nodeX, nodeY) by the last Select
+	uint32_t LevelAt(uint32_t nodeX, uint32_t nodeY) const;
+};
@@ -0,0 +1,95 @@
+#include "CpuFeatures.h"
+#include <cstdint>
+
+#if defined(HEIGHTMAP_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(HEIGHTMAP_X86)
+static void QueryCpuid(int leaf, int subLeaf, uint32_t registers[4])
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, leaf, subLeaf);
+	for (int i = 0; i < 4; ++i)
+		registers[i] = static_cast<uint32_t>(info[i]);
+#else
+	__cpuid_count(leaf, subLeaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+//which register states the os saves on context switch
+static uint64_t QueryXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+static SimdLevel QuerySimdLevel()
+{
+	uint32_t leaf0[4];
+	QueryCpuid(0, 0, leaf0);
+	uint32_t maxLeaf = leaf0[0];
+
+	uint32_t leaf1[4];
+	QueryCpuid(1, 0, leaf1);
+
+	bool sse2 = (leaf1[3] & (1u << 26)) != 0;
+	if (!sse2)
+		return SimdLevel::Scalar;
+
+	bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+	bool avx = (leaf1[2] & (1u << 28)) != 0;
+	if (!osxsave || !avx || maxLeaf < 7)
+		return SimdLevel::SSE2;
+
+	uint64_t xcr0 = QueryXcr0();
+	bool ymmState = (xcr0 & 0x6) == 0x6;
+	bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+	uint32_t leaf7[4];
+	QueryCpuid(7, 0, leaf7);
+	bool avx2 = (leaf7[1] & (1u << 5)) != 0;
+	bool avx512f = (leaf7[1] & (1u << 16)) != 0;
+
+	if (avx512f && zmmState)
+		return SimdLevel::AVX512;
+	if (avx2 && ymmState)
+		return SimdLevel::AVX2;
+	return SimdLevel::SSE2;
+}
+#endif
+
+SimdLevel DetectSimdLevel()
+{
+#if defined(HEIGHTMAP_X86)
+	static const SimdLevel level = QuerySimdLevel();
+	return level;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+const char* SimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::SSE2:
+		return "SSE2";
+	case SimdLevel::AVX2:
+		return "AVX2";
+	case SimdLevel::AVX512:
+		return "AVX-512";
+	default:
+		return "Scalar";
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+enum class SimdLevel
+{
+	Scalar,
+	SSE2,
+	AVX2,
+	AVX512
+};
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HEIGHTMAP_X86 1
+#endif
+
+//gcc and clang only emit avx intrinsics inside functions marked for that target, msvc accepts them anywhere
+#if defined(HEIGHTMAP_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+//highest instruction set supported by both the cpu and the os, detected once
+SimdLevel DetectSimdLevel();
+const char* SimdLevelName(SimdLevel level);
@@ -0,0 +1,39 @@
+#include "D3D11BufferDevice.h"
+#include <limits>
+
+D3D11BufferDevice::D3D11BufferDevice(ID3D11Device* device)
+	: _device(device)
+{
+}
+
+void* D3D11BufferDevice::CreateBuffer(BufferBinding binding, const void* data, size_t bytes)
+{
+	//parenthesized, windows.h defines max as a macro
+	if (bytes == 0 || bytes > (std::numeric_limits<UINT>::max)())
+		return nullptr;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.ByteWidth = static_cast<UINT>(bytes);
+	desc.BindFlags = binding == BufferBinding::Index ? D3D11_BIND_INDEX_BUFFER : D3D11_BIND_VERTEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = data;
+
+	//the reference of CreateBuffer is the one ReleaseBuffer gives back
+	ID3D11Buffer* buffer = nullptr;
+	if (FAILED(_device->CreateBuffer(&desc, &initialData, &buffer)))
+		return nullptr;
+	return buffer;
+}
+
+void D3D11BufferDevice::ReleaseBuffer(void* buffer)
+{
+	if (buffer != nullptr)
+		Buffer(buffer)->Release();
+}
+
+ID3D11Buffer* D3D11BufferDevice::Buffer(void* buffer)
+{
+	return static_cast<ID3D11Buffer*>(buffer);
+}
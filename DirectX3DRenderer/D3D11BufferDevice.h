@@ -0,0 +1,19 @@
+#pragma once
+#include "GeometryPool.h"
+#include <d3d11_2.h>
+#include <wrl.h>
+
+//BufferDevice of an ID3D11Device: immutable vertex and index buffers, handed out as the ID3D11Buffer* they are
+class D3D11BufferDevice : public BufferDevice
+{
+public:
+	explicit D3D11BufferDevice(ID3D11Device* device);
+
+	void* CreateBuffer(BufferBinding binding, const void* data, size_t bytes) override;
+	void ReleaseBuffer(void* buffer) override;
+
+	static ID3D11Buffer* Buffer(void* buffer);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> _device;
+};
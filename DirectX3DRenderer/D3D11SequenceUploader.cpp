@@ -0,0 +1,89 @@
+#include "D3D11SequenceUploader.h"
+#include <stdexcept>
+
+D3D11SequenceUploader::D3D11SequenceUploader(ID3D11Device* device)
+	: _device(device)
+{
+	if (FAILED(_device->CreateDeferredContext(0, &_deferredContext)))
+		throw std::runtime_error("D3D11SequenceUploader: cannot create a deferred context");
+}
+
+//the frames of a sequence share their size, so the buffers are only created for the first frame of each slot
+bool D3D11SequenceUploader::EnsureBuffer(ID3D11Device* device, size_t bytes, ComPtr<ID3D11Buffer>& buffer)
+{
+	if (bytes == 0)
+	{
+		buffer.Reset();
+		return false;
+	}
+
+	D3D11_BUFFER_DESC desc = {};
+	if (buffer != nullptr)
+	{
+		buffer->GetDesc(&desc);
+		if (desc.ByteWidth == bytes)
+			return true;
+	}
+
+	desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = static_cast<UINT>(bytes);
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	buffer.Reset();
+	return SUCCEEDED(device->CreateBuffer(&desc, nullptr, &buffer));
+}
+
+void D3D11SequenceUploader::Upload(uint32_t slot, const SequenceFrame& frame)
+{
+	Slot& target = _slots[slot];
+	const TiledHeightmapMesh& mesh = frame.mesh;
+
+	//a slot dropped before Render took it still holds its commands, they are replaced by this frame's
+	target.commands.Reset();
+	if (EnsureBuffer(_device.Get(), mesh.VertexBytes(), target.vertexBuffer))
+		_deferredContext->UpdateSubresource(target.vertexBuffer.Get(), 0, nullptr, mesh.VertexData(), 0, 0);
+	if (EnsureBuffer(_device.Get(), mesh.NormalBytes(), target.normalBuffer))
+		_deferredContext->UpdateSubresource(target.normalBuffer.Get(), 0, nullptr, mesh.NormalData(), 0, 0);
+
+	D3D11_TEXTURE2D_DESC colorDesc = {};
+	if (target.colorTexture != nullptr)
+		target.colorTexture->GetDesc(&colorDesc);
+	if (target.colorTexture == nullptr || colorDesc.Width != frame.color.width || colorDesc.Height != frame.color.height)
+	{
+		colorDesc = {};
+		colorDesc.Width = frame.color.width;
+		colorDesc.Height = frame.color.height;
+		colorDesc.MipLevels = 1;
+		colorDesc.ArraySize = 1;
+		colorDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		colorDesc.SampleDesc.Count = 1;
+		colorDesc.Usage = D3D11_USAGE_DEFAULT;
+		colorDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		target.colorView.Reset();
+		target.colorTexture.Reset();
+		if (SUCCEEDED(_device->CreateTexture2D(&colorDesc, nullptr, &target.colorTexture)))
+			_device->CreateShaderResourceView(target.colorTexture.Get(), nullptr, &target.colorView);
+	}
+	if (target.colorTexture != nullptr)
+		_deferredContext->UpdateSubresource(target.colorTexture.Get(), 0, nullptr, frame.colorRgba.data(), frame.color.width * 4, 0);
+
+	_deferredContext->FinishCommandList(FALSE, &target.commands);
+
+	target.frameIndex = frame.index;
+	target.tiles = mesh.tiles;
+	target.tileBounds.Clear();
+	for (const HeightmapTile& tile : mesh.tiles)
+		target.tileBounds.Add(tile.boundsMin, tile.boundsMax);
+	target.indexTable = mesh.indexTable;
+}
+
+const D3D11SequenceUploader::Slot& D3D11SequenceUploader::Present(uint32_t slot, ID3D11DeviceContext* immediateContext)
+{
+	Slot& target = _slots[slot];
+	if (target.commands != nullptr)
+	{
+		immediateContext->ExecuteCommandList(target.commands.Get(), TRUE);
+		target.commands.Reset();
+	}
+	return target;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "FrustumCulling.h"
+#include "SequencePipeline.h"
+#include <d3d11_2.h>
+#include <wrl.h>
+
+//gpu side of SequencePipeline: three sets of default usage vertex, normal and color resources. the upload thread
+//records the copies of a frame into a deferred context, the device itself is free threaded, and the render
+//thread executes that command list on the immediate context when it takes the slot
+class D3D11SequenceUploader : public SequenceUploader
+{
+	template <typename T>
+	using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+public:
+	struct Slot
+	{
+		ComPtr<ID3D11Buffer> vertexBuffer;
+		ComPtr<ID3D11Buffer> normalBuffer;		//empty without normals
+		ComPtr<ID3D11Texture2D> colorTexture;
+		ComPtr<ID3D11ShaderResourceView> colorView;
+		ComPtr<ID3D11CommandList> commands;		//copies of the last upload, executed once by Present
+		uint32_t frameIndex = 0;
+		std::vector<HeightmapTile> tiles;
+		BoundingBoxes tileBounds;				//one box per tile, for culling the slot's mesh
+		std::shared_ptr<const GridIndexTable> indexTable;
+	};
+
+private:
+	ComPtr<ID3D11Device> _device;
+	ComPtr<ID3D11DeviceContext> _deferredContext;
+	Slot _slots[3];
+
+	static bool EnsureBuffer(ID3D11Device* device, size_t bytes, ComPtr<ID3D11Buffer>& buffer);
+
+public:
+	//throws std::runtime_error when the device cannot create a deferred context
+	explicit D3D11SequenceUploader(ID3D11Device* device);
+
+	void Upload(uint32_t slot, const SequenceFrame& frame) override;
+
+	//render thread only, for the slot SequencePipeline::AcquireLatest just returned: applies its copies on the
+	//immediate context and returns the resources to draw with
+	const Slot& Present(uint32_t slot, ID3D11DeviceContext* immediateContext);
+};
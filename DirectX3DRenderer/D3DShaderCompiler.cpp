@@ -0,0 +1,38 @@
+#include "D3DShaderCompiler.h"
+#include <Windows.h>
+#include <d3dcompiler.h>
+#include <wrl.h>
+
+uint64_t D3DShaderCompiler::Version() const
+{
+	return D3D_COMPILER_VERSION;
+}
+
+bool D3DShaderCompiler::Compile(const ShaderCompileRequest& request, ShaderBytecode& bytecode, std::string& error)
+{
+	//the request holds ansi paths, like every other path handed to the c runtime
+	int length = MultiByteToWideChar(CP_ACP, 0, request.path.c_str(), -1, nullptr, 0);
+	std::wstring path(length > 0 ? length - 1 : 0, L'\0');
+	MultiByteToWideChar(CP_ACP, 0, request.path.c_str(), -1, &path[0], length);
+
+	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+	Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
+	if (FAILED(D3DCompileFromFile(
+		path.c_str(),
+		nullptr,
+		D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		request.entryPoint.c_str(),
+		request.profile.c_str(),
+		request.flags,
+		0,
+		&shaderBlob,
+		&errorBlob)))
+	{
+		error = errorBlob != nullptr ? static_cast<const char*>(errorBlob->GetBufferPointer()) : "cannot read " + request.path;
+		return false;
+	}
+
+	const uint8_t* data = static_cast<const uint8_t*>(shaderBlob->GetBufferPointer());
+	bytecode.assign(data, data + shaderBlob->GetBufferSize());
+	return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include "ShaderCache.h"
+
+//ShaderCompiler of d3dcompiler, reads the source with D3DCompileFromFile and its standard include handler
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+	uint64_t Version() const override;
+	bool Compile(const ShaderCompileRequest& request, ShaderBytecode& bytecode, std::string& error) override;
+};
@@ -0,0 +1,697 @@
+#include "DepthFilter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#if defined(HEIGHTMAP_X86)
+#include <immintrin.h>
+#endif
+
+#pragma region Median
+//forgetful selection: keep count / 2 + 2 candidates, every round moves the smallest and the largest to the ends with
+//compare-exchanges, drops them since they can no longer be the median, and takes in the next value. the rounds only
+//depend on count, so they are worked out once as a list of compare-exchanges that every kernel runs with its own min
+//and max, and all of them agree on the result
+template <int count>
+struct MedianSchedule
+{
+	uint8_t pairs[count * count][2] = {};
+	int pairCount = 0;
+	int result = 0;
+
+	constexpr MedianSchedule()
+	{
+		int candidates[count] = {};
+		int size = count / 2 + 2;
+		for (int i = 0; i < size; ++i)
+			candidates[i] = i;
+
+		for (int next = size; ; ++next)
+		{
+			for (int i = 1; i < size; ++i)
+				Add(candidates[0], candidates[i]);
+			for (int i = 1; i < size - 1; ++i)
+				Add(candidates[i], candidates[size - 1]);
+
+			//drop the smallest and the largest
+			for (int i = 0; i < size - 2; ++i)
+				candidates[i] = candidates[i + 1];
+			size -= 2;
+			if (next == count)
+				break;
+			candidates[size++] = next;
+		}
+		result = candidates[0];
+	}
+
+	//after the exchange the smaller value is in low
+	constexpr void Add(int low, int high)
+	{
+		pairs[pairCount][0] = static_cast<uint8_t>(low);
+		pairs[pairCount][1] = static_cast<uint8_t>(high);
+		++pairCount;
+	}
+};
+
+static constexpr MedianSchedule<9> median3Schedule;
+static constexpr MedianSchedule<25> median5Schedule;
+
+template <int radius>
+static constexpr const auto& GetMedianSchedule()
+{
+	if constexpr (radius == 1)
+		return median3Schedule;
+	else
+		return median5Schedule;
+}
+
+//optimal network that sorts 5 values, used on the columns of the 5x5 neighbourhood
+static constexpr uint8_t sortFivePairs[9][2] = { { 0, 1 }, { 3, 4 }, { 2, 4 }, { 2, 3 }, { 0, 3 }, { 0, 2 }, { 1, 4 }, { 1, 3 }, { 1, 2 } };
+
+//median of 25 values whose 5 columns are already sorted, slot rank * 5 + column. sorting the rows as well keeps the
+//columns sorted, and then 6 values are known to be below the median and 6 above it: the median is the median of the
+//13 left, found with forgetful selection. exchanges whose order is already known are left out, and of the others only
+//the min or the max is kept when the other is never read again. the simd kernels sort every column once and share it
+//between the 5 neighbourhoods it is part of, so this needs about 40% of the min and max of MedianSchedule<25>
+struct SortedColumnsMedianSchedule
+{
+	uint8_t pairs[128][2] = {};
+	bool keepMin[128] = {};
+	bool keepMax[128] = {};
+	int pairCount = 0;
+	int result = 0;
+
+	constexpr SortedColumnsMedianSchedule()
+	{
+		for (int rank = 0; rank < 5; ++rank)
+			for (const auto& pair : sortFivePairs)
+				Add(rank * 5 + pair[0], rank * 5 + pair[1]);
+
+		//known[a][b]: the value in slot a is known to be at most the one in slot b
+		bool known[25][25] = {};
+		for (int a = 0; a < 25; ++a)
+			for (int b = 0; b < 25; ++b)
+				known[a][b] = a / 5 <= b / 5 && a % 5 <= b % 5;
+
+		//at least (rank + 1) * (column + 1) - 1 values are at most slot rank * 5 + column, (5 - rank) * (5 - column) - 1
+		//are at least it
+		int remaining[13] = {};
+		int remainingCount = 0;
+		for (int slot = 0; slot < 25; ++slot)
+			if ((slot / 5 + 1) * (slot % 5 + 1) <= 13 && (5 - slot / 5) * (5 - slot % 5) <= 13)
+				remaining[remainingCount++] = slot;
+
+		int candidates[13] = {};
+		int size = remainingCount / 2 + 2;
+		for (int i = 0; i < size; ++i)
+			candidates[i] = remaining[i];
+
+		for (int next = size; ; ++next)
+		{
+			for (int i = 1; i < size; ++i)
+				Exchange(candidates[0], candidates[i], known);
+			for (int i = 1; i < size - 1; ++i)
+				Exchange(candidates[i], candidates[size - 1], known);
+
+			for (int i = 0; i < size - 2; ++i)
+				candidates[i] = candidates[i + 1];
+			size -= 2;
+			if (next == remainingCount)
+				break;
+			candidates[size++] = remaining[next];
+		}
+		result = candidates[0];
+
+		//walking back from the result, an exchange is needed for the outputs read later
+		bool read[25] = {};
+		read[result] = true;
+		for (int i = pairCount - 1; i >= 0; --i)
+		{
+			keepMin[i] = read[pairs[i][0]];
+			keepMax[i] = read[pairs[i][1]];
+			if (keepMin[i] || keepMax[i])
+				read[pairs[i][0]] = read[pairs[i][1]] = true;
+		}
+
+		int kept = 0;
+		for (int i = 0; i < pairCount; ++i)
+		{
+			if (!keepMin[i] && !keepMax[i])
+				continue;
+			pairs[kept][0] = pairs[i][0];
+			pairs[kept][1] = pairs[i][1];
+			keepMin[kept] = keepMin[i];
+			keepMax[kept] = keepMax[i];
+			++kept;
+		}
+		pairCount = kept;
+	}
+
+	constexpr void Add(int low, int high)
+	{
+		pairs[pairCount][0] = static_cast<uint8_t>(low);
+		pairs[pairCount][1] = static_cast<uint8_t>(high);
+		++pairCount;
+	}
+
+	//adds the exchange unless its order is already known, and updates what is known after it
+	constexpr void Exchange(int low, int high, bool (&known)[25][25])
+	{
+		if (known[low][high])
+			return;
+		Add(low, high);
+
+		bool lowBelow[25] = {}, highBelow[25] = {}, lowAbove[25] = {}, highAbove[25] = {};
+		for (int slot = 0; slot < 25; ++slot)
+		{
+			lowBelow[slot] = known[slot][low];
+			highBelow[slot] = known[slot][high];
+			lowAbove[slot] = known[low][slot];
+			highAbove[slot] = known[high][slot];
+		}
+		for (int slot = 0; slot < 25; ++slot)
+		{
+			if (slot == low || slot == high)
+				continue;
+			//the min is above what is below both and below what is above either, the max the other way around
+			known[slot][low] = lowBelow[slot] && highBelow[slot];
+			known[slot][high] = lowBelow[slot] || highBelow[slot];
+			known[low][slot] = lowAbove[slot] || highAbove[slot];
+			known[high][slot] = lowAbove[slot] && highAbove[slot];
+		}
+		known[low][high] = true;
+		known[high][low] = false;
+	}
+};
+
+static constexpr SortedColumnsMedianSchedule median5SortedColumns;
+
+static inline uint32_t ClampColumn(int64_t x, uint32_t width)
+{
+	return static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(x, 0), width - 1));
+}
+
+template <int radius>
+static void MedianRowScalar(const uint8_t* const* rows, uint32_t width, uint32_t xBegin, uint32_t xEnd, uint8_t* out)
+{
+	constexpr int side = radius * 2 + 1;
+	for (uint32_t x = xBegin; x < xEnd; ++x)
+	{
+		uint8_t values[side * side];
+		for (int dy = 0; dy < side; ++dy)
+			for (int dx = 0; dx < side; ++dx)
+				values[dy * side + dx] = rows[dy][ClampColumn(static_cast<int64_t>(x) + dx - radius, width)];
+		const auto& schedule = GetMedianSchedule<radius>();
+		for (int i = 0; i < schedule.pairCount; ++i)
+		{
+			uint8_t& low = values[schedule.pairs[i][0]];
+			uint8_t& high = values[schedule.pairs[i][1]];
+			uint8_t smaller = std::min(low, high);
+			high = std::max(low, high);
+			low = smaller;
+		}
+		out[x - xBegin] = values[schedule.result];
+	}
+}
+#pragma endregion
+
+#pragma region Bilateral
+static void BilateralRowScalar(const uint8_t* const* rows, uint32_t width, uint32_t xBegin, uint32_t xEnd,
+	const BilateralWeights& weights, uint8_t* out)
+{
+	const int radius = static_cast<int>(weights.radius);
+	const int side = radius * 2 + 1;
+	for (uint32_t x = xBegin; x < xEnd; ++x)
+	{
+		float center = static_cast<float>(rows[radius][x]);
+		float weightSum = 0.0f;
+		float valueSum = 0.0f;
+		for (int dy = 0; dy < side; ++dy)
+		{
+			for (int dx = 0; dx < side; ++dx)
+			{
+				float value = static_cast<float>(rows[dy][ClampColumn(static_cast<int64_t>(x) + dx - radius, width)]);
+				float difference = value - center;
+				float falloff = std::max(1.0f - difference * difference * weights.rangeScale, 0.0f);
+				float weight = weights.spatial[dy * side + dx] * (falloff * falloff);
+				weightSum += weight;
+				valueSum += weight * value;
+			}
+		}
+		//the center always counts with weight 1, so the sum is never 0
+		out[x - xBegin] = static_cast<uint8_t>(static_cast<int>(valueSum / weightSum + 0.5f));
+	}
+}
+#pragma endregion
+
+//the columns whose whole neighbourhood lies inside the row, the simd kernels only handle those
+static inline void InteriorColumns(uint32_t width, uint32_t radius, uint32_t xBegin, uint32_t xEnd, uint32_t& interiorBegin,
+	uint32_t& interiorEnd)
+{
+	interiorBegin = std::min(std::max(xBegin, radius), xEnd);
+	interiorEnd = width > radius ? std::max(std::min(xEnd, width - radius), interiorBegin) : interiorBegin;
+}
+
+//simd part of a row: columns [xBegin, xEnd) are interior, out points at column xBegin. returns the first column left
+//for the scalar kernel
+using MedianInteriorKernel = uint32_t(*)(const uint8_t* const* rows, uint32_t xBegin, uint32_t xEnd, uint8_t* out);
+using BilateralInteriorKernel = uint32_t(*)(const uint8_t* const* rows, uint32_t xBegin, uint32_t xEnd,
+	const BilateralWeights& weights, uint8_t* out);
+
+//columns [xBegin, xEnd) next to an edge of the row, or left over by the interior kernel. the interior kernel runs on
+//copies of the 32 columns around them in which the samples past the edge are repeated, what it cannot do on those
+//goes to the scalar kernel. a scalar median5 costs as much as a few hundred simd ones
+template <int radius, MedianInteriorKernel interior>
+static void MedianEdgeSimd(const uint8_t* const* rows, uint32_t width, uint32_t xBegin, uint32_t xEnd, uint8_t* out)
+{
+	constexpr int side = radius * 2 + 1;
+	constexpr uint32_t span = 32;
+	if (xBegin >= xEnd)
+		return;
+
+	uint32_t first = std::min(xBegin, width > span ? width - span : 0);
+	uint32_t count = std::min(span, width - first);
+	uint8_t copies[side][span + 2 * radius];
+	const uint8_t* copyRows[side];
+	for (int dy = 0; dy < side; ++dy)
+	{
+		for (uint32_t i = 0; i < count + 2 * radius; ++i)
+			copies[dy][i] = rows[dy][ClampColumn(static_cast<int64_t>(first) + i - radius, width)];
+		copyRows[dy] = copies[dy];
+	}
+
+	//results[i] is column first + i
+	uint8_t results[span];
+	uint32_t done = interior(copyRows, radius, radius + count, results) - radius;
+	uint32_t simdEnd = std::max(xBegin, std::min(xEnd, first + done));
+	std::memcpy(out, results + (xBegin - first), simdEnd - xBegin);
+	MedianRowScalar<radius>(rows, width, simdEnd, xEnd, out + (simdEnd - xBegin));
+}
+
+//as in HeightmapMeshKernels, the edges are written from here and not from inside the avx kernels
+template <int radius, MedianInteriorKernel interior>
+static void MedianRowSimd(const uint8_t* const* rows, uint32_t width, uint32_t xBegin, uint32_t xEnd, uint8_t* out)
+{
+	uint32_t interiorBegin, interiorEnd;
+	InteriorColumns(width, radius, xBegin, xEnd, interiorBegin, interiorEnd);
+	MedianEdgeSimd<radius, interior>(rows, width, xBegin, interiorBegin, out);
+	uint32_t x = interior(rows, interiorBegin, interiorEnd, out + (interiorBegin - xBegin));
+	MedianEdgeSimd<radius, interior>(rows, width, x, xEnd, out + (x - xBegin));
+}
+
+template <BilateralInteriorKernel interior>
+static void BilateralRowSimd(const uint8_t* const* rows, uint32_t width, uint32_t xBegin, uint32_t xEnd,
+	const BilateralWeights& weights, uint8_t* out)
+{
+	uint32_t interiorBegin, interiorEnd;
+	InteriorColumns(width, weights.radius, xBegin, xEnd, interiorBegin, interiorEnd);
+	BilateralRowScalar(rows, width, xBegin, interiorBegin, weights, out);
+	uint32_t x = interior(rows, interiorBegin, interiorEnd, weights, out + (interiorBegin - xBegin));
+	BilateralRowScalar(rows, width, x, xEnd, weights, out + (x - xBegin));
+}
+
+#if defined(HEIGHTMAP_X86)
+//outputs per block of the sorted column median5 kernels, the sorted columns of a block stay in the l1 cache
+constexpr uint32_t median5BlockColumns = 256;
+
+#pragma region SSE2
+template <int radius>
+static uint32_t MedianInteriorSSE2(const uint8_t* const* rows, uint32_t xBegin, uint32_t xEnd, uint8_t* out)
+{
+	constexpr int side = radius * 2 + 1;
+	uint32_t x = xBegin;
+	for (; x + 16 <= xEnd; x += 16)
+	{
+		__m128i values[side * side];
+		for (int dy = 0; dy < side; ++dy)
+			for (int dx = 0; dx < side; ++dx)
+				values[dy * side + dx] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[dy] + x + dx - radius));
+		const auto& schedule = GetMedianSchedule<radius>();
+		for (int i = 0; i < schedule.pairCount; ++i)
+		{
+			__m128i low = values[schedule.pairs[i][0]];
+			__m128i high = values[schedule.pairs[i][1]];
+			values[schedule.pairs[i][0]] = _mm_min_epu8(low, high);
+			values[schedule.pairs[i][1]] = _mm_max_epu8(low, high);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + (x - xBegin)), values[schedule.result]);
+	}
+	return x;
+}
+
+template <int pair>
+static inline void ExchangeSortedSSE2(__m128i* values)
+{
+	constexpr const SortedColumnsMedianSchedule& schedule = median5SortedColumns;
+	__m128i low = values[schedule.pairs[pair][0]];
+	__m128i high = values[schedule.pairs[pair][1]];
+	if constexpr (schedule.keepMin[pair])
+		values[schedule.pairs[pair][0]] = _mm_min_epu8(low, high);
+	if constexpr (schedule.keepMax[pair])
+		values[schedule.pairs[pair][1]] = _mm_max_epu8(low, high);
+}
+
+template <int... pair>
+static inline void MedianSortedColumnsSSE2(__m128i* values, std::integer_sequence<int, pair...>)
+{
+	(ExchangeSortedSSE2<pair>(values), ...);
+}
+
+//median5 over columns sorted once per block, see SortedColumnsMedianSchedule
+static uint32_t Median5InteriorSSE2(const uint8_t* const* rows, uint32_t xBegin, uint32_t xEnd, uint8_t* out)
+{
+	constexpr uint32_t lanes = 16;
+	uint8_t sorted[5][median5BlockColumns + 4];
+	uint32_t x = xBegin;
+	while (x < xEnd && xEnd - xBegin >= lanes)
+	{
+		//the last block is moved back to end on xEnd and writes a few outputs twice, instead of leaving up to
+		//lanes - 1 of them to the scalar kernel
+		if (x + lanes > xEnd)
+			x = xEnd - lanes;
+		//columns x - 2 up to the last output + 2, the last load is moved back so it stays inside them
+		uint32_t outputs = std::min((xEnd - x) / lanes * lanes, median5BlockColumns);
+		uint32_t span = outputs + 4;
+		for (uint32_t column = 0; column < span; column += lanes)
+		{
+			uint32_t offset = std::min(column, span - lanes);
+			__m128i values[5];
+			for (int rank = 0; rank < 5; ++rank)
+				values[rank] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[rank] + x - 2 + offset));
+			for (const auto& pair : sortFivePairs)
+			{
+				__m128i low = values[pair[0]];
+				values[pair[0]] = _mm_min_epu8(low, values[pair[1]]);
+				values[pair[1]] = _mm_max_epu8(low, values[pair[1]]);
+			}
+			for (int rank = 0; rank < 5; ++rank)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(sorted[rank] + offset), values[rank]);
+		}
+
+		for (uint32_t block = 0; block < outputs; block += lanes)
+		{
+			__m128i values[25];
+			for (int rank = 0; rank < 5; ++rank)
+				for (int dx = 0; dx < 5; ++dx)
+					values[rank * 5 + dx] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sorted[rank] + block + dx));
+			MedianSortedColumnsSSE2(values, std::make_integer_sequence<int, median5SortedColumns.pairCount>());
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + (x - xBegin) + block), values[median5SortedColumns.result]);
+		}
+		x += outputs;
+	}
+	return x;
+}
+
+//4 samples widened to floats
+static inline __m128 LoadSamples4(const uint8_t* samples)
+{
+	int32_t packed;
+	std::memcpy(&packed, samples, sizeof(packed));
+	__m128i bytes = _mm_cvtsi32_si128(packed);
+	__m128i zero = _mm_setzero_si128();
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+
+static uint32_t BilateralInteriorSSE2(const uint8_t* const* rows, uint32_t xBegin, uint32_t xEnd, const BilateralWeights& weights,
+	uint8_t* out)
+{
+	const int radius = static_cast<int>(weights.radius);
+	const int side = radius * 2 + 1;
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 rangeScale = _mm_set1_ps(weights.rangeScale);
+
+	uint32_t x = xBegin;
+	for (; x + 4 <= xEnd; x += 4)
+	{
+		__m128 center = LoadSamples4(rows[radius] + x);
+		__m128 weightSum = zero;
+		__m128 valueSum = zero;
+		for (int dy = 0; dy < side; ++dy)
+		{
+			for (int dx = 0; dx < side; ++dx)
+			{
+				__m128 value = LoadSamples4(rows[dy] + x + dx - radius);
+				__m128 difference = _mm_sub_ps(value, center);
+				__m128 falloff = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(_mm_mul_ps(difference, difference), rangeScale)), zero);
+				__m128 weight = _mm_mul_ps(_mm_set1_ps(weights.spatial[dy * side + dx]), _mm_mul_ps(falloff, falloff));
+				weightSum = _mm_add_ps(weightSum, weight);
+				valueSum = _mm_add_ps(valueSum, _mm_mul_ps(weight, value));
+			}
+		}
+
+		__m128i result = _mm_cvttps_epi32(_mm_add_ps(_mm_div_ps(valueSum, weightSum), half));
+		result = _mm_packus_epi16(_mm_packs_epi32(result, result), result);
+		int32_t packed = _mm_cvtsi128_si32(result);
+		std::memcpy(out + (x - xBegin), &packed, sizeof(packed));
+	}
+	return x;
+}
+#pragma endregion
+
+#pragma region AVX2
+template <int radius>
+SIMD_TARGET("avx2")
+static uint32_t MedianInteriorAVX2(const uint8_t* const* rows, uint32_t xBegin, uint32_t xEnd, uint8_t* out)
+{
+	constexpr int side = radius * 2 + 1;
+	uint32_t x = xBegin;
+	for (; x + 32 <= xEnd; x += 32)
+	{
+		__m256i values[side * side];
+		for (int dy = 0; dy < side; ++dy)
+			for (int dx = 0; dx < side; ++dx)
+				values[dy * side + dx] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[dy] + x + dx - radius));
+		const auto& schedule = GetMedianSchedule<radius>();
+		for (int i = 0; i < schedule.pairCount; ++i)
+		{
+			__m256i low = values[schedule.pairs[i][0]];
+			__m256i high = values[schedule.pairs[i][1]];
+			values[schedule.pairs[i][0]] = _mm256_min_epu8(low, high);
+			values[schedule.pairs[i][1]] = _mm256_max_epu8(low, high);
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (x - xBegin)), values[schedule.result]);
+	}
+	_mm256_zeroupper();
+	return x;
+}
+
+template <int pair>
+SIMD_TARGET("avx2")
+static inline void ExchangeSortedAVX2(__m256i* values)
+{
+	constexpr const SortedColumnsMedianSchedule& schedule = median5SortedColumns;
+	__m256i low = values[schedule.pairs[pair][0]];
+	__m256i high = values[schedule.pairs[pair][1]];
+	if constexpr (schedule.keepMin[pair])
+		values[schedule.pairs[pair][0]] = _mm256_min_epu8(low, high);
+	if constexpr (schedule.keepMax[pair])
+		values[schedule.pairs[pair][1]] = _mm256_max_epu8(low, high);
+}
+
+template <int... pair>
+SIMD_TARGET("avx2")
+static inline void MedianSortedColumnsAVX2(__m256i* values, std::integer_sequence<int, pair...>)
+{
+	(ExchangeSortedAVX2<pair>(values), ...);
+}
+
+SIMD_TARGET("avx2")
+static uint32_t Median5InteriorAVX2(const uint8_t* const* rows, uint32_t xBegin, uint32_t xEnd, uint8_t* out)
+{
+	constexpr uint32_t lanes = 32;
+	uint8_t sorted[5][median5BlockColumns + 4];
+	uint32_t x = xBegin;
+	while (x < xEnd && xEnd - xBegin >= lanes)
+	{
+		if (x + lanes > xEnd)
+			x = xEnd - lanes;
+		uint32_t outputs = std::min((xEnd - x) / lanes * lanes, median5BlockColumns);
+		uint32_t span = outputs + 4;
+		for (uint32_t column = 0; column < span; column += lanes)
+		{
+			uint32_t offset = std::min(column, span - lanes);
+			__m256i values[5];
+			for (int rank = 0; rank < 5; ++rank)
+				values[rank] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[rank] + x - 2 + offset));
+			for (const auto& pair : sortFivePairs)
+			{
+				__m256i low = values[pair[0]];
+				values[pair[0]] = _mm256_min_epu8(low, values[pair[1]]);
+				values[pair[1]] = _mm256_max_epu8(low, values[pair[1]]);
+			}
+			for (int rank = 0; rank < 5; ++rank)
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(sorted[rank] + offset), values[rank]);
+		}
+
+		for (uint32_t block = 0; block < outputs; block += lanes)
+		{
+			__m256i values[25];
+			for (int rank = 0; rank < 5; ++rank)
+				for (int dx = 0; dx < 5; ++dx)
+					values[rank * 5 + dx] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sorted[rank] + block + dx));
+			MedianSortedColumnsAVX2(values, std::make_integer_sequence<int, median5SortedColumns.pairCount>());
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (x - xBegin) + block), values[median5SortedColumns.result]);
+		}
+		x += outputs;
+	}
+	_mm256_zeroupper();
+	return x;
+}
+
+SIMD_TARGET("avx2")
+static inline __m256 LoadSamples8(const uint8_t* samples)
+{
+	return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples))));
+}
+
+SIMD_TARGET("avx2")
+static uint32_t BilateralInteriorAVX2(const uint8_t* const* rows, uint32_t xBegin, uint32_t xEnd, const BilateralWeights& weights,
+	uint8_t* out)
+{
+	const int radius = static_cast<int>(weights.radius);
+	const int side = radius * 2 + 1;
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 rangeScale = _mm256_set1_ps(weights.rangeScale);
+
+	uint32_t x = xBegin;
+	for (; x + 8 <= xEnd; x += 8)
+	{
+		__m256 center = LoadSamples8(rows[radius] + x);
+		__m256 weightSum = zero;
+		__m256 valueSum = zero;
+		for (int dy = 0; dy < side; ++dy)
+		{
+			for (int dx = 0; dx < side; ++dx)
+			{
+				__m256 value = LoadSamples8(rows[dy] + x + dx - radius);
+				__m256 difference = _mm256_sub_ps(value, center);
+				__m256 falloff = _mm256_max_ps(_mm256_sub_ps(one, _mm256_mul_ps(_mm256_mul_ps(difference, difference), rangeScale)), zero);
+				__m256 weight = _mm256_mul_ps(_mm256_set1_ps(weights.spatial[dy * side + dx]), _mm256_mul_ps(falloff, falloff));
+				weightSum = _mm256_add_ps(weightSum, weight);
+				valueSum = _mm256_add_ps(valueSum, _mm256_mul_ps(weight, value));
+			}
+		}
+
+		__m256i result = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_div_ps(valueSum, weightSum), half));
+		__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out + (x - xBegin)), _mm_packus_epi16(words, words));
+	}
+	_mm256_zeroupper();
+	return x;
+}
+#pragma endregion
+#endif
+
+const DepthFilterKernels& GetDepthFilterKernels(SimdLevel level)
+{
+	static const DepthFilterKernels scalar = { SimdLevel::Scalar, MedianRowScalar<1>, MedianRowScalar<2>, BilateralRowScalar };
+#if defined(HEIGHTMAP_X86)
+	static const DepthFilterKernels sse2 = { SimdLevel::SSE2, MedianRowSimd<1, MedianInteriorSSE2<1>>, MedianRowSimd<2, Median5InteriorSSE2>,
+		BilateralRowSimd<BilateralInteriorSSE2> };
+	static const DepthFilterKernels avx2 = { SimdLevel::AVX2, MedianRowSimd<1, MedianInteriorAVX2<1>>, MedianRowSimd<2, Median5InteriorAVX2>,
+		BilateralRowSimd<BilateralInteriorAVX2> };
+	static const DepthFilterKernels avx512 = { SimdLevel::AVX512, avx2.median3Row, avx2.median5Row, avx2.bilateralRow };
+
+	SimdLevel supported = DetectSimdLevel();
+	if (level > supported)
+		level = supported;
+
+	switch (level)
+	{
+	case SimdLevel::AVX512:
+		return avx512;
+	case SimdLevel::AVX2:
+		return avx2;
+	case SimdLevel::SSE2:
+		return sse2;
+	default:
+		break;
+	}
+#endif
+	return scalar;
+}
+
+const char* DepthFilterName(DepthFilterKind kind)
+{
+	switch (kind)
+	{
+	case DepthFilterKind::Median3:
+		return "median3";
+	case DepthFilterKind::Median5:
+		return "median5";
+	case DepthFilterKind::Bilateral3:
+		return "bilateral3";
+	case DepthFilterKind::Bilateral5:
+		return "bilateral5";
+	default:
+		return "none";
+	}
+}
+
+DepthFilter::DepthFilter(unsigned int threadCount, SimdLevel simdLevel)
+	: _pool(threadCount),
+	_simdLevel(GetDepthFilterKernels(simdLevel).level)
+{
+}
+
+SimdLevel DepthFilter::GetSimdLevel() const
+{
+	return _simdLevel;
+}
+
+void DepthFilter::Apply(const uint8_t* source, uint32_t width, uint32_t height, const DepthFilterOptions& options,
+	std::vector<uint8_t>& destination) const
+{
+	destination.resize(static_cast<size_t>(width) * height);
+	if (destination.empty())
+		return;
+	if (options.kind == DepthFilterKind::None)
+	{
+		std::copy(source, source + destination.size(), destination.begin());
+		return;
+	}
+
+	bool median = options.kind == DepthFilterKind::Median3 || options.kind == DepthFilterKind::Median5;
+	uint32_t radius = options.kind == DepthFilterKind::Median3 || options.kind == DepthFilterKind::Bilateral3 ? 1 : 2;
+	const DepthFilterKernels& kernels = GetDepthFilterKernels(_simdLevel);
+	MedianRowKernel medianRow = radius == 1 ? kernels.median3Row : kernels.median5Row;
+
+	BilateralWeights weights{};
+	weights.radius = radius;
+	weights.rangeScale = 1.0f / (options.rangeCutoff * options.rangeCutoff);
+	int side = static_cast<int>(radius) * 2 + 1;
+	for (int dy = 0; dy < side; ++dy)
+	{
+		for (int dx = 0; dx < side; ++dx)
+		{
+			float distanceSquared = static_cast<float>((dx - static_cast<int>(radius)) * (dx - static_cast<int>(radius))
+				+ (dy - static_cast<int>(radius)) * (dy - static_cast<int>(radius)));
+			weights.spatial[dy * side + dx] = std::exp(-distanceSquared / (2.0f * options.spatialSigma * options.spatialSigma));
+		}
+	}
+
+	uint8_t* target = destination.data();
+	ParallelForRowBands(_pool, height, [&](unsigned int, uint32_t rowBegin, uint32_t rowEnd)
+	{
+		const uint8_t* rows[2 * maxDepthFilterRadius + 1];
+		for (uint32_t y = rowBegin; y < rowEnd; ++y)
+		{
+			for (int dy = 0; dy < side; ++dy)
+			{
+				int64_t sourceRow = std::min<int64_t>(std::max<int64_t>(static_cast<int64_t>(y) + dy - radius, 0), height - 1);
+				rows[dy] = source + static_cast<size_t>(sourceRow) * width;
+			}
+
+			uint8_t* out = target + static_cast<size_t>(y) * width;
+			if (median)
+				medianRow(rows, width, 0, width, out);
+			else
+				kernels.bilateralRow(rows, width, 0, width, weights, out);
+		}
+	});
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "CpuFeatures.h"
+#include "ParallelFor.h"
+#include <cstdint>
+#include <vector>
+
+//edge preserving filters that clean a noisy 8-bit depth map before a mesh is built from it. the medians remove
+//speckles and jpeg ringing without moving edges, the bilateral filter smooths block artifacts inside surfaces
+//and stops at depth jumps. samples past the border repeat the nearest edge sample.
+
+enum class DepthFilterKind
+{
+	None,
+	Median3,	//median of the 3x3 neighbourhood
+	Median5,	//median of the 5x5 neighbourhood
+	Bilateral3,	//3x3 bilateral
+	Bilateral5	//5x5 bilateral
+};
+
+struct DepthFilterOptions
+{
+	DepthFilterKind kind = DepthFilterKind::None;
+	float rangeCutoff = 24.0f;	//bilateral: depth difference at which a neighbour stops counting, in 8-bit depth units
+	float spatialSigma = 1.0f;	//bilateral: gaussian falloff with the distance, in samples
+};
+
+//largest filter radius, 5x5
+constexpr uint32_t maxDepthFilterRadius = 2;
+
+//weights of one bilateral pass. the range weight is tukey's biweight (1 - (d / cutoff)^2)^2, which falls to 0 at the
+//cutoff and needs no exp, so every kernel computes it with the same float operations and stays bit-exact
+struct BilateralWeights
+{
+	uint32_t radius;
+	float spatial[(2 * maxDepthFilterRadius + 1) * (2 * maxDepthFilterRadius + 1)];	//row major, 1 in the center
+	float rangeScale;	//1 / cutoff^2
+};
+
+//writes columns [xBegin, xEnd) of one output row. rows holds the 2 * radius + 1 source rows centered on it, with the
+//rows past the top and bottom edge already replaced by the edge row
+using MedianRowKernel = void(*)(const uint8_t* const* rows, uint32_t width, uint32_t xBegin, uint32_t xEnd, uint8_t* out);
+using BilateralRowKernel = void(*)(const uint8_t* const* rows, uint32_t width, uint32_t xBegin, uint32_t xEnd,
+	const BilateralWeights& weights, uint8_t* out);
+
+//one set of row kernels per instruction set, all of them write the same bytes as the scalar one
+struct DepthFilterKernels
+{
+	SimdLevel level;
+	MedianRowKernel median3Row;
+	MedianRowKernel median5Row;
+	BilateralRowKernel bilateralRow;
+};
+
+//returns the kernels for the requested level, clamped to what the running cpu supports.
+//AVX-512 uses the AVX2 kernels
+const DepthFilterKernels& GetDepthFilterKernels(SimdLevel level);
+
+const char* DepthFilterName(DepthFilterKind kind);
+
+//runs a filter over a whole map in bands of rows, one band per thread
+class DepthFilter
+{
+private:
+	mutable RowBandPool _pool;
+	SimdLevel _simdLevel;
+
+public:
+	//threadCount of 0 uses every hardware thread, simdLevel is clamped to what the cpu supports
+	explicit DepthFilter(unsigned int threadCount = 0, SimdLevel simdLevel = SimdLevel::AVX512);
+
+	SimdLevel GetSimdLevel() const;
+
+	//filters width x height samples of source into destination, which is resized to fit and must not share storage
+	//with source. DepthFilterKind::None copies
+	void Apply(const uint8_t* source, uint32_t width, uint32_t height, const DepthFilterOptions& options,
+		std::vector<uint8_t>& destination) const;
+};
@@ -0,0 +1,361 @@
+#include "DepthImage.h"
+#include "NetpbmImage.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(HEIGHTMAP_X86)
+#include <immintrin.h>
+#endif
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <wincodec.h>
+#include <wrl.h>
+#include <iostream>
+#endif
+
+template <uint32_t bytes>
+static void ExtractRowScalar(const uint8_t* pixels, uint32_t count, uint32_t channel, uint8_t* out)
+{
+	for (uint32_t x = 0; x < count; ++x)
+		out[x] = pixels[x * bytes + channel];
+}
+
+//simd part of a row, returns the first pixel left for the scalar kernel
+using ChannelInteriorKernel = uint32_t(*)(const uint8_t* pixels, uint32_t count, uint32_t channel, uint8_t* out);
+
+//as in HeightmapMeshKernels, the scalar tail is written from here and not from inside the avx kernels
+template <uint32_t bytes, ChannelInteriorKernel interior>
+static void ExtractRowSimd(const uint8_t* pixels, uint32_t count, uint32_t channel, uint8_t* out)
+{
+	uint32_t x = interior(pixels, count, channel, out);
+	ExtractRowScalar<bytes>(pixels + static_cast<size_t>(x) * bytes, count - x, channel, out + x);
+}
+
+#if defined(HEIGHTMAP_X86)
+#pragma region SSE2
+//sse2 has no byte shuffle, so 3 byte pixels stay scalar
+static uint32_t ExtractInterior4SSE2(const uint8_t* pixels, uint32_t count, uint32_t channel, uint8_t* out)
+{
+	const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(channel * 8));
+	const __m128i lowByte = _mm_set1_epi32(0xFF);
+	uint32_t x = 0;
+	for (; x + 16 <= count; x += 16)
+	{
+		const __m128i* source = reinterpret_cast<const __m128i*>(pixels + static_cast<size_t>(x) * 4);
+		__m128i a = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(source), shift), lowByte);
+		__m128i b = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(source + 1), shift), lowByte);
+		__m128i c = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(source + 2), shift), lowByte);
+		__m128i d = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(source + 3), shift), lowByte);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+	return x;
+}
+#pragma endregion
+
+#pragma region AVX2
+SIMD_TARGET("avx2")
+static uint32_t ExtractInterior4AVX2(const uint8_t* pixels, uint32_t count, uint32_t channel, uint8_t* out)
+{
+	const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(channel * 8));
+	const __m256i lowByte = _mm256_set1_epi32(0xFF);
+	//the packs work inside 128 bit lanes, this puts the groups of 4 pixels back in order
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	uint32_t x = 0;
+	for (; x + 32 <= count; x += 32)
+	{
+		const __m256i* source = reinterpret_cast<const __m256i*>(pixels + static_cast<size_t>(x) * 4);
+		__m256i a = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(source), shift), lowByte);
+		__m256i b = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(source + 1), shift), lowByte);
+		__m256i c = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(source + 2), shift), lowByte);
+		__m256i d = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(source + 3), shift), lowByte);
+		__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_permutevar8x32_epi32(packed, order));
+	}
+	_mm256_zeroupper();
+	return x;
+}
+
+//16 pixels per step: each lane takes 4 pixels from a 16 byte load, the two shuffles put them in different dwords
+//and the permute puts the 4 groups in order
+SIMD_TARGET("avx2")
+static uint32_t ExtractInterior3AVX2(const uint8_t* pixels, uint32_t count, uint32_t channel, uint8_t* out)
+{
+	const __m256i offset = _mm256_set1_epi8(static_cast<char>(channel));
+	const __m256i first = _mm256_add_epi8(_mm256_setr_epi8(
+		0, 3, 6, 9, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128,
+		0, 3, 6, 9, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128), offset);
+	const __m256i second = _mm256_add_epi8(_mm256_setr_epi8(
+		-128, -128, -128, -128, 0, 3, 6, 9, -128, -128, -128, -128, -128, -128, -128, -128,
+		-128, -128, -128, -128, 0, 3, 6, 9, -128, -128, -128, -128, -128, -128, -128, -128), offset);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	uint32_t x = 0;
+	//the last load reads 4 bytes past the 16 pixels
+	for (; x + 18 <= count; x += 16)
+	{
+		const uint8_t* source = pixels + static_cast<size_t>(x) * 3;
+		__m256i low = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 12)), 1);
+		__m256i high = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 24))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 36)), 1);
+		__m256i packed = _mm256_or_si256(_mm256_shuffle_epi8(low, first), _mm256_shuffle_epi8(high, second));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(packed, order)));
+	}
+	_mm256_zeroupper();
+	return x;
+}
+#pragma endregion
+#endif
+
+const ChannelExtractKernels& GetChannelExtractKernels(SimdLevel level)
+{
+	static const ChannelExtractKernels scalar = { SimdLevel::Scalar, ExtractRowScalar<3>, ExtractRowScalar<4> };
+#if defined(HEIGHTMAP_X86)
+	static const ChannelExtractKernels sse2 = { SimdLevel::SSE2, ExtractRowScalar<3>, ExtractRowSimd<4, ExtractInterior4SSE2> };
+	static const ChannelExtractKernels avx2 = { SimdLevel::AVX2, ExtractRowSimd<3, ExtractInterior3AVX2>, ExtractRowSimd<4, ExtractInterior4AVX2> };
+	static const ChannelExtractKernels avx512 = { SimdLevel::AVX512, avx2.extract3, avx2.extract4 };
+
+	SimdLevel supported = DetectSimdLevel();
+	if (level > supported)
+		level = supported;
+
+	switch (level)
+	{
+	case SimdLevel::AVX512:
+		return avx512;
+	case SimdLevel::AVX2:
+		return avx2;
+	case SimdLevel::SSE2:
+		return sse2;
+	default:
+		break;
+	}
+#endif
+	return scalar;
+}
+
+uint32_t PixelLayoutBytes(PixelLayout layout)
+{
+	switch (layout)
+	{
+	case PixelLayout::Rgb8:
+	case PixelLayout::Bgr8:
+		return 3;
+	case PixelLayout::Rgba8:
+	case PixelLayout::Bgra8:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+void ExtractDepthChannel(const uint8_t* pixels, size_t rowPitch, uint32_t width, uint32_t height, PixelLayout layout,
+	uint8_t* samples, SimdLevel simdLevel)
+{
+	const ChannelExtractKernels& kernels = GetChannelExtractKernels(simdLevel);
+	uint32_t bytes = PixelLayoutBytes(layout);
+	uint32_t channel = layout == PixelLayout::Bgr8 || layout == PixelLayout::Bgra8 ? 2 : 0;
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* row = pixels + y * rowPitch;
+		uint8_t* out = samples + static_cast<size_t>(y) * width;
+		if (bytes == 1)
+			std::copy(row, row + width, out);
+		else if (bytes == 3)
+			kernels.extract3(row, width, channel, out);
+		else
+			kernels.extract4(row, width, channel, out);
+	}
+}
+
+uint32_t DepthSampleBytes(DepthSampleType type)
+{
+	switch (type)
+	{
+	case DepthSampleType::UInt16:
+		return 2;
+	case DepthSampleType::Float32:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+DepthSamples DepthImage::Samples() const
+{
+	return DepthSamples{ width, height, sampleType, samples.data() };
+}
+
+template <typename Sample>
+static void QuantizeSamples(const Sample* samples, size_t count, uint8_t* out)
+{
+	//negative and nan floats count as 0, like the 8-bit maps have no samples below it
+	float maxSample = 0.0f;
+	for (size_t i = 0; i < count; ++i)
+		maxSample = std::max(maxSample, static_cast<float>(samples[i]));
+
+	const float scale = maxSample > 0.0f ? 255.0f / maxSample : 0.0f;
+	for (size_t i = 0; i < count; ++i)
+	{
+		float value = static_cast<float>(samples[i]) * scale + 0.5f;
+		out[i] = value > 0.0f ? static_cast<uint8_t>(std::min(value, 255.0f)) : 0;
+	}
+}
+
+void QuantizeDepthSamples(const DepthSamples& samples, std::vector<uint8_t>& out)
+{
+	size_t count = static_cast<size_t>(samples.width) * samples.height;
+	out.resize(count);
+	if (samples.type == DepthSampleType::UInt8)
+	{
+		std::copy(static_cast<const uint8_t*>(samples.data), static_cast<const uint8_t*>(samples.data) + count, out.data());
+		return;
+	}
+
+	VisitDepthSamples(samples, [&](const auto* typed) { QuantizeSamples(typed, count, out.data()); });
+}
+
+//first channel of 16-bit pixels, rare enough (16-bit color files) that it stays scalar
+static void ExtractDepthChannel16(const uint8_t* pixels, size_t rowPitch, uint32_t width, uint32_t height, uint32_t channels,
+	uint16_t* samples)
+{
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* row = pixels + rowPitch * y;
+		for (uint32_t x = 0; x < width; ++x)
+			std::memcpy(samples + static_cast<size_t>(y) * width + x, row + static_cast<size_t>(x) * channels * 2, 2);
+	}
+}
+
+void ReadNetpbmDepth(const std::string& path, DepthImage& image)
+{
+	NetpbmImage netpbm;
+	ReadNetpbm(path, netpbm, 65535);
+	image.width = netpbm.width;
+	image.height = netpbm.height;
+	image.sampleType = NetpbmSampleBytes(netpbm) == 2 ? DepthSampleType::UInt16 : DepthSampleType::UInt8;
+	if (netpbm.channels == 1)
+	{
+		//already one sample per pixel, take the storage over
+		image.samples.swap(netpbm.pixels);
+		return;
+	}
+
+	image.samples.resize(static_cast<size_t>(netpbm.width) * netpbm.height * DepthSampleBytes(image.sampleType));
+	if (image.sampleType == DepthSampleType::UInt16)
+	{
+		ExtractDepthChannel16(netpbm.pixels.data(), static_cast<size_t>(netpbm.width) * 6, netpbm.width, netpbm.height, 3,
+			reinterpret_cast<uint16_t*>(image.samples.data()));
+		return;
+	}
+
+	ExtractDepthChannel(netpbm.pixels.data(), static_cast<size_t>(netpbm.width) * 3, netpbm.width, netpbm.height, PixelLayout::Rgb8,
+		image.samples.data());
+}
+
+#if defined(_WIN32)
+bool DecodeDepthImage(const std::wstring& path, DepthImage& image)
+{
+	//netpbm goes through the same reader as the sequences
+	if (path.size() > 4 && (_wcsicmp(path.c_str() + path.size() - 4, L".pgm") == 0 || _wcsicmp(path.c_str() + path.size() - 4, L".ppm") == 0))
+	{
+		int length = WideCharToMultiByte(CP_ACP, 0, path.c_str(), -1, nullptr, 0, nullptr, nullptr);
+		std::string ansiPath(length > 0 ? length - 1 : 0, '\0');
+		WideCharToMultiByte(CP_ACP, 0, path.c_str(), -1, &ansiPath[0], length, nullptr, nullptr);
+		try
+		{
+			ReadNetpbmDepth(ansiPath, image);
+			return true;
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << exception.what() << std::endl;
+			return false;
+		}
+	}
+
+	Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+	Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+	Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+	if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory)))
+		|| FAILED(factory->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder))
+		|| FAILED(decoder->GetFrame(0, &frame)))
+		return false;
+
+	UINT width = 0;
+	UINT height = 0;
+	WICPixelFormatGUID format = {};
+	if (FAILED(frame->GetSize(&width, &height)) || FAILED(frame->GetPixelFormat(&format)))
+		return false;
+
+	image.width = width;
+	image.height = height;
+
+	//wide formats keep their precision, 16-bit png decodes to one of the first three and float tiff to the last
+	if (format == GUID_WICPixelFormat16bppGray || format == GUID_WICPixelFormat32bppGrayFloat)
+	{
+		image.sampleType = format == GUID_WICPixelFormat16bppGray ? DepthSampleType::UInt16 : DepthSampleType::Float32;
+		UINT rowBytes = width * DepthSampleBytes(image.sampleType);
+		image.samples.resize(static_cast<size_t>(rowBytes) * height);
+		return SUCCEEDED(frame->CopyPixels(nullptr, rowBytes, static_cast<UINT>(image.samples.size()), image.samples.data()));
+	}
+	if (format == GUID_WICPixelFormat48bppRGB || format == GUID_WICPixelFormat64bppRGBA)
+	{
+		image.sampleType = DepthSampleType::UInt16;
+		image.samples.resize(static_cast<size_t>(width) * height * 2);
+		UINT channels = format == GUID_WICPixelFormat48bppRGB ? 3 : 4;
+		constexpr UINT wideBandRows = 64;
+		UINT wideStride = width * channels * 2;
+		std::vector<uint8_t> wideBand(static_cast<size_t>(wideStride) * wideBandRows);
+		for (UINT y = 0; y < height; y += wideBandRows)
+		{
+			UINT rows = (std::min)(wideBandRows, height - y);
+			WICRect rect = { 0, static_cast<INT>(y), static_cast<INT>(width), static_cast<INT>(rows) };
+			if (FAILED(frame->CopyPixels(&rect, wideStride, wideStride * rows, wideBand.data())))
+				return false;
+			ExtractDepthChannel16(wideBand.data(), wideStride, width, rows, channels,
+				reinterpret_cast<uint16_t*>(image.samples.data()) + static_cast<size_t>(y) * width);
+		}
+		return true;
+	}
+
+	//the formats jpeg and png decode to are read as they are, anything else is converted to rgba first
+	image.sampleType = DepthSampleType::UInt8;
+	Microsoft::WRL::ComPtr<IWICBitmapSource> source = frame;
+	PixelLayout layout = PixelLayout::Rgba8;
+	if (format == GUID_WICPixelFormat8bppGray)
+		layout = PixelLayout::Gray8;
+	else if (format == GUID_WICPixelFormat24bppBGR)
+		layout = PixelLayout::Bgr8;
+	else if (format == GUID_WICPixelFormat24bppRGB)
+		layout = PixelLayout::Rgb8;
+	else if (format == GUID_WICPixelFormat32bppBGRA || format == GUID_WICPixelFormat32bppBGR)
+		layout = PixelLayout::Bgra8;
+	else if (format != GUID_WICPixelFormat32bppRGBA)
+	{
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+		if (FAILED(factory->CreateFormatConverter(&converter))
+			|| FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+			return false;
+		source = converter;
+	}
+
+	image.samples.resize(static_cast<size_t>(width) * height);
+	if (layout == PixelLayout::Gray8)
+		return SUCCEEDED(source->CopyPixels(nullptr, width, static_cast<UINT>(image.samples.size()), image.samples.data()));
+
+	//bands of rows in decode order, so the pixels with every channel never exist for the whole image
+	constexpr UINT bandRows = 64;
+	UINT stride = width * PixelLayoutBytes(layout);
+	std::vector<uint8_t> band(static_cast<size_t>(stride) * bandRows);
+	for (UINT y = 0; y < height; y += bandRows)
+	{
+		UINT rows = (std::min)(bandRows, height - y);
+		WICRect rect = { 0, static_cast<INT>(y), static_cast<INT>(width), static_cast<INT>(rows) };
+		if (FAILED(source->CopyPixels(&rect, stride, stride * rows, band.data())))
+			return false;
+		ExtractDepthChannel(band.data(), stride, width, rows, layout, image.samples.data() + static_cast<size_t>(y) * width);
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+#include "CpuFeatures.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//depth maps decoded on the cpu straight into one sample per pixel. image decoders hand out gray, rgb or rgba rows,
+//a depth map only needs the red channel (all channels are equal in a gray image saved as color), so the other
+//channels are dropped while the rows are copied instead of being kept around in a 4 channel texture.
+//16-bit and float maps keep their samples as they are, HeightmapMeshBuilder meshes every sample type directly
+
+//the values are stored in RawDepthFile headers, do not renumber
+enum class DepthSampleType : uint32_t
+{
+	UInt8 = 1,
+	UInt16 = 2,	//millimeters of most depth cameras
+	Float32 = 3	//finite and non negative
+};
+
+//byte order of the pixels a decoder writes
+enum class PixelLayout
+{
+	Gray8,
+	Rgb8,
+	Bgr8,
+	Rgba8,
+	Bgra8
+};
+
+uint32_t DepthSampleBytes(DepthSampleType type);
+
+//samples of a map owned by someone else, a DepthImage or a mapped RawDepthFile
+struct DepthSamples
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	DepthSampleType type = DepthSampleType::UInt8;
+	const void* data = nullptr;	//rows top to bottom, width samples each
+};
+
+struct DepthImage
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	DepthSampleType sampleType = DepthSampleType::UInt8;
+	std::vector<uint8_t> samples;	//rows top to bottom, width samples of sampleType each
+
+	DepthSamples Samples() const;
+};
+
+//calls visit with data as a const uint8_t*, const uint16_t* or const float*, so templated code such as
+//HeightmapMeshBuilder::BuildTiled is instantiated for the sample type instead of reading a converted copy
+template <typename TVisitor>
+void VisitDepthSamples(const DepthSamples& samples, TVisitor&& visit)
+{
+	switch (samples.type)
+	{
+	case DepthSampleType::UInt16:
+		visit(static_cast<const uint16_t*>(samples.data));
+		break;
+	case DepthSampleType::Float32:
+		visit(static_cast<const float*>(samples.data));
+		break;
+	default:
+		visit(static_cast<const uint8_t*>(samples.data));
+		break;
+	}
+}
+
+//8-bit copy of samples for the code that only reads bytes (the depth filter, the other render modes).
+//8-bit samples are copied as they are, wider ones are scaled so the largest sample becomes 255
+void QuantizeDepthSamples(const DepthSamples& samples, std::vector<uint8_t>& out);
+
+//copies byte channel of count pixels of 3 or 4 bytes into out
+using ChannelRowKernel = void(*)(const uint8_t* pixels, uint32_t count, uint32_t channel, uint8_t* out);
+
+//one set of row kernels per instruction set, all of them write the same bytes as the scalar one
+struct ChannelExtractKernels
+{
+	SimdLevel level;
+	ChannelRowKernel extract3;
+	ChannelRowKernel extract4;
+};
+
+//returns the kernels for the requested level, clamped to what the running cpu supports.
+//AVX-512 uses the AVX2 kernels
+const ChannelExtractKernels& GetChannelExtractKernels(SimdLevel level);
+
+uint32_t PixelLayoutBytes(PixelLayout layout);
+
+//copies the red channel of width x height pixels into width x height samples. rowPitch is the distance between the
+//starts of two rows in bytes
+void ExtractDepthChannel(const uint8_t* pixels, size_t rowPitch, uint32_t width, uint32_t height, PixelLayout layout,
+	uint8_t* samples, SimdLevel simdLevel = SimdLevel::AVX512);
+
+//reads a P5 or P6 file into image, the red channel of a P6 one, as 16-bit samples when the max value is above 255.
+//throws std::runtime_error like ReadNetpbm
+void ReadNetpbmDepth(const std::string& path, DepthImage& image);
+
+#if defined(_WIN32)
+//netpbm with ReadNetpbmDepth, anything else with wic, which needs com initialized on the calling thread.
+//16-bit gray or color (png) and float gray (tiff) keep their precision, every other format is read as 8 bits.
+//returns false when the file cannot be read or decoded
+bool DecodeDepthImage(const std::wstring& path, DepthImage& image);
+#endif
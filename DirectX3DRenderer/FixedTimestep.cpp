@@ -0,0 +1,51 @@
+#include "FixedTimestep.h"
+#include <cmath>
+
+static int64_t ToNanoseconds(double seconds)
+{
+	return static_cast<int64_t>(std::llround(seconds * 1e9));
+}
+
+FixedTimestep::FixedTimestep(double updatesPerSecond, double maxFrameSeconds)
+{
+	double rate = updatesPerSecond > 0.0 ? updatesPerSecond : defaultUpdatesPerSecond;
+	_step = ToNanoseconds(1.0 / rate);
+	if (_step < 1)
+		_step = 1;
+	_maxFrame = maxFrameSeconds > 0.0 ? ToNanoseconds(maxFrameSeconds) : _step;
+}
+
+uint32_t FixedTimestep::Advance(double frameSeconds)
+{
+	if (!std::isfinite(frameSeconds) || frameSeconds < 0.0)
+		frameSeconds = 0.0;
+
+	int64_t frame = frameSeconds * 1e9 < static_cast<double>(_maxFrame) ? ToNanoseconds(frameSeconds) : _maxFrame;
+	_droppedSeconds += frameSeconds - static_cast<double>(frame) * 1e-9;
+	_accumulated += frame;
+
+	uint32_t steps = static_cast<uint32_t>(_accumulated / _step);
+	_accumulated -= static_cast<int64_t>(steps) * _step;
+	_steps += steps;
+	return steps;
+}
+
+float FixedTimestep::Alpha() const
+{
+	return static_cast<float>(static_cast<double>(_accumulated) / static_cast<double>(_step));
+}
+
+float FixedTimestep::StepSeconds() const
+{
+	return static_cast<float>(static_cast<double>(_step) * 1e-9);
+}
+
+uint64_t FixedTimestep::Steps() const
+{
+	return _steps;
+}
+
+double FixedTimestep::DroppedSeconds() const
+{
+	return _droppedSeconds;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+//splits the measured frame times into simulation steps of one fixed length, so the camera moves the same way at
+//30 and at 300 frames per second. the time left over after the last whole step is carried into the next frame, and
+//Alpha tells how far the rendered frame is between the state before the last step and the state after it.
+//the accumulator only counts, it neither reads a clock nor runs the steps, so it can be driven with made up frame times
+
+constexpr double defaultUpdatesPerSecond = 120.0;
+
+class FixedTimestep
+{
+public:
+	//frames longer than maxFrameSeconds, a breakpoint or a window drag, are cut to it instead of being caught up on
+	explicit FixedTimestep(double updatesPerSecond = defaultUpdatesPerSecond, double maxFrameSeconds = 0.25);
+
+	//adds the seconds since the previous frame and returns how many steps to run before rendering it.
+	//negative or non finite times count as 0
+	uint32_t Advance(double frameSeconds);
+	//time left over after the steps of the last Advance as a fraction of a step, in [0, 1)
+	float Alpha() const;
+	float StepSeconds() const;
+	uint64_t Steps() const;		//run since construction
+	double DroppedSeconds() const;	//cut off long frames since construction
+
+private:
+	//nanoseconds, so the leftover does not drift the way an accumulated double does
+	int64_t _step;
+	int64_t _maxFrame;
+	int64_t _accumulated = 0;
+	uint64_t _steps = 0;
+	double _droppedSeconds = 0.0;
+};
+
+//the state rendered Alpha of the way from the state before the last step to the state after it
+inline float InterpolateStep(float previous, float current, float alpha)
+{
+	return previous + (current - previous) * alpha;
+}
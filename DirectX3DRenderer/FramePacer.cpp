@@ -0,0 +1,192 @@
+#include "FramePacer.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+#if defined(HEIGHTMAP_X86)
+#include <immintrin.h>
+#endif
+
+#pragma region SystemFrameClock
+SystemFrameClock::SystemFrameClock()
+{
+#if defined(_WIN32) && defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+	//windows 10 1803 and later, without it Sleep rounds up to the timer resolution of the system
+	_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+}
+
+SystemFrameClock::~SystemFrameClock()
+{
+#if defined(_WIN32)
+	if (_timer != nullptr)
+		CloseHandle(_timer);
+#endif
+}
+
+FrameClock::Duration SystemFrameClock::Now()
+{
+	return std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+void SystemFrameClock::Sleep(Duration duration)
+{
+#if defined(_WIN32)
+	if (_timer != nullptr)
+	{
+		//negative due times are relative, in 100 ns units
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -static_cast<LONGLONG>(duration.count() / 100);
+		if (SetWaitableTimer(_timer, &dueTime, 0, nullptr, nullptr, FALSE))
+		{
+			WaitForSingleObject(_timer, INFINITE);
+			return;
+		}
+	}
+#endif
+	std::this_thread::sleep_for(duration);
+}
+
+void SystemFrameClock::Spin()
+{
+#if defined(HEIGHTMAP_X86)
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+#pragma endregion
+
+#pragma region FramePacer
+std::string FormatFramePacerStats(const FramePacerStats& stats)
+{
+	std::ostringstream line;
+	line << "Frames: " << stats.frames << ", " << stats.meanMilliseconds << " ms mean, " << stats.jitterMilliseconds << " ms jitter, "
+		<< stats.minMilliseconds << " to " << stats.maxMilliseconds << " ms, " << stats.late << " late\n";
+	return line.str();
+}
+
+FramePacer::FramePacer(FrameClock& clock, const FramePacerOptions& options)
+	: _clock(clock), _options(options)
+{
+	double rate = options.targetFramesPerSecond > 0.0 ? options.targetFramesPerSecond : 60.0;
+	_period = std::chrono::duration_cast<FrameClock::Duration>(std::chrono::duration<double>(1.0 / rate));
+	SetRefreshRate(options.refreshRate);
+}
+
+uint32_t FramePacer::SyncInterval() const
+{
+	switch (_options.pacing)
+	{
+	case FramePacing::VSync:
+		return 1;
+	case FramePacing::VSyncHalf:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+void FramePacer::SetRefreshRate(double framesPerSecond)
+{
+	_options.refreshRate = framesPerSecond > 0.0 ? framesPerSecond : 60.0;
+	_refreshPeriod = std::chrono::duration_cast<FrameClock::Duration>(std::chrono::duration<double>(1.0 / _options.refreshRate));
+}
+
+FrameClock::Duration FramePacer::PollPeriod() const
+{
+	switch (_options.pacing)
+	{
+	case FramePacing::VSyncHalf:
+		return 2 * _refreshPeriod;
+	case FramePacing::TargetRate:
+		return _period;
+	default:
+		//uncapped polls no faster than the display shows a new frame
+		return _refreshPeriod;
+	}
+}
+
+void FramePacer::WaitUntil(FrameClock::Duration deadline)
+{
+	FrameClock::Duration remaining = deadline - _clock.Now();
+	if (remaining > _options.spinTime)
+		_clock.Sleep(remaining - _options.spinTime);
+	while (_clock.Now() < deadline)
+		_clock.Spin();
+}
+
+void FramePacer::Record(double milliseconds)
+{
+	++_frames;
+	double delta = milliseconds - _mean;
+	_mean += delta / static_cast<double>(_frames);
+	_squaredDeviations += delta * (milliseconds - _mean);
+	_min = _frames == 1 ? milliseconds : std::min(_min, milliseconds);
+	_max = _frames == 1 ? milliseconds : std::max(_max, milliseconds);
+	if (_options.pacing == FramePacing::TargetRate && milliseconds > 1.5 * std::chrono::duration<double, std::milli>(_period).count())
+		++_late;
+}
+
+double FramePacer::EndFrame()
+{
+	if (!_started)
+	{
+		_started = true;
+		_lastFrameEnd = _clock.Now();
+		_deadline = _lastFrameEnd + _period;
+		return 0.0;
+	}
+
+	if (_options.pacing == FramePacing::TargetRate)
+	{
+		//due one period after the previous deadline, so the rate does not drift by the wake up latency of every frame.
+		//a frame that ended after its deadline starts a new schedule from now
+		FrameClock::Duration now = _clock.Now();
+		if (now < _deadline)
+			WaitUntil(_deadline);
+		else
+			_deadline = now;
+		_deadline += _period;
+	}
+
+	FrameClock::Duration end = _clock.Now();
+	double seconds = std::chrono::duration<double>(end - _lastFrameEnd).count();
+	_lastFrameEnd = end;
+	Record(seconds * 1000.0);
+	return seconds;
+}
+
+void FramePacer::Restart()
+{
+	_started = false;
+}
+
+FramePacerStats FramePacer::Stats() const
+{
+	FramePacerStats stats;
+	stats.frames = _frames;
+	stats.meanMilliseconds = _mean;
+	stats.jitterMilliseconds = _frames > 1 ? std::sqrt(_squaredDeviations / static_cast<double>(_frames - 1)) : 0.0;
+	stats.minMilliseconds = _min;
+	stats.maxMilliseconds = _max;
+	stats.late = _late;
+	return stats;
+}
+
+void FramePacer::ResetStats()
+{
+	_frames = 0;
+	_mean = 0.0;
+	_squaredDeviations = 0.0;
+	_min = 0.0;
+	_max = 0.0;
+	_late = 0;
+}
+#pragma endregion
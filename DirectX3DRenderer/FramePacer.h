@@ -0,0 +1,112 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+//paces the render loop after Present. the target rate sleeps through most of the time left in the frame and spins
+//for the last stretch, since a sleep can return a scheduler tick late. the vsync modes leave the waiting to Present
+//and only measure. every time goes through a FrameClock, so the pacing can be replayed with a clock driven by hand
+
+enum class FramePacing
+{
+	VSync,		//Present waits for every vertical blank
+	VSyncHalf,	//Present waits for every second vertical blank
+	TargetRate,	//FramePacer waits until 1 / targetFramesPerSecond has passed, Present does not wait
+	Uncapped	//nothing waits, for benchmarks
+};
+
+//time source and waits of FramePacer
+class FrameClock
+{
+public:
+	using Duration = std::chrono::nanoseconds;
+
+	virtual ~FrameClock() = default;
+	//since an arbitrary point before the first call, never goes back
+	virtual Duration Now() = 0;
+	//returns after roughly duration, possibly a scheduler tick later
+	virtual void Sleep(Duration duration) = 0;
+	//one round of a busy wait
+	virtual void Spin() = 0;
+};
+
+//steady_clock, and on windows a high resolution waitable timer where the system has one
+class SystemFrameClock : public FrameClock
+{
+public:
+	SystemFrameClock();
+	~SystemFrameClock() override;
+
+	SystemFrameClock(const SystemFrameClock&) = delete;
+	SystemFrameClock& operator=(const SystemFrameClock&) = delete;
+
+	Duration Now() override;
+	void Sleep(Duration duration) override;
+	void Spin() override;
+
+private:
+	void* _timer = nullptr;	//HANDLE of the waitable timer, nullptr elsewhere or when it cannot be created
+};
+
+struct FramePacerOptions
+{
+	FramePacing pacing = FramePacing::VSync;
+	double targetFramesPerSecond = 60.0;	//FramePacing::TargetRate only
+	double refreshRate = 60.0;				//of the display, what the vsync modes wait for
+	FrameClock::Duration spinTime = std::chrono::microseconds(2000);	//the end of a wait spun instead of slept
+};
+
+struct FramePacerStats
+{
+	uint64_t frames = 0;
+	double meanMilliseconds = 0.0;
+	double jitterMilliseconds = 0.0;	//standard deviation of the frame times
+	double minMilliseconds = 0.0;
+	double maxMilliseconds = 0.0;
+	uint64_t late = 0;					//frames of the target rate that took over 1.5 times its period
+};
+
+//one line for the log
+std::string FormatFramePacerStats(const FramePacerStats& stats);
+
+class FramePacer
+{
+public:
+	FramePacer(FrameClock& clock, const FramePacerOptions& options);
+
+	//SyncInterval of IDXGISwapChain::Present
+	uint32_t SyncInterval() const;
+	//the refresh rate of the display the window is on, once it is known
+	void SetRefreshRate(double framesPerSecond);
+	//one frame of the active pacing: the target period, one or two refresh periods with vsync, one refresh period
+	//uncapped. how often an idle render loop looks at what changes without a message, such as a playing sequence
+	FrameClock::Duration PollPeriod() const;
+	//call once per frame after Present. waits until the frame is due and returns the seconds since the previous call,
+	//0 on the first one. a frame that ran late moves the schedule instead of making the next frames hurry
+	double EndFrame();
+	//forgets the previous frame, the next EndFrame returns 0 again. for the render loop after it idled, so the idle time
+	//is neither a frame time nor a reason to hurry
+	void Restart();
+	FramePacerStats Stats() const;
+	void ResetStats();
+
+private:
+	FrameClock& _clock;
+	FramePacerOptions _options;
+	FrameClock::Duration _period;
+	FrameClock::Duration _refreshPeriod;
+	FrameClock::Duration _deadline{ 0 };	//when the frame after the current one is due
+	FrameClock::Duration _lastFrameEnd{ 0 };
+	bool _started = false;
+
+	//running mean and variance of the frame times in milliseconds, Welford's method
+	uint64_t _frames = 0;
+	double _mean = 0.0;
+	double _squaredDeviations = 0.0;
+	double _min = 0.0;
+	double _max = 0.0;
+	uint64_t _late = 0;
+
+	void WaitUntil(FrameClock::Duration deadline);
+	void Record(double milliseconds);
+};
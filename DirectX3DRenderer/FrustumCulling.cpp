@@ -0,0 +1,234 @@
+#include "FrustumCulling.h"
+
+#if defined(HEIGHTMAP_X86)
+#include <immintrin.h>
+#endif
+
+Frustum ExtractFrustum(const float matrix[4][4])
+{
+	//clip coordinate j of a point is the dot product with column j, every plane is a sum of two columns
+	auto column = [&](int j, int i) { return matrix[i][j]; };
+
+	Frustum frustum{};
+	for (int i = 0; i < 4; ++i)
+	{
+		frustum.planes[0][i] = column(3, i) + column(0, i);	//left, -w <= x
+		frustum.planes[1][i] = column(3, i) - column(0, i);	//right, x <= w
+		frustum.planes[2][i] = column(3, i) + column(1, i);	//bottom, -w <= y
+		frustum.planes[3][i] = column(3, i) - column(1, i);	//top, y <= w
+		frustum.planes[4][i] = column(2, i);					//near, 0 <= z
+		frustum.planes[5][i] = column(3, i) - column(2, i);	//far, z <= w
+	}
+	return frustum;
+}
+
+size_t BoundingBoxes::Size() const
+{
+	return minX.size();
+}
+
+void BoundingBoxes::Clear()
+{
+	minX.clear();
+	minY.clear();
+	minZ.clear();
+	maxX.clear();
+	maxY.clear();
+	maxZ.clear();
+}
+
+void BoundingBoxes::Add(const float boundsMin[3], const float boundsMax[3])
+{
+	minX.push_back(boundsMin[0]);
+	minY.push_back(boundsMin[1]);
+	minZ.push_back(boundsMin[2]);
+	maxX.push_back(boundsMax[0]);
+	maxY.push_back(boundsMax[1]);
+	maxZ.push_back(boundsMax[2]);
+}
+
+void BoundingBoxes::Set(size_t index, const float boundsMin[3], const float boundsMax[3])
+{
+	minX[index] = boundsMin[0];
+	minY[index] = boundsMin[1];
+	minZ[index] = boundsMin[2];
+	maxX[index] = boundsMax[0];
+	maxY[index] = boundsMax[1];
+	maxZ[index] = boundsMax[2];
+}
+
+//a box is outside a plane when its corner furthest along the plane normal is. which corner that is only depends
+//on the signs of the plane, so every plane picks its min or max array per axis once for all boxes
+struct CullPlane
+{
+	float a;
+	float b;
+	float c;
+	float d;
+	const float* x;
+	const float* y;
+	const float* z;
+};
+
+static void PrepareCullPlanes(const Frustum& frustum, const BoundingBoxes& boxes, CullPlane planes[6])
+{
+	for (int p = 0; p < 6; ++p)
+	{
+		const float* plane = frustum.planes[p];
+		planes[p] = CullPlane{ plane[0], plane[1], plane[2], plane[3],
+			plane[0] >= 0.0f ? boxes.maxX.data() : boxes.minX.data(),
+			plane[1] >= 0.0f ? boxes.maxY.data() : boxes.minY.data(),
+			plane[2] >= 0.0f ? boxes.maxZ.data() : boxes.minZ.data() };
+	}
+}
+
+#pragma region Scalar
+static inline bool BoxVisibleScalar(const CullPlane planes[6], size_t box)
+{
+	for (int p = 0; p < 6; ++p)
+	{
+		const CullPlane& plane = planes[p];
+		float distance = plane.a * plane.x[box] + plane.b * plane.y[box] + plane.c * plane.z[box] + plane.d;
+		if (distance < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+static uint32_t CullBoxesRange(const CullPlane planes[6], size_t begin, size_t end, uint32_t* visible, uint32_t count)
+{
+	for (size_t box = begin; box < end; ++box)
+	{
+		if (BoxVisibleScalar(planes, box))
+			visible[count++] = static_cast<uint32_t>(box);
+	}
+	return count;
+}
+
+static uint32_t CullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t* visible)
+{
+	CullPlane planes[6];
+	PrepareCullPlanes(frustum, boxes, planes);
+	return CullBoxesRange(planes, 0, boxes.Size(), visible, 0);
+}
+#pragma endregion
+
+#if defined(HEIGHTMAP_X86)
+#pragma region SSE2
+//four boxes per plane test, the products are summed in the scalar order so the kernels agree bit for bit.
+//the compaction has no branches: every lane writes its index to the next free slot and only the visible ones
+//advance it. the slot is never past the box itself, so visible does not need extra room
+static uint32_t CullBoxesSSE2(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t* visible)
+{
+	CullPlane planes[6];
+	PrepareCullPlanes(frustum, boxes, planes);
+
+	__m128 a[6], b[6], c[6], d[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		a[p] = _mm_set1_ps(planes[p].a);
+		b[p] = _mm_set1_ps(planes[p].b);
+		c[p] = _mm_set1_ps(planes[p].c);
+		d[p] = _mm_set1_ps(planes[p].d);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	size_t count = boxes.Size();
+	uint32_t visibleCount = 0;
+	size_t box = 0;
+	for (; box + 4 <= count; box += 4)
+	{
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(a[p], _mm_loadu_ps(planes[p].x + box)),
+				_mm_mul_ps(b[p], _mm_loadu_ps(planes[p].y + box))),
+				_mm_mul_ps(c[p], _mm_loadu_ps(planes[p].z + box))),
+				d[p]);
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+		}
+
+		int visibleMask = ~_mm_movemask_ps(outside) & 0xF;
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			visible[visibleCount] = static_cast<uint32_t>(box + lane);
+			visibleCount += (visibleMask >> lane) & 1;
+		}
+	}
+
+	return CullBoxesRange(planes, box, count, visible, visibleCount);
+}
+#pragma endregion
+
+#pragma region AVX2
+SIMD_TARGET("avx2")
+static uint32_t CullBoxesAVX2(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t* visible)
+{
+	CullPlane planes[6];
+	PrepareCullPlanes(frustum, boxes, planes);
+
+	__m256 a[6], b[6], c[6], d[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		a[p] = _mm256_set1_ps(planes[p].a);
+		b[p] = _mm256_set1_ps(planes[p].b);
+		c[p] = _mm256_set1_ps(planes[p].c);
+		d[p] = _mm256_set1_ps(planes[p].d);
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+	size_t count = boxes.Size();
+	uint32_t visibleCount = 0;
+	size_t box = 0;
+	for (; box + 8 <= count; box += 8)
+	{
+		__m256 outside = _mm256_setzero_ps();
+		for (int p = 0; p < 6; ++p)
+		{
+			//no fma, it would round differently from the other kernels
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(a[p], _mm256_loadu_ps(planes[p].x + box)),
+				_mm256_mul_ps(b[p], _mm256_loadu_ps(planes[p].y + box))),
+				_mm256_mul_ps(c[p], _mm256_loadu_ps(planes[p].z + box))),
+				d[p]);
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+		}
+
+		int visibleMask = ~_mm256_movemask_ps(outside) & 0xFF;
+		for (int lane = 0; lane < 8; ++lane)
+		{
+			visible[visibleCount] = static_cast<uint32_t>(box + lane);
+			visibleCount += (visibleMask >> lane) & 1;
+		}
+	}
+
+	return CullBoxesRange(planes, box, count, visible, visibleCount);
+}
+#pragma endregion
+#endif
+
+const FrustumCullKernels& GetFrustumCullKernels(SimdLevel level)
+{
+	static const FrustumCullKernels scalar = { SimdLevel::Scalar, CullBoxesScalar };
+#if defined(HEIGHTMAP_X86)
+	static const FrustumCullKernels sse2 = { SimdLevel::SSE2, CullBoxesSSE2 };
+	static const FrustumCullKernels avx2 = { SimdLevel::AVX2, CullBoxesAVX2 };
+
+	SimdLevel supported = DetectSimdLevel();
+	if (level > supported)
+		level = supported;
+
+	switch (level)
+	{
+	case SimdLevel::AVX512:
+	case SimdLevel::AVX2:
+		return avx2;
+	case SimdLevel::SSE2:
+		return sse2;
+	default:
+		break;
+	}
+#endif
+	return scalar;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "CpuFeatures.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//view frustum as six planes (a, b, c, d), a point p is on the inner side of a plane when a p.x + b p.y + c p.z + d >= 0.
+//the planes are not normalized, the culling only looks at the sign
+struct Frustum
+{
+	float planes[6][4];
+};
+
+//planes of a d3d style clip space (0 <= z <= w) in the space the matrix transforms from.
+//matrix is row major for row vectors, clip = v * matrix, which is the layout of XMFLOAT4X4. pass
+//model * view * projection to cull boxes given in the local space of the mesh
+Frustum ExtractFrustum(const float matrix[4][4]);
+
+//axis aligned boxes in structure of arrays layout, so the culling kernels load several boxes per instruction
+struct BoundingBoxes
+{
+	std::vector<float> minX;
+	std::vector<float> minY;
+	std::vector<float> minZ;
+	std::vector<float> maxX;
+	std::vector<float> maxY;
+	std::vector<float> maxZ;
+
+	size_t Size() const;
+	void Clear();
+	void Add(const float boundsMin[3], const float boundsMax[3]);
+	void Set(size_t index, const float boundsMin[3], const float boundsMax[3]);
+};
+
+//writes the index of every box that is not entirely outside one of the planes to visible, in order, and returns
+//how many were written. visible needs room for boxes.Size() indices. a box crossing the corner of the frustum
+//can be kept although it is outside, it is never culled while a part of it is inside
+using CullBoxesKernel = uint32_t(*)(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t* visible);
+
+//one culling kernel per instruction set, all of them keep the same boxes as the scalar one
+struct FrustumCullKernels
+{
+	SimdLevel level;
+	CullBoxesKernel cullBoxes;
+};
+
+//returns the kernels for the requested level, clamped to what the running cpu supports.
+//AVX-512 uses the AVX2 kernel, a frame has too few tiles for 16 lanes to matter
+const FrustumCullKernels& GetFrustumCullKernels(SimdLevel level);
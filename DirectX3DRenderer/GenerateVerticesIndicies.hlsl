@@ -5,7 +5,7 @@ struct VertexPositionUv {
 
 StructuredBuffer<float> DepthData  : register(t0); // Input depth data
 RWStructuredBuffer<VertexPositionUv> Vertices : register(u0); // Output vertices
-RWStructuredBuffer<uint> Indices : register(u1); // Output indices
+// Indices only depend on the grid size, they come from the shared GridIndexTable on the cpu
 
 cbuffer Constants{
 	uint modelWidth;
@@ -34,15 +34,4 @@ void Main(uint3 DTid : SV_DispatchThreadID)
 	vertex.uv = float2(posX, invertedPosY);
 
 	Vertices[vertexIndex] = vertex;
-
-	if (x < modelWidth - 1 && y < modelHeight - 1) {
-		uint baseIndex = (y * (modelWidth - 1) + x) * 6;
-		Indices[baseIndex + 0] = vertexIndex;
-		Indices[baseIndex + 1] = vertexIndex + 1;
-		Indices[baseIndex + 2] = vertexIndex + modelWidth;
-
-		Indices[baseIndex + 3] = vertexIndex + modelWidth;
-		Indices[baseIndex + 4] = vertexIndex + 1;
-		Indices[baseIndex + 5] = vertexIndex + modelWidth + 1;
-	}
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "GeometryPool.h"
+#include <algorithm>
+#include <sstream>
+
+#pragma region MemoryBufferDevice
+void* MemoryBufferDevice::CreateBuffer(BufferBinding, const void* data, size_t bytes)
+{
+	if (++_creates == failingCreate)
+		return nullptr;
+
+	auto contents = std::make_unique<std::string>(static_cast<const char*>(data), bytes);
+	void* buffer = contents.get();
+	_buffers[buffer] = std::move(contents);
+	_liveBytes += bytes;
+	return buffer;
+}
+
+void MemoryBufferDevice::ReleaseBuffer(void* buffer)
+{
+	auto found = _buffers.find(buffer);
+	if (found == _buffers.end())
+	{
+		++_unknownReleases;
+		return;
+	}
+	_liveBytes -= found->second->size();
+	_buffers.erase(found);
+}
+
+uint32_t MemoryBufferDevice::LiveBuffers() const
+{
+	return static_cast<uint32_t>(_buffers.size());
+}
+
+size_t MemoryBufferDevice::LiveBytes() const
+{
+	return _liveBytes;
+}
+
+uint32_t MemoryBufferDevice::UnknownReleases() const
+{
+	return _unknownReleases;
+}
+
+const std::string* MemoryBufferDevice::Contents(void* buffer) const
+{
+	auto found = _buffers.find(buffer);
+	return found != _buffers.end() ? found->second.get() : nullptr;
+}
+#pragma endregion
+
+#pragma region GeometryPool
+std::string FormatGeometryPoolStats(const GeometryPoolStats& stats)
+{
+	std::ostringstream line;
+	line << "Static geometry: " << stats.liveBuffers << " live buffers of " << stats.liveBytes << " bytes, " << stats.peakBytes
+		<< " bytes at the peak, " << stats.created << " created, " << stats.released << " released, " << stats.failed << " failed\n";
+	return line.str();
+}
+
+GeometryPool::GeometryPool(BufferDevice& device)
+	: _device(device)
+{
+}
+
+GeometryPool::~GeometryPool()
+{
+	Clear();
+}
+
+const StaticGeometry* GeometryPool::Register(const std::string& name, const void* vertices, uint32_t vertexStride, uint32_t vertexCount,
+	const uint32_t* indices, uint32_t indexCount)
+{
+	auto found = _geometry.find(name);
+	if (found != _geometry.end())
+		return &found->second;
+
+	StaticGeometry geometry;
+	geometry.vertexStride = vertexStride;
+	geometry.vertexCount = vertexCount;
+	geometry.indexCount = indexCount;
+	size_t vertexBytes = static_cast<size_t>(vertexStride) * vertexCount;
+	size_t indexBytes = sizeof(uint32_t) * static_cast<size_t>(indexCount);
+	geometry.bytes = vertexBytes + indexBytes;
+
+	geometry.vertexBuffer = _device.CreateBuffer(BufferBinding::Vertex, vertices, vertexBytes);
+	if (geometry.vertexBuffer != nullptr)
+		geometry.indexBuffer = _device.CreateBuffer(BufferBinding::Index, indices, indexBytes);
+	if (geometry.indexBuffer == nullptr)
+	{
+		if (geometry.vertexBuffer != nullptr)
+			_device.ReleaseBuffer(geometry.vertexBuffer);
+		++_stats.failed;
+		return nullptr;
+	}
+
+	_stats.created += 2;
+	_stats.liveBuffers += 2;
+	_stats.liveBytes += geometry.bytes;
+	_stats.peakBytes = (std::max)(_stats.peakBytes, _stats.liveBytes);
+	return &_geometry.emplace(name, geometry).first->second;
+}
+
+const StaticGeometry* GeometryPool::Find(const std::string& name) const
+{
+	auto found = _geometry.find(name);
+	return found != _geometry.end() ? &found->second : nullptr;
+}
+
+void GeometryPool::ReleaseBuffers(const StaticGeometry& geometry)
+{
+	_device.ReleaseBuffer(geometry.vertexBuffer);
+	_device.ReleaseBuffer(geometry.indexBuffer);
+	_stats.released += 2;
+	_stats.liveBuffers -= 2;
+	_stats.liveBytes -= geometry.bytes;
+}
+
+void GeometryPool::Release(const std::string& name)
+{
+	auto found = _geometry.find(name);
+	if (found == _geometry.end())
+		return;
+
+	ReleaseBuffers(found->second);
+	_geometry.erase(found);
+}
+
+void GeometryPool::Clear()
+{
+	for (const auto& entry : _geometry)
+		ReleaseBuffers(entry.second);
+	_geometry.clear();
+}
+
+GeometryPoolStats GeometryPool::Stats() const
+{
+	return _stats;
+}
+#pragma endregion
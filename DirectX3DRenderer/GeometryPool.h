@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+//owner of the geometry that never changes after startup, such as the base quad under the heightmap. every buffer is
+//created once through a BufferDevice, registered under a name and released by Release, Clear or the destructor,
+//and the pool keeps count of what is alive so a leak shows up in the log instead of in the debug layer only
+
+enum class BufferBinding
+{
+	Vertex,
+	Index
+};
+
+//creates and releases the buffers of a GeometryPool, d3d11 in Application (see D3D11BufferDevice)
+class BufferDevice
+{
+public:
+	virtual ~BufferDevice() = default;
+	//an immutable buffer holding a copy of bytes bytes of data. returns nullptr when it cannot be created
+	virtual void* CreateBuffer(BufferBinding binding, const void* data, size_t bytes) = 0;
+	//buffer came from CreateBuffer of this device
+	virtual void ReleaseBuffer(void* buffer) = 0;
+};
+
+//headless device: every buffer is a copy in system memory. counts what it holds on its own, so the accounting of
+//a pool can be checked against it
+class MemoryBufferDevice : public BufferDevice
+{
+public:
+	uint32_t failingCreate = 0;	//number of the CreateBuffer call that fails, counting from 1, 0 for none. for the error paths
+
+	void* CreateBuffer(BufferBinding binding, const void* data, size_t bytes) override;
+	void ReleaseBuffer(void* buffer) override;
+
+	uint32_t LiveBuffers() const;
+	size_t LiveBytes() const;
+	uint32_t UnknownReleases() const;	//buffers released twice or never created here
+	//the bytes of a live buffer, nullptr for anything else
+	const std::string* Contents(void* buffer) const;
+
+private:
+	std::map<void*, std::unique_ptr<std::string>> _buffers;
+	uint32_t _creates = 0;
+	size_t _liveBytes = 0;
+	uint32_t _unknownReleases = 0;
+};
+
+//vertices and 32-bit indices of one registered mesh
+struct StaticGeometry
+{
+	void* vertexBuffer = nullptr;
+	void* indexBuffer = nullptr;
+	uint32_t vertexStride = 0;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	size_t bytes = 0;	//of both buffers
+};
+
+struct GeometryPoolStats
+{
+	uint32_t liveBuffers = 0;
+	size_t liveBytes = 0;
+	size_t peakBytes = 0;
+	uint64_t created = 0;	//buffers since construction
+	uint64_t released = 0;
+	uint64_t failed = 0;	//Register calls whose buffers could not be created
+};
+
+//one line for the log
+std::string FormatGeometryPoolStats(const GeometryPoolStats& stats);
+
+class GeometryPool
+{
+public:
+	explicit GeometryPool(BufferDevice& device);
+	//releases whatever is still registered
+	~GeometryPool();
+
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	//creates the buffers of a mesh and registers them under name. a name that is already registered returns its geometry
+	//without creating anything. returns nullptr when a buffer cannot be created, nothing is kept then.
+	//the pointer stays valid until the name is released
+	const StaticGeometry* Register(const std::string& name, const void* vertices, uint32_t vertexStride, uint32_t vertexCount,
+		const uint32_t* indices, uint32_t indexCount);
+	//nullptr when name is not registered
+	const StaticGeometry* Find(const std::string& name) const;
+	void Release(const std::string& name);
+	void Clear();
+	GeometryPoolStats Stats() const;
+
+private:
+	BufferDevice& _device;
+	std::map<std::string, StaticGeometry> _geometry;
+	GeometryPoolStats _stats;
+
+	void ReleaseBuffers(const StaticGeometry& geometry);
+};
@@ -0,0 +1,127 @@
+#include "GridIndexTable.h"
+#include <algorithm>
+#include <cstring>
+
+//full tiles of the common sizes are generated by the compiler, only the edge tiles are built at run time
+static constexpr auto tileIndices16 = MakeTileIndices<GridTopology::TriangleList, 16>();
+static constexpr auto tileIndices32 = MakeTileIndices<GridTopology::TriangleList, 32>();
+static constexpr auto tileIndices64 = MakeTileIndices<GridTopology::TriangleList, 64>();
+static constexpr auto tileStripIndices16 = MakeTileIndices<GridTopology::TriangleStrip, 16>();
+static constexpr auto tileStripIndices32 = MakeTileIndices<GridTopology::TriangleStrip, 32>();
+static constexpr auto tileStripIndices64 = MakeTileIndices<GridTopology::TriangleStrip, 64>();
+static constexpr auto tileBandIndices16 = MakeTileIndices<GridTopology::TriangleListBands, 16>();
+static constexpr auto tileBandIndices32 = MakeTileIndices<GridTopology::TriangleListBands, 32>();
+static constexpr auto tileBandIndices64 = MakeTileIndices<GridTopology::TriangleListBands, 64>();
+
+static_assert(tileIndices64[6 * 64 - 1] == 63 + 65 + 1, "last quad of the first row ends on the second row");
+static_assert(tileIndices64.back() == 65 * 65 - 1, "last index is the bottom right vertex");
+static_assert(tileStripIndices64[2 * 65] == stripRestartIndex, "rows of the strip are separated by a restart");
+static_assert(tileStripIndices64.back() == 65 * 65 - 1, "last index is the bottom right vertex");
+static_assert(tileBandIndices64[6 * 6 * 64 - 1] == 64 * 65 + 6, "first band of 6 cells ends on the last row");
+static_assert(tileBandIndices64.back() == 65 * 65 - 1, "last index is the bottom right vertex");
+
+static const uint16_t* PrecomputedTile(GridTopology topology, uint32_t tileQuads)
+{
+	const uint16_t* lists[3] = { tileIndices16.data(), tileIndices32.data(), tileIndices64.data() };
+	const uint16_t* strips[3] = { tileStripIndices16.data(), tileStripIndices32.data(), tileStripIndices64.data() };
+	const uint16_t* bands[3] = { tileBandIndices16.data(), tileBandIndices32.data(), tileBandIndices64.data() };
+	const uint16_t* const* tables = topology == GridTopology::TriangleList ? lists : topology == GridTopology::TriangleStrip ? strips : bands;
+
+	switch (tileQuads)
+	{
+	case 16:
+		return tables[0];
+	case 32:
+		return tables[1];
+	case 64:
+		return tables[2];
+	default:
+		return nullptr;
+	}
+}
+
+const TileIndexRange* GridIndexTable::Find(uint32_t quadsX, uint32_t quadsY) const
+{
+	for (const TileIndexRange& range : ranges)
+	{
+		if (range.quadsX == quadsX && range.quadsY == quadsY)
+			return &range;
+	}
+	return nullptr;
+}
+
+bool GridIndexTableCache::HasPrecomputedTile(uint32_t tileQuads)
+{
+	return PrecomputedTile(GridTopology::TriangleList, tileQuads) != nullptr;
+}
+
+std::shared_ptr<const GridIndexTable> GridIndexTableCache::Create(uint32_t width, uint32_t height, uint32_t tileQuads, GridTopology topology)
+{
+	auto table = std::make_shared<GridIndexTable>();
+	table->width = width;
+	table->height = height;
+	table->tileQuads = tileQuads;
+	table->topology = topology;
+
+	if (width < 2 || height < 2 || tileQuads == 0)
+		return table;
+
+	//every tile is either full size or cut short by the right and/or bottom edge of the grid
+	uint32_t quadsX = width - 1;
+	uint32_t quadsY = height - 1;
+	uint32_t widths[2] = { std::min(tileQuads, quadsX), quadsX % tileQuads };
+	uint32_t heights[2] = { std::min(tileQuads, quadsY), quadsY % tileQuads };
+
+	for (uint32_t shapeHeight : heights)
+	{
+		for (uint32_t shapeWidth : widths)
+		{
+			if (shapeWidth == 0 || shapeHeight == 0 || table->Find(shapeWidth, shapeHeight) != nullptr)
+				continue;
+
+			TileIndexRange range{};
+			range.quadsX = shapeWidth;
+			range.quadsY = shapeHeight;
+			range.startIndex = static_cast<uint32_t>(table->indices.size());
+			range.indexCount = TileIndexCount(topology, shapeWidth, shapeHeight);
+			table->ranges.push_back(range);
+
+			table->indices.resize(table->indices.size() + range.indexCount);
+			uint16_t* out = table->indices.data() + range.startIndex;
+
+			const uint16_t* precomputed = PrecomputedTile(topology, tileQuads);
+			if (precomputed != nullptr && shapeWidth == tileQuads && shapeHeight == tileQuads)
+				std::memcpy(out, precomputed, range.indexCount * sizeof(uint16_t));
+			else
+				WriteTileIndices(topology, shapeWidth, shapeHeight, out);
+		}
+	}
+
+	return table;
+}
+
+std::shared_ptr<const GridIndexTable> GridIndexTableCache::Get(uint32_t width, uint32_t height, uint32_t tileQuads, GridTopology topology)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Key key(width, height, tileQuads, topology);
+	auto found = _tables.find(key);
+	if (found != _tables.end())
+		return found->second;
+
+	std::shared_ptr<const GridIndexTable> table = Create(width, height, tileQuads, topology);
+	_tables.emplace(key, table);
+	return table;
+}
+
+void GridIndexTableCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_tables.clear();
+}
+
+GridIndexTableCache& GridIndexTableCache::Shared()
+{
+	static GridIndexTableCache cache;
+	return cache;
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+enum class GridTopology
+{
+	TriangleList,		//six indices per cell
+	TriangleStrip,		//one strip per row of cells, rows separated by the 0xFFFF strip cut index
+	TriangleListBands	//six indices per cell, cells walked in vertical bands sized for the post-transform cache
+};
+
+//widest band of TriangleListBands. the first row of a band loads the vertices of two rows, 2 (band + 1) of them,
+//and a fifo post-transform cache has to hold all of them, or the misses cascade down every row after it.
+//7 suits the smallest (16 entry) caches
+constexpr uint32_t gridCacheBandQuads = 7;
+
+//d3d always restarts a strip at 0xFFFF when drawing with 16-bit indices
+constexpr uint16_t stripRestartIndex = 0xFFFF;
+
+constexpr uint32_t TileIndexCount(GridTopology topology, uint32_t quadsX, uint32_t quadsY)
+{
+	if (quadsX == 0 || quadsY == 0)
+		return 0;
+	if (topology != GridTopology::TriangleStrip)
+		return quadsX * quadsY * 6;
+
+	//two indices per column of every row, plus a restart between rows
+	return quadsY * (quadsX + 1) * 2 + (quadsY - 1);
+}
+
+//writes the two triangles of every cell of a quadsX x quadsY tile whose vertices are stored row major,
+//(quadsX + 1) per row. usable at compile time and at run time.
+constexpr void WriteTileIndices(uint32_t quadsX, uint32_t quadsY, uint16_t* out)
+{
+	uint32_t stride = quadsX + 1;
+	for (uint32_t y = 0; y < quadsY; ++y)
+	{
+		for (uint32_t x = 0; x < quadsX; ++x)
+		{
+			uint16_t topLeft = static_cast<uint16_t>(y * stride + x);
+			uint16_t bottomLeft = static_cast<uint16_t>(topLeft + stride);
+
+			out[0] = topLeft;
+			out[1] = static_cast<uint16_t>(topLeft + 1);
+			out[2] = bottomLeft;
+
+			out[3] = bottomLeft;
+			out[4] = static_cast<uint16_t>(topLeft + 1);
+			out[5] = static_cast<uint16_t>(bottomLeft + 1);
+			out += 6;
+		}
+	}
+}
+
+//same cells as WriteTileIndices, as a zigzag top, bottom, top, bottom... along every row. the triangles share
+//the diagonals of the list, but wind the other way round, which does not matter with culling off.
+constexpr void WriteTileStripIndices(uint32_t quadsX, uint32_t quadsY, uint16_t* out)
+{
+	uint32_t stride = quadsX + 1;
+	for (uint32_t y = 0; y < quadsY; ++y)
+	{
+		if (y > 0)
+			*out++ = stripRestartIndex;
+
+		for (uint32_t x = 0; x <= quadsX; ++x)
+		{
+			out[0] = static_cast<uint16_t>(y * stride + x);
+			out[1] = static_cast<uint16_t>((y + 1) * stride + x);
+			out += 2;
+		}
+	}
+}
+
+//same triangles as WriteTileIndices, but the columns are split into equal bands of at most gridCacheBandQuads
+//cells and each band is walked top to bottom before the next one. a row-major row of a wide tile has pushed the
+//row above out of the cache by the time it is reused, a band row still finds it there, which halves the vertex
+//shader invocations
+constexpr void WriteTileBandIndices(uint32_t quadsX, uint32_t quadsY, uint16_t* out)
+{
+	uint32_t stride = quadsX + 1;
+	uint32_t bandCount = (quadsX + gridCacheBandQuads - 1) / gridCacheBandQuads;
+	for (uint32_t band = 0; band < bandCount; ++band)
+	{
+		uint32_t xBegin = quadsX * band / bandCount;
+		uint32_t xEnd = quadsX * (band + 1) / bandCount;
+		for (uint32_t y = 0; y < quadsY; ++y)
+		{
+			for (uint32_t x = xBegin; x < xEnd; ++x)
+			{
+				uint16_t topLeft = static_cast<uint16_t>(y * stride + x);
+				uint16_t bottomLeft = static_cast<uint16_t>(topLeft + stride);
+
+				out[0] = topLeft;
+				out[1] = static_cast<uint16_t>(topLeft + 1);
+				out[2] = bottomLeft;
+
+				out[3] = bottomLeft;
+				out[4] = static_cast<uint16_t>(topLeft + 1);
+				out[5] = static_cast<uint16_t>(bottomLeft + 1);
+				out += 6;
+			}
+		}
+	}
+}
+
+constexpr void WriteTileIndices(GridTopology topology, uint32_t quadsX, uint32_t quadsY, uint16_t* out)
+{
+	if (topology == GridTopology::TriangleList)
+		WriteTileIndices(quadsX, quadsY, out);
+	else if (topology == GridTopology::TriangleListBands)
+		WriteTileBandIndices(quadsX, quadsY, out);
+	else
+		WriteTileStripIndices(quadsX, quadsY, out);
+}
+
+template <GridTopology TTopology, uint32_t TQuads>
+constexpr std::array<uint16_t, TileIndexCount(TTopology, TQuads, TQuads)> MakeTileIndices()
+{
+	std::array<uint16_t, TileIndexCount(TTopology, TQuads, TQuads)> indices{};
+	WriteTileIndices(TTopology, TQuads, TQuads, indices.data());
+	return indices;
+}
+
+//index range of one tile shape inside a GridIndexTable
+struct TileIndexRange
+{
+	uint32_t quadsX;
+	uint32_t quadsY;
+	uint32_t startIndex;
+	uint32_t indexCount;
+};
+
+//local 16-bit indices for every distinct tile shape of a tiled grid: the full tiles plus the narrower
+//tiles along the right and bottom edges. depends only on the grid size, never on the depth values.
+struct GridIndexTable
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t tileQuads = 0;
+	GridTopology topology = GridTopology::TriangleList;
+	std::vector<uint16_t> indices;
+	std::vector<TileIndexRange> ranges;
+
+	//nullptr when the grid has no tile of that shape
+	const TileIndexRange* Find(uint32_t quadsX, uint32_t quadsY) const;
+};
+
+//hands out one shared table per (width, height, tile size, topology), so every mesh and every reload of the same
+//size reuses the same indices and the renderer can keep the index buffer it already uploaded
+class GridIndexTableCache
+{
+private:
+	using Key = std::tuple<uint32_t, uint32_t, uint32_t, GridTopology>;
+
+	std::mutex _mutex;
+	std::map<Key, std::shared_ptr<const GridIndexTable>> _tables;
+
+	static std::shared_ptr<const GridIndexTable> Create(uint32_t width, uint32_t height, uint32_t tileQuads, GridTopology topology);
+
+public:
+	std::shared_ptr<const GridIndexTable> Get(uint32_t width, uint32_t height, uint32_t tileQuads, GridTopology topology);
+	void Clear();
+
+	//true when full tiles of this size are copied from a table generated at compile time
+	static bool HasPrecomputedTile(uint32_t tileQuads);
+
+	static GridIndexTableCache& Shared();
+};
@@ -0,0 +1,406 @@
+#include "HeightmapMeshBuilder.h"
+#include "HeightmapMeshKernels.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+HeightmapMeshBuilder::HeightmapMeshBuilder(HeightmapOrientation orientation, unsigned int threadCount, SimdLevel simdLevel,
+	GridIndexTableCache& indexTables)
+	: _orientation(orientation),
+	_pool(threadCount),
+	_simdLevel(GetHeightmapKernels<uint8_t>(simdLevel).level),
+	_indexTables(indexTables)
+{
+}
+
+SimdLevel HeightmapMeshBuilder::GetSimdLevel() const
+{
+	return _simdLevel;
+}
+
+size_t HeightmapMeshBuilder::VertexCount(uint32_t width, uint32_t height)
+{
+	return static_cast<size_t>(width) * height;
+}
+
+size_t HeightmapMeshBuilder::IndexCount(uint32_t width, uint32_t height)
+{
+	if (width < 2 || height < 2)
+		return 0;
+
+	return static_cast<size_t>(width - 1) * (height - 1) * 6;
+}
+
+const void* TiledHeightmapMesh::VertexData() const
+{
+	if (vertexFormat == HeightmapVertexFormat::Compact)
+		return compactVertices.data();
+	return vertices.data();
+}
+
+size_t TiledHeightmapMesh::VertexCount() const
+{
+	return vertexFormat == HeightmapVertexFormat::Compact ? compactVertices.size() : vertices.size();
+}
+
+size_t TiledHeightmapMesh::VertexStride() const
+{
+	return vertexFormat == HeightmapVertexFormat::Compact ? sizeof(CompactHeightmapVertex) : sizeof(HeightmapVertex);
+}
+
+size_t TiledHeightmapMesh::VertexBytes() const
+{
+	return VertexCount() * VertexStride();
+}
+
+const void* TiledHeightmapMesh::NormalData() const
+{
+	if (normalFormat == HeightmapNormalFormat::Octahedral)
+		return octahedralNormals.data();
+	return normals.data();
+}
+
+size_t TiledHeightmapMesh::NormalStride() const
+{
+	switch (normalFormat)
+	{
+	case HeightmapNormalFormat::Float:
+		return sizeof(HeightmapNormal);
+	case HeightmapNormalFormat::Octahedral:
+		return sizeof(OctahedralNormal);
+	default:
+		return 0;
+	}
+}
+
+size_t TiledHeightmapMesh::NormalBytes() const
+{
+	return NormalStride() * (normalFormat == HeightmapNormalFormat::Octahedral ? octahedralNormals.size() : normals.size());
+}
+
+template <typename Sample>
+void HeightmapMeshBuilder::Build(const Sample* depthData, uint32_t width, uint32_t height, HeightmapMesh& mesh) const
+{
+	mesh.width = width;
+	mesh.height = height;
+	mesh.maxDepth = 0;
+	mesh.vertices.resize(VertexCount(width, height));
+	mesh.indices.resize(IndexCount(width, height));
+
+	if (mesh.vertices.empty())
+		return;
+
+	const HeightmapKernels<Sample>& kernels = GetHeightmapKernels<Sample>(_simdLevel);
+
+	//first pass: every band reduces the max depth of its rows and emits the indices of the quads
+	//starting on those rows, the indices do not depend on the depth values so they can be written here
+	Sample bandMax[maxRowBands];
+	uint32_t* indices = mesh.indices.data();
+	ParallelForRowBands(_pool, height, [&](unsigned int band, uint32_t rowBegin, uint32_t rowEnd)
+	{
+		const Sample* begin = depthData + static_cast<size_t>(rowBegin) * width;
+		const Sample* end = depthData + static_cast<size_t>(rowEnd) * width;
+		bandMax[band] = *std::max_element(begin, end);
+
+		uint32_t quadRowEnd = std::min(rowEnd, height - 1);
+		for (uint32_t y = rowBegin; y < quadRowEnd && width > 1; ++y)
+			kernels.writeIndexRow(width, y, indices + static_cast<size_t>(y) * (width - 1) * 6);
+	});
+
+	mesh.maxDepth = static_cast<float>(*std::max_element(bandMax, bandMax + RowBandCount(height, _pool)));
+
+	//second pass: normalize and write the vertices.
+	//a max of 0 means every sample is 0, dividing by 1 keeps the map flat instead of producing nan
+	const float depthDivisor = mesh.maxDepth > 0.0f ? mesh.maxDepth : 1.0f;
+	HeightmapVertex* vertices = mesh.vertices.data();
+	ParallelForRowBands(_pool, height, [&](unsigned int, uint32_t rowBegin, uint32_t rowEnd)
+	{
+		for (uint32_t y = rowBegin; y < rowEnd; ++y)
+		{
+			size_t rowOffset = static_cast<size_t>(y) * width;
+			kernels.writeVertexRow(depthData + rowOffset, width, height, y, 0, width, depthDivisor, _orientation, vertices + rowOffset);
+		}
+	});
+}
+
+template <typename Sample>
+Sample HeightmapMeshBuilder::ReduceMaxDepth(const Sample* depthData, uint32_t width, uint32_t height) const
+{
+	Sample bandMax[maxRowBands];
+	ParallelForRowBands(_pool, height, [&](unsigned int band, uint32_t rowBegin, uint32_t rowEnd)
+	{
+		const Sample* begin = depthData + static_cast<size_t>(rowBegin) * width;
+		const Sample* end = depthData + static_cast<size_t>(rowEnd) * width;
+		bandMax[band] = *std::max_element(begin, end);
+	});
+
+	unsigned int bandCount = RowBandCount(height, _pool);
+	return bandCount == 0 ? Sample() : *std::max_element(bandMax, bandMax + bandCount);
+}
+
+//same divisions as the vertex kernels, so the box is exactly the extent of the tile's vertices. the depth goes
+//through the unorm16 round trip for compact vertices, which is monotonic and keeps the box tight
+void HeightmapMeshBuilder::WriteTileBounds(HeightmapTile& tile, uint32_t width, uint32_t height, float minDepth, float maxDepth,
+	float depthDivisor, bool compact) const
+{
+	float minDepthValue = minDepth / depthDivisor;
+	float maxDepthValue = maxDepth / depthDivisor;
+	if (compact)
+	{
+		minDepthValue = DequantizeHeight(QuantizeHeight(minDepthValue));
+		maxDepthValue = DequantizeHeight(QuantizeHeight(maxDepthValue));
+	}
+
+	int depthSlot = _orientation == HeightmapOrientation::HeightAlongY ? 1 : 2;
+	int rowSlot = 3 - depthSlot;
+
+	tile.boundsMin[0] = static_cast<float>(tile.x) / static_cast<float>(width);
+	tile.boundsMax[0] = static_cast<float>(tile.x + tile.quadsX) / static_cast<float>(width);
+	tile.boundsMin[depthSlot] = minDepthValue;
+	tile.boundsMax[depthSlot] = maxDepthValue;
+	//rows run towards smaller coordinates
+	tile.boundsMin[rowSlot] = 1.0f - static_cast<float>(tile.y + tile.quadsY) / static_cast<float>(height);
+	tile.boundsMax[rowSlot] = 1.0f - static_cast<float>(tile.y) / static_cast<float>(height);
+}
+
+template <typename Sample>
+void HeightmapMeshBuilder::BuildTiled(const Sample* depthData, uint32_t width, uint32_t height, const TiledMeshOptions& options,
+	TiledHeightmapMesh& mesh) const
+{
+	const uint32_t tileQuads = options.tileQuads;
+	if (tileQuads == 0 || tileQuads > maxHeightmapTileQuads)
+		throw std::invalid_argument("HeightmapMeshBuilder: tile size must be between 1 and maxHeightmapTileQuads");
+	if (options.vertexFormat == HeightmapVertexFormat::Compact && (width > 0x10000 || height > 0x10000))
+		throw std::invalid_argument("HeightmapMeshBuilder: compact vertices address at most 65536 x 65536 samples");
+
+	mesh.width = width;
+	mesh.height = height;
+	mesh.tileQuads = tileQuads;
+	mesh.maxDepth = 0.0f;
+	mesh.vertexFormat = options.vertexFormat;
+	mesh.normalFormat = options.normalFormat;
+	mesh.tiles.clear();
+	mesh.indexTable = _indexTables.Get(width, height, tileQuads, options.topology);
+
+	//only the vectors of the chosen formats hold vertices and normals
+	mesh.vertices.clear();
+	mesh.compactVertices.clear();
+	mesh.normals.clear();
+	mesh.octahedralNormals.clear();
+	mesh.rowMaxDepth.clear();
+	if (width < 2 || height < 2)
+		return;
+
+	//lay out the tiles first so every tile knows where its vertices go and which shared indices it draws
+	uint32_t quadsX = width - 1;
+	uint32_t quadsY = height - 1;
+	size_t vertexCount = 0;
+	for (uint32_t tileY = 0; tileY < quadsY; tileY += tileQuads)
+	{
+		for (uint32_t tileX = 0; tileX < quadsX; tileX += tileQuads)
+		{
+			HeightmapTile tile{};
+			tile.x = tileX;
+			tile.y = tileY;
+			tile.quadsX = std::min(tileQuads, quadsX - tileX);
+			tile.quadsY = std::min(tileQuads, quadsY - tileY);
+			tile.baseVertex = static_cast<uint32_t>(vertexCount);
+
+			const TileIndexRange* range = mesh.indexTable->Find(tile.quadsX, tile.quadsY);
+			tile.startIndex = range->startIndex;
+			tile.indexCount = range->indexCount;
+			mesh.tiles.push_back(tile);
+
+			vertexCount += static_cast<size_t>(tile.quadsX + 1) * (tile.quadsY + 1);
+		}
+	}
+	bool compact = options.vertexFormat == HeightmapVertexFormat::Compact;
+	if (compact)
+		mesh.compactVertices.resize(vertexCount);
+	else
+		mesh.vertices.resize(vertexCount);
+	if (options.normalFormat == HeightmapNormalFormat::Float)
+		mesh.normals.resize(vertexCount);
+	else if (options.normalFormat == HeightmapNormalFormat::Octahedral)
+		mesh.octahedralNormals.resize(vertexCount);
+
+	mesh.rowMaxDepth.resize(height);
+	WriteRowMaxDepth(depthData, mesh);
+	mesh.maxDepth = *std::max_element(mesh.rowMaxDepth.begin(), mesh.rowMaxDepth.end());
+	WriteTiles(depthData, mesh);
+}
+
+template <typename Sample>
+void HeightmapMeshBuilder::WriteRowMaxDepth(const Sample* depthData, TiledHeightmapMesh& mesh) const
+{
+	ParallelForRowBands(_pool, mesh.height, [&](unsigned int, uint32_t rowBegin, uint32_t rowEnd)
+	{
+		for (uint32_t y = rowBegin; y < rowEnd; ++y)
+		{
+			const Sample* depthRow = depthData + static_cast<size_t>(y) * mesh.width;
+			mesh.rowMaxDepth[y] = static_cast<float>(*std::max_element(depthRow, depthRow + mesh.width));
+		}
+	});
+}
+
+//vertices and normals of the samples [xBegin, xEnd) of row y, inside the block of tile
+template <typename Sample>
+void HeightmapMeshBuilder::WriteTileRow(const Sample* depthData, const HeightmapKernels<Sample>& kernels, const HeightmapTile& tile,
+	uint32_t y, uint32_t xBegin, uint32_t xEnd, float depthDivisor, TiledHeightmapMesh& mesh) const
+{
+	const Sample* depthRow = depthData + static_cast<size_t>(y) * mesh.width;
+	size_t rowVertex = tile.baseVertex + static_cast<size_t>(y - tile.y) * (tile.quadsX + 1) + (xBegin - tile.x);
+	if (mesh.vertexFormat == HeightmapVertexFormat::Compact)
+		WriteCompactVertexRow(depthRow, y, xBegin, xEnd, depthDivisor, mesh.compactVertices.data() + rowVertex);
+	else
+		kernels.writeVertexRow(depthRow, mesh.width, mesh.height, y, xBegin, xEnd, depthDivisor, _orientation,
+			mesh.vertices.data() + rowVertex);
+
+	if (mesh.normalFormat == HeightmapNormalFormat::Float)
+		kernels.writeNormalRow(depthData, mesh.width, mesh.height, y, xBegin, xEnd, depthDivisor, _orientation,
+			mesh.normals.data() + rowVertex);
+	else if (mesh.normalFormat == HeightmapNormalFormat::Octahedral)
+		kernels.writeOctahedralNormalRow(depthData, mesh.width, mesh.height, y, xBegin, xEnd, depthDivisor,
+			mesh.octahedralNormals.data() + rowVertex);
+}
+
+//every vertex, normal and box of the laid out tiles, normalized by mesh.maxDepth
+template <typename Sample>
+void HeightmapMeshBuilder::WriteTiles(const Sample* depthData, TiledHeightmapMesh& mesh) const
+{
+	const HeightmapKernels<Sample>& kernels = GetHeightmapKernels<Sample>(_simdLevel);
+	const float depthDivisor = mesh.maxDepth > 0.0f ? mesh.maxDepth : 1.0f;
+	bool compact = mesh.vertexFormat == HeightmapVertexFormat::Compact;
+
+	uint32_t tileCount = static_cast<uint32_t>(mesh.tiles.size());
+	ParallelForRowBands(_pool, tileCount, [&](unsigned int, uint32_t tileBegin, uint32_t tileEnd)
+	{
+		for (uint32_t t = tileBegin; t < tileEnd; ++t)
+		{
+			HeightmapTile& tile = mesh.tiles[t];
+			uint32_t stride = tile.quadsX + 1;
+			Sample minDepth = std::numeric_limits<Sample>::max();
+			Sample maxDepth = Sample();
+
+			for (uint32_t y = tile.y; y <= tile.y + tile.quadsY; ++y)
+			{
+				WriteTileRow(depthData, kernels, tile, y, tile.x, tile.x + stride, depthDivisor, mesh);
+
+				const Sample* depthRow = depthData + static_cast<size_t>(y) * mesh.width;
+				auto rowRange = std::minmax_element(depthRow + tile.x, depthRow + tile.x + stride);
+				minDepth = std::min(minDepth, *rowRange.first);
+				maxDepth = std::max(maxDepth, *rowRange.second);
+			}
+
+			WriteTileBounds(tile, mesh.width, mesh.height, static_cast<float>(minDepth), static_cast<float>(maxDepth), depthDivisor, compact);
+		}
+	});
+}
+
+template <typename Sample>
+void HeightmapMeshBuilder::UpdateTiled(const Sample* depthData, const DepthRect& rect, TiledHeightmapMesh& mesh,
+	TiledMeshUpdate& update) const
+{
+	update.vertexRanges.clear();
+	update.tiles.clear();
+	update.allVertices = false;
+	if (mesh.tiles.empty() || rect.x >= mesh.width || rect.y >= mesh.height || rect.width == 0 || rect.height == 0)
+		return;
+
+	uint32_t x0 = rect.x;
+	uint32_t y0 = rect.y;
+	uint32_t x1 = rect.x + std::min(rect.width, mesh.width - rect.x);
+	uint32_t y1 = rect.y + std::min(rect.height, mesh.height - rect.y);
+
+	//the heights are divided by the max depth, when it moves nothing of the old mesh is left
+	for (uint32_t y = y0; y < y1; ++y)
+	{
+		const Sample* depthRow = depthData + static_cast<size_t>(y) * mesh.width;
+		mesh.rowMaxDepth[y] = static_cast<float>(*std::max_element(depthRow, depthRow + mesh.width));
+	}
+	float maxDepth = *std::max_element(mesh.rowMaxDepth.begin(), mesh.rowMaxDepth.end());
+	if (maxDepth != mesh.maxDepth)
+	{
+		mesh.maxDepth = maxDepth;
+		WriteTiles(depthData, mesh);
+
+		update.allVertices = true;
+		update.vertexRanges.push_back(VertexRange{ 0, static_cast<uint32_t>(mesh.VertexCount()) });
+		update.tiles.resize(mesh.tiles.size());
+		for (uint32_t t = 0; t < update.tiles.size(); ++t)
+			update.tiles[t] = t;
+		return;
+	}
+
+	//a normal reads the samples next to it, so the ring around the rect changes too
+	if (mesh.normalFormat != HeightmapNormalFormat::None)
+	{
+		x0 = x0 > 0 ? x0 - 1 : 0;
+		y0 = y0 > 0 ? y0 - 1 : 0;
+		x1 = std::min(x1 + 1, mesh.width);
+		y1 = std::min(y1 + 1, mesh.height);
+	}
+
+	//a sample on the edge between tiles is a vertex of each of them
+	const uint32_t tileQuads = mesh.tileQuads;
+	uint32_t tilesX = (mesh.width - 1 + tileQuads - 1) / tileQuads;
+	uint32_t tilesY = (mesh.height - 1 + tileQuads - 1) / tileQuads;
+	uint32_t tileXBegin = x0 > 0 ? (x0 - 1) / tileQuads : 0;
+	uint32_t tileYBegin = y0 > 0 ? (y0 - 1) / tileQuads : 0;
+	uint32_t tileXEnd = std::min((x1 - 1) / tileQuads + 1, tilesX);
+	uint32_t tileYEnd = std::min((y1 - 1) / tileQuads + 1, tilesY);
+
+	const HeightmapKernels<Sample>& kernels = GetHeightmapKernels<Sample>(_simdLevel);
+	const float depthDivisor = mesh.maxDepth > 0.0f ? mesh.maxDepth : 1.0f;
+	bool compact = mesh.vertexFormat == HeightmapVertexFormat::Compact;
+	for (uint32_t tileY = tileYBegin; tileY < tileYEnd; ++tileY)
+	{
+		for (uint32_t tileX = tileXBegin; tileX < tileXEnd; ++tileX)
+		{
+			uint32_t t = tileY * tilesX + tileX;
+			HeightmapTile& tile = mesh.tiles[t];
+			uint32_t stride = tile.quadsX + 1;
+			uint32_t xBegin = std::max(x0, tile.x);
+			uint32_t xEnd = std::min(x1, tile.x + stride);
+			uint32_t yBegin = std::max(y0, tile.y);
+			uint32_t yEnd = std::min(y1, tile.y + tile.quadsY + 1);
+			for (uint32_t y = yBegin; y < yEnd; ++y)
+				WriteTileRow(depthData, kernels, tile, y, xBegin, xEnd, depthDivisor, mesh);
+
+			//the box may shrink as well as grow, so it is measured again over the whole tile
+			Sample minDepth = std::numeric_limits<Sample>::max();
+			Sample tileMaxDepth = Sample();
+			for (uint32_t y = tile.y; y <= tile.y + tile.quadsY; ++y)
+			{
+				const Sample* depthRow = depthData + static_cast<size_t>(y) * mesh.width;
+				auto rowRange = std::minmax_element(depthRow + tile.x, depthRow + tile.x + stride);
+				minDepth = std::min(minDepth, *rowRange.first);
+				tileMaxDepth = std::max(tileMaxDepth, *rowRange.second);
+			}
+			WriteTileBounds(tile, mesh.width, mesh.height, static_cast<float>(minDepth), static_cast<float>(tileMaxDepth), depthDivisor, compact);
+			update.tiles.push_back(t);
+
+			//one range from the first to the last rewritten vertex, the rows between are only uploaded again
+			uint32_t firstVertex = tile.baseVertex + (yBegin - tile.y) * stride + (xBegin - tile.x);
+			uint32_t endVertex = tile.baseVertex + (yEnd - 1 - tile.y) * stride + (xEnd - tile.x);
+			if (!update.vertexRanges.empty() &&
+				update.vertexRanges.back().firstVertex + update.vertexRanges.back().vertexCount == firstVertex)
+				update.vertexRanges.back().vertexCount += endVertex - firstVertex;
+			else
+				update.vertexRanges.push_back(VertexRange{ firstVertex, endVertex - firstVertex });
+		}
+	}
+}
+
+//the sample types of the map, see HeightmapMeshBuilder
+#define INSTANTIATE_HEIGHTMAP_MESH_BUILDER(Sample) \
+	template void HeightmapMeshBuilder::Build<Sample>(const Sample* depthData, uint32_t width, uint32_t height, HeightmapMesh& mesh) const; \
+	template void HeightmapMeshBuilder::BuildTiled<Sample>(const Sample* depthData, uint32_t width, uint32_t height, \
+		const TiledMeshOptions& options, TiledHeightmapMesh& mesh) const; \
+	template void HeightmapMeshBuilder::UpdateTiled<Sample>(const Sample* depthData, const DepthRect& rect, TiledHeightmapMesh& mesh, \
+		TiledMeshUpdate& update) const; \
+	template Sample HeightmapMeshBuilder::ReduceMaxDepth<Sample>(const Sample* depthData, uint32_t width, uint32_t height) const;
+
+INSTANTIATE_HEIGHTMAP_MESH_BUILDER(uint8_t)
+INSTANTIATE_HEIGHTMAP_MESH_BUILDER(uint16_t)
+INSTANTIATE_HEIGHTMAP_MESH_BUILDER(float)
@@ -0,0 +1,165 @@
+#pragma once
+#include "CpuFeatures.h"
+#include "GridIndexTable.h"
+#include "HeightmapVertex.h"
+#include "ParallelFor.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct HeightmapMesh
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	float maxDepth = 0.0f;	//largest sample, in the units of the map
+	std::vector<HeightmapVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+//largest tile edge in quads, (254 + 1)^2 vertices keep every local index below the 0xFFFF restart value
+constexpr uint32_t maxHeightmapTileQuads = 254;
+//full tiles of this size use the index table generated at compile time
+constexpr uint32_t defaultHeightmapTileQuads = 64;
+
+//how BuildTiled splits and encodes the grid
+struct TiledMeshOptions
+{
+	uint32_t tileQuads = defaultHeightmapTileQuads;
+	GridTopology topology = GridTopology::TriangleStrip;
+	HeightmapVertexFormat vertexFormat = HeightmapVertexFormat::Full;
+	HeightmapNormalFormat normalFormat = HeightmapNormalFormat::Octahedral;
+};
+
+//one DrawIndexed of a TiledHeightmapMesh
+struct HeightmapTile
+{
+	uint32_t x;				//first grid column covered by the tile
+	uint32_t y;				//first grid row covered by the tile
+	uint32_t quadsX;
+	uint32_t quadsY;
+	uint32_t baseVertex;	//BaseVertexLocation of the draw
+	uint32_t startIndex;	//StartIndexLocation of the draw, inside indexTable
+	uint32_t indexCount;
+	float boundsMin[3];		//tight box of the tile's vertices in the local space of the mesh, for culling
+	float boundsMax[3];
+};
+
+//grid split into tiles of at most tileQuads x tileQuads cells. every tile owns a (quadsX + 1) x (quadsY + 1)
+//block of vertices, vertices on the edge between two tiles are written into both blocks so the 16-bit
+//indices of a tile only have to address its own block. tiles of the same shape therefore draw the same
+//indices, which live in a GridIndexTable shared by every mesh of that size.
+struct TiledHeightmapMesh
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t tileQuads = 0;
+	float maxDepth = 0.0f;	//largest sample, in the units of the map
+	HeightmapVertexFormat vertexFormat = HeightmapVertexFormat::Full;
+	std::vector<HeightmapVertex> vertices;				//filled for HeightmapVertexFormat::Full
+	std::vector<CompactHeightmapVertex> compactVertices;	//filled for HeightmapVertexFormat::Compact
+	HeightmapNormalFormat normalFormat = HeightmapNormalFormat::None;
+	std::vector<HeightmapNormal> normals;				//filled for HeightmapNormalFormat::Float, one per vertex
+	std::vector<OctahedralNormal> octahedralNormals;	//filled for HeightmapNormalFormat::Octahedral, one per vertex
+	std::vector<float> rowMaxDepth;						//largest sample of every map row, so updates find maxDepth without reading the map
+	std::shared_ptr<const GridIndexTable> indexTable;
+	std::vector<HeightmapTile> tiles;
+
+	//vertex buffer contents in the chosen format
+	const void* VertexData() const;
+	size_t VertexCount() const;
+	size_t VertexStride() const;
+	size_t VertexBytes() const;
+
+	//normal stream in the chosen format, empty for HeightmapNormalFormat::None
+	const void* NormalData() const;
+	size_t NormalStride() const;
+	size_t NormalBytes() const;
+};
+
+//samples [x, x + width) x [y, y + height) of the depth map
+struct DepthRect
+{
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+//vertices [firstVertex, firstVertex + vertexCount) of a TiledHeightmapMesh, the same range of its normal stream
+struct VertexRange
+{
+	uint32_t firstVertex;
+	uint32_t vertexCount;
+};
+
+//what UpdateTiled rewrote, to be uploaded
+struct TiledMeshUpdate
+{
+	std::vector<VertexRange> vertexRanges;	//ascending and disjoint
+	std::vector<uint32_t> tiles;			//tiles whose vertices or bounds were rewritten, ascending
+	bool allVertices = false;				//the max depth moved and every vertex was normalized again
+};
+
+template <typename Sample>
+struct HeightmapKernels;
+
+//converts a depth map into a regular grid mesh with two triangles per cell. the map is read in place in its own sample
+//type, uint8_t, uint16_t (millimeters of a depth sensor) or float, and the heights are the samples divided by the
+//largest one, so an 8-bit map widened to 16 bits or float builds the same mesh. float samples must be finite and not
+//negative. the member templates are instantiated for those three types in HeightmapMeshBuilder.cpp.
+//for 8-bit maps the output matches the original single threaded loop in LoadAndPrepareRenderResource bit for bit,
+//but the buffers are sized up front, the rows are split into bands that are processed in parallel
+//and each row is written by the widest SIMD kernel the cpu supports (see HeightmapMeshKernels).
+class HeightmapMeshBuilder
+{
+private:
+	HeightmapOrientation _orientation;
+	mutable RowBandPool _pool;
+	SimdLevel _simdLevel;
+	GridIndexTableCache& _indexTables;
+
+	void WriteTileBounds(HeightmapTile& tile, uint32_t width, uint32_t height, float minDepth, float maxDepth,
+		float depthDivisor, bool compact) const;
+	template <typename Sample>
+	void WriteTileRow(const Sample* depthData, const HeightmapKernels<Sample>& kernels, const HeightmapTile& tile, uint32_t y,
+		uint32_t xBegin, uint32_t xEnd, float depthDivisor, TiledHeightmapMesh& mesh) const;
+	template <typename Sample>
+	void WriteTiles(const Sample* depthData, TiledHeightmapMesh& mesh) const;
+	template <typename Sample>
+	void WriteRowMaxDepth(const Sample* depthData, TiledHeightmapMesh& mesh) const;
+
+public:
+	//threadCount of 0 uses every hardware thread, simdLevel is clamped to what the cpu supports
+	explicit HeightmapMeshBuilder(
+		HeightmapOrientation orientation = HeightmapOrientation::HeightAlongY,
+		unsigned int threadCount = 0,
+		SimdLevel simdLevel = SimdLevel::AVX512,
+		GridIndexTableCache& indexTables = GridIndexTableCache::Shared());
+
+	SimdLevel GetSimdLevel() const;
+
+	//reuses the storage already held by mesh, so rebuilding a map of the same size does not allocate
+	template <typename Sample>
+	void Build(const Sample* depthData, uint32_t width, uint32_t height, HeightmapMesh& mesh) const;
+
+	//same vertices as Build (or their compact encoding), split into tiles with 16-bit local indices in the given topology.
+	//the normals are written in the same pass as the vertices, while the rows around them are still in the cache.
+	//throws std::invalid_argument when options.tileQuads is 0 or larger than maxHeightmapTileQuads
+	template <typename Sample>
+	void BuildTiled(const Sample* depthData, uint32_t width, uint32_t height, const TiledMeshOptions& options,
+		TiledHeightmapMesh& mesh) const;
+
+	//rewrites what depends on the samples in rect after they changed in depthData: their vertices, the normals around
+	//them and the bounds of the tiles they are in, the rest of mesh is kept. mesh must come from BuildTiled of a map of
+	//the same size. a change of the max depth rewrites every vertex, since the heights are normalized by it
+	template <typename Sample>
+	void UpdateTiled(const Sample* depthData, const DepthRect& rect, TiledHeightmapMesh& mesh, TiledMeshUpdate& update) const;
+
+	//largest sample of the map, the value every builder normalizes the depth by
+	template <typename Sample>
+	Sample ReduceMaxDepth(const Sample* depthData, uint32_t width, uint32_t height) const;
+
+	static size_t VertexCount(uint32_t width, uint32_t height);
+	static size_t IndexCount(uint32_t width, uint32_t height);
+};
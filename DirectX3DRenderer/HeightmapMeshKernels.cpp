@@ -0,0 +1,660 @@
+#include "HeightmapMeshKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(HEIGHTMAP_X86)
+#include <immintrin.h>
+#endif
+
+//quad index pattern relative to the top left vertex: two triangles (tl, tr, bl) and (bl, tr, br)
+static inline void FillIndexPattern(uint32_t width, uint32_t quadCount, uint32_t* pattern)
+{
+	const uint32_t offsets[6] = { 0, 1, width, width, 1, width + 1 };
+	for (uint32_t quad = 0; quad < quadCount; ++quad)
+		for (uint32_t i = 0; i < 6; ++i)
+			pattern[quad * 6 + i] = quad + offsets[i];
+}
+
+#pragma region Scalar
+template <typename Sample>
+static void WriteVertexRowScalar(const Sample* depthRow, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, HeightmapOrientation orientation, HeightmapVertex* out)
+{
+	const float fWidth = static_cast<float>(width);
+	float posZ = static_cast<float>(y) / static_cast<float>(height);
+	float invertedPosZ = 1.0f - posZ;
+	int depthSlot = orientation == HeightmapOrientation::HeightAlongY ? 1 : 2;
+	int rowSlot = 3 - depthSlot;
+
+	for (uint32_t x = xBegin; x < xEnd; ++x)
+	{
+		float posX = static_cast<float>(x) / fWidth;
+
+		HeightmapVertex& vertex = out[x - xBegin];
+		vertex.position[0] = posX;
+		vertex.position[depthSlot] = static_cast<float>(depthRow[x]) / depthDivisor;
+		vertex.position[rowSlot] = invertedPosZ;
+		vertex.texCoord[0] = posX;
+		vertex.texCoord[1] = invertedPosZ;
+	}
+}
+
+template <typename Sample>
+void WriteCompactVertexRow(const Sample* depthRow, uint32_t y, uint32_t xBegin, uint32_t xEnd, float depthDivisor,
+	CompactHeightmapVertex* out)
+{
+	for (uint32_t x = xBegin; x < xEnd; ++x)
+	{
+		CompactHeightmapVertex& vertex = out[x - xBegin];
+		vertex.gridX = static_cast<uint16_t>(x);
+		vertex.gridY = static_cast<uint16_t>(y);
+		vertex.height = QuantizeHeight(static_cast<float>(depthRow[x]) / depthDivisor);
+		vertex.padding = 0;
+	}
+}
+
+//the unnormalized normal of a sample is (a, 1, b) in the (x, depth, row) slots, a and b are the depth differences
+//across the sample times the grid spacing. the scales are fixed per row so the simd kernels multiply by the same values
+template <typename Sample>
+struct NormalRows
+{
+	const Sample* up;
+	const Sample* row;
+	const Sample* down;
+	float scaleX;		//interior columns, -width / (2 * depthDivisor)
+	float edgeScaleX;	//first and last column, one sided
+	float scaleY;		//positive, the row coordinate shrinks as y grows
+};
+
+template <typename Sample>
+static inline NormalRows<Sample> MakeNormalRows(const Sample* depthData, uint32_t width, uint32_t height, uint32_t y, float depthDivisor)
+{
+	NormalRows<Sample> rows;
+	rows.row = depthData + static_cast<size_t>(y) * width;
+	rows.up = y > 0 ? rows.row - width : rows.row;
+	rows.down = y + 1 < height ? rows.row + width : rows.row;
+	rows.scaleX = -static_cast<float>(width) / (2.0f * depthDivisor);
+	rows.edgeScaleX = -static_cast<float>(width) / depthDivisor;
+	float rowSteps = y > 0 && y + 1 < height ? 2.0f : 1.0f;
+	rows.scaleY = static_cast<float>(height) / (rowSteps * depthDivisor);
+	return rows;
+}
+
+//the differences are taken in float, which is exact for 8 and 16-bit samples, so every sample type runs the same code
+template <typename Sample>
+static inline void NormalSlopes(const NormalRows<Sample>& rows, uint32_t width, uint32_t x, float& a, float& b)
+{
+	uint32_t left = x > 0 ? x - 1 : x;
+	uint32_t right = x + 1 < width ? x + 1 : x;
+	float scaleX = right - left == 2 ? rows.scaleX : rows.edgeScaleX;
+	a = (static_cast<float>(rows.row[right]) - static_cast<float>(rows.row[left])) * scaleX;
+	b = (static_cast<float>(rows.down[x]) - static_cast<float>(rows.up[x])) * rows.scaleY;
+}
+
+template <typename Sample>
+static void WriteNormalRowScalar(const Sample* depthData, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, HeightmapOrientation orientation, HeightmapNormal* out)
+{
+	NormalRows<Sample> rows = MakeNormalRows(depthData, width, height, y, depthDivisor);
+	for (uint32_t x = xBegin; x < xEnd; ++x)
+	{
+		float a, b;
+		NormalSlopes(rows, width, x, a, b);
+		float inverseLength = 1.0f / std::sqrt(a * a + b * b + 1.0f);
+		StoreHeightmapNormal(a * inverseLength, inverseLength, b * inverseLength, orientation, out[x - xBegin].normal);
+	}
+}
+
+//(a, 1, b) divided by its l1 norm is already on the octahedron, the normal never has to be normalized
+template <typename Sample>
+static void WriteOctahedralNormalRowScalar(const Sample* depthData, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, OctahedralNormal* out)
+{
+	NormalRows<Sample> rows = MakeNormalRows(depthData, width, height, y, depthDivisor);
+	for (uint32_t x = xBegin; x < xEnd; ++x)
+	{
+		float a, b;
+		NormalSlopes(rows, width, x, a, b);
+		float sum = std::fabs(a) + std::fabs(b) + 1.0f;
+		out[x - xBegin] = OctahedralNormal{ QuantizeSnorm16(a / sum), QuantizeSnorm16(b / sum) };
+	}
+}
+
+//columns a simd kernel may handle: both neighbours exist and the range stays inside [xBegin, xEnd)
+static inline void InteriorColumns(uint32_t width, uint32_t xBegin, uint32_t xEnd, uint32_t& interiorBegin, uint32_t& interiorEnd)
+{
+	interiorBegin = std::min(std::max(xBegin, 1u), xEnd);
+	interiorEnd = std::max(std::min(xEnd, width - 1), interiorBegin);
+}
+
+//simd part of a normal row: columns [xBegin, xEnd) are interior, out points at column xBegin. returns the first column
+//left for the scalar kernel
+template <typename Sample>
+using NormalInteriorKernel = uint32_t(*)(const NormalRows<Sample>& rows, uint32_t xBegin, uint32_t xEnd, HeightmapOrientation orientation,
+	HeightmapNormal* out);
+template <typename Sample>
+using OctahedralNormalInteriorKernel = uint32_t(*)(const NormalRows<Sample>& rows, uint32_t xBegin, uint32_t xEnd, OctahedralNormal* out);
+
+//the edge columns are written from here and not from inside the simd kernels: gcc keeps vector constants live across
+//calls to static functions, so an avx kernel calling the scalar one would run it with dirty upper halves
+template <typename Sample, NormalInteriorKernel<Sample> interior>
+static void WriteNormalRowSimd(const Sample* depthData, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, HeightmapOrientation orientation, HeightmapNormal* out)
+{
+	uint32_t interiorBegin, interiorEnd;
+	InteriorColumns(width, xBegin, xEnd, interiorBegin, interiorEnd);
+	WriteNormalRowScalar(depthData, width, height, y, xBegin, interiorBegin, depthDivisor, orientation, out);
+
+	NormalRows<Sample> rows = MakeNormalRows(depthData, width, height, y, depthDivisor);
+	uint32_t x = interior(rows, interiorBegin, interiorEnd, orientation, out + (interiorBegin - xBegin));
+	WriteNormalRowScalar(depthData, width, height, y, x, xEnd, depthDivisor, orientation, out + (x - xBegin));
+}
+
+template <typename Sample, OctahedralNormalInteriorKernel<Sample> interior>
+static void WriteOctahedralNormalRowSimd(const Sample* depthData, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, OctahedralNormal* out)
+{
+	uint32_t interiorBegin, interiorEnd;
+	InteriorColumns(width, xBegin, xEnd, interiorBegin, interiorEnd);
+	WriteOctahedralNormalRowScalar(depthData, width, height, y, xBegin, interiorBegin, depthDivisor, out);
+
+	NormalRows<Sample> rows = MakeNormalRows(depthData, width, height, y, depthDivisor);
+	uint32_t x = interior(rows, interiorBegin, interiorEnd, out + (interiorBegin - xBegin));
+	WriteOctahedralNormalRowScalar(depthData, width, height, y, x, xEnd, depthDivisor, out + (x - xBegin));
+}
+
+static void WriteIndexRowScalar(uint32_t width, uint32_t y, uint32_t* out)
+{
+	for (uint32_t x = 0; x + 1 < width; ++x)
+	{
+		uint32_t topLeft = y * width + x;
+		uint32_t bottomLeft = topLeft + width;
+
+		out[0] = topLeft;
+		out[1] = topLeft + 1;
+		out[2] = bottomLeft;
+
+		out[3] = bottomLeft;
+		out[4] = topLeft + 1;
+		out[5] = bottomLeft + 1;
+		out += 6;
+	}
+}
+#pragma endregion
+
+#if defined(HEIGHTMAP_X86)
+#pragma region SSE2
+//turns four lanes of posX/depth into four interleaved vertices: {x, a, b, x} comes out of a 4x4 transpose,
+//the trailing v coordinate is the same for the whole row so it is written with a single scalar store
+static inline void StoreVertices4(__m128 posX, __m128 slot1, __m128 slot2, __m128 rowCoord, HeightmapVertex* out)
+{
+	__m128 r0 = posX;
+	__m128 r1 = slot1;
+	__m128 r2 = slot2;
+	__m128 r3 = posX;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	float* dst = reinterpret_cast<float*>(out);
+	_mm_storeu_ps(dst + 0, r0);
+	_mm_store_ss(dst + 4, rowCoord);
+	_mm_storeu_ps(dst + 5, r1);
+	_mm_store_ss(dst + 9, rowCoord);
+	_mm_storeu_ps(dst + 10, r2);
+	_mm_store_ss(dst + 14, rowCoord);
+	_mm_storeu_ps(dst + 15, r3);
+	_mm_store_ss(dst + 19, rowCoord);
+}
+
+static inline void StoreVertices4(__m128 posX, __m128 depth, __m128 rowCoord, HeightmapOrientation orientation, HeightmapVertex* out)
+{
+	if (orientation == HeightmapOrientation::HeightAlongY)
+		StoreVertices4(posX, depth, rowCoord, rowCoord, out);
+	else
+		StoreVertices4(posX, rowCoord, depth, rowCoord, out);
+}
+
+//four samples as floats, one overload per sample type
+static inline __m128 LoadDepth4(const uint8_t* samples)
+{
+	int32_t packed;
+	std::memcpy(&packed, samples, sizeof(packed));
+	const __m128i zero = _mm_setzero_si128();
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+}
+
+static inline __m128 LoadDepth4(const uint16_t* samples)
+{
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples)), _mm_setzero_si128()));
+}
+
+static inline __m128 LoadDepth4(const float* samples)
+{
+	return _mm_loadu_ps(samples);
+}
+
+template <typename Sample>
+static void WriteVertexRowSSE2(const Sample* depthRow, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, HeightmapOrientation orientation, HeightmapVertex* out)
+{
+	const __m128 widthVector = _mm_set1_ps(static_cast<float>(width));
+	const __m128 divisor = _mm_set1_ps(depthDivisor);
+	const __m128 rowCoord = _mm_set1_ps(1.0f - static_cast<float>(y) / static_cast<float>(height));
+	__m128i column = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(xBegin)), _mm_setr_epi32(0, 1, 2, 3));
+	const __m128i step = _mm_set1_epi32(4);
+
+	uint32_t x = xBegin;
+	for (; x + 4 <= xEnd; x += 4)
+	{
+		__m128 depth = _mm_div_ps(LoadDepth4(depthRow + x), divisor);
+		__m128 posX = _mm_div_ps(_mm_cvtepi32_ps(column), widthVector);
+		StoreVertices4(posX, depth, rowCoord, orientation, out + (x - xBegin));
+
+		column = _mm_add_epi32(column, step);
+	}
+
+	//the scalar kernel finishes the tail, it computes the same values
+	WriteVertexRowScalar(depthRow, width, height, y, x, xEnd, depthDivisor, orientation, out + (x - xBegin));
+}
+
+//four normals from their slot vectors, the overlapping stores write the 12 floats without touching the next normal
+static inline void StoreNormals4(__m128 slot0, __m128 slot1, __m128 slot2, HeightmapNormal* out)
+{
+	__m128 r0 = slot0;
+	__m128 r1 = slot1;
+	__m128 r2 = slot2;
+	__m128 r3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	float* dst = reinterpret_cast<float*>(out);
+	_mm_storeu_ps(dst + 0, r0);
+	_mm_storeu_ps(dst + 3, r1);
+	_mm_storeu_ps(dst + 6, r2);
+	_mm_storel_pi(reinterpret_cast<__m64*>(dst + 9), r3);
+	_mm_store_ss(dst + 11, _mm_movehl_ps(r3, r3));
+}
+
+static inline void StoreNormals4(__m128 a, __m128 inverseLength, __m128 b, HeightmapOrientation orientation, HeightmapNormal* out)
+{
+	__m128 x = _mm_mul_ps(a, inverseLength);
+	__m128 row = _mm_mul_ps(b, inverseLength);
+	if (orientation == HeightmapOrientation::HeightAlongY)
+		StoreNormals4(x, inverseLength, row, out);
+	else
+		StoreNormals4(x, row, inverseLength, out);
+}
+
+//QuantizeSnorm16 without the clamp, the octahedral coordinates are inside [-1, 1] already
+static inline __m128i QuantizeSnorm16x4(__m128 value)
+{
+	__m128 half = _mm_or_ps(_mm_and_ps(value, _mm_set1_ps(-0.0f)), _mm_set1_ps(0.5f));
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(32767.0f)), half));
+}
+
+//u in the low and v in the high half of every lane, the memory layout of OctahedralNormal
+static inline __m128i PackOctahedral4(__m128i u, __m128i v)
+{
+	return _mm_or_si128(_mm_and_si128(u, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(v, 16));
+}
+
+template <typename Sample>
+static uint32_t WriteNormalInteriorSSE2(const NormalRows<Sample>& rows, uint32_t xBegin, uint32_t xEnd, HeightmapOrientation orientation,
+	HeightmapNormal* out)
+{
+	const __m128 scaleX = _mm_set1_ps(rows.scaleX);
+	const __m128 scaleY = _mm_set1_ps(rows.scaleY);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	uint32_t x = xBegin;
+	for (; x + 4 <= xEnd; x += 4)
+	{
+		__m128 a = _mm_mul_ps(_mm_sub_ps(LoadDepth4(rows.row + x + 1), LoadDepth4(rows.row + x - 1)), scaleX);
+		__m128 b = _mm_mul_ps(_mm_sub_ps(LoadDepth4(rows.down + x), LoadDepth4(rows.up + x)), scaleY);
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), one);
+		StoreNormals4(a, _mm_div_ps(one, _mm_sqrt_ps(lengthSquared)), b, orientation, out + (x - xBegin));
+	}
+	return x;
+}
+
+template <typename Sample>
+static uint32_t WriteOctahedralNormalInteriorSSE2(const NormalRows<Sample>& rows, uint32_t xBegin, uint32_t xEnd, OctahedralNormal* out)
+{
+	const __m128 scaleX = _mm_set1_ps(rows.scaleX);
+	const __m128 scaleY = _mm_set1_ps(rows.scaleY);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	uint32_t x = xBegin;
+	for (; x + 4 <= xEnd; x += 4)
+	{
+		__m128 a = _mm_mul_ps(_mm_sub_ps(LoadDepth4(rows.row + x + 1), LoadDepth4(rows.row + x - 1)), scaleX);
+		__m128 b = _mm_mul_ps(_mm_sub_ps(LoadDepth4(rows.down + x), LoadDepth4(rows.up + x)), scaleY);
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, a), _mm_andnot_ps(signMask, b)), one);
+		__m128i packed = PackOctahedral4(QuantizeSnorm16x4(_mm_div_ps(a, sum)), QuantizeSnorm16x4(_mm_div_ps(b, sum)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + (x - xBegin)), packed);
+	}
+	return x;
+}
+
+static void WriteIndexRowSSE2(uint32_t width, uint32_t y, uint32_t* out)
+{
+	uint32_t quadCount = width - 1;
+	alignas(16) uint32_t pattern[4 * 6];
+	FillIndexPattern(width, 4, pattern);
+
+	__m128i p[6];
+	for (int i = 0; i < 6; ++i)
+		p[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern) + i);
+
+	uint32_t x = 0;
+	for (; x + 4 <= quadCount; x += 4)
+	{
+		__m128i base = _mm_set1_epi32(static_cast<int>(y * width + x));
+		__m128i* dst = reinterpret_cast<__m128i*>(out + x * 6);
+		for (int i = 0; i < 6; ++i)
+			_mm_storeu_si128(dst + i, _mm_add_epi32(p[i], base));
+	}
+
+	for (; x < quadCount; ++x)
+	{
+		uint32_t* dst = out + x * 6;
+		uint32_t topLeft = y * width + x;
+		for (int i = 0; i < 6; ++i)
+			dst[i] = topLeft + pattern[i];
+	}
+}
+#pragma endregion
+
+#pragma region AVX2
+//eight samples as floats, one overload per sample type
+SIMD_TARGET("avx2")
+static inline __m256 LoadDepth8(const uint8_t* samples)
+{
+	return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples))));
+}
+
+SIMD_TARGET("avx2")
+static inline __m256 LoadDepth8(const uint16_t* samples)
+{
+	return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples))));
+}
+
+SIMD_TARGET("avx2")
+static inline __m256 LoadDepth8(const float* samples)
+{
+	return _mm256_loadu_ps(samples);
+}
+
+template <typename Sample>
+SIMD_TARGET("avx2")
+static void WriteVertexRowAVX2(const Sample* depthRow, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, HeightmapOrientation orientation, HeightmapVertex* out)
+{
+	const __m256 widthVector = _mm256_set1_ps(static_cast<float>(width));
+	const __m256 divisor = _mm256_set1_ps(depthDivisor);
+	const __m128 rowCoord = _mm_set1_ps(1.0f - static_cast<float>(y) / static_cast<float>(height));
+	__m256i column = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(xBegin)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	const __m256i step = _mm256_set1_epi32(8);
+
+	uint32_t x = xBegin;
+	for (; x + 8 <= xEnd; x += 8)
+	{
+		__m256 depth = _mm256_div_ps(LoadDepth8(depthRow + x), divisor);
+		__m256 posX = _mm256_div_ps(_mm256_cvtepi32_ps(column), widthVector);
+
+		HeightmapVertex* dst = out + (x - xBegin);
+		StoreVertices4(_mm256_castps256_ps128(posX), _mm256_castps256_ps128(depth), rowCoord, orientation, dst);
+		StoreVertices4(_mm256_extractf128_ps(posX, 1), _mm256_extractf128_ps(depth, 1), rowCoord, orientation, dst + 4);
+
+		column = _mm256_add_epi32(column, step);
+	}
+
+	//the scalar kernel finishes the tail, it computes the same values. gcc turns the call into a jump without the
+	//vzeroupper it puts before returns, and legacy sse code after dirty upper halves runs several times slower
+	_mm256_zeroupper();
+	WriteVertexRowScalar(depthRow, width, height, y, x, xEnd, depthDivisor, orientation, out + (x - xBegin));
+}
+
+template <typename Sample>
+SIMD_TARGET("avx2")
+static inline __m256 DepthDifference8(const Sample* plus, const Sample* minus)
+{
+	return _mm256_sub_ps(LoadDepth8(plus), LoadDepth8(minus));
+}
+
+template <typename Sample>
+SIMD_TARGET("avx2")
+static uint32_t WriteNormalInteriorAVX2(const NormalRows<Sample>& rows, uint32_t xBegin, uint32_t xEnd, HeightmapOrientation orientation,
+	HeightmapNormal* out)
+{
+	const __m256 scaleX = _mm256_set1_ps(rows.scaleX);
+	const __m256 scaleY = _mm256_set1_ps(rows.scaleY);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	uint32_t x = xBegin;
+	for (; x + 8 <= xEnd; x += 8)
+	{
+		__m256 a = _mm256_mul_ps(DepthDifference8(rows.row + x + 1, rows.row + x - 1), scaleX);
+		__m256 b = _mm256_mul_ps(DepthDifference8(rows.down + x, rows.up + x), scaleY);
+		__m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)), one);
+		__m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared));
+
+		HeightmapNormal* dst = out + (x - xBegin);
+		StoreNormals4(_mm256_castps256_ps128(a), _mm256_castps256_ps128(inverseLength), _mm256_castps256_ps128(b), orientation, dst);
+		StoreNormals4(_mm256_extractf128_ps(a, 1), _mm256_extractf128_ps(inverseLength, 1), _mm256_extractf128_ps(b, 1), orientation, dst + 4);
+	}
+
+	_mm256_zeroupper();
+	return x;
+}
+
+template <typename Sample>
+SIMD_TARGET("avx2")
+static uint32_t WriteOctahedralNormalInteriorAVX2(const NormalRows<Sample>& rows, uint32_t xBegin, uint32_t xEnd, OctahedralNormal* out)
+{
+	const __m256 scaleX = _mm256_set1_ps(rows.scaleX);
+	const __m256 scaleY = _mm256_set1_ps(rows.scaleY);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 snormScale = _mm256_set1_ps(32767.0f);
+	const __m256i lowHalf = _mm256_set1_epi32(0xFFFF);
+
+	uint32_t x = xBegin;
+	for (; x + 8 <= xEnd; x += 8)
+	{
+		__m256 a = _mm256_mul_ps(DepthDifference8(rows.row + x + 1, rows.row + x - 1), scaleX);
+		__m256 b = _mm256_mul_ps(DepthDifference8(rows.down + x, rows.up + x), scaleY);
+		__m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(signMask, a), _mm256_andnot_ps(signMask, b)), one);
+		__m256 u = _mm256_div_ps(a, sum);
+		__m256 v = _mm256_div_ps(b, sum);
+
+		//QuantizeSnorm16x4 and PackOctahedral4 eight lanes wide
+		__m256i quantizedU = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(u, snormScale), _mm256_or_ps(_mm256_and_ps(u, signMask), half)));
+		__m256i quantizedV = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, snormScale), _mm256_or_ps(_mm256_and_ps(v, signMask), half)));
+		__m256i packed = _mm256_or_si256(_mm256_and_si256(quantizedU, lowHalf), _mm256_slli_epi32(quantizedV, 16));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (x - xBegin)), packed);
+	}
+
+	_mm256_zeroupper();
+	return x;
+}
+
+SIMD_TARGET("avx2")
+static void WriteIndexRowAVX2(uint32_t width, uint32_t y, uint32_t* out)
+{
+	uint32_t quadCount = width - 1;
+	alignas(32) uint32_t pattern[8 * 6];
+	FillIndexPattern(width, 8, pattern);
+
+	__m256i p[6];
+	for (int i = 0; i < 6; ++i)
+		p[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern) + i);
+
+	uint32_t x = 0;
+	for (; x + 8 <= quadCount; x += 8)
+	{
+		__m256i base = _mm256_set1_epi32(static_cast<int>(y * width + x));
+		__m256i* dst = reinterpret_cast<__m256i*>(out + x * 6);
+		for (int i = 0; i < 6; ++i)
+			_mm256_storeu_si256(dst + i, _mm256_add_epi32(p[i], base));
+	}
+
+	for (; x < quadCount; ++x)
+	{
+		uint32_t* dst = out + x * 6;
+		uint32_t topLeft = y * width + x;
+		for (int i = 0; i < 6; ++i)
+			dst[i] = topLeft + pattern[i];
+	}
+}
+#pragma endregion
+
+#pragma region AVX-512
+//vzeroupper leaves zmm16-31 alone, which gcc allocates freely in avx-512 code, and while their upper halves
+//are dirty every legacy sse instruction after the kernel is slowed down several times. msvc has no inline
+//assembly on x64, there the kernels rely on vzeroupper alone
+SIMD_TARGET("avx512f")
+static inline void ClearAVX512UpperState()
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__asm__ volatile(
+		"vpxord %%zmm16, %%zmm16, %%zmm16\n\tvpxord %%zmm17, %%zmm17, %%zmm17\n\t"
+		"vpxord %%zmm18, %%zmm18, %%zmm18\n\tvpxord %%zmm19, %%zmm19, %%zmm19\n\t"
+		"vpxord %%zmm20, %%zmm20, %%zmm20\n\tvpxord %%zmm21, %%zmm21, %%zmm21\n\t"
+		"vpxord %%zmm22, %%zmm22, %%zmm22\n\tvpxord %%zmm23, %%zmm23, %%zmm23\n\t"
+		"vpxord %%zmm24, %%zmm24, %%zmm24\n\tvpxord %%zmm25, %%zmm25, %%zmm25\n\t"
+		"vpxord %%zmm26, %%zmm26, %%zmm26\n\tvpxord %%zmm27, %%zmm27, %%zmm27\n\t"
+		"vpxord %%zmm28, %%zmm28, %%zmm28\n\tvpxord %%zmm29, %%zmm29, %%zmm29\n\t"
+		"vpxord %%zmm30, %%zmm30, %%zmm30\n\tvpxord %%zmm31, %%zmm31, %%zmm31"
+		::: "xmm16", "xmm17", "xmm18", "xmm19", "xmm20", "xmm21", "xmm22", "xmm23",
+		"xmm24", "xmm25", "xmm26", "xmm27", "xmm28", "xmm29", "xmm30", "xmm31");
+#endif
+	_mm256_zeroupper();
+}
+
+//sixteen samples as floats, one overload per sample type
+SIMD_TARGET("avx512f")
+static inline __m512 LoadDepth16(const uint8_t* samples)
+{
+	return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples))));
+}
+
+SIMD_TARGET("avx512f")
+static inline __m512 LoadDepth16(const uint16_t* samples)
+{
+	return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples))));
+}
+
+SIMD_TARGET("avx512f")
+static inline __m512 LoadDepth16(const float* samples)
+{
+	return _mm512_loadu_ps(samples);
+}
+
+template <typename Sample>
+SIMD_TARGET("avx512f")
+static void WriteVertexRowAVX512(const Sample* depthRow, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, HeightmapOrientation orientation, HeightmapVertex* out)
+{
+	const __m512 widthVector = _mm512_set1_ps(static_cast<float>(width));
+	const __m512 divisor = _mm512_set1_ps(depthDivisor);
+	const __m128 rowCoord = _mm_set1_ps(1.0f - static_cast<float>(y) / static_cast<float>(height));
+	__m512i column = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(xBegin)), _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+	const __m512i step = _mm512_set1_epi32(16);
+
+	uint32_t x = xBegin;
+	for (; x + 16 <= xEnd; x += 16)
+	{
+		__m512 depth = _mm512_div_ps(LoadDepth16(depthRow + x), divisor);
+		__m512 posX = _mm512_div_ps(_mm512_cvtepi32_ps(column), widthVector);
+
+		HeightmapVertex* dst = out + (x - xBegin);
+		StoreVertices4(_mm512_extractf32x4_ps(posX, 0), _mm512_extractf32x4_ps(depth, 0), rowCoord, orientation, dst);
+		StoreVertices4(_mm512_extractf32x4_ps(posX, 1), _mm512_extractf32x4_ps(depth, 1), rowCoord, orientation, dst + 4);
+		StoreVertices4(_mm512_extractf32x4_ps(posX, 2), _mm512_extractf32x4_ps(depth, 2), rowCoord, orientation, dst + 8);
+		StoreVertices4(_mm512_extractf32x4_ps(posX, 3), _mm512_extractf32x4_ps(depth, 3), rowCoord, orientation, dst + 12);
+
+		column = _mm512_add_epi32(column, step);
+	}
+
+	//the scalar kernel finishes the tail, it computes the same values
+	ClearAVX512UpperState();
+	WriteVertexRowScalar(depthRow, width, height, y, x, xEnd, depthDivisor, orientation, out + (x - xBegin));
+}
+
+SIMD_TARGET("avx512f")
+static void WriteIndexRowAVX512(uint32_t width, uint32_t y, uint32_t* out)
+{
+	uint32_t quadCount = width - 1;
+	alignas(64) uint32_t pattern[16 * 6];
+	FillIndexPattern(width, 16, pattern);
+
+	__m512i p[6];
+	for (int i = 0; i < 6; ++i)
+		p[i] = _mm512_load_si512(pattern + i * 16);
+
+	uint32_t x = 0;
+	for (; x + 16 <= quadCount; x += 16)
+	{
+		__m512i base = _mm512_set1_epi32(static_cast<int>(y * width + x));
+		uint32_t* dst = out + x * 6;
+		for (int i = 0; i < 6; ++i)
+			_mm512_storeu_si512(dst + i * 16, _mm512_add_epi32(p[i], base));
+	}
+
+	for (; x < quadCount; ++x)
+	{
+		uint32_t* dst = out + x * 6;
+		uint32_t topLeft = y * width + x;
+		for (int i = 0; i < 6; ++i)
+			dst[i] = topLeft + pattern[i];
+	}
+
+	ClearAVX512UpperState();
+}
+#pragma endregion
+#endif
+
+template <typename Sample>
+const HeightmapKernels<Sample>& GetHeightmapKernels(SimdLevel level)
+{
+	static const HeightmapKernels<Sample> scalar = { SimdLevel::Scalar, WriteVertexRowScalar<Sample>, WriteIndexRowScalar,
+		WriteNormalRowScalar<Sample>, WriteOctahedralNormalRowScalar<Sample> };
+#if defined(HEIGHTMAP_X86)
+	static const HeightmapKernels<Sample> sse2 = { SimdLevel::SSE2, WriteVertexRowSSE2<Sample>, WriteIndexRowSSE2,
+		WriteNormalRowSimd<Sample, WriteNormalInteriorSSE2<Sample>>, WriteOctahedralNormalRowSimd<Sample, WriteOctahedralNormalInteriorSSE2<Sample>> };
+	static const HeightmapKernels<Sample> avx2 = { SimdLevel::AVX2, WriteVertexRowAVX2<Sample>, WriteIndexRowAVX2,
+		WriteNormalRowSimd<Sample, WriteNormalInteriorAVX2<Sample>>, WriteOctahedralNormalRowSimd<Sample, WriteOctahedralNormalInteriorAVX2<Sample>> };
+	//the normal rows are bound by the divisions, which are no faster per element at 512 bits
+	static const HeightmapKernels<Sample> avx512 = { SimdLevel::AVX512, WriteVertexRowAVX512<Sample>, WriteIndexRowAVX512,
+		WriteNormalRowSimd<Sample, WriteNormalInteriorAVX2<Sample>>, WriteOctahedralNormalRowSimd<Sample, WriteOctahedralNormalInteriorAVX2<Sample>> };
+
+	SimdLevel supported = DetectSimdLevel();
+	if (level > supported)
+		level = supported;
+
+	switch (level)
+	{
+	case SimdLevel::AVX512:
+		return avx512;
+	case SimdLevel::AVX2:
+		return avx2;
+	case SimdLevel::SSE2:
+		return sse2;
+	default:
+		break;
+	}
+#endif
+	return scalar;
+}
+
+template const HeightmapKernels<uint8_t>& GetHeightmapKernels<uint8_t>(SimdLevel level);
+template const HeightmapKernels<uint16_t>& GetHeightmapKernels<uint16_t>(SimdLevel level);
+template const HeightmapKernels<float>& GetHeightmapKernels<float>(SimdLevel level);
+template void WriteCompactVertexRow<uint8_t>(const uint8_t* depthRow, uint32_t y, uint32_t xBegin, uint32_t xEnd, float depthDivisor,
+	CompactHeightmapVertex* out);
+template void WriteCompactVertexRow<uint16_t>(const uint16_t* depthRow, uint32_t y, uint32_t xBegin, uint32_t xEnd, float depthDivisor,
+	CompactHeightmapVertex* out);
+template void WriteCompactVertexRow<float>(const float* depthRow, uint32_t y, uint32_t xBegin, uint32_t xEnd, float depthDivisor,
+	CompactHeightmapVertex* out);
@@ -0,0 +1,48 @@
+#pragma once
+#include "CpuFeatures.h"
+#include "HeightmapMeshBuilder.h"
+#include <cstdint>
+
+//every kernel is a template on the sample type of the depth map, uint8_t, uint16_t or float (see HeightmapMeshBuilder),
+//the samples are converted to float as they are loaded so no widened copy of the map is ever made
+
+//writes the vertices of columns [xBegin, xEnd) of grid row y, out points at the vertex of column xBegin.
+//depthRow points at the start of the row and depthDivisor must be non zero.
+template <typename Sample>
+using VertexRowKernel = void(*)(const Sample* depthRow, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, HeightmapOrientation orientation, HeightmapVertex* out);
+
+//writes the (width - 1) * 6 indices of the quads whose top edge is grid row y
+using IndexRowKernel = void(*)(uint32_t width, uint32_t y, uint32_t* out);
+
+//writes the normals of columns [xBegin, xEnd) of grid row y from central differences of the neighbouring samples,
+//one sided on the edges of the map. depthData points at the whole map, since rows y - 1 and y + 1 are read too
+template <typename Sample>
+using NormalRowKernel = void(*)(const Sample* depthData, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, HeightmapOrientation orientation, HeightmapNormal* out);
+
+//octahedral counterpart of NormalRowKernel, the encoding does not depend on the orientation
+template <typename Sample>
+using OctahedralNormalRowKernel = void(*)(const Sample* depthData, uint32_t width, uint32_t height, uint32_t y,
+	uint32_t xBegin, uint32_t xEnd, float depthDivisor, OctahedralNormal* out);
+
+//one set of row kernels per instruction set and sample type, every set produces bit-identical output to the scalar one
+template <typename Sample>
+struct HeightmapKernels
+{
+	SimdLevel level;
+	VertexRowKernel<Sample> writeVertexRow;
+	IndexRowKernel writeIndexRow;
+	NormalRowKernel<Sample> writeNormalRow;
+	OctahedralNormalRowKernel<Sample> writeOctahedralNormalRow;
+};
+
+//compact counterpart of VertexRowKernel, the height is depthRow[x] / depthDivisor quantized to unorm16.
+//scalar only, the row is a handful of integer stores per vertex and does not gain from the wide kernels
+template <typename Sample>
+void WriteCompactVertexRow(const Sample* depthRow, uint32_t y, uint32_t xBegin, uint32_t xEnd, float depthDivisor,
+	CompactHeightmapVertex* out);
+
+//returns the kernels for the requested level, clamped to what the running cpu supports
+template <typename Sample>
+const HeightmapKernels<Sample>& GetHeightmapKernels(SimdLevel level);
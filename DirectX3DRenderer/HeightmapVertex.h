@@ -0,0 +1,147 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+//platform independent mirror of VertexPositionUv, so the mesh can be built without d3d headers
+struct HeightmapVertex
+{
+	float position[3];
+	float texCoord[2];
+};
+
+//8 byte alternative to HeightmapVertex. x/z and the uv are a function of the grid coordinate, so only the
+//grid coordinate and a unorm16 height are stored, Main.vs.hlsl (MainCompact) rebuilds the rest.
+struct CompactHeightmapVertex
+{
+	uint16_t gridX;
+	uint16_t gridY;
+	uint16_t height;	//depth / maxDepth as unorm16
+	uint16_t padding;	//keeps the stride at 8 bytes, read as the second channel of the R16G16_UNORM element
+};
+
+enum class HeightmapVertexFormat
+{
+	Full,		//HeightmapVertex, 20 bytes
+	Compact		//CompactHeightmapVertex, 8 bytes
+};
+
+//optional second vertex stream of HeightmapMeshBuilder::BuildTiled, one normal per vertex in the same order
+enum class HeightmapNormalFormat
+{
+	None,
+	Float,		//HeightmapNormal, 12 bytes
+	Octahedral	//OctahedralNormal, 4 bytes
+};
+
+//unit normal in the local space of the mesh
+struct HeightmapNormal
+{
+	float normal[3];
+};
+
+//normal projected onto the octahedron around the height axis, the x and the row coordinate as snorm16 (R16G16_SNORM).
+//the lower half of the octahedron is folded over the upper one, heightmap normals never need it
+struct OctahedralNormal
+{
+	int16_t u;
+	int16_t v;
+};
+
+enum class HeightmapOrientation
+{
+	HeightAlongY,	//grid on the x/z plane, depth along +y (Application)
+	HeightAlongZ	//grid on the x/y plane, depth along +z (Application2)
+};
+
+inline uint16_t QuantizeHeight(float normalizedHeight)
+{
+	return static_cast<uint16_t>(normalizedHeight * 65535.0f + 0.5f);
+}
+
+inline float DequantizeHeight(uint16_t height)
+{
+	return static_cast<float>(height) / 65535.0f;
+}
+
+//same rounding as the d3d snorm conversion in reverse: -1 and 1 map to -32767 and 32767
+inline int16_t QuantizeSnorm16(float value)
+{
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return static_cast<int16_t>(value * 32767.0f + (value < 0.0f ? -0.5f : 0.5f));
+}
+
+inline float DequantizeSnorm16(int16_t value)
+{
+	float decoded = static_cast<float>(value) / 32767.0f;
+	return decoded < -1.0f ? -1.0f : decoded;
+}
+
+//vertex of grid sample (x, y) with the given normalized depth, the arithmetic of the vertex row kernels
+inline HeightmapVertex MakeHeightmapVertex(uint32_t x, uint32_t y, uint32_t width, uint32_t height, float depthValue,
+	HeightmapOrientation orientation)
+{
+	float posX = static_cast<float>(x) / static_cast<float>(width);
+	float invertedPosZ = 1.0f - static_cast<float>(y) / static_cast<float>(height);
+
+	HeightmapVertex vertex;
+	vertex.position[0] = posX;
+	vertex.position[1] = orientation == HeightmapOrientation::HeightAlongY ? depthValue : invertedPosZ;
+	vertex.position[2] = orientation == HeightmapOrientation::HeightAlongY ? invertedPosZ : depthValue;
+	vertex.texCoord[0] = posX;
+	vertex.texCoord[1] = invertedPosZ;
+	return vertex;
+}
+
+//cpu reference of the MainCompact vertex shader, used to check the round trip error of the compact format
+inline HeightmapVertex DecodeCompactVertex(const CompactHeightmapVertex& compact, uint32_t width, uint32_t height,
+	HeightmapOrientation orientation)
+{
+	return MakeHeightmapVertex(compact.gridX, compact.gridY, width, height, DequantizeHeight(compact.height), orientation);
+}
+
+//normal in the (x, depth, row) slots of the orientation, the order MakeHeightmapVertex writes the position in
+inline void StoreHeightmapNormal(float x, float depth, float row, HeightmapOrientation orientation, float normal[3])
+{
+	normal[0] = x;
+	normal[1] = orientation == HeightmapOrientation::HeightAlongY ? depth : row;
+	normal[2] = orientation == HeightmapOrientation::HeightAlongY ? row : depth;
+}
+
+inline OctahedralNormal EncodeOctahedralNormal(const float normal[3], HeightmapOrientation orientation)
+{
+	int depthSlot = orientation == HeightmapOrientation::HeightAlongY ? 1 : 2;
+	int rowSlot = 3 - depthSlot;
+	float x = normal[0];
+	float row = normal[rowSlot];
+	float depth = normal[depthSlot];
+
+	float sum = (x < 0.0f ? -x : x) + (row < 0.0f ? -row : row) + (depth < 0.0f ? -depth : depth);
+	float u = x / sum;
+	float v = row / sum;
+	if (depth < 0.0f)
+	{
+		float foldedU = (1.0f - (v < 0.0f ? -v : v)) * (u < 0.0f ? -1.0f : 1.0f);
+		float foldedV = (1.0f - (u < 0.0f ? -u : u)) * (v < 0.0f ? -1.0f : 1.0f);
+		u = foldedU;
+		v = foldedV;
+	}
+	return OctahedralNormal{ QuantizeSnorm16(u), QuantizeSnorm16(v) };
+}
+
+//cpu reference of DecodeNormal in Main.vs.hlsl, the result is normalized
+inline void DecodeOctahedralNormal(const OctahedralNormal& encoded, HeightmapOrientation orientation, float normal[3])
+{
+	float u = DequantizeSnorm16(encoded.u);
+	float v = DequantizeSnorm16(encoded.v);
+	float depth = 1.0f - (u < 0.0f ? -u : u) - (v < 0.0f ? -v : v);
+	if (depth < 0.0f)
+	{
+		float unfoldedU = (1.0f - (v < 0.0f ? -v : v)) * (u < 0.0f ? -1.0f : 1.0f);
+		float unfoldedV = (1.0f - (u < 0.0f ? -u : u)) * (v < 0.0f ? -1.0f : 1.0f);
+		u = unfoldedU;
+		v = unfoldedV;
+	}
+
+	float length = std::sqrt(u * u + v * v + depth * depth);
+	StoreHeightmapNormal(u / length, depth / length, v / length, orientation, normal);
+}
@@ -5,11 +5,23 @@ struct VSOutput
 {
     float4 Position : SV_Position;
     float2 Uv : TEXCOORD0;
+    float3 Normal : NORMAL;
 };
 
+//world space direction towards the light, from above on the side of the default camera
+static const float3 lightDirection = normalize(float3(0.4f, 1.0f, -0.6f));
+
 float4 Main(VSOutput input) : SV_Target
 {
     float4 color = rgbTexture.Sample(samLinear, input.Uv);
 
-	return color;
+    //lambert plus ambient, meshes without a normal stream stay unlit
+    float lengthSquared = dot(input.Normal, input.Normal);
+    if (lengthSquared > 0.0f)
+    {
+        float diffuse = saturate(dot(input.Normal * rsqrt(lengthSquared), lightDirection));
+        color.rgb *= 0.35f + 0.65f * diffuse;
+    }
+
+    return color;
 }
\ No newline at end of file
@@ -4,10 +4,18 @@ struct VSInput
 	float2 Uv : TEXCOORD0;
 };
 
+//CompactHeightmapVertex: grid coordinate and unorm16 height, the second HEIGHT channel is padding
+struct VSCompactInput
+{
+	uint2 Grid : GRID;
+	float2 Height : HEIGHT;
+};
+
 struct VSOutput
 {
 	float4 Position : SV_Position;
 	float2 Uv : TEXCOORD0;
+	float3 Normal : NORMAL;	//world space, zero from the unlit entry points
 };
 
 cbuffer PerFrame : register(b0)
@@ -18,8 +26,12 @@ cbuffer PerFrame : register(b0)
 cbuffer PerObject : register(b1)
 {
 	matrix modelmatrix;
+	float4 gridsize;	//width, height, 255 / max depth, 1 when the normal stream is octahedral
 };
 
+//depth map of the vertex buffer free mode, bound to the vertex shader only
+Texture2D<float> heightmap : register(t0);
+
 VSOutput Main(VSInput input)
 {
 	matrix world = mul(viewprojection, modelmatrix);
@@ -28,4 +40,70 @@ VSOutput Main(VSInput input)
 	output.Position = mul(world, float4(input.Position, 1.0));
 	output.Uv = float2(input.Uv.x, 1.0f - input.Uv.y);
 	return output;
-}
\ No newline at end of file
+}
+
+//second stream of the lit entry points: a float3, or an octahedral R16G16_SNORM pair whose missing z reads as 0.
+//see DecodeOctahedralNormal for the cpu reference, the octahedron is folded around the height axis y
+float3 DecodeNormal(float3 stored)
+{
+	float3 normal = stored;
+	if (gridsize.w > 0.0f)
+	{
+		float2 encoded = stored.xy;
+		float depth = 1.0f - abs(encoded.x) - abs(encoded.y);
+		if (depth < 0.0f)
+			encoded = (1.0f - abs(encoded.yx)) * (encoded >= 0.0f ? 1.0f : -1.0f);
+		normal = float3(encoded.x, depth, encoded.y);
+	}
+	//the model matrix scales uniformly, so it turns normals like any other direction
+	return normalize(mul(modelmatrix, float4(normal, 0.0f)).xyz);
+}
+
+VSOutput MainLit(VSInput input, float3 normal : NORMAL)
+{
+	VSOutput output = Main(input);
+	output.Normal = DecodeNormal(normal);
+	return output;
+}
+
+//same vertex as Main would get from the full format, see DecodeCompactVertex for the cpu reference
+VSOutput MainCompact(VSCompactInput input)
+{
+	matrix world = mul(viewprojection, modelmatrix);
+
+	float posX = input.Grid.x / gridsize.x;
+	float invertedPosZ = 1.0f - input.Grid.y / gridsize.y;
+
+	VSOutput output = (VSOutput)0;
+	output.Position = mul(world, float4(posX, input.Height.x, invertedPosZ, 1.0));
+	output.Uv = float2(posX, 1.0f - invertedPosZ);
+	return output;
+}
+
+VSOutput MainCompactLit(VSCompactInput input, float3 normal : NORMAL)
+{
+	VSOutput output = MainCompact(input);
+	output.Normal = DecodeNormal(normal);
+	return output;
+}
+
+//no vertex buffer, the cells are walked row by row with six vertices each, see VertexIdGrid.h for the cpu reference
+VSOutput MainVertexId(uint vertexId : SV_VertexID)
+{
+	static const uint2 corners[6] = { uint2(0, 0), uint2(1, 0), uint2(0, 1), uint2(0, 1), uint2(1, 0), uint2(1, 1) };
+
+	matrix world = mul(viewprojection, modelmatrix);
+
+	uint cellsPerRow = (uint)gridsize.x - 1;
+	uint cell = vertexId / 6;
+	uint2 grid = uint2(cell % cellsPerRow, cell / cellsPerRow) + corners[vertexId % 6];
+
+	float posX = grid.x / gridsize.x;
+	float invertedPosZ = 1.0f - grid.y / gridsize.y;
+	float depthValue = heightmap.Load(int3(grid, 0)) * gridsize.z;
+
+	VSOutput output = (VSOutput)0;
+	output.Position = mul(world, float4(posX, depthValue, invertedPosZ, 1.0));
+	output.Uv = float2(posX, 1.0f - invertedPosZ);
+	return output;
+}
@@ -0,0 +1,130 @@
+#include "MappedFile.h"
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+//the view keeps the file and the mapping alive, both handles are closed as soon as it exists
+static void MapFile(HANDLE file, const uint8_t*& data, size_t& size)
+{
+	LARGE_INTEGER fileSize = {};
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("MappedFile: cannot open file");
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		throw std::runtime_error("MappedFile: cannot read the file size");
+	}
+	if (fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
+		throw std::runtime_error("MappedFile: cannot create a mapping");
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == nullptr)
+		throw std::runtime_error("MappedFile: cannot map a view");
+
+	data = static_cast<const uint8_t*>(view);
+	size = static_cast<size_t>(fileSize.QuadPart);
+}
+
+MappedFile::MappedFile(const std::string& path)
+{
+	MapFile(CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr), _data, _size);
+}
+
+MappedFile::MappedFile(const std::wstring& path)
+{
+	MapFile(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr), _data, _size);
+}
+
+void MappedFile::Unmap()
+{
+	if (_data != nullptr)
+		UnmapViewOfFile(_data);
+	_data = nullptr;
+	_size = 0;
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		throw std::runtime_error("MappedFile: cannot open " + path);
+
+	struct stat status = {};
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		throw std::runtime_error("MappedFile: cannot read the size of " + path);
+	}
+	if (status.st_size == 0)
+	{
+		close(file);
+		return;
+	}
+
+	//the mapping keeps the file alive after the descriptor is closed
+	void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (view == MAP_FAILED)
+		throw std::runtime_error("MappedFile: cannot map " + path);
+
+	_data = static_cast<const uint8_t*>(view);
+	_size = static_cast<size_t>(status.st_size);
+}
+
+void MappedFile::Unmap()
+{
+	if (_data != nullptr)
+		munmap(const_cast<uint8_t*>(_data), _size);
+	_data = nullptr;
+	_size = 0;
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+	Unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: _data(std::exchange(other._data, nullptr)),
+	_size(std::exchange(other._size, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Unmap();
+		_data = std::exchange(other._data, nullptr);
+		_size = std::exchange(other._size, 0);
+	}
+	return *this;
+}
+
+const uint8_t* MappedFile::Data() const
+{
+	return _data;
+}
+
+size_t MappedFile::Size() const
+{
+	return _size;
+}
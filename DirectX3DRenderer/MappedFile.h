@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//read only view of a whole file through the os page cache, nothing is copied until a page is touched.
+//the view is page aligned, so data at an aligned offset can be read in place as wider types
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	//throws std::runtime_error when the file cannot be opened or mapped, an empty file maps to no data
+	explicit MappedFile(const std::string& path);
+#if defined(_WIN32)
+	explicit MappedFile(const std::wstring& path);
+#endif
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* Data() const;
+	size_t Size() const;
+
+private:
+	void Unmap();
+
+	const uint8_t* _data = nullptr;
+	size_t _size = 0;
+};
@@ -0,0 +1,431 @@
+#include "MeshCache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+static const char meshCacheMagic[4] = { 'H', 'M', 'M', 'C' };
+constexpr uint32_t meshCacheVersion = 1;
+
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t blockCount;
+	uint32_t reserved;
+};
+
+struct MeshCacheBlockEntry
+{
+	uint32_t id;
+	uint32_t encoding;
+	uint64_t offset;	//from the start of the file, a multiple of meshCachePageBytes
+	uint64_t bytes;
+};
+static_assert(sizeof(MeshCacheHeader) + maxMeshCacheBlocks * sizeof(MeshCacheBlockEntry) <= meshCachePageBytes,
+	"the header and the block table fit in the first page");
+
+//blocks of the meshes stored by AddTiledMesh and AddAdaptiveMesh
+enum MeshCacheBlockId : uint32_t
+{
+	TiledInfoBlock = 1,
+	TiledTilesBlock = 2,
+	TiledVerticesBlock = 3,
+	TiledNormalsBlock = 4,
+	AdaptiveInfoBlock = 16,
+	AdaptiveVerticesBlock = 17,
+	AdaptiveIndicesBlock = 18
+};
+
+struct TiledMeshInfo
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t tileQuads;
+	uint32_t vertexFormat;
+	uint32_t normalFormat;
+	uint32_t topology;
+	uint32_t vertexCount;
+	float maxDepth;
+};
+
+struct AdaptiveMeshInfo
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	float maxDepth;
+};
+
+#pragma region Hash
+constexpr uint64_t hashPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t hashPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t hashPrime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t hashPrime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t hashPrime5 = 0x27D4EB2F165667C5ull;
+
+static uint64_t RotateLeft(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t Read64(const uint8_t* bytes)
+{
+	uint64_t value;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static uint64_t HashRound(uint64_t lane, uint64_t input)
+{
+	lane += input * hashPrime2;
+	return RotateLeft(lane, 31) * hashPrime1;
+}
+
+static uint64_t MergeLane(uint64_t hash, uint64_t lane)
+{
+	hash ^= HashRound(0, lane);
+	return hash * hashPrime1 + hashPrime4;
+}
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const uint8_t* end = bytes + size;
+	uint64_t hash;
+	if (size >= 32)
+	{
+		uint64_t lanes[4] = { seed + hashPrime1 + hashPrime2, seed + hashPrime2, seed, seed - hashPrime1 };
+		for (; end - bytes >= 32; bytes += 32)
+		{
+			lanes[0] = HashRound(lanes[0], Read64(bytes));
+			lanes[1] = HashRound(lanes[1], Read64(bytes + 8));
+			lanes[2] = HashRound(lanes[2], Read64(bytes + 16));
+			lanes[3] = HashRound(lanes[3], Read64(bytes + 24));
+		}
+		hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+		for (uint64_t lane : lanes)
+			hash = MergeLane(hash, lane);
+	}
+	else
+		hash = seed + hashPrime5;
+
+	hash += static_cast<uint64_t>(size);
+	for (; end - bytes >= 8; bytes += 8)
+		hash = RotateLeft(hash ^ HashRound(0, Read64(bytes)), 27) * hashPrime1 + hashPrime4;
+	for (; bytes < end; ++bytes)
+		hash = RotateLeft(hash ^ (*bytes * hashPrime5), 11) * hashPrime1;
+
+	hash ^= hash >> 33;
+	hash *= hashPrime2;
+	hash ^= hash >> 29;
+	hash *= hashPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+#pragma endregion
+
+#pragma region Writer
+void MeshCacheWriter::AddBlock(uint32_t id, const void* data, size_t bytes)
+{
+	if (_blocks.size() == maxMeshCacheBlocks)
+		throw std::length_error("MeshCacheWriter: too many blocks");
+	_blocks.push_back(MeshBlock{ id, MeshBlockEncoding::Raw, data, bytes });
+}
+
+void MeshCacheWriter::AddCopiedBlock(uint32_t id, const void* data, size_t bytes)
+{
+	//the inner vectors keep their storage when the outer one grows, so the block can point into it
+	const uint8_t* begin = static_cast<const uint8_t*>(data);
+	_ownedData.emplace_back(begin, begin + bytes);
+	AddBlock(id, _ownedData.back().data(), bytes);
+}
+
+void MeshCacheWriter::AddIndexBlock(uint32_t id, const uint32_t* indices, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (indices[i] > UINT16_MAX)
+		{
+			AddBlock(id, indices, count * sizeof(uint32_t));
+			return;
+		}
+	}
+
+	std::vector<uint8_t> narrowed(count * sizeof(uint16_t));
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint16_t index = static_cast<uint16_t>(indices[i]);
+		std::memcpy(narrowed.data() + i * sizeof(uint16_t), &index, sizeof(index));
+	}
+	_ownedData.push_back(std::move(narrowed));
+	AddBlock(id, _ownedData.back().data(), count * sizeof(uint16_t));
+	_blocks.back().encoding = MeshBlockEncoding::Index16;
+}
+
+static uint64_t AlignToPage(uint64_t offset)
+{
+	return (offset + meshCachePageBytes - 1) / meshCachePageBytes * meshCachePageBytes;
+}
+
+void MeshCacheWriter::Write(const std::string& path, uint64_t key) const
+{
+	MeshCacheHeader header = {};
+	std::memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+	header.version = meshCacheVersion;
+	header.key = key;
+	header.blockCount = static_cast<uint32_t>(_blocks.size());
+
+	std::vector<MeshCacheBlockEntry> table(_blocks.size());
+	uint64_t offset = meshCachePageBytes;
+	for (size_t b = 0; b < _blocks.size(); ++b)
+	{
+		table[b] = MeshCacheBlockEntry{ _blocks[b].id, static_cast<uint32_t>(_blocks[b].encoding), offset, _blocks[b].bytes };
+		offset = AlignToPage(offset + _blocks[b].bytes);
+	}
+
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::unique_ptr<FILE, int(*)(FILE*)> file(std::fopen(temporaryPath.c_str(), "wb"), &std::fclose);
+		if (!file)
+			throw std::runtime_error("MeshCacheWriter: cannot create " + temporaryPath);
+
+		//the first page holds the header and the table, every block is padded to the next page
+		std::vector<uint8_t> page(meshCachePageBytes, 0);
+		std::memcpy(page.data(), &header, sizeof(header));
+		std::memcpy(page.data() + sizeof(header), table.data(), table.size() * sizeof(MeshCacheBlockEntry));
+		bool written = std::fwrite(page.data(), 1, page.size(), file.get()) == page.size();
+		std::fill(page.begin(), page.end(), static_cast<uint8_t>(0));
+		for (size_t b = 0; b < _blocks.size() && written; ++b)
+		{
+			size_t padding = static_cast<size_t>(AlignToPage(_blocks[b].bytes) - _blocks[b].bytes);
+			written = std::fwrite(_blocks[b].data, 1, _blocks[b].bytes, file.get()) == _blocks[b].bytes
+				&& std::fwrite(page.data(), 1, padding, file.get()) == padding;
+		}
+		if (!written || std::fflush(file.get()) != 0)
+		{
+			file.reset();
+			std::remove(temporaryPath.c_str());
+			throw std::runtime_error("MeshCacheWriter: cannot write " + temporaryPath);
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::remove(temporaryPath.c_str());
+		throw std::runtime_error("MeshCacheWriter: cannot replace " + path + ": " + error.message());
+	}
+}
+#pragma endregion
+
+#pragma region Entry
+MeshCacheEntry::MeshCacheEntry(const std::string& path, uint64_t key)
+	: _file(path)
+{
+	MeshCacheHeader header = {};
+	if (_file.Size() < meshCachePageBytes)
+		throw std::runtime_error("MeshCacheEntry: " + path + " is too small for a header");
+	std::memcpy(&header, _file.Data(), sizeof(header));
+	if (std::memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0 || header.version != meshCacheVersion)
+		throw std::runtime_error("MeshCacheEntry: " + path + " is not a mesh cache entry of this version");
+	if (header.key != key)
+		throw std::runtime_error("MeshCacheEntry: " + path + " was written for another key");
+	if (header.blockCount > maxMeshCacheBlocks)
+		throw std::runtime_error("MeshCacheEntry: " + path + " has a malformed block table");
+
+	_blocks.resize(header.blockCount);
+	for (uint32_t b = 0; b < header.blockCount; ++b)
+	{
+		MeshCacheBlockEntry block;
+		std::memcpy(&block, _file.Data() + sizeof(header) + b * sizeof(block), sizeof(block));
+		//every block is written padded to a page, so a file cut anywhere is caught, even in the padding of the last block
+		if (block.offset % meshCachePageBytes != 0 || block.offset > _file.Size() || block.bytes > _file.Size() - block.offset
+			|| AlignToPage(block.bytes) > _file.Size() - block.offset || block.encoding > static_cast<uint32_t>(MeshBlockEncoding::Index16))
+			throw std::runtime_error("MeshCacheEntry: " + path + " is truncated or has a malformed block table");
+		_blocks[b] = MeshBlock{ block.id, static_cast<MeshBlockEncoding>(block.encoding), _file.Data() + block.offset,
+			static_cast<size_t>(block.bytes) };
+	}
+}
+
+const MeshBlock* MeshCacheEntry::Find(uint32_t id) const
+{
+	for (const MeshBlock& block : _blocks)
+	{
+		if (block.id == id)
+			return &block;
+	}
+	return nullptr;
+}
+
+size_t MeshCacheEntry::Bytes() const
+{
+	return _file.Size();
+}
+#pragma endregion
+
+#pragma region Cache
+MeshCache::MeshCache(std::string directory)
+	: _directory(std::move(directory))
+{
+}
+
+bool MeshCache::Enabled() const
+{
+	return !_directory.empty();
+}
+
+std::string MeshCache::EntryPath(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.meshcache", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(_directory) / name).string();
+}
+
+bool MeshCache::Load(uint64_t key, MeshCacheEntry& entry) const
+{
+	if (!Enabled())
+		return false;
+
+	std::string path = EntryPath(key);
+	std::error_code error;
+	if (!std::filesystem::exists(path, error))
+		return false;
+
+	try
+	{
+		entry = MeshCacheEntry(path, key);
+		return true;
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << "Ignoring mesh cache entry: " << exception.what() << std::endl;
+		return false;
+	}
+}
+
+void MeshCache::Store(uint64_t key, const MeshCacheWriter& writer) const
+{
+	if (!Enabled())
+		return;
+
+	try
+	{
+		std::filesystem::create_directories(_directory);
+		writer.Write(EntryPath(key), key);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << "Not caching the mesh: " << exception.what() << std::endl;
+	}
+}
+#pragma endregion
+
+#pragma region Meshes
+void AddTiledMesh(const TiledHeightmapMesh& mesh, MeshCacheWriter& writer)
+{
+	TiledMeshInfo info = {};
+	info.width = mesh.width;
+	info.height = mesh.height;
+	info.tileQuads = mesh.tileQuads;
+	info.vertexFormat = static_cast<uint32_t>(mesh.vertexFormat);
+	info.normalFormat = static_cast<uint32_t>(mesh.normalFormat);
+	info.topology = static_cast<uint32_t>(mesh.indexTable != nullptr ? mesh.indexTable->topology : GridTopology::TriangleList);
+	info.vertexCount = static_cast<uint32_t>(mesh.VertexCount());
+	info.maxDepth = mesh.maxDepth;
+
+	writer.AddCopiedBlock(TiledInfoBlock, &info, sizeof(info));
+	writer.AddBlock(TiledTilesBlock, mesh.tiles.data(), mesh.tiles.size() * sizeof(HeightmapTile));
+	writer.AddBlock(TiledVerticesBlock, mesh.VertexData(), mesh.VertexBytes());
+	if (mesh.NormalBytes() > 0)
+		writer.AddBlock(TiledNormalsBlock, mesh.NormalData(), mesh.NormalBytes());
+}
+
+bool ReadTiledMesh(const MeshCacheEntry& entry, TiledHeightmapMesh& mesh, const MeshBlock*& vertices, const MeshBlock*& normals,
+	GridIndexTableCache& indexTables)
+{
+	const MeshBlock* infoBlock = entry.Find(TiledInfoBlock);
+	const MeshBlock* tilesBlock = entry.Find(TiledTilesBlock);
+	vertices = entry.Find(TiledVerticesBlock);
+	normals = entry.Find(TiledNormalsBlock);
+	if (infoBlock == nullptr || infoBlock->bytes != sizeof(TiledMeshInfo) || tilesBlock == nullptr
+		|| tilesBlock->bytes % sizeof(HeightmapTile) != 0 || vertices == nullptr)
+		return false;
+
+	TiledMeshInfo info;
+	std::memcpy(&info, infoBlock->data, sizeof(info));
+	mesh.width = info.width;
+	mesh.height = info.height;
+	mesh.tileQuads = info.tileQuads;
+	mesh.maxDepth = info.maxDepth;
+	mesh.vertexFormat = static_cast<HeightmapVertexFormat>(info.vertexFormat);
+	mesh.normalFormat = static_cast<HeightmapNormalFormat>(info.normalFormat);
+	mesh.vertices.clear();
+	mesh.compactVertices.clear();
+	mesh.normals.clear();
+	mesh.octahedralNormals.clear();
+	mesh.rowMaxDepth.clear();
+	if (vertices->bytes != static_cast<size_t>(info.vertexCount) * mesh.VertexStride()
+		|| (normals != nullptr ? normals->bytes : 0) != static_cast<size_t>(info.vertexCount) * mesh.NormalStride())
+		return false;
+
+	if (info.tileQuads == 0 || info.tileQuads > maxHeightmapTileQuads || info.topology > static_cast<uint32_t>(GridTopology::TriangleListBands))
+		return false;
+	mesh.tiles.resize(tilesBlock->bytes / sizeof(HeightmapTile));
+	std::memcpy(mesh.tiles.data(), tilesBlock->data, tilesBlock->bytes);
+	mesh.indexTable = mesh.tiles.empty() ? nullptr
+		: indexTables.Get(mesh.width, mesh.height, mesh.tileQuads, static_cast<GridTopology>(info.topology));
+
+	//a tile reading past the vertex block or the index table would draw garbage
+	for (const HeightmapTile& tile : mesh.tiles)
+	{
+		uint64_t tileVertices = static_cast<uint64_t>(tile.quadsX + 1ull) * (tile.quadsY + 1ull);
+		uint64_t tileIndexEnd = static_cast<uint64_t>(tile.startIndex) + tile.indexCount;
+		if (static_cast<uint64_t>(tile.baseVertex) + tileVertices > info.vertexCount || tileIndexEnd > mesh.indexTable->indices.size())
+			return false;
+	}
+	return true;
+}
+
+void AddAdaptiveMesh(const HeightmapMesh& mesh, MeshCacheWriter& writer)
+{
+	AdaptiveMeshInfo info = {};
+	info.width = mesh.width;
+	info.height = mesh.height;
+	info.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	info.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	info.maxDepth = mesh.maxDepth;
+
+	writer.AddCopiedBlock(AdaptiveInfoBlock, &info, sizeof(info));
+	writer.AddBlock(AdaptiveVerticesBlock, mesh.vertices.data(), mesh.vertices.size() * sizeof(HeightmapVertex));
+	writer.AddIndexBlock(AdaptiveIndicesBlock, mesh.indices.data(), mesh.indices.size());
+}
+
+bool ReadAdaptiveMesh(const MeshCacheEntry& entry, HeightmapMesh& mesh, const MeshBlock*& vertices, const MeshBlock*& indices)
+{
+	const MeshBlock* infoBlock = entry.Find(AdaptiveInfoBlock);
+	vertices = entry.Find(AdaptiveVerticesBlock);
+	indices = entry.Find(AdaptiveIndicesBlock);
+	if (infoBlock == nullptr || infoBlock->bytes != sizeof(AdaptiveMeshInfo) || vertices == nullptr || indices == nullptr)
+		return false;
+
+	AdaptiveMeshInfo info;
+	std::memcpy(&info, infoBlock->data, sizeof(info));
+	size_t indexBytes = indices->encoding == MeshBlockEncoding::Index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	if (vertices->bytes != static_cast<size_t>(info.vertexCount) * sizeof(HeightmapVertex)
+		|| indices->bytes != static_cast<size_t>(info.indexCount) * indexBytes)
+		return false;
+
+	mesh.width = info.width;
+	mesh.height = info.height;
+	mesh.maxDepth = info.maxDepth;
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	return true;
+}
+#pragma endregion
@@ -0,0 +1,104 @@
+#pragma once
+#include "HeightmapMeshBuilder.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+//built meshes stored on disk under a hash of the depth file and of the settings they were built with, so a map that
+//was meshed before is mapped instead of decoded and built again. an entry is a header and a block table followed by
+//the blocks, each starting on a page boundary so a mapped block can be handed to CreateBuffer in place:
+//	offset  0  char[4]  "HMMC"
+//	offset  4  uint32   version, 1
+//	offset  8  uint64   key
+//	offset 16  uint32   block count, at most maxMeshCacheBlocks
+//	offset 20  uint32   0
+//	offset 24  block table, MeshCacheBlockEntry per block
+//all fields are little endian, the blocks hold the structs of HeightmapMeshBuilder as they are in memory
+constexpr uint32_t meshCachePageBytes = 4096;
+constexpr uint32_t maxMeshCacheBlocks = 16;
+
+//64-bit hash of size bytes built like xxh64, four 8 byte lanes per round, so hashing a depth file costs a fraction of
+//decoding it. chain calls through seed to hash several buffers
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+enum class MeshBlockEncoding : uint32_t
+{
+	Raw = 0,
+	Index16 = 1	//32-bit indices stored as 16 bits, every index was below 65536
+};
+
+struct MeshBlock
+{
+	uint32_t id = 0;
+	MeshBlockEncoding encoding = MeshBlockEncoding::Raw;
+	const void* data = nullptr;
+	size_t bytes = 0;
+};
+
+//collects the blocks of one entry. the data of AddBlock is not copied and has to outlive Write
+class MeshCacheWriter
+{
+public:
+	void AddBlock(uint32_t id, const void* data, size_t bytes);
+	//for small blocks built on the stack, such as the description of a mesh
+	void AddCopiedBlock(uint32_t id, const void* data, size_t bytes);
+	//stores the indices as 16 bits when every one of them fits, the block reads back as MeshBlockEncoding::Index16 then
+	void AddIndexBlock(uint32_t id, const uint32_t* indices, size_t count);
+
+	//writes a temporary file next to path and renames it over path, so a reader never maps a half written entry.
+	//throws std::runtime_error when the file cannot be written
+	void Write(const std::string& path, uint64_t key) const;
+
+private:
+	std::vector<MeshBlock> _blocks;
+	std::vector<std::vector<uint8_t>> _ownedData;	//of AddCopiedBlock and the narrowed indices
+};
+
+//a mapped entry, the blocks point into the mapping and stay valid as long as the object
+class MeshCacheEntry
+{
+public:
+	MeshCacheEntry() = default;
+	//throws std::runtime_error when the file is missing, truncated, in another format or written for another key
+	MeshCacheEntry(const std::string& path, uint64_t key);
+
+	//nullptr when the entry has no block id
+	const MeshBlock* Find(uint32_t id) const;
+	size_t Bytes() const;
+
+private:
+	MappedFile _file;
+	std::vector<MeshBlock> _blocks;
+};
+
+//the entries of one directory, each named after its key. an empty directory disables the cache
+class MeshCache
+{
+public:
+	explicit MeshCache(std::string directory = std::string());
+
+	bool Enabled() const;
+	std::string EntryPath(uint64_t key) const;
+	//false on a miss, an entry that cannot be read counts as one and is written over by the next Store
+	bool Load(uint64_t key, MeshCacheEntry& entry) const;
+	//creates the directory when needed. failures are reported on stderr and otherwise ignored, the cache only saves time
+	void Store(uint64_t key, const MeshCacheWriter& writer) const;
+
+private:
+	std::string _directory;
+};
+
+//the tiles, vertices and normals of a tiled mesh. the index table is not stored, GridIndexTableCache rebuilds it from
+//the size of the mesh
+void AddTiledMesh(const TiledHeightmapMesh& mesh, MeshCacheWriter& writer);
+
+//fills mesh except for its vertex and normal vectors, those stay in the entry and are returned as blocks to be
+//uploaded from the mapping, normals is nullptr without normals. false when entry holds no tiled mesh
+bool ReadTiledMesh(const MeshCacheEntry& entry, TiledHeightmapMesh& mesh, const MeshBlock*& vertices, const MeshBlock*& normals,
+	GridIndexTableCache& indexTables = GridIndexTableCache::Shared());
+
+//the vertices and indices of an adaptive (rtin) mesh
+void AddAdaptiveMesh(const HeightmapMesh& mesh, MeshCacheWriter& writer);
+
+//fills the size and max depth of mesh, the vertices and indices stay in the entry. false when entry holds no adaptive mesh
+bool ReadAdaptiveMesh(const MeshCacheEntry& entry, HeightmapMesh& mesh, const MeshBlock*& vertices, const MeshBlock*& indices);
@@ -0,0 +1,240 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+static void Normalize(float v[3])
+{
+	float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (length > 0.0f)
+	{
+		for (int i = 0; i < 3; ++i)
+			v[i] /= length;
+	}
+}
+
+//bounds and normal cone of a meshlet whose vertices and triangles are already written
+static void ComputeMeshletBounds(const MeshletMesh& meshlets, const HeightmapMesh& mesh, int depthSlot, Meshlet& meshlet)
+{
+	const uint32_t* vertices = meshlets.meshletVertices.data() + meshlet.vertexOffset;
+	const uint8_t* triangles = meshlets.meshletTriangles.data() + static_cast<size_t>(meshlet.triangleOffset) * 3;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		meshlet.boundsMin[i] = mesh.vertices[vertices[0]].position[i];
+		meshlet.boundsMax[i] = meshlet.boundsMin[i];
+	}
+	for (uint32_t v = 1; v < meshlet.vertexCount; ++v)
+	{
+		const float* position = mesh.vertices[vertices[v]].position;
+		for (int i = 0; i < 3; ++i)
+		{
+			meshlet.boundsMin[i] = std::min(meshlet.boundsMin[i], position[i]);
+			meshlet.boundsMax[i] = std::max(meshlet.boundsMax[i], position[i]);
+		}
+	}
+
+	float radiusSquared = 0.0f;
+	for (int i = 0; i < 3; ++i)
+		meshlet.center[i] = (meshlet.boundsMin[i] + meshlet.boundsMax[i]) * 0.5f;
+	for (uint32_t v = 0; v < meshlet.vertexCount; ++v)
+	{
+		const float* position = mesh.vertices[vertices[v]].position;
+		float dx = position[0] - meshlet.center[0];
+		float dy = position[1] - meshlet.center[1];
+		float dz = position[2] - meshlet.center[2];
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+	meshlet.radius = std::sqrt(radiusSquared);
+
+	//face normals turned to growing height, the rasterizer culls nothing so the winding does not say which side is front
+	float normals[maxMeshletTriangles * 3];
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const float* a = mesh.vertices[vertices[triangles[t * 3]]].position;
+		const float* b = mesh.vertices[vertices[triangles[t * 3 + 1]]].position;
+		const float* c = mesh.vertices[vertices[triangles[t * 3 + 2]]].position;
+		float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+		float* normal = normals + t * 3;
+		normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+		normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+		normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+		if (normal[depthSlot] < 0.0f)
+		{
+			for (int i = 0; i < 3; ++i)
+				normal[i] = -normal[i];
+		}
+		Normalize(normal);
+
+		for (int i = 0; i < 3; ++i)
+			axis[i] += normal[i];
+	}
+	Normalize(axis);
+
+	float minDot = 1.0f;
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const float* normal = normals + t * 3;
+		minDot = std::min(minDot, normal[0] * axis[0] + normal[1] * axis[1] + normal[2] * axis[2]);
+	}
+
+	for (int i = 0; i < 3; ++i)
+		meshlet.coneAxis[i] = axis[i];
+	//a cone of 90 degrees or more contains a front facing direction for every eye position
+	meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
+
+MeshletBuilder::MeshletBuilder(HeightmapOrientation orientation, unsigned int threadCount)
+	: _orientation(orientation),
+	_pool(threadCount)
+{
+}
+
+void MeshletBuilder::Build(const HeightmapMesh& mesh, MeshletMesh& meshlets) const
+{
+	meshlets.width = mesh.width;
+	meshlets.height = mesh.height;
+	meshlets.meshlets.clear();
+	meshlets.meshletVertices.clear();
+	meshlets.meshletTriangles.clear();
+	meshlets.indices.clear();
+	if (mesh.width < 2 || mesh.height < 2)
+		return;
+
+	//lay out the blocks first, every block knows where its vertices and triangles go
+	uint32_t quadsX = mesh.width - 1;
+	uint32_t quadsY = mesh.height - 1;
+	uint32_t blocksX = (quadsX + meshletBlockQuads - 1) / meshletBlockQuads;
+	uint32_t blocksY = (quadsY + meshletBlockQuads - 1) / meshletBlockQuads;
+	size_t vertexCount = 0;
+	size_t triangleCount = 0;
+	for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			uint32_t blockQuadsX = std::min(meshletBlockQuads, quadsX - blockX * meshletBlockQuads);
+			uint32_t blockQuadsY = std::min(meshletBlockQuads, quadsY - blockY * meshletBlockQuads);
+
+			Meshlet meshlet{};
+			meshlet.vertexOffset = static_cast<uint32_t>(vertexCount);
+			meshlet.triangleOffset = static_cast<uint32_t>(triangleCount);
+			meshlet.vertexCount = (blockQuadsX + 1) * (blockQuadsY + 1);
+			meshlet.triangleCount = blockQuadsX * blockQuadsY * 2;
+			meshlets.meshlets.push_back(meshlet);
+
+			vertexCount += meshlet.vertexCount;
+			triangleCount += meshlet.triangleCount;
+		}
+	}
+	meshlets.meshletVertices.resize(vertexCount);
+	meshlets.meshletTriangles.resize(triangleCount * 3);
+	meshlets.indices.resize(triangleCount * 3);
+
+	int depthSlot = _orientation == HeightmapOrientation::HeightAlongY ? 1 : 2;
+	ParallelForRowBands(_pool, blocksY, [&](unsigned int, uint32_t rowBegin, uint32_t rowEnd)
+	{
+		for (uint32_t blockY = rowBegin; blockY < rowEnd; ++blockY)
+		{
+			for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+			{
+				Meshlet& meshlet = meshlets.meshlets[static_cast<size_t>(blockY) * blocksX + blockX];
+				uint32_t x0 = blockX * meshletBlockQuads;
+				uint32_t y0 = blockY * meshletBlockQuads;
+				uint32_t blockQuadsX = std::min(meshletBlockQuads, quadsX - x0);
+				uint32_t blockQuadsY = std::min(meshletBlockQuads, quadsY - y0);
+				uint32_t stride = blockQuadsX + 1;
+
+				uint32_t* vertices = meshlets.meshletVertices.data() + meshlet.vertexOffset;
+				for (uint32_t ly = 0; ly <= blockQuadsY; ++ly)
+					for (uint32_t lx = 0; lx <= blockQuadsX; ++lx)
+						vertices[ly * stride + lx] = (y0 + ly) * mesh.width + x0 + lx;
+
+				//the cells in the pattern of HeightmapMeshBuilder::Build, (tl, tr, bl) (bl, tr, br)
+				uint8_t* triangles = meshlets.meshletTriangles.data() + static_cast<size_t>(meshlet.triangleOffset) * 3;
+				uint32_t* indices = meshlets.indices.data() + static_cast<size_t>(meshlet.triangleOffset) * 3;
+				for (uint32_t ly = 0; ly < blockQuadsY; ++ly)
+				{
+					for (uint32_t lx = 0; lx < blockQuadsX; ++lx)
+					{
+						uint8_t topLeft = static_cast<uint8_t>(ly * stride + lx);
+						uint8_t bottomLeft = static_cast<uint8_t>(topLeft + stride);
+						const uint8_t corners[6] = { topLeft, static_cast<uint8_t>(topLeft + 1), bottomLeft,
+							bottomLeft, static_cast<uint8_t>(topLeft + 1), static_cast<uint8_t>(bottomLeft + 1) };
+
+						for (int i = 0; i < 6; ++i)
+						{
+							triangles[i] = corners[i];
+							indices[i] = vertices[corners[i]];
+						}
+						triangles += 6;
+						indices += 6;
+					}
+				}
+
+				ComputeMeshletBounds(meshlets, mesh, depthSlot, meshlet);
+			}
+		}
+	});
+}
+
+bool MeshletConeCulled(const Meshlet& meshlet, const float eye[3])
+{
+	float toCenter[3] = { meshlet.center[0] - eye[0], meshlet.center[1] - eye[1], meshlet.center[2] - eye[2] };
+	float distance = std::sqrt(toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] + toCenter[2] * toCenter[2]);
+	float along = toCenter[0] * meshlet.coneAxis[0] + toCenter[1] * meshlet.coneAxis[1] + toCenter[2] * meshlet.coneAxis[2];
+	return along >= meshlet.coneCutoff * distance + meshlet.radius;
+}
+
+MeshletCuller::MeshletCuller(SimdLevel simdLevel)
+	: _kernels(GetFrustumCullKernels(simdLevel))
+{
+}
+
+void MeshletCuller::SetMeshlets(const MeshletMesh& meshlets)
+{
+	_bounds.Clear();
+	for (const Meshlet& meshlet : meshlets.meshlets)
+		_bounds.Add(meshlet.boundsMin, meshlet.boundsMax);
+	_insideFrustum.resize(meshlets.meshlets.size());
+}
+
+const std::vector<MeshletDraw>& MeshletCuller::Cull(const MeshletMesh& meshlets, const Frustum& frustum, const float eye[3])
+{
+	_draws.clear();
+	_stats = MeshletCullStats{};
+	_stats.meshlets = static_cast<uint32_t>(meshlets.meshlets.size());
+
+	uint32_t insideCount = _kernels.cullBoxes(frustum, _bounds, _insideFrustum.data());
+	_stats.frustumCulled = _stats.meshlets - insideCount;
+
+	for (uint32_t i = 0; i < insideCount; ++i)
+	{
+		const Meshlet& meshlet = meshlets.meshlets[_insideFrustum[i]];
+		if (MeshletConeCulled(meshlet, eye))
+		{
+			++_stats.coneCulled;
+			continue;
+		}
+
+		//meshlets are stored in order, so neighbours that both survive continue each other's indices
+		uint32_t startIndex = meshlet.triangleOffset * 3;
+		uint32_t indexCount = meshlet.triangleCount * 3;
+		if (!_draws.empty() && _draws.back().startIndex + _draws.back().indexCount == startIndex)
+			_draws.back().indexCount += indexCount;
+		else
+			_draws.push_back(MeshletDraw{ startIndex, indexCount });
+
+		++_stats.visible;
+		_stats.triangles += meshlet.triangleCount;
+	}
+
+	_stats.draws = static_cast<uint32_t>(_draws.size());
+	return _draws;
+}
+
+const MeshletCullStats& MeshletCuller::Stats() const
+{
+	return _stats;
+}
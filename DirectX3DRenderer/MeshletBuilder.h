@@ -0,0 +1,101 @@
+#pragma once
+#include "FrustumCulling.h"
+#include "HeightmapMeshBuilder.h"
+#include "ParallelFor.h"
+#include <cstdint>
+#include <vector>
+
+//clusters of the uniform grid for culling finer than tiles. a meshlet is a block of up to
+//meshletBlockQuads x meshletBlockQuads cells of the mesh of HeightmapMeshBuilder::Build, in the usual
+//64 vertex / 124 triangle budget, with the bounds and the normal cone needed to reject it on the cpu.
+
+constexpr uint32_t maxMeshletVertices = 64;
+constexpr uint32_t maxMeshletTriangles = 124;
+constexpr uint32_t meshletBlockQuads = 7;
+
+static_assert((meshletBlockQuads + 1) * (meshletBlockQuads + 1) <= maxMeshletVertices, "a block has too many vertices");
+static_assert(meshletBlockQuads * meshletBlockQuads * 2 <= maxMeshletTriangles, "a block has too many triangles");
+
+struct Meshlet
+{
+	uint32_t vertexOffset;		//first entry in MeshletMesh::meshletVertices
+	uint32_t triangleOffset;	//first triangle in MeshletMesh::meshletTriangles, and in MeshletMesh::indices
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	float center[3];			//bounding sphere
+	float radius;
+	float boundsMin[3];
+	float boundsMax[3];
+	float coneAxis[3];			//average normal, the normals point to growing height
+	float coneCutoff;			//sine of the cone's half angle, 1 when the cone is too wide to ever cull
+};
+
+struct MeshletMesh
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;	//vertex of the source mesh for every local vertex
+	std::vector<uint8_t> meshletTriangles;	//three local vertices per triangle
+	std::vector<uint32_t> indices;			//the same triangles as a 32-bit list into the source mesh, meshlet after meshlet
+};
+
+class MeshletBuilder
+{
+private:
+	HeightmapOrientation _orientation;
+	mutable RowBandPool _pool;
+
+public:
+	//threadCount of 0 uses every hardware thread
+	explicit MeshletBuilder(HeightmapOrientation orientation = HeightmapOrientation::HeightAlongY, unsigned int threadCount = 0);
+
+	//mesh must come from HeightmapMeshBuilder::Build with the same orientation, the meshlets are rows of blocks
+	//and keep the triangles and the winding of the source mesh
+	void Build(const HeightmapMesh& mesh, MeshletMesh& meshlets) const;
+};
+
+//indices of a run of consecutive visible meshlets, one DrawIndexed of MeshletMesh::indices
+struct MeshletDraw
+{
+	uint32_t startIndex;
+	uint32_t indexCount;
+};
+
+struct MeshletCullStats
+{
+	uint32_t meshlets = 0;
+	uint32_t frustumCulled = 0;
+	uint32_t coneCulled = 0;
+	uint32_t visible = 0;
+	uint32_t draws = 0;
+	size_t triangles = 0;
+};
+
+//true when every triangle of the meshlet faces away from eye, for a sphere and cone of the meshlet
+bool MeshletConeCulled(const Meshlet& meshlet, const float eye[3]);
+
+//rejects meshlets outside the frustum with the batched box kernels, then the ones facing away from the camera, and
+//merges what is left into as few draws as possible. keeps its buffers between frames so culling does not allocate
+class MeshletCuller
+{
+private:
+	const FrustumCullKernels& _kernels;
+	BoundingBoxes _bounds;
+	std::vector<uint32_t> _insideFrustum;
+	std::vector<MeshletDraw> _draws;
+	MeshletCullStats _stats;
+
+public:
+	//simdLevel is clamped to what the cpu supports
+	explicit MeshletCuller(SimdLevel simdLevel = SimdLevel::AVX512);
+
+	//call once after every MeshletBuilder::Build
+	void SetMeshlets(const MeshletMesh& meshlets);
+
+	//frustum and eye in the local space of the mesh
+	const std::vector<MeshletDraw>& Cull(const MeshletMesh& meshlets, const Frustum& frustum, const float eye[3]);
+
+	//counts of the last Cull
+	const MeshletCullStats& Stats() const;
+};
@@ -0,0 +1,98 @@
+#include "NetpbmImage.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+using FileHandle = std::unique_ptr<FILE, int(*)(FILE*)>;
+
+//next header number, skipping whitespace and # comments
+static bool ReadHeaderNumber(FILE* file, uint32_t& value)
+{
+	int c = std::fgetc(file);
+	while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+	{
+		if (c == '#')
+		{
+			while (c != '\n' && c != EOF)
+				c = std::fgetc(file);
+		}
+		c = std::fgetc(file);
+	}
+
+	if (c < '0' || c > '9')
+		return false;
+
+	uint64_t number = 0;
+	while (c >= '0' && c <= '9' && number <= UINT32_MAX)
+	{
+		number = number * 10 + static_cast<uint64_t>(c - '0');
+		c = std::fgetc(file);
+	}
+	value = static_cast<uint32_t>(number);
+	//exactly one whitespace character separates the header from the samples
+	return number <= UINT32_MAX && (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+}
+
+uint32_t NetpbmSampleBytes(const NetpbmImage& image)
+{
+	return image.maxValue > 255 ? 2 : 1;
+}
+
+//16-bit samples are big endian in the file, swapping is its own inverse so reading and writing share it
+static void SwapSampleBytes(uint8_t* bytes, size_t size)
+{
+	for (size_t i = 0; i + 1 < size; i += 2)
+		std::swap(bytes[i], bytes[i + 1]);
+}
+
+void ReadNetpbm(const std::string& path, NetpbmImage& image, uint32_t largestMaxValue)
+{
+	FileHandle file(std::fopen(path.c_str(), "rb"), &std::fclose);
+	if (!file)
+		throw std::runtime_error("ReadNetpbm: cannot open " + path);
+
+	char magic[2] = {};
+	if (std::fread(magic, 1, 2, file.get()) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6'))
+		throw std::runtime_error("ReadNetpbm: " + path + " is not a binary pgm or ppm");
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t maxValue = 0;
+	if (!ReadHeaderNumber(file.get(), width) || !ReadHeaderNumber(file.get(), height) || !ReadHeaderNumber(file.get(), maxValue))
+		throw std::runtime_error("ReadNetpbm: malformed header in " + path);
+	if (width == 0 || height == 0 || maxValue == 0 || maxValue > 65535)
+		throw std::runtime_error("ReadNetpbm: malformed header in " + path);
+	if (maxValue > largestMaxValue)
+		throw std::runtime_error("ReadNetpbm: " + path + " has more bits per sample than the caller reads");
+
+	image.width = width;
+	image.height = height;
+	image.channels = magic[1] == '5' ? 1 : 3;
+	image.maxValue = maxValue;
+	image.pixels.resize(static_cast<size_t>(width) * height * image.channels * NetpbmSampleBytes(image));
+	if (std::fread(image.pixels.data(), 1, image.pixels.size(), file.get()) != image.pixels.size())
+		throw std::runtime_error("ReadNetpbm: " + path + " is truncated");
+	if (NetpbmSampleBytes(image) == 2)
+		SwapSampleBytes(image.pixels.data(), image.pixels.size());
+}
+
+void WriteNetpbm(const std::string& path, const NetpbmImage& image)
+{
+	FileHandle file(std::fopen(path.c_str(), "wb"), &std::fclose);
+	if (!file)
+		throw std::runtime_error("WriteNetpbm: cannot create " + path);
+
+	std::fprintf(file.get(), "P%c\n%u %u\n%u\n", image.channels == 1 ? '5' : '6', image.width, image.height, image.maxValue);
+	if (NetpbmSampleBytes(image) == 1)
+	{
+		if (std::fwrite(image.pixels.data(), 1, image.pixels.size(), file.get()) != image.pixels.size())
+			throw std::runtime_error("WriteNetpbm: cannot write " + path);
+		return;
+	}
+
+	std::vector<uint8_t> bigEndian(image.pixels);
+	SwapSampleBytes(bigEndian.data(), bigEndian.size());
+	if (std::fwrite(bigEndian.data(), 1, bigEndian.size(), file.get()) != bigEndian.size())
+		throw std::runtime_error("WriteNetpbm: cannot write " + path);
+}
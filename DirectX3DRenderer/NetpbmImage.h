@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//binary netpbm images, the uncompressed format capture tools can write without a codec library:
+//P5 (pgm) holds one channel, P6 (ppm) three interleaved rgb channels, with 8 bits per sample up to a max value of 255
+//and 16 bits above it (depth cameras write millimeters as 16-bit pgm)
+struct NetpbmImage
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t channels = 0;		//1 for P5, 3 for P6
+	uint32_t maxValue = 255;	//above 255 every sample is a native endian uint16_t
+	std::vector<uint8_t> pixels;	//rows top to bottom, width * channels samples each
+};
+
+//bytes of one sample, 1 or 2
+uint32_t NetpbmSampleBytes(const NetpbmImage& image);
+
+//reads a P5 or P6 file with a max value of at most largestMaxValue (255 or 65535), reusing the storage of image.
+//throws std::runtime_error when the file is missing, truncated or in another format
+void ReadNetpbm(const std::string& path, NetpbmImage& image, uint32_t largestMaxValue = 255);
+
+//writes image as P5 or P6 depending on its channel count, throws std::runtime_error when the file cannot be written
+void WriteNetpbm(const std::string& path, const NetpbmImage& image);
@@ -0,0 +1,120 @@
+#include "ParallelFor.h"
+#include <system_error>
+
+RowBandPool::RowBandPool(unsigned int threadCount)
+{
+	unsigned int count = (std::min)(threadCount == 0 ? DefaultThreadCount() : threadCount, maxRowBands);
+	_workers.reserve(count - 1);
+	for (unsigned int worker = 1; worker < count; ++worker)
+	{
+		try
+		{
+			_workers.emplace_back(&RowBandPool::WorkerLoop, this);
+		}
+		catch (const std::system_error&)
+		{
+			break;
+		}
+	}
+	_threadCount = static_cast<unsigned int>(_workers.size()) + 1;
+}
+
+RowBandPool::~RowBandPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (std::thread& worker : _workers)
+		worker.join();
+}
+
+unsigned int RowBandPool::ThreadCount() const
+{
+	return _threadCount;
+}
+
+void RowBandPool::Run(unsigned int bandCount, void (*task)(void* context, unsigned int band), void* context)
+{
+	//nothing to share, or the workers belong to another call: run every band here
+	bool idle = false;
+	if (_workers.empty() || bandCount < 2 || !_running.compare_exchange_strong(idle, true, std::memory_order_acquire))
+	{
+		for (unsigned int band = 0; band < bandCount; ++band)
+			task(context, band);
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		//a worker that woke late for the previous call may still be looking for a band of it
+		_finished.wait(lock, [this] { return _busyWorkers == 0; });
+		_task = task;
+		_context = context;
+		_bandCount = bandCount;
+		_pendingBands = bandCount;
+		_nextBand.store(0, std::memory_order_relaxed);
+		++_generation;
+	}
+	_wake.notify_all();
+
+	RunBands();
+
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_finished.wait(lock, [this] { return _pendingBands == 0 && _busyWorkers == 0; });
+		std::swap(error, _error);
+	}
+	_running.store(false, std::memory_order_release);
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void RowBandPool::WorkerLoop()
+{
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;)
+	{
+		_wake.wait(lock, [&] { return _stopping || _generation != seen; });
+		if (_stopping)
+			return;
+
+		seen = _generation;
+		++_busyWorkers;
+		lock.unlock();
+		RunBands();
+		lock.lock();
+		if (--_busyWorkers == 0)
+			_finished.notify_all();
+	}
+}
+
+void RowBandPool::RunBands()
+{
+	for (;;)
+	{
+		unsigned int band = _nextBand.fetch_add(1, std::memory_order_relaxed);
+		if (band >= _bandCount)
+			return;
+
+		std::exception_ptr error;
+		try
+		{
+			_task(_context, band);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (error && !_error)
+			_error = error;
+		if (--_pendingBands == 0)
+			_finished.notify_all();
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//most bands a row loop is split into, so a caller can keep one value per band in a fixed size array
+constexpr unsigned int maxRowBands = 64;
+
+//number of worker threads to use when the caller does not specify one
+inline unsigned int DefaultThreadCount()
+{
+	unsigned int count = std::thread::hardware_concurrency();
+	return count == 0 ? 1 : count;
+}
+
+//threads that run the bands of ParallelForRowBands. a builder owns one and its workers live as long as the builder,
+//so a build wakes threads that are already waiting instead of starting and joining new ones every call.
+//the calling thread works on bands as well, a pool of one thread has no workers and runs everything inline.
+//Run may be called from several threads or from inside a band: while the workers are busy with one call, another
+//runs its bands on its own thread
+class RowBandPool
+{
+public:
+	//threadCount of 0 uses every hardware thread, at most maxRowBands are used. threads the system refuses to start
+	//are left out, the pool then runs with fewer
+	explicit RowBandPool(unsigned int threadCount = 0);
+	//wakes and joins the workers
+	~RowBandPool();
+
+	RowBandPool(const RowBandPool&) = delete;
+	RowBandPool& operator=(const RowBandPool&) = delete;
+
+	//the calling thread included
+	unsigned int ThreadCount() const;
+
+	//runs task(context, band) once for every band in [0, bandCount) and returns when all have finished. the first
+	//exception a band throws is rethrown here, once no band of the call is running anymore
+	void Run(unsigned int bandCount, void (*task)(void* context, unsigned int band), void* context);
+
+private:
+	std::vector<std::thread> _workers;
+	unsigned int _threadCount = 1;
+
+	std::mutex _mutex;
+	std::condition_variable _wake;		//a new call or the destructor
+	std::condition_variable _finished;	//the last band of the current call is done
+	std::atomic<bool> _running{ false };	//a call owns the workers
+	uint64_t _generation = 0;			//calls handed to the workers so far
+	bool _stopping = false;
+	unsigned int _busyWorkers = 0;		//workers that may still claim a band of the current call
+
+	void (*_task)(void*, unsigned int) = nullptr;
+	void* _context = nullptr;
+	unsigned int _bandCount = 0;
+	std::atomic<unsigned int> _nextBand{ 0 };
+	unsigned int _pendingBands = 0;
+	std::exception_ptr _error;
+
+	void WorkerLoop();
+	//claims and runs bands of the current call until none are left
+	void RunBands();
+};
+
+//number of bands ParallelForRowBands will use for the given row count
+inline unsigned int RowBandCount(uint32_t rowCount, const RowBandPool& pool)
+{
+	return rowCount == 0 ? 0 : (std::max)(1u, (std::min)(pool.ThreadCount(), rowCount));
+}
+
+//splits [0, rowCount) into contiguous bands, one per thread of pool, and runs fn(bandIndex, rowBegin, rowEnd) for
+//each band. returns when every band is done, rethrowing the first exception one of them threw
+template <typename TFunction>
+void ParallelForRowBands(RowBandPool& pool, uint32_t rowCount, TFunction&& fn)
+{
+	struct Bands
+	{
+		TFunction& fn;
+		uint32_t rowsPerBand;
+		uint32_t remainder;
+
+		static void Run(void* context, unsigned int band)
+		{
+			Bands& bands = *static_cast<Bands*>(context);
+			uint32_t rowBegin = band * bands.rowsPerBand + (std::min)(band, bands.remainder);
+			uint32_t rowEnd = rowBegin + bands.rowsPerBand + (band < bands.remainder ? 1 : 0);
+			bands.fn(band, rowBegin, rowEnd);
+		}
+	};
+
+	unsigned int bandCount = RowBandCount(rowCount, pool);
+	if (bandCount == 0)
+		return;
+
+	Bands bands{ fn, rowCount / bandCount, rowCount % bandCount };
+	pool.Run(bandCount, &Bands::Run, &bands);
+}
@@ -0,0 +1,80 @@
+#include "ProgressiveMesh.h"
+#include <type_traits>
+
+template <typename Sample>
+static void DecimateRows(const Sample* samples, uint32_t width, uint32_t step, uint32_t previewWidth, uint32_t previewHeight,
+	Sample* out)
+{
+	for (uint32_t y = 0; y < previewHeight; ++y)
+	{
+		const Sample* row = samples + static_cast<size_t>(y) * step * width;
+		for (uint32_t x = 0; x < previewWidth; ++x)
+			out[static_cast<size_t>(y) * previewWidth + x] = row[static_cast<size_t>(x) * step];
+	}
+}
+
+void DecimateDepthSamples(const DepthSamples& samples, uint32_t step, DepthImage& preview)
+{
+	step = step > 0 ? step : 1;
+	preview.width = (samples.width + step - 1) / step;
+	preview.height = (samples.height + step - 1) / step;
+	preview.sampleType = samples.type;
+	preview.samples.resize(static_cast<size_t>(preview.width) * preview.height * DepthSampleBytes(samples.type));
+	VisitDepthSamples(samples, [&](const auto* data)
+	{
+		using Sample = std::remove_const_t<std::remove_pointer_t<decltype(data)>>;
+		DecimateRows(data, samples.width, step, preview.width, preview.height, reinterpret_cast<Sample*>(preview.samples.data()));
+	});
+}
+
+BackgroundMeshBuild::~BackgroundMeshBuild()
+{
+	if (_thread.joinable())
+		_thread.join();
+}
+
+void BackgroundMeshBuild::Start(Job job)
+{
+	_started = true;
+	_done.store(false, std::memory_order_relaxed);
+	_error.clear();
+	_start = Clock::now();
+	_thread = std::thread([this, job = std::move(job)]
+	{
+		try
+		{
+			job(_mesh);
+		}
+		catch (const std::exception& exception)
+		{
+			_error = exception.what();
+		}
+		_end = Clock::now();
+		_done.store(true, std::memory_order_release);
+	});
+}
+
+bool BackgroundMeshBuild::TryTake(TiledHeightmapMesh& mesh, std::string& error)
+{
+	if (!_started || !_done.load(std::memory_order_acquire))
+		return false;
+
+	Wait();
+	_started = false;
+	error = _error;
+	if (error.empty())
+		mesh = std::move(_mesh);
+	_mesh = TiledHeightmapMesh();
+	return true;
+}
+
+void BackgroundMeshBuild::Wait()
+{
+	if (_thread.joinable())
+		_thread.join();
+}
+
+double BackgroundMeshBuild::Seconds() const
+{
+	return std::chrono::duration<double>(_end - _start).count();
+}
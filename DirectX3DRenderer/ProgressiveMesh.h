@@ -0,0 +1,55 @@
+#pragma once
+#include "DepthImage.h"
+#include "HeightmapMeshBuilder.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+//progressive loading of a single map: a preview mesh of a decimated copy of the map is built and drawn right away,
+//while the full mesh is built on a worker thread that the render thread polls, without waiting, to swap it in
+
+constexpr uint32_t defaultPreviewStep = 8;
+
+//every step-th sample of every step-th row of samples, starting with the first one. the preview keeps the sample type,
+//so it is meshed by the same builder and drawn by the same shaders as the full map
+void DecimateDepthSamples(const DepthSamples& samples, uint32_t step, DepthImage& preview);
+
+//runs one job on its own thread. the job fills the mesh and can do anything else that should not block the render
+//thread, such as writing the mesh cache or creating the buffers on the free threaded d3d11 device
+class BackgroundMeshBuild
+{
+public:
+	using Job = std::function<void(TiledHeightmapMesh& mesh)>;
+	using Clock = std::chrono::steady_clock;
+
+private:
+	std::thread _thread;
+	bool _started = false;
+	std::atomic<bool> _done{ false };	//set by the worker after everything else it writes
+	TiledHeightmapMesh _mesh;
+	std::string _error;
+	Clock::time_point _start;
+	Clock::time_point _end;
+
+public:
+	BackgroundMeshBuild() = default;
+	//waits for a job in flight, the builders cannot be stopped halfway
+	~BackgroundMeshBuild();
+
+	BackgroundMeshBuild(const BackgroundMeshBuild&) = delete;
+	BackgroundMeshBuild& operator=(const BackgroundMeshBuild&) = delete;
+
+	//starts job, the previous one must have been taken
+	void Start(Job job);
+	//started and not taken yet
+	bool Running() const { return _started; }
+	//true once, when the job has returned: its mesh is moved into mesh, or error says why it threw and mesh is left
+	//alone. false while the job runs or when none was started, never waits
+	bool TryTake(TiledHeightmapMesh& mesh, std::string& error);
+	//blocks until the job has returned, TryTake then succeeds
+	void Wait();
+	//how long the job ran, valid after TryTake
+	double Seconds() const;
+};
@@ -0,0 +1,85 @@
+#include "RawDepthFile.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+static const char rawDepthMagic[4] = { 'H', 'M', 'R', 'D' };
+constexpr uint32_t rawDepthVersion = 1;
+
+//the fields of the header, the samples follow at dataOffset
+struct RawDepthHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t sampleType;
+	uint32_t dataOffset;
+	uint64_t reserved;
+};
+static_assert(sizeof(RawDepthHeader) == rawDepthHeaderBytes, "the raw depth header is 32 bytes");
+
+RawDepthFile::RawDepthFile(const std::string& path)
+	: _file(path)
+{
+	ReadHeader();
+}
+
+#if defined(_WIN32)
+RawDepthFile::RawDepthFile(const std::wstring& path)
+	: _file(path)
+{
+	ReadHeader();
+}
+#endif
+
+void RawDepthFile::ReadHeader()
+{
+	RawDepthHeader header = {};
+	if (_file.Size() < sizeof(header))
+		throw std::runtime_error("RawDepthFile: file too small for a header");
+	std::memcpy(&header, _file.Data(), sizeof(header));
+	if (std::memcmp(header.magic, rawDepthMagic, sizeof(rawDepthMagic)) != 0 || header.version != rawDepthVersion)
+		throw std::runtime_error("RawDepthFile: not a raw depth map");
+
+	DepthSampleType type = static_cast<DepthSampleType>(header.sampleType);
+	if (type != DepthSampleType::UInt8 && type != DepthSampleType::UInt16 && type != DepthSampleType::Float32)
+		throw std::runtime_error("RawDepthFile: unknown sample type");
+
+	//the mapping is page aligned, an offset that is a multiple of the sample size keeps the samples aligned
+	uint32_t sampleBytes = DepthSampleBytes(type);
+	if (header.dataOffset < sizeof(header) || header.dataOffset > _file.Size() || header.dataOffset % sampleBytes != 0)
+		throw std::runtime_error("RawDepthFile: samples misaligned or outside the file");
+	//divided instead of multiplied, width * height * sampleBytes of a corrupt header can overflow
+	size_t availableSamples = (_file.Size() - header.dataOffset) / sampleBytes;
+	if (header.width != 0 && availableSamples / header.width < header.height)
+		throw std::runtime_error("RawDepthFile: file truncated");
+
+	_samples = DepthSamples{ header.width, header.height, type, _file.Data() + header.dataOffset };
+}
+
+DepthSamples RawDepthFile::Samples() const
+{
+	return _samples;
+}
+
+void WriteRawDepth(const std::string& path, const DepthSamples& samples)
+{
+	std::unique_ptr<FILE, int(*)(FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+	if (!file)
+		throw std::runtime_error("WriteRawDepth: cannot create " + path);
+
+	RawDepthHeader header = {};
+	std::memcpy(header.magic, rawDepthMagic, sizeof(rawDepthMagic));
+	header.version = rawDepthVersion;
+	header.width = samples.width;
+	header.height = samples.height;
+	header.sampleType = static_cast<uint32_t>(samples.type);
+	header.dataOffset = rawDepthHeaderBytes;
+
+	size_t sampleBytes = static_cast<size_t>(samples.width) * samples.height * DepthSampleBytes(samples.type);
+	if (std::fwrite(&header, sizeof(header), 1, file.get()) != 1
+		|| std::fwrite(samples.data, 1, sampleBytes, file.get()) != sampleBytes)
+		throw std::runtime_error("WriteRawDepth: cannot write " + path);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "DepthImage.h"
+#include "MappedFile.h"
+#include <string>
+
+//depth maps stored the way they sit in memory, so a file can be mapped and meshed without being read or converted.
+//unlike pfm the header has a fixed size (the samples stay aligned) and the rows run top to bottom like every other map.
+//all fields and samples are little endian:
+//	offset  0  char[4]  "HMRD"
+//	offset  4  uint32   version, 1
+//	offset  8  uint32   width
+//	offset 12  uint32   height
+//	offset 16  uint32   sample type, DepthSampleType
+//	offset 20  uint32   offset of the samples from the start of the file, rawDepthHeaderBytes
+//	offset 24  uint64   0
+//followed by width * height samples
+constexpr uint32_t rawDepthHeaderBytes = 32;
+
+//a mapped raw depth map, the samples point into the mapping and stay valid as long as the object
+class RawDepthFile
+{
+public:
+	RawDepthFile() = default;
+	//throws std::runtime_error when the file is missing, truncated or in another format
+	explicit RawDepthFile(const std::string& path);
+#if defined(_WIN32)
+	explicit RawDepthFile(const std::wstring& path);
+#endif
+
+	DepthSamples Samples() const;
+
+private:
+	void ReadHeader();
+
+	MappedFile _file;
+	DepthSamples _samples;
+};
+
+//writes samples with a raw depth header, throws std::runtime_error when the file cannot be written
+void WriteRawDepth(const std::string& path, const DepthSamples& samples);
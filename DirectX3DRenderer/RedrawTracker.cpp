@@ -0,0 +1,60 @@
+#include "RedrawTracker.h"
+#include <sstream>
+
+std::string FormatRedrawStats(const RedrawStats& stats)
+{
+	std::ostringstream line;
+	line << "Redraws: " << stats.rendered << " frames (" << stats.byReason[static_cast<size_t>(RedrawReason::Camera)] << " camera, "
+		<< stats.byReason[static_cast<size_t>(RedrawReason::Window)] << " window, " << stats.byReason[static_cast<size_t>(RedrawReason::Scene)]
+		<< " scene), " << stats.skipped << " skipped, " << stats.waits << " waits, " << stats.idleSeconds << " s idle\n";
+	return line.str();
+}
+
+RedrawTracker::RedrawTracker(RedrawMode mode)
+	: _mode(mode), _pending(1u << static_cast<uint32_t>(RedrawReason::Scene))
+{
+}
+
+void RedrawTracker::Invalidate(RedrawReason reason)
+{
+	_pending |= 1u << static_cast<uint32_t>(reason);
+}
+
+bool RedrawTracker::BeginFrame()
+{
+	if (_pending == 0 && _mode == RedrawMode::OnDemand)
+	{
+		++_stats.skipped;
+		return false;
+	}
+
+	++_stats.rendered;
+	for (uint32_t reason = 0; reason < static_cast<uint32_t>(RedrawReason::Count); ++reason)
+	{
+		if (_pending & (1u << reason))
+			++_stats.byReason[reason];
+	}
+	_pending = 0;
+	return true;
+}
+
+bool RedrawTracker::Idle() const
+{
+	return _pending == 0 && _mode == RedrawMode::OnDemand;
+}
+
+void RedrawTracker::RecordWait(double seconds)
+{
+	++_stats.waits;
+	_stats.idleSeconds += seconds;
+}
+
+RedrawMode RedrawTracker::Mode() const
+{
+	return _mode;
+}
+
+RedrawStats RedrawTracker::Stats() const
+{
+	return _stats;
+}
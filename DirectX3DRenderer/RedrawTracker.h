@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+//decides whether the render loop draws a frame. in on demand mode a frame is drawn only after something it shows
+//changed: the camera, the size of the window or the scene. while nothing did, the loop blocks in a message wait
+//instead of drawing the same picture again. the tracker only bookkeeps, the loop does the waiting
+
+enum class RedrawMode
+{
+	OnDemand,	//draws after an Invalidate
+	Continuous	//draws every pass of the loop, for benchmarks
+};
+
+enum class RedrawReason
+{
+	Camera,	//moved, turned or zoomed, or still moving from a held key
+	Window,	//resized or uncovered
+	Scene,	//a mesh was swapped in or edited, a sequence frame arrived
+	Count
+};
+
+struct RedrawStats
+{
+	uint64_t rendered = 0;
+	uint64_t skipped = 0;	//passes of the loop that had nothing to draw
+	uint64_t byReason[static_cast<size_t>(RedrawReason::Count)] = {};	//frames drawn for each reason, a frame can count for several
+	uint64_t waits = 0;
+	double idleSeconds = 0.0;	//spent blocked in the message wait
+};
+
+//one line for the log
+std::string FormatRedrawStats(const RedrawStats& stats);
+
+class RedrawTracker
+{
+public:
+	//the first frame is always drawn
+	explicit RedrawTracker(RedrawMode mode = RedrawMode::OnDemand);
+
+	void Invalidate(RedrawReason reason);
+	//whether this pass of the loop draws a frame. clears the reasons it draws for, or counts a skipped pass
+	bool BeginFrame();
+	//true when no reason is pending, so the loop can wait for the next message
+	bool Idle() const;
+	void RecordWait(double seconds);
+	RedrawMode Mode() const;
+	RedrawStats Stats() const;
+
+private:
+	RedrawMode _mode;
+	uint32_t _pending;	//bit per RedrawReason
+	RedrawStats _stats;
+};
@@ -0,0 +1,131 @@
+#include "RenderSettings.h"
+#include <iostream>
+#include <sstream>
+
+static bool ParseUnsigned(const std::wstring& text, uint32_t& value)
+{
+	if (text.empty() || text.find_first_not_of(L"0123456789") != std::wstring::npos || text.size() > 9)
+		return false;
+
+	value = static_cast<uint32_t>(std::stoul(text));
+	return true;
+}
+
+static bool ParseNonNegative(const std::wstring& text, float& value)
+{
+	if (text.empty() || text.find_first_not_of(L"0123456789.") != std::wstring::npos || text.size() > 9)
+		return false;
+
+	try
+	{
+		size_t parsed = 0;
+		value = std::stof(text, &parsed);
+		return parsed == text.size();
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
+
+RenderSettings ParseRenderSettings(const std::wstring& commandLine)
+{
+	RenderSettings settings;
+
+	std::wistringstream stream(commandLine);
+	std::wstring argument;
+	while (stream >> argument)
+	{
+		size_t separator = argument.find(L'=');
+		std::wstring name = argument.substr(0, separator);
+		std::wstring value = separator == std::wstring::npos ? std::wstring() : argument.substr(separator + 1);
+
+		uint32_t number = 0;
+		float error = 0.0f;
+		if (name == L"--topology" && value == L"list")
+			settings.mesh.topology = GridTopology::TriangleList;
+		else if (name == L"--topology" && value == L"strip")
+			settings.mesh.topology = GridTopology::TriangleStrip;
+		else if (name == L"--topology" && value == L"bands")
+			settings.mesh.topology = GridTopology::TriangleListBands;
+		else if (name == L"--tile" && ParseUnsigned(value, number) && number > 0 && number <= maxHeightmapTileQuads)
+			settings.mesh.tileQuads = number;
+		else if (name == L"--vertex" && value == L"full")
+			settings.mesh.vertexFormat = HeightmapVertexFormat::Full;
+		else if (name == L"--vertex" && value == L"compact")
+			settings.mesh.vertexFormat = HeightmapVertexFormat::Compact;
+		else if (name == L"--normals" && value == L"none")
+			settings.mesh.normalFormat = HeightmapNormalFormat::None;
+		else if (name == L"--normals" && value == L"float")
+			settings.mesh.normalFormat = HeightmapNormalFormat::Float;
+		else if (name == L"--normals" && value == L"octahedral")
+			settings.mesh.normalFormat = HeightmapNormalFormat::Octahedral;
+		else if (name == L"--mode" && value == L"mesh")
+			settings.renderMode = HeightmapRenderMode::Mesh;
+		else if (name == L"--mode" && value == L"vertexid")
+			settings.renderMode = HeightmapRenderMode::VertexId;
+		else if (name == L"--mode" && value == L"rtin")
+			settings.renderMode = HeightmapRenderMode::Rtin;
+		else if (name == L"--mode" && value == L"lod")
+			settings.renderMode = HeightmapRenderMode::Lod;
+		else if (name == L"--mode" && value == L"meshlets")
+			settings.renderMode = HeightmapRenderMode::Meshlets;
+		else if (name == L"--max-error" && ParseNonNegative(value, error))
+			settings.maxError = error;
+		else if (name == L"--lod-error" && ParseNonNegative(value, error) && error > 0.0f)
+			settings.maxPixelError = error;
+		else if (name == L"--depth" && !value.empty())
+			settings.depthPath = value;
+		else if (name == L"--sequence" && !value.empty())
+			settings.sequenceDirectory = value;
+		else if (name == L"--sequence-fps" && ParseNonNegative(value, error))
+			settings.sequenceFramesPerSecond = error;
+		else if (name == L"--filter" && value == L"none")
+			settings.depthFilter.kind = DepthFilterKind::None;
+		else if (name == L"--filter" && value == L"median3")
+			settings.depthFilter.kind = DepthFilterKind::Median3;
+		else if (name == L"--filter" && value == L"median5")
+			settings.depthFilter.kind = DepthFilterKind::Median5;
+		else if (name == L"--filter" && value == L"bilateral3")
+			settings.depthFilter.kind = DepthFilterKind::Bilateral3;
+		else if (name == L"--filter" && value == L"bilateral5")
+			settings.depthFilter.kind = DepthFilterKind::Bilateral5;
+		else if (name == L"--mesh-cache" && value == L"none")
+			settings.meshCacheDirectory.clear();
+		else if (name == L"--mesh-cache" && !value.empty())
+			settings.meshCacheDirectory = value;
+		else if (name == L"--shader-cache" && value == L"none")
+			settings.shaderCacheDirectory.clear();
+		else if (name == L"--shader-cache" && !value.empty())
+			settings.shaderCacheDirectory = value;
+		else if (name == L"--embed-shaders" && !value.empty())
+			settings.embedShadersPath = value;
+		else if (name == L"--pacing" && value == L"vsync")
+			settings.pacing.pacing = FramePacing::VSync;
+		else if (name == L"--pacing" && value == L"vsync2")
+			settings.pacing.pacing = FramePacing::VSyncHalf;
+		else if (name == L"--pacing" && value == L"target")
+			settings.pacing.pacing = FramePacing::TargetRate;
+		else if (name == L"--pacing" && value == L"uncapped")
+			settings.pacing.pacing = FramePacing::Uncapped;
+		else if (name == L"--fps" && ParseNonNegative(value, error) && error > 0.0f)
+		{
+			settings.pacing.pacing = FramePacing::TargetRate;
+			settings.pacing.targetFramesPerSecond = error;
+		}
+		else if (name == L"--update-rate" && ParseNonNegative(value, error) && error > 0.0f)
+			settings.updatesPerSecond = error;
+		else if (name == L"--redraw" && value == L"ondemand")
+			settings.redraw = RedrawMode::OnDemand;
+		else if (name == L"--redraw" && value == L"continuous")
+			settings.redraw = RedrawMode::Continuous;
+		else if (name == L"--preview-step" && ParseUnsigned(value, number))
+			settings.previewStep = number;
+		else if (name == L"--filter-range" && ParseNonNegative(value, error) && error > 0.0f)
+			settings.depthFilter.rangeCutoff = error;
+		else
+			std::wcerr << L"Ignoring unknown option " << argument << std::endl;
+	}
+
+	return settings;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "DepthFilter.h"
+#include "FixedTimestep.h"
+#include "FramePacer.h"
+#include "HeightmapMeshBuilder.h"
+#include "ProgressiveMesh.h"
+#include "RedrawTracker.h"
+#include <string>
+
+enum class HeightmapRenderMode
+{
+	Mesh,		//tiles of the mesh built by HeightmapMeshBuilder
+	VertexId,	//no vertex buffer, MainVertexId samples the depth texture (see VertexIdGrid.h)
+	Rtin,		//error bounded adaptive mesh of RtinMeshBuilder
+	Lod,		//view dependent chunk quadtree of ChunkedLodBuilder
+	Meshlets	//uniform mesh in MeshletBuilder clusters, culled per cluster by MeshletCuller
+};
+
+//options chosen at startup, before the heightmap is loaded
+struct RenderSettings
+{
+	std::wstring depthPath = L"C:\\Users\\Payhemfoh\\source\\repos\\DirectX3DRenderer\\data\\depth.jpg";	//see DecodeDepthImage and RawDepthFile
+	HeightmapRenderMode renderMode = HeightmapRenderMode::Mesh;
+	TiledMeshOptions mesh;	//only used by HeightmapRenderMode::Mesh
+	float maxError = 1.0f;	//largest vertical error of HeightmapRenderMode::Rtin, in 8-bit depth units
+	float maxPixelError = 2.0f;	//largest projected error of HeightmapRenderMode::Lod, in pixels
+	std::wstring sequenceDirectory;	//plays this rgb-d sequence instead of the single map, HeightmapRenderMode::Mesh only
+	float sequenceFramesPerSecond = 30.0f;	//playback rate of the sequence, 0 plays it as fast as it can be built
+	DepthFilterOptions depthFilter;	//applied to every depth map before a mesh is built from it
+	std::wstring meshCacheDirectory = L"MeshCache";	//entries of MeshCache for mesh and rtin modes, empty disables it
+	std::wstring shaderCacheDirectory = L"ShaderCache";	//entries of ShaderCache, empty compiles every shader that is not embedded
+	std::wstring embedShadersPath;	//writes the loaded shaders into this header for a HEIGHTMAP_EMBEDDED_SHADERS build
+	FramePacerOptions pacing;	//how the render loop waits between frames
+	double updatesPerSecond = defaultUpdatesPerSecond;	//fixed steps of the camera motion, see FixedTimestep
+	RedrawMode redraw = RedrawMode::OnDemand;	//whether frames are drawn only after a change
+	uint32_t previewStep = defaultPreviewStep;	//mesh mode draws every previewStep-th sample until the full mesh is built, 0 or 1 waits for it
+};
+
+//recognised switches:
+//	--depth=<image or .rawdepth file>
+//	--topology=list|strip|bands
+//	--tile=<quads per tile edge>
+//	--vertex=full|compact
+//	--normals=none|float|octahedral
+//	--mode=mesh|vertexid|rtin|lod|meshlets
+//	--max-error=<depth units>
+//	--lod-error=<pixels>
+//	--sequence=<directory>
+//	--sequence-fps=<frames per second>
+//	--filter=none|median3|median5|bilateral3|bilateral5
+//	--filter-range=<depth units>
+//	--mesh-cache=<directory>|none
+//	--preview-step=<samples>
+//	--shader-cache=<directory>|none
+//	--embed-shaders=<header>
+//	--pacing=vsync|vsync2|target|uncapped
+//	--fps=<frames per second>, implies --pacing=target
+//	--update-rate=<steps per second>
+//	--redraw=ondemand|continuous
+//unknown or malformed switches are reported on stderr and ignored
+RenderSettings ParseRenderSettings(const std::wstring& commandLine);
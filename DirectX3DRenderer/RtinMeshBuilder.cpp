@@ -0,0 +1,241 @@
+#include "RtinMeshBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//the grid is refined in pairs of levels per step s = 1, 2, 4 ... gridSize / 2:
+//	axis level:		hypotenuse of length 2s along x or y, midpoints on the odd multiples of s of one axis
+//	diagonal level:	hypotenuse along a diagonal of a 2s square, midpoints on the odd multiples of s of both axes
+//every sample is the hypotenuse midpoint of exactly one level, so each level writes disjoint samples and only
+//reads the finer level below it, which is what allows the samples of a level to be processed in parallel.
+
+namespace
+{
+	//levels writing fewer samples than this run on the calling thread, waking the workers costs more than they save
+	constexpr size_t minParallelLevelSamples = 64 * 1024;
+
+	template <typename TFunction>
+	void ForLevelRows(RowBandPool& pool, uint32_t rowCount, size_t samplesPerRow, TFunction&& fn)
+	{
+		if (static_cast<size_t>(rowCount) * samplesPerRow < minParallelLevelSamples)
+			fn(0, 0, rowCount);
+		else
+			ParallelForRowBands(pool, rowCount, fn);
+	}
+
+	struct ErrorContext
+	{
+		const uint8_t* depthData;
+		uint32_t width;
+		uint32_t height;
+		int32_t gridSize;
+		float* errors;
+
+		bool Exists(int32_t x, int32_t y) const
+		{
+			return x >= 0 && y >= 0 && x < gridSize && y < gridSize;
+		}
+
+		bool Inside(int32_t x, int32_t y) const
+		{
+			return static_cast<uint32_t>(x) < width && static_cast<uint32_t>(y) < height;
+		}
+
+		float Depth(int32_t x, int32_t y) const
+		{
+			return static_cast<float>(depthData[static_cast<size_t>(y) * width + x]);
+		}
+
+		float Error(int32_t x, int32_t y) const
+		{
+			return errors[static_cast<size_t>(y) * gridSize + x];
+		}
+
+		//error of sample (mx, my) split along the hypotenuse m -+ (ux, uy), shared by the one or two triangles
+		//whose right angle sits at m -+ (vx, vy). children are only read above the finest level.
+		void Write(int32_t mx, int32_t my, int32_t ux, int32_t uy, int32_t vx, int32_t vy, bool hasChildren) const
+		{
+			float& error = errors[static_cast<size_t>(my) * gridSize + mx];
+
+			bool inside = Inside(mx - ux, my - uy) && Inside(mx + ux, my + uy);
+			for (int side = -1; side <= 1; side += 2)
+			{
+				if (Exists(mx + side * vx, my + side * vy))
+					inside = inside && Inside(mx + side * vx, my + side * vy);
+			}
+			if (!inside)
+			{
+				error = std::numeric_limits<float>::infinity();
+				return;
+			}
+
+			float interpolated = (Depth(mx - ux, my - uy) + Depth(mx + ux, my + uy)) * 0.5f;
+			error = std::fabs(interpolated - Depth(mx, my));
+			if (!hasChildren)
+				return;
+
+			for (int side = -1; side <= 1; side += 2)
+			{
+				int32_t cx = mx + side * vx;
+				int32_t cy = my + side * vy;
+				if (!Exists(cx, cy))
+					continue;
+
+				//midpoints of the two legs of the triangle with its right angle at c
+				error = std::max(error, Error((mx - ux + cx) / 2, (my - uy + cy) / 2));
+				error = std::max(error, Error((mx + ux + cx) / 2, (my + uy + cy) / 2));
+			}
+		}
+	};
+
+	struct ExtractContext
+	{
+		const uint8_t* depthData;
+		const RtinErrorPyramid& pyramid;
+		float maxError;
+		HeightmapOrientation orientation;
+		float depthDivisor;
+		std::vector<uint32_t>& vertexIndex;
+		HeightmapMesh& mesh;
+
+		//same arithmetic as the vertex row kernels, so shared samples match the uniform mesh bit for bit
+		uint32_t Vertex(uint32_t x, uint32_t y)
+		{
+			uint32_t& index = vertexIndex[static_cast<size_t>(y) * pyramid.width + x];
+			if (index != UINT32_MAX)
+				return index;
+
+			float depthValue = static_cast<float>(depthData[static_cast<size_t>(y) * pyramid.width + x]) / depthDivisor;
+			HeightmapVertex vertex = MakeHeightmapVertex(x, y, pyramid.width, pyramid.height, depthValue, orientation);
+
+			index = static_cast<uint32_t>(mesh.vertices.size());
+			mesh.vertices.push_back(vertex);
+			return index;
+		}
+
+		//(a, b) is the hypotenuse, c the right angle
+		void Triangle(uint32_t ax, uint32_t ay, uint32_t bx, uint32_t by, uint32_t cx, uint32_t cy)
+		{
+			//nothing of the map below a triangle that lies entirely in the padding
+			if (std::min({ ax, bx, cx }) >= pyramid.width || std::min({ ay, by, cy }) >= pyramid.height)
+				return;
+
+			uint32_t mx = (ax + bx) / 2;
+			uint32_t my = (ay + by) / 2;
+			bool finest = (ax > cx ? ax - cx : cx - ax) + (ay > cy ? ay - cy : cy - ay) == 1;
+
+			if (!finest && pyramid.errors[static_cast<size_t>(my) * pyramid.gridSize + mx] > maxError)
+			{
+				Triangle(cx, cy, ax, ay, mx, my);
+				Triangle(bx, by, cx, cy, mx, my);
+				return;
+			}
+
+			//the finest triangles along the edge of the map may still reach into the padding
+			uint32_t maxX = std::max({ ax, bx, cx });
+			uint32_t maxY = std::max({ ay, by, cy });
+			if (maxX >= pyramid.width || maxY >= pyramid.height)
+				return;
+
+			mesh.indices.push_back(Vertex(ax, ay));
+			mesh.indices.push_back(Vertex(bx, by));
+			mesh.indices.push_back(Vertex(cx, cy));
+		}
+	};
+}
+
+RtinMeshBuilder::RtinMeshBuilder(HeightmapOrientation orientation, unsigned int threadCount)
+	: _orientation(orientation),
+	_pool(threadCount)
+{
+}
+
+uint32_t RtinMeshBuilder::GridSize(uint32_t width, uint32_t height)
+{
+	uint32_t cells = 1;
+	while (cells + 1 < std::max(width, height))
+		cells *= 2;
+	return cells + 1;
+}
+
+void RtinMeshBuilder::BuildErrors(const uint8_t* depthData, uint32_t width, uint32_t height, RtinErrorPyramid& pyramid) const
+{
+	pyramid.width = width;
+	pyramid.height = height;
+	pyramid.gridSize = GridSize(width, height);
+	pyramid.errors.assign(static_cast<size_t>(pyramid.gridSize) * pyramid.gridSize, 0.0f);
+	pyramid.maxDepth = width > 0 && height > 0 ? *std::max_element(depthData, depthData + static_cast<size_t>(width) * height) : 0;
+
+	if (width < 2 || height < 2)
+		return;
+
+	ErrorContext context{ depthData, width, height, static_cast<int32_t>(pyramid.gridSize), pyramid.errors.data() };
+	int32_t cells = context.gridSize - 1;
+
+	for (int32_t s = 1; s < cells; s *= 2)
+	{
+		//axis level: rows on the odd multiples of s split vertically, the others horizontally
+		uint32_t axisRows = static_cast<uint32_t>(cells / s + 1);
+		ForLevelRows(_pool, axisRows, static_cast<size_t>(cells / (2 * s) + 1), [&](unsigned int, uint32_t rowBegin, uint32_t rowEnd)
+		{
+			for (uint32_t row = rowBegin; row < rowEnd; ++row)
+			{
+				int32_t y = static_cast<int32_t>(row) * s;
+				bool vertical = row % 2 == 1;
+				for (int32_t x = vertical ? 0 : s; x <= cells; x += 2 * s)
+				{
+					if (vertical)
+						context.Write(x, y, 0, s, s, 0, s > 1);
+					else
+						context.Write(x, y, s, 0, 0, s, s > 1);
+				}
+			}
+		});
+
+		//diagonal level: the diagonal of every 2s square runs through its corner on the odd multiples of 2s
+		uint32_t diagonalRows = static_cast<uint32_t>(cells / (2 * s));
+		ForLevelRows(_pool, diagonalRows, static_cast<size_t>(cells / (2 * s)), [&](unsigned int, uint32_t rowBegin, uint32_t rowEnd)
+		{
+			for (uint32_t row = rowBegin; row < rowEnd; ++row)
+			{
+				int32_t y = (2 * static_cast<int32_t>(row) + 1) * s;
+				int32_t uy = ((y + s) / (2 * s)) % 2 == 1 ? s : -s;
+				for (int32_t x = s; x < cells; x += 2 * s)
+				{
+					int32_t ux = ((x + s) / (2 * s)) % 2 == 1 ? s : -s;
+					context.Write(x, y, ux, uy, ux, -uy, true);
+				}
+			}
+		});
+	}
+}
+
+void RtinMeshBuilder::Extract(const uint8_t* depthData, const RtinErrorPyramid& pyramid, float maxError, HeightmapMesh& mesh) const
+{
+	mesh.width = pyramid.width;
+	mesh.height = pyramid.height;
+	mesh.maxDepth = pyramid.maxDepth;
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	if (pyramid.width < 2 || pyramid.height < 2)
+		return;
+
+	//an infinite threshold would keep the triangles that reach past the map
+	maxError = std::min(maxError, std::numeric_limits<float>::max());
+
+	std::vector<uint32_t> vertexIndex(static_cast<size_t>(pyramid.width) * pyramid.height, UINT32_MAX);
+	float depthDivisor = pyramid.maxDepth > 0 ? static_cast<float>(pyramid.maxDepth) : 1.0f;
+	ExtractContext context{ depthData, pyramid, maxError, _orientation, depthDivisor, vertexIndex, mesh };
+
+	uint32_t cells = pyramid.gridSize - 1;
+	context.Triangle(0, 0, cells, cells, cells, 0);
+	context.Triangle(cells, cells, 0, 0, 0, cells);
+}
+
+void RtinMeshBuilder::Build(const uint8_t* depthData, uint32_t width, uint32_t height, float maxError, HeightmapMesh& mesh) const
+{
+	RtinErrorPyramid pyramid;
+	BuildErrors(depthData, width, height, pyramid);
+	Extract(depthData, pyramid, maxError, mesh);
+}
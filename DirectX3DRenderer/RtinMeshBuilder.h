@@ -0,0 +1,47 @@
+#pragma once
+#include "HeightmapMeshBuilder.h"
+#include "ParallelFor.h"
+#include <cstdint>
+#include <vector>
+
+//per sample error of a right triangulated irregular network over the heightmap.
+//the map is embedded in a square grid of gridSize = 2^k + 1 samples, errors[y * gridSize + x] is the largest
+//vertical error (in 8-bit depth units) of not splitting the triangles whose hypotenuse midpoint is (x, y).
+//triangles reaching past the map are given an infinite error, so they are always split and then dropped.
+struct RtinErrorPyramid
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t gridSize = 0;
+	uint8_t maxDepth = 0;
+	std::vector<float> errors;
+};
+
+//error bounded alternative to the uniform grid of HeightmapMeshBuilder (martini style rtin):
+//flat regions are covered by a few large right triangles, detailed regions go down to two triangles per cell.
+//the mesh is crack free for every threshold, and a threshold of 0 only merges cells that are exactly planar.
+class RtinMeshBuilder
+{
+private:
+	HeightmapOrientation _orientation;
+	mutable RowBandPool _pool;
+
+public:
+	//threadCount of 0 uses every hardware thread
+	explicit RtinMeshBuilder(HeightmapOrientation orientation = HeightmapOrientation::HeightAlongY, unsigned int threadCount = 0);
+
+	//computes the error of every level, finest first. the samples of a level are processed in parallel,
+	//the few of a coarse level on the calling thread
+	void BuildErrors(const uint8_t* depthData, uint32_t width, uint32_t height, RtinErrorPyramid& pyramid) const;
+
+	//emits the coarsest mesh in which no skipped hypotenuse midpoint, at any level, is further than maxError depth
+	//units from the interpolation of its hypotenuse.
+	//vertices are normalized exactly like HeightmapMeshBuilder, mesh.indices is a triangle list
+	void Extract(const uint8_t* depthData, const RtinErrorPyramid& pyramid, float maxError, HeightmapMesh& mesh) const;
+
+	//BuildErrors and Extract in one go, use the two steps to extract several thresholds from one pyramid
+	void Build(const uint8_t* depthData, uint32_t width, uint32_t height, float maxError, HeightmapMesh& mesh) const;
+
+	//smallest 2^k + 1 that covers the map
+	static uint32_t GridSize(uint32_t width, uint32_t height);
+};
@@ -0,0 +1,335 @@
+#include "SequencePipeline.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+//a stage with nothing to do sleeps this long before it looks again, short against a frame and long enough
+//to leave the core to the other stages
+constexpr std::chrono::microseconds stageIdleSleep(200);
+
+std::string SequenceFramePath(const std::string& directory, const char* kind, uint32_t index)
+{
+	char name[64];
+	std::snprintf(name, sizeof(name), "%s_%04u.%s", kind, index, kind[0] == 'd' ? "pgm" : "ppm");
+	if (directory.empty())
+		return name;
+
+	char last = directory.back();
+	return directory + (last == '/' || last == '\\' ? "" : "/") + name;
+}
+
+std::string FormatSequenceStats(const SequenceStats& stats)
+{
+	std::string text;
+	char line[160];
+	const std::pair<const char*, const SequenceStageStats*> stages[] = {
+		{ "decode", &stats.decode }, { "mesh", &stats.mesh }, { "upload", &stats.upload }, { "latency", &stats.latency } };
+	for (const auto& stage : stages)
+	{
+		std::snprintf(line, sizeof(line), "%-8s %6llu frames, mean %8.3f ms, max %8.3f ms\n", stage.first,
+			static_cast<unsigned long long>(stage.second->frames), stage.second->meanMilliseconds, stage.second->maxMilliseconds);
+		text += line;
+	}
+	std::snprintf(line, sizeof(line), "%.2f s: %.1f frames/s uploaded, %.1f frames/s presented, %llu presented, %llu dropped\n",
+		stats.seconds, stats.uploadedPerSecond, stats.presentedPerSecond, static_cast<unsigned long long>(stats.presented),
+		static_cast<unsigned long long>(stats.dropped));
+	return text + line;
+}
+
+static bool FileExists(const std::string& path)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+	std::fclose(file);
+	return true;
+}
+
+void MemorySequenceUploader::Upload(uint32_t slot, const SequenceFrame& frame)
+{
+	Slot& target = _slots[slot];
+	target.frameIndex = frame.index;
+	const uint8_t* vertices = static_cast<const uint8_t*>(frame.mesh.VertexData());
+	const uint8_t* normals = static_cast<const uint8_t*>(frame.mesh.NormalData());
+	target.vertices.assign(vertices, vertices + frame.mesh.VertexBytes());
+	target.normals.assign(normals, normals + frame.mesh.NormalBytes());
+	target.color.assign(frame.colorRgba.begin(), frame.colorRgba.end());
+}
+
+const MemorySequenceUploader::Slot& MemorySequenceUploader::GetSlot(uint32_t slot) const
+{
+	return _slots[slot];
+}
+
+void SequencePipeline::StageCounter::Add(SequenceClock::duration elapsed)
+{
+	uint64_t nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	totalNanoseconds.store(totalNanoseconds.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+	if (nanoseconds > maxNanoseconds.load(std::memory_order_relaxed))
+		maxNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+	frames.store(frames.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+SequenceStageStats SequencePipeline::StageCounter::Read() const
+{
+	SequenceStageStats stats;
+	stats.frames = frames.load(std::memory_order_acquire);
+	if (stats.frames > 0)
+		stats.meanMilliseconds = totalNanoseconds.load(std::memory_order_relaxed) / 1e6 / stats.frames;
+	stats.maxMilliseconds = maxNanoseconds.load(std::memory_order_relaxed) / 1e6;
+	return stats;
+}
+
+SequencePipeline::SequencePipeline(const SequencePipelineOptions& options, SequenceUploader& uploader)
+	: _options(options),
+	_uploader(uploader),
+	_free(options.ringCapacity),
+	_decoded(options.ringCapacity),
+	_meshed(options.ringCapacity)
+{
+	//the pool is as large as a ring, so a ring can never be full while a frame waits to be pushed into it
+	for (uint32_t i = 0; i < options.ringCapacity; ++i)
+		_frames.push_back(std::make_unique<SequenceFrame>());
+}
+
+SequencePipeline::~SequencePipeline()
+{
+	Stop();
+}
+
+SequenceInfo SequencePipeline::Probe(const std::string& directory)
+{
+	SequenceInfo info;
+	NetpbmImage image;
+	ReadNetpbm(SequenceFramePath(directory, "depth", 0), image);
+	if (image.channels != 1)
+		throw std::runtime_error("SequencePipeline: depth frames must be single channel pgm files");
+	info.width = image.width;
+	info.height = image.height;
+
+	ReadNetpbm(SequenceFramePath(directory, "rgb", 0), image);
+	if (image.channels != 3)
+		throw std::runtime_error("SequencePipeline: color frames must be rgb ppm files");
+	info.colorWidth = image.width;
+	info.colorHeight = image.height;
+
+	while (FileExists(SequenceFramePath(directory, "depth", info.frameCount)))
+		++info.frameCount;
+	return info;
+}
+
+void SequencePipeline::Start(const std::string& directory)
+{
+	Stop();
+	_info = Probe(directory);
+	_directory = directory;
+
+	SequenceFrame* frame = nullptr;
+	while (_decoded.TryPop(frame) || _meshed.TryPop(frame) || _free.TryPop(frame))
+	{
+	}
+	for (const std::unique_ptr<SequenceFrame>& pooled : _frames)
+		_free.TryPush(pooled.get());
+	_slots.Reset();
+
+	for (StageCounter* counter : { &_decodeCounter, &_meshCounter, &_uploadCounter, &_latencyCounter })
+	{
+		counter->frames = 0;
+		counter->totalNanoseconds = 0;
+		counter->maxNanoseconds = 0;
+	}
+	_presented = 0;
+	_dropped = 0;
+	_error.clear();
+	_stop = false;
+	_decodeDone = false;
+	_meshDone = false;
+	_uploadDone = false;
+
+	_start = SequenceClock::now();
+	_decodeThread = std::thread(&SequencePipeline::Decode, this);
+	_meshThread = std::thread(&SequencePipeline::Mesh, this);
+	_uploadThread = std::thread(&SequencePipeline::Upload, this);
+}
+
+void SequencePipeline::Stop()
+{
+	_stop = true;
+	for (std::thread* thread : { &_decodeThread, &_meshThread, &_uploadThread })
+	{
+		if (thread->joinable())
+			thread->join();
+	}
+}
+
+const SequenceInfo& SequencePipeline::Info() const
+{
+	return _info;
+}
+
+bool SequencePipeline::Finished() const
+{
+	return _uploadDone.load(std::memory_order_acquire);
+}
+
+std::string SequencePipeline::Error() const
+{
+	return _decodeDone.load(std::memory_order_acquire) ? _error : std::string();
+}
+
+bool SequencePipeline::AcquireLatest(uint32_t& slot)
+{
+	if (!_slots.Acquire())
+		return false;
+
+	slot = _slots.FrontSlot();
+	_presented.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+SequenceStats SequencePipeline::Stats() const
+{
+	SequenceStats stats;
+	stats.decode = _decodeCounter.Read();
+	stats.mesh = _meshCounter.Read();
+	stats.upload = _uploadCounter.Read();
+	stats.latency = _latencyCounter.Read();
+	stats.presented = _presented.load(std::memory_order_relaxed);
+	stats.dropped = _dropped.load(std::memory_order_relaxed);
+	stats.seconds = std::chrono::duration<double>(SequenceClock::now() - _start).count();
+	if (stats.seconds > 0.0)
+	{
+		stats.uploadedPerSecond = stats.upload.frames / stats.seconds;
+		stats.presentedPerSecond = stats.presented / stats.seconds;
+	}
+	return stats;
+}
+
+void SequencePipeline::DecodeFrame(uint32_t index, SequenceFrame& frame) const
+{
+	frame.index = index;
+	ReadNetpbm(SequenceFramePath(_directory, "depth", index), frame.depth);
+	ReadNetpbm(SequenceFramePath(_directory, "rgb", index), frame.color);
+	if (frame.depth.channels != 1 || frame.depth.width != _info.width || frame.depth.height != _info.height
+		|| frame.color.channels != 3 || frame.color.width != _info.colorWidth || frame.color.height != _info.colorHeight)
+		throw std::runtime_error("SequencePipeline: frame " + std::to_string(index) + " differs in size or format from frame 0");
+
+	size_t pixelCount = static_cast<size_t>(frame.color.width) * frame.color.height;
+	frame.colorRgba.resize(pixelCount * 4);
+	const uint8_t* rgb = frame.color.pixels.data();
+	uint8_t* rgba = frame.colorRgba.data();
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		rgba[i * 4] = rgb[i * 3];
+		rgba[i * 4 + 1] = rgb[i * 3 + 1];
+		rgba[i * 4 + 2] = rgb[i * 3 + 2];
+		rgba[i * 4 + 3] = 255;
+	}
+}
+
+void SequencePipeline::Decode()
+{
+	uint32_t index = 0;
+	uint64_t decodedCount = 0;
+	while (!_stop.load(std::memory_order_relaxed))
+	{
+		if (index == _info.frameCount)
+		{
+			if (!_options.loop)
+				break;
+			index = 0;
+		}
+
+		//back-pressure: every frame of the pool is somewhere further down the pipeline
+		SequenceFrame* frame = nullptr;
+		if (!_free.TryPop(frame))
+		{
+			std::this_thread::sleep_for(stageIdleSleep);
+			continue;
+		}
+
+		if (_options.framesPerSecond > 0.0f)
+		{
+			auto due = _start + std::chrono::duration_cast<SequenceClock::duration>(
+				std::chrono::duration<double>(decodedCount / static_cast<double>(_options.framesPerSecond)));
+			std::this_thread::sleep_until(due);
+		}
+
+		frame->decodeStart = SequenceClock::now();
+		try
+		{
+			DecodeFrame(index, *frame);
+		}
+		catch (const std::exception& exception)
+		{
+			_error = exception.what();
+			_free.TryPush(frame);
+			break;
+		}
+		_decodeCounter.Add(SequenceClock::now() - frame->decodeStart);
+
+		//the pool is no larger than the ring, so there is always room
+		_decoded.TryPush(frame);
+		++index;
+		++decodedCount;
+	}
+	_decodeDone.store(true, std::memory_order_release);
+}
+
+void SequencePipeline::Mesh()
+{
+	HeightmapMeshBuilder builder(_options.orientation, _options.meshThreads);
+	DepthFilter filter(_options.meshThreads);
+	std::vector<uint8_t> filtered;
+	while (!_stop.load(std::memory_order_relaxed))
+	{
+		SequenceFrame* frame = nullptr;
+		if (!_decoded.TryPop(frame))
+		{
+			//decode publishes its last frame before it sets the flag, so an empty ring after the flag is final
+			if (_decodeDone.load(std::memory_order_acquire) && _decoded.Size() == 0)
+				break;
+			std::this_thread::sleep_for(stageIdleSleep);
+			continue;
+		}
+
+		SequenceClock::time_point meshStart = SequenceClock::now();
+		if (_options.filter.kind != DepthFilterKind::None)
+		{
+			//trades buffers with the frame, both are the size of a depth frame once every frame of the pool went through
+			filter.Apply(frame->depth.pixels.data(), frame->depth.width, frame->depth.height, _options.filter, filtered);
+			frame->depth.pixels.swap(filtered);
+		}
+		builder.BuildTiled(frame->depth.pixels.data(), frame->depth.width, frame->depth.height, _options.mesh, frame->mesh);
+		_meshCounter.Add(SequenceClock::now() - meshStart);
+		_meshed.TryPush(frame);
+	}
+	_meshDone.store(true, std::memory_order_release);
+}
+
+void SequencePipeline::Upload()
+{
+	while (!_stop.load(std::memory_order_relaxed))
+	{
+		SequenceFrame* frame = nullptr;
+		if (!_meshed.TryPop(frame))
+		{
+			if (_meshDone.load(std::memory_order_acquire) && _meshed.Size() == 0)
+				break;
+			std::this_thread::sleep_for(stageIdleSleep);
+			continue;
+		}
+
+		SequenceClock::time_point uploadStart = SequenceClock::now();
+		_uploader.Upload(_slots.BackSlot(), *frame);
+		SequenceClock::time_point uploadEnd = SequenceClock::now();
+		_uploadCounter.Add(uploadEnd - uploadStart);
+		_latencyCounter.Add(uploadEnd - frame->decodeStart);
+		if (_slots.Publish())
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+
+		_free.TryPush(frame);
+	}
+	_uploadDone.store(true, std::memory_order_release);
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include "DepthFilter.h"
+#include "HeightmapMeshBuilder.h"
+#include "NetpbmImage.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//playback of a captured rgb-d sequence in three stages on their own threads: decode reads the frame files, mesh
+//builds the tiled mesh, upload copies it into one of three gpu slots that Render takes the newest of. the stages
+//pass frames through bounded SpscRings and recycle them through a free ring, so nothing is allocated once every
+//frame of the pool has been used. a full ring makes the stage before it wait, a frame uploaded twice before Render
+//came back drops the older one, and Render itself never waits.
+//
+//a sequence is a directory of depth_0000.pgm, rgb_0000.ppm, depth_0001.pgm, ... numbered from 0 without gaps,
+//the depth frames 8-bit P5 and the color frames P6, all depth frames of one size and all color frames of one size
+
+using SequenceClock = std::chrono::steady_clock;
+
+struct SequenceFrame
+{
+	uint32_t index = 0;					//frame number in the sequence
+	NetpbmImage depth;
+	NetpbmImage color;
+	std::vector<uint8_t> colorRgba;		//color expanded to 4 bytes per pixel, the layout of DXGI_FORMAT_R8G8B8A8_UNORM
+	TiledHeightmapMesh mesh;
+	SequenceClock::time_point decodeStart;
+};
+
+struct SequenceInfo
+{
+	uint32_t frameCount = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t colorWidth = 0;
+	uint32_t colorHeight = 0;
+};
+
+//receives the built frames on the upload thread. the slot is one of three, never the one Render holds
+class SequenceUploader
+{
+public:
+	virtual ~SequenceUploader() = default;
+	virtual void Upload(uint32_t slot, const SequenceFrame& frame) = 0;
+};
+
+//headless uploader: copies the vertex, normal and color bytes into three slots of system memory, the way a gpu
+//upload would read them
+class MemorySequenceUploader : public SequenceUploader
+{
+public:
+	struct Slot
+	{
+		uint32_t frameIndex = 0;
+		std::vector<uint8_t> vertices;
+		std::vector<uint8_t> normals;
+		std::vector<uint8_t> color;
+	};
+
+	void Upload(uint32_t slot, const SequenceFrame& frame) override;
+	const Slot& GetSlot(uint32_t slot) const;
+
+private:
+	Slot _slots[3];
+};
+
+struct SequencePipelineOptions
+{
+	TiledMeshOptions mesh;
+	HeightmapOrientation orientation = HeightmapOrientation::HeightAlongY;
+	uint32_t ringCapacity = 4;		//frames in flight between decode and upload, a power of two
+	float framesPerSecond = 0.0f;	//decode paces the sequence to this rate, 0 runs every stage as fast as it can
+	bool loop = false;				//start over after the last frame instead of finishing
+	unsigned int meshThreads = 0;	//threads of the mesh builder and the filter, 0 uses every hardware thread
+	DepthFilterOptions filter;		//applied to each depth frame in the mesh stage, before it is built
+};
+
+struct SequenceStageStats
+{
+	uint64_t frames = 0;
+	double meanMilliseconds = 0.0;
+	double maxMilliseconds = 0.0;
+};
+
+struct SequenceStats
+{
+	SequenceStageStats decode;
+	SequenceStageStats mesh;
+	SequenceStageStats upload;
+	SequenceStageStats latency;		//start of the decode to the end of the upload, with the time spent waiting in the rings
+	uint64_t presented = 0;			//slots Render took
+	uint64_t dropped = 0;			//uploaded slots replaced before Render took them
+	double seconds = 0.0;			//since Start
+	double uploadedPerSecond = 0.0;
+	double presentedPerSecond = 0.0;
+};
+
+//path of one frame file of a sequence, kind is "depth" or "rgb"
+std::string SequenceFramePath(const std::string& directory, const char* kind, uint32_t index);
+
+//one line per stage and one for the rates, for the log
+std::string FormatSequenceStats(const SequenceStats& stats);
+
+class SequencePipeline
+{
+private:
+	//written by one stage thread, read by any
+	struct StageCounter
+	{
+		std::atomic<uint64_t> frames{ 0 };
+		std::atomic<uint64_t> totalNanoseconds{ 0 };
+		std::atomic<uint64_t> maxNanoseconds{ 0 };
+
+		void Add(SequenceClock::duration elapsed);
+		SequenceStageStats Read() const;
+	};
+
+	SequencePipelineOptions _options;
+	SequenceUploader& _uploader;
+	std::string _directory;
+	SequenceInfo _info;
+
+	std::vector<std::unique_ptr<SequenceFrame>> _frames;
+	SpscRing<SequenceFrame*> _free;		//upload to decode
+	SpscRing<SequenceFrame*> _decoded;	//decode to mesh
+	SpscRing<SequenceFrame*> _meshed;	//mesh to upload
+	TripleBufferSlots _slots;
+
+	std::string _error;				//written by the decode thread before it sets _decodeDone
+	std::atomic<bool> _stop{ false };
+	std::atomic<bool> _decodeDone{ false };
+	std::atomic<bool> _meshDone{ false };
+	std::atomic<bool> _uploadDone{ false };
+	std::thread _decodeThread;
+	std::thread _meshThread;
+	std::thread _uploadThread;
+
+	SequenceClock::time_point _start;
+	StageCounter _decodeCounter;
+	StageCounter _meshCounter;
+	StageCounter _uploadCounter;
+	StageCounter _latencyCounter;
+	std::atomic<uint64_t> _presented{ 0 };
+	std::atomic<uint64_t> _dropped{ 0 };
+
+	void Decode();
+	void Mesh();
+	void Upload();
+	void DecodeFrame(uint32_t index, SequenceFrame& frame) const;
+
+public:
+	SequencePipeline(const SequencePipelineOptions& options, SequenceUploader& uploader);
+	~SequencePipeline();
+
+	SequencePipeline(const SequencePipeline&) = delete;
+	SequencePipeline& operator=(const SequencePipeline&) = delete;
+
+	//counts the frames of directory and reads the size of the first one.
+	//throws std::runtime_error when there is no frame 0 or it cannot be read
+	static SequenceInfo Probe(const std::string& directory);
+
+	//probes directory and starts the stage threads, a running playback is stopped first
+	void Start(const std::string& directory);
+	//stops the threads, frames in flight are discarded
+	void Stop();
+
+	const SequenceInfo& Info() const;
+	//true once every frame went through the upload stage, never for a looping sequence
+	bool Finished() const;
+	//why decoding stopped early, empty while decoding runs or when it went through
+	std::string Error() const;
+
+	//called by the render thread, never waits: takes the newest uploaded slot when there is one Render has not seen,
+	//and returns false when nothing was uploaded since the last call
+	bool AcquireLatest(uint32_t& slot);
+
+	SequenceStats Stats() const;
+};
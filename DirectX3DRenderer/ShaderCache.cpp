@@ -0,0 +1,272 @@
+#include "ShaderCache.h"
+#include "MeshCache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+static const char shaderCacheMagic[4] = { 'H', 'M', 'S', 'C' };
+constexpr uint32_t shaderCacheVersion = 1;
+constexpr uint32_t maxShaderIncludeDepth = 32;
+
+struct ShaderCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint64_t bytes;
+	uint64_t hash;
+};
+
+static bool ReadTextFile(const std::filesystem::path& path, std::string& text)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	text = stream.str();
+	return true;
+}
+
+//name of an #include line, false for every other line
+static bool ParseInclude(const std::string& line, std::string& name)
+{
+	size_t i = line.find_first_not_of(" \t");
+	if (i == std::string::npos || line[i] != '#')
+		return false;
+	i = line.find_first_not_of(" \t", i + 1);
+	if (i == std::string::npos || line.compare(i, 7, "include") != 0)
+		return false;
+	i = line.find_first_not_of(" \t", i + 7);
+	if (i == std::string::npos || (line[i] != '"' && line[i] != '<'))
+		return false;
+
+	size_t end = line.find(line[i] == '"' ? '"' : '>', i + 1);
+	if (end == std::string::npos)
+		return false;
+	name = line.substr(i + 1, end - i - 1);
+	return true;
+}
+
+//hashes the source and, depth first, every file it includes. a file included twice is hashed once, like #pragma once
+static bool HashSource(const std::filesystem::path& path, uint32_t depth, std::set<std::filesystem::path>& visited, uint64_t& hash)
+{
+	std::string source;
+	if (depth > maxShaderIncludeDepth || !ReadTextFile(path, source))
+		return false;
+	if (!visited.insert(std::filesystem::absolute(path).lexically_normal()).second)
+		return true;
+
+	hash = HashBytes(source.data(), source.size(), hash);
+	std::istringstream lines(source);
+	std::string line;
+	std::string name;
+	while (std::getline(lines, line))
+	{
+		if (!ParseInclude(line, name))
+			continue;
+		hash = HashBytes(name.data(), name.size(), hash);
+		if (!HashSource(path.parent_path() / name, depth + 1, visited, hash))
+			return false;
+	}
+	return true;
+}
+
+ShaderCache::ShaderCache(ShaderCompiler& compiler, std::string directory, const EmbeddedShader* embedded, size_t embeddedCount)
+	: _compiler(compiler), _directory(std::move(directory)), _embedded(embedded), _embeddedCount(embedded != nullptr ? embeddedCount : 0)
+{
+}
+
+bool ShaderCache::Key(const ShaderCompileRequest& request, uint64_t& key) const
+{
+	uint64_t parameters[2] = { _compiler.Version(), request.flags };
+	uint64_t hash = HashBytes(parameters, sizeof(parameters));
+	//the terminating zeros keep "ab" + "c" apart from "a" + "bc"
+	hash = HashBytes(request.entryPoint.c_str(), request.entryPoint.size() + 1, hash);
+	hash = HashBytes(request.profile.c_str(), request.profile.size() + 1, hash);
+
+	std::set<std::filesystem::path> visited;
+	if (!HashSource(request.path, 0, visited, hash))
+		return false;
+	key = hash;
+	return true;
+}
+
+std::string ShaderCache::EntryPath(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.shadercache", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(_directory) / name).string();
+}
+
+const EmbeddedShader* ShaderCache::FindEmbedded(const ShaderCompileRequest& request, bool keyKnown, uint64_t key) const
+{
+	for (size_t i = 0; i < _embeddedCount; ++i)
+	{
+		const EmbeddedShader& shader = _embedded[i];
+		bool sameRequest = request.path == shader.path && request.entryPoint == shader.entryPoint && request.profile == shader.profile
+			&& request.flags == shader.flags;
+		if (keyKnown ? shader.key == key : sameRequest)
+			return &shader;
+	}
+	return nullptr;
+}
+
+bool ShaderCache::ReadEntry(uint64_t key, ShaderBytecode& bytecode) const
+{
+	if (_directory.empty())
+		return false;
+
+	std::string path = EntryPath(key);
+	std::unique_ptr<FILE, int(*)(FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+	if (!file)
+		return false;
+
+	ShaderCacheHeader header = {};
+	bool valid = std::fread(&header, sizeof(header), 1, file.get()) == 1
+		&& std::memcmp(header.magic, shaderCacheMagic, sizeof(shaderCacheMagic)) == 0 && header.version == shaderCacheVersion
+		&& header.key == key && header.bytes > 0 && header.bytes <= (64u << 20);
+	if (valid)
+	{
+		bytecode.resize(static_cast<size_t>(header.bytes));
+		valid = std::fread(bytecode.data(), 1, bytecode.size(), file.get()) == bytecode.size()
+			&& std::fgetc(file.get()) == EOF && HashBytes(bytecode.data(), bytecode.size()) == header.hash;
+	}
+	if (!valid)
+		std::cerr << "Ignoring shader cache entry " << path << ", it is truncated or in another format" << std::endl;
+	return valid;
+}
+
+void ShaderCache::WriteEntry(uint64_t key, const ShaderBytecode& bytecode) const
+{
+	if (_directory.empty())
+		return;
+
+	ShaderCacheHeader header = {};
+	std::memcpy(header.magic, shaderCacheMagic, sizeof(shaderCacheMagic));
+	header.version = shaderCacheVersion;
+	header.key = key;
+	header.bytes = bytecode.size();
+	header.hash = HashBytes(bytecode.data(), bytecode.size());
+
+	//written next to the entry and renamed over it, like MeshCacheWriter::Write
+	std::string path = EntryPath(key);
+	std::string temporaryPath = path + ".tmp";
+	std::error_code error;
+	std::filesystem::create_directories(_directory, error);
+	bool written = false;
+	{
+		std::unique_ptr<FILE, int(*)(FILE*)> file(std::fopen(temporaryPath.c_str(), "wb"), &std::fclose);
+		written = file && std::fwrite(&header, sizeof(header), 1, file.get()) == 1
+			&& std::fwrite(bytecode.data(), 1, bytecode.size(), file.get()) == bytecode.size() && std::fflush(file.get()) == 0;
+	}
+	if (written)
+		std::filesystem::rename(temporaryPath, path, error);
+	if (!written || error)
+	{
+		std::remove(temporaryPath.c_str());
+		std::cerr << "Not caching the shader: cannot write " << path << std::endl;
+	}
+}
+
+bool ShaderCache::Load(const ShaderCompileRequest& request, ShaderBytecode& bytecode, std::string& error)
+{
+	uint64_t key = 0;
+	bool keyKnown = Key(request, key);
+	//the include handler of the compiler may find what HashSource cannot, so a readable source is still compiled. the
+	//request alone would pick embedded bytecode that is older than the source, it is left for builds without one
+	bool uncacheable = !keyKnown && std::ifstream(request.path, std::ios::binary).good();
+	const EmbeddedShader* embedded = uncacheable ? nullptr : FindEmbedded(request, keyKnown, key);
+	if (embedded != nullptr)
+	{
+		bytecode.assign(embedded->bytecode, embedded->bytecode + embedded->bytes);
+		++_stats.embedded;
+	}
+	else if (!keyKnown && !uncacheable)
+	{
+		error = "cannot read " + request.path;
+		++_stats.failed;
+		return false;
+	}
+	else if (keyKnown && ReadEntry(key, bytecode))
+		++_stats.disk;
+	else if (_compiler.Compile(request, bytecode, error))
+	{
+		++_stats.compiled;
+		if (keyKnown)
+			WriteEntry(key, bytecode);
+		else
+			++_stats.uncached;
+	}
+	else
+	{
+		++_stats.failed;
+		return false;
+	}
+
+	_loaded.push_back(LoadedShader{ request, embedded != nullptr ? embedded->key : key, bytecode });
+	return true;
+}
+
+//a c string literal of text
+static std::string QuoteString(const std::string& text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '\\' || c == '"')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+void ShaderCache::WriteEmbeddedHeader(const std::string& path) const
+{
+	//a c++ array cannot be empty
+	if (_loaded.empty())
+		throw std::runtime_error("ShaderCache: no shader was loaded, there is nothing to embed");
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("ShaderCache: cannot create " + path);
+
+	file << "//written by ShaderCache::WriteEmbeddedHeader, regenerate it instead of editing it\n"
+		"#pragma once\n#include \"ShaderCache.h\"\n\n";
+	char byte[8];
+	for (size_t s = 0; s < _loaded.size(); ++s)
+	{
+		file << "static const uint8_t embeddedShader" << s << "[] = {";
+		for (size_t i = 0; i < _loaded[s].bytecode.size(); ++i)
+		{
+			std::snprintf(byte, sizeof(byte), "0x%02x,", _loaded[s].bytecode[i]);
+			file << (i % 24 == 0 ? "\n\t" : " ") << byte;
+		}
+		file << "\n};\n\n";
+	}
+
+	char key[32];
+	file << "static const EmbeddedShader embeddedShaders[] = {\n";
+	for (size_t s = 0; s < _loaded.size(); ++s)
+	{
+		const ShaderCompileRequest& request = _loaded[s].request;
+		std::snprintf(key, sizeof(key), "0x%016llxull", static_cast<unsigned long long>(_loaded[s].key));
+		file << "\t{ " << QuoteString(request.path) << ", " << QuoteString(request.entryPoint) << ", " << QuoteString(request.profile)
+			<< ", " << request.flags << "u, " << key << ", embeddedShader" << s << ", sizeof(embeddedShader" << s << ") },\n";
+	}
+	file << "};\n";
+	if (!file.flush())
+		throw std::runtime_error("ShaderCache: cannot write " + path);
+}
+
+const ShaderCacheStats& ShaderCache::Stats() const
+{
+	return _stats;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//compiled shader bytecode kept under a hash of everything the compiler reads: the source file, the files it includes,
+//the entry point, the profile, the flags and the version of the compiler. Load looks for the bytecode in a table
+//embedded at build time, then in a directory of entries, and only compiles on a miss. an entry on disk is
+//	offset  0  char[4]  "HMSC"
+//	offset  4  uint32   version, 1
+//	offset  8  uint64   key
+//	offset 16  uint64   bytecode size
+//	offset 24  uint64   HashBytes of the bytecode
+//followed by the bytecode, all fields little endian
+
+using ShaderBytecode = std::vector<uint8_t>;
+
+struct ShaderCompileRequest
+{
+	std::string path;	//source file, quoted includes are looked up next to the file that includes them
+	std::string entryPoint;
+	std::string profile;	//such as vs_5_0
+	uint32_t flags = 0;		//D3DCOMPILE_ flags
+};
+
+//compiles one request, behind an interface so the cache does not depend on d3dcompiler
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() = default;
+	//changes whenever the same request could compile to other bytecode
+	virtual uint64_t Version() const = 0;
+	//false when the source does not compile, error holds the messages of the compiler then
+	virtual bool Compile(const ShaderCompileRequest& request, ShaderBytecode& bytecode, std::string& error) = 0;
+};
+
+//bytecode compiled into the executable, see ShaderCache::WriteEmbeddedHeader
+struct EmbeddedShader
+{
+	const char* path;
+	const char* entryPoint;
+	const char* profile;
+	uint32_t flags;
+	uint64_t key;	//of the source it was compiled from
+	const uint8_t* bytecode;
+	size_t bytes;
+};
+
+struct ShaderCacheStats
+{
+	uint32_t embedded = 0;	//taken from the embedded table
+	uint32_t disk = 0;		//read from an entry
+	uint32_t compiled = 0;	//missed and compiled
+	uint32_t uncached = 0;	//of compiled, an include the key could not follow kept them out of the entries
+	uint32_t failed = 0;	//did not compile, or had neither a source nor embedded bytecode
+};
+
+class ShaderCache
+{
+public:
+	//an empty directory disables the entries on disk, the embedded table is still used
+	ShaderCache(ShaderCompiler& compiler, std::string directory, const EmbeddedShader* embedded = nullptr, size_t embeddedCount = 0);
+
+	//false when the source or an include cannot be read, the key is only known from the files
+	bool Key(const ShaderCompileRequest& request, uint64_t& key) const;
+	std::string EntryPath(uint64_t key) const;
+
+	//embedded bytecode compiled from the same source comes first, then the entry of the key, then the compiler, whose
+	//result is stored for the next run. without the source file an embedded shader of the same path, entry point,
+	//profile and flags is taken as it is. a source whose key is unknown only because of an include, such as one in <>
+	//or inside #if 0, is compiled every time without an entry. false when nothing worked, error says why
+	bool Load(const ShaderCompileRequest& request, ShaderBytecode& bytecode, std::string& error);
+
+	//writes a header defining embeddedShaders[] with every shader Load returned so far. a build that includes it
+	//starts without compiling or reading a single entry. throws std::runtime_error when the file cannot be written
+	void WriteEmbeddedHeader(const std::string& path) const;
+
+	const ShaderCacheStats& Stats() const;
+
+private:
+	struct LoadedShader
+	{
+		ShaderCompileRequest request;
+		uint64_t key;
+		ShaderBytecode bytecode;
+	};
+
+	ShaderCompiler& _compiler;
+	std::string _directory;
+	const EmbeddedShader* _embedded;
+	size_t _embeddedCount;
+	std::vector<LoadedShader> _loaded;
+	ShaderCacheStats _stats;
+
+	const EmbeddedShader* FindEmbedded(const ShaderCompileRequest& request, bool keyKnown, uint64_t key) const;
+	bool ReadEntry(uint64_t key, ShaderBytecode& bytecode) const;
+	void WriteEntry(uint64_t key, const ShaderBytecode& bytecode) const;
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+//bounded queue between exactly one producer thread and one consumer thread, without locks. each side owns one
+//index and only reads the other's, the two indices live on their own cache lines so the threads do not share one
+constexpr size_t cacheLineBytes = 64;
+
+template <typename T>
+class SpscRing
+{
+private:
+	std::vector<T> _items;
+	size_t _mask;
+	alignas(cacheLineBytes) std::atomic<size_t> _head{ 0 };	//next slot to pop, written by the consumer
+	alignas(cacheLineBytes) std::atomic<size_t> _tail{ 0 };	//next slot to push, written by the producer
+
+public:
+	//capacity must be a power of two
+	explicit SpscRing(size_t capacity)
+		: _items(capacity), _mask(capacity - 1)
+	{
+		if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+			throw std::invalid_argument("SpscRing: capacity must be a power of two");
+	}
+
+	size_t Capacity() const
+	{
+		return _items.size();
+	}
+
+	//producer only, false when the ring is full
+	bool TryPush(const T& item)
+	{
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _head.load(std::memory_order_acquire) == _items.size())
+			return false;
+
+		_items[tail & _mask] = item;
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//consumer only, false when the ring is empty
+	bool TryPop(T& item)
+	{
+		size_t head = _head.load(std::memory_order_relaxed);
+		if (head == _tail.load(std::memory_order_acquire))
+			return false;
+
+		item = _items[head & _mask];
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	//either side, a snapshot that may be stale by the time it is used
+	size_t Size() const
+	{
+		return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+	}
+};
+
+//three slots shared by one writer and one reader: the writer fills its back slot and publishes it as the newest,
+//the reader takes the newest whenever it wants. neither side ever waits for the other, a slot published twice
+//before the reader came back replaces the older one, which is dropped
+class TripleBufferSlots
+{
+private:
+	static constexpr uint32_t freshBit = 4;
+
+	alignas(cacheLineBytes) std::atomic<uint32_t> _middle{ 1 };	//published slot, with freshBit while the reader has not taken it
+	alignas(cacheLineBytes) uint32_t _back = 0;					//writer only
+	alignas(cacheLineBytes) uint32_t _front = 2;				//reader only
+
+public:
+	//back to the initial slots, only while neither side uses them
+	void Reset()
+	{
+		_middle.store(1, std::memory_order_relaxed);
+		_back = 0;
+		_front = 2;
+	}
+
+	//slot the writer may fill
+	uint32_t BackSlot() const
+	{
+		return _back;
+	}
+
+	//makes the back slot the newest and hands the writer another one. true when this replaced a slot the reader never took
+	bool Publish()
+	{
+		uint32_t old = _middle.exchange(_back | freshBit, std::memory_order_acq_rel);
+		_back = old & 3;
+		return (old & freshBit) != 0;
+	}
+
+	//slot the reader holds, stays valid until the next successful Acquire
+	uint32_t FrontSlot() const
+	{
+		return _front;
+	}
+
+	//takes the newest published slot, false when nothing was published since the last call
+	bool Acquire()
+	{
+		if ((_middle.load(std::memory_order_relaxed) & freshBit) == 0)
+			return false;
+
+		_front = _middle.exchange(_front, std::memory_order_acq_rel) & 3;
+		return true;
+	}
+};
@@ -0,0 +1,245 @@
+#include "VertexCache.h"
+#include <algorithm>
+#include <cmath>
+
+//fifo caches are simulated with insertion stamps: an entry is still cached while fewer than size entries have
+//been inserted after it, which makes every lookup O(1) whatever the cache size
+struct FifoCache
+{
+	std::vector<size_t> stamps;
+	size_t inserted = 0;
+	size_t size;
+
+	FifoCache(size_t entryCount, size_t cacheSize)
+		: stamps(entryCount, SIZE_MAX), size(cacheSize)
+	{
+	}
+
+	//true on a miss, which inserts the entry
+	bool Miss(size_t entry)
+	{
+		if (stamps[entry] != SIZE_MAX && inserted - stamps[entry] < size)
+			return false;
+		stamps[entry] = ++inserted;
+		return true;
+	}
+};
+
+template <typename TIndex>
+static VertexCacheStats Simulate(const TIndex* indices, size_t indexCount, bool strip, size_t vertexStride, uint32_t cacheSize)
+{
+	constexpr size_t lineBytes = 64;
+	constexpr size_t fetchCacheLines = 4096 / lineBytes;
+
+	VertexCacheStats stats;
+	size_t vertexCount = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		if (!strip || indices[i] != stripRestartIndex)
+			vertexCount = std::max(vertexCount, static_cast<size_t>(indices[i]) + 1);
+	}
+
+	FifoCache transformCache(vertexCount, cacheSize);
+	FifoCache fetchCache((vertexCount * vertexStride + lineBytes - 1) / lineBytes, fetchCacheLines);
+	std::vector<bool> referenced(vertexCount, false);
+	size_t fetchedLines = 0;
+	size_t run = 0;
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		if (strip && indices[i] == stripRestartIndex)
+		{
+			run = 0;
+			continue;
+		}
+
+		size_t vertex = indices[i];
+		if (!referenced[vertex])
+		{
+			referenced[vertex] = true;
+			++stats.uniqueVertices;
+		}
+
+		if (transformCache.Miss(vertex))
+		{
+			++stats.transformedVertices;
+			size_t firstLine = vertex * vertexStride / lineBytes;
+			size_t lastLine = ((vertex + 1) * vertexStride - 1) / lineBytes;
+			for (size_t line = firstLine; line <= lastLine; ++line)
+				fetchedLines += fetchCache.Miss(line) ? 1 : 0;
+		}
+
+		if (strip)
+			stats.triangles += ++run >= 3 ? 1 : 0;
+	}
+
+	if (!strip)
+		stats.triangles = indexCount / 3;
+	if (stats.triangles > 0)
+		stats.acmr = static_cast<double>(stats.transformedVertices) / stats.triangles;
+	if (stats.uniqueVertices > 0)
+	{
+		stats.atvr = static_cast<double>(stats.transformedVertices) / stats.uniqueVertices;
+		stats.overfetch = static_cast<double>(fetchedLines * lineBytes) / (stats.uniqueVertices * vertexStride);
+	}
+	return stats;
+}
+
+VertexCacheStats SimulateVertexCache(const uint16_t* indices, size_t indexCount, GridTopology topology, size_t vertexStride,
+	uint32_t cacheSize)
+{
+	return Simulate(indices, indexCount, topology == GridTopology::TriangleStrip, vertexStride, cacheSize);
+}
+
+VertexCacheStats SimulateVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexStride, uint32_t cacheSize)
+{
+	return Simulate(indices, indexCount, false, vertexStride, cacheSize);
+}
+
+#pragma region Forsyth
+//greedy: always emit the triangle with the best score, the score of a triangle is the sum of its vertex scores.
+//vertices score high when they are near the front of the cache, and when few triangles are left to use them,
+//so lone triangles are finished before the cache moves on
+static float ForsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles, uint32_t cacheSize)
+{
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		//the last triangle's vertices get a fixed score, so the next one does not simply repeat its edge
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / static_cast<float>(cacheSize - 3), 1.5f);
+	}
+	return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || cacheSize <= 3)
+		return;
+
+	//triangles of every vertex, the ones not emitted yet are kept at the front of each slice
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+		++remaining[indices[i]];
+
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+	std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+	std::vector<uint32_t> filled(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			uint32_t v = indices[t * 3 + corner];
+			vertexTriangles[firstTriangle[v] + filled[v]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = ForsythVertexScore(-1, remaining[v], cacheSize);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; ++t)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(cacheSize + 3);
+	nextCache.reserve(cacheSize + 3);
+
+	size_t bestTriangle = SIZE_MAX;
+	size_t scanStart = 0;
+	for (size_t step = 0; step < triangleCount; ++step)
+	{
+		//nothing left around the cache, go on with the first triangle not emitted yet. searching all of them for
+		//the best score would make the pass quadratic for the price of a few misses
+		if (bestTriangle == SIZE_MAX)
+		{
+			while (emitted[scanStart])
+				++scanStart;
+			bestTriangle = scanStart;
+		}
+
+		const uint32_t* corners = indices + bestTriangle * 3;
+		output.insert(output.end(), corners, corners + 3);
+		emitted[bestTriangle] = true;
+
+		nextCache.assign(corners, corners + 3);
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			uint32_t v = corners[corner];
+			uint32_t* begin = vertexTriangles.data() + firstTriangle[v];
+			uint32_t* end = begin + remaining[v];
+			std::iter_swap(std::find(begin, end, static_cast<uint32_t>(bestTriangle)), end - 1);
+			--remaining[v];
+		}
+		for (uint32_t v : cache)
+		{
+			if (v != corners[0] && v != corners[1] && v != corners[2])
+				nextCache.push_back(v);
+		}
+
+		//the entries past cacheSize fall out, they are rescored once with no cache position
+		for (size_t i = 0; i < nextCache.size(); ++i)
+		{
+			uint32_t v = nextCache[i];
+			cachePosition[v] = i < cacheSize ? static_cast<int32_t>(i) : -1;
+			vertexScore[v] = ForsythVertexScore(cachePosition[v], remaining[v], cacheSize);
+		}
+
+		bestTriangle = SIZE_MAX;
+		float bestScore = -1.0f;
+		for (uint32_t v : nextCache)
+		{
+			for (uint32_t i = 0; i < remaining[v]; ++i)
+			{
+				uint32_t t = vertexTriangles[firstTriangle[v] + i];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (nextCache.size() > cacheSize)
+			nextCache.resize(cacheSize);
+		cache.swap(nextCache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+#pragma endregion
+
+void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<HeightmapVertex>& vertices)
+{
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<HeightmapVertex> ordered;
+	ordered.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = static_cast<uint32_t>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(ordered);
+}
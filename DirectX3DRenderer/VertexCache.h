@@ -0,0 +1,38 @@
+#pragma once
+#include "GridIndexTable.h"
+#include "HeightmapVertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//post-transform cache tools: a simulator that scores an index order without a gpu, a triangle reordering for
+//irregular meshes and the matching vertex reordering. regular grids get their cache friendly order from
+//GridTopology::TriangleListBands instead.
+
+//fifo size the simulator defaults to, the smallest cache still found on current gpus
+constexpr uint32_t defaultVertexCacheSize = 16;
+
+struct VertexCacheStats
+{
+	size_t triangles = 0;
+	size_t transformedVertices = 0;	//cache misses, every one runs the vertex shader
+	size_t uniqueVertices = 0;
+	double acmr = 0.0;				//transformed vertices per triangle, 3 without any reuse, 0.5 is the limit of a grid
+	double atvr = 0.0;				//transformed vertices per referenced vertex, 1 is ideal
+	double overfetch = 0.0;			//vertex buffer bytes read per referenced vertex byte, 1 is ideal
+};
+
+//runs the indices through a fifo post-transform cache of cacheSize entries and a 4 KB cache of 64-byte lines in
+//front of the vertex buffer. topology only tells how triangles are counted, strips skip stripRestartIndex
+VertexCacheStats SimulateVertexCache(const uint16_t* indices, size_t indexCount, GridTopology topology, size_t vertexStride,
+	uint32_t cacheSize = defaultVertexCacheSize);
+VertexCacheStats SimulateVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexStride,
+	uint32_t cacheSize = defaultVertexCacheSize);
+
+//reorders the triangles of a triangle list for the post-transform cache (forsyth's linear speed optimizer),
+//the triangles and their winding are kept
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 32);
+
+//renumbers the vertices in the order the indices first use them, so the vertex fetch walks the buffer forwards,
+//and drops the vertices no triangle uses
+void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<HeightmapVertex>& vertices);
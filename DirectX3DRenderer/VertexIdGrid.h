@@ -0,0 +1,52 @@
+#pragma once
+#include "HeightmapVertex.h"
+#include <cstddef>
+#include <cstdint>
+
+//vertex buffer free rendering: the heightmap is drawn as a non-indexed triangle list of GridVertexIdCount vertices
+//and the MainVertexId entry point of Main.vs.hlsl derives every vertex from SV_VertexID and the depth texture.
+//the functions below emulate that shader on the cpu, so the mapping can be checked against HeightmapMeshBuilder.
+
+//six vertices per cell, no vertex is shared between triangles
+constexpr uint32_t GridVertexIdCount(uint32_t width, uint32_t height)
+{
+	return width < 2 || height < 2 ? 0 : (width - 1) * (height - 1) * 6;
+}
+
+//grid sample that SV_VertexID vertexId lands on. the cells are walked row by row and the corners of a cell follow
+//the index pattern of HeightmapMeshBuilder::Build, (tl, tr, bl) (bl, tr, br), so vertex i of the draw is
+//mesh.vertices[mesh.indices[i]] of the flat mesh
+constexpr void GridCoordFromVertexId(uint32_t vertexId, uint32_t width, uint32_t& x, uint32_t& y)
+{
+	constexpr uint32_t cornerX[6] = { 0, 1, 0, 0, 1, 1 };
+	constexpr uint32_t cornerY[6] = { 0, 0, 1, 1, 0, 1 };
+
+	uint32_t cell = vertexId / 6;
+	uint32_t corner = vertexId % 6;
+	x = cell % (width - 1) + cornerX[corner];
+	y = cell / (width - 1) + cornerY[corner];
+}
+
+//the shader reads the depth as unorm8 and rescales it with depthScale = 255 / max depth, see VertexIdDepthScale
+inline float VertexIdDepthScale(uint8_t maxDepth)
+{
+	return 255.0f / (maxDepth > 0 ? static_cast<float>(maxDepth) : 1.0f);
+}
+
+//wider maps are sampled from r16 unorm (textureRange 65535) or r32 float (textureRange 1) textures
+inline float VertexIdDepthScale(float maxDepth, float textureRange)
+{
+	return textureRange / (maxDepth > 0.0f ? maxDepth : 1.0f);
+}
+
+//cpu reference of MainVertexId, depthData is the same 8-bit map the texture was created from
+inline HeightmapVertex EmulateVertexIdVertex(uint32_t vertexId, const uint8_t* depthData, uint32_t width, uint32_t height,
+	float depthScale, HeightmapOrientation orientation)
+{
+	uint32_t x = 0;
+	uint32_t y = 0;
+	GridCoordFromVertexId(vertexId, width, x, y);
+
+	float depthValue = static_cast<float>(depthData[static_cast<size_t>(y) * width + x]) / 255.0f * depthScale;
+	return MakeHeightmapVertex(x, y, width, height, depthValue, orientation);
+}
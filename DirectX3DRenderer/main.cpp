@@ -7,7 +7,7 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	_In_ LPWSTR    lpCmdLine,
 	_In_ int       nCmdShow)
 {
-	Application app(hInstance, nCmdShow);
+	Application app(hInstance, nCmdShow, ParseRenderSettings(lpCmdLine));
 
 	try {
 		app.Run();